@@ -0,0 +1,235 @@
+//! Hot-path benchmarks over a synthetic full race (20 drivers × 300k samples).
+//!
+//!     cargo bench --features bench
+//!
+//! After the Criterion run, every benchmark's mean is checked against
+//! `benches/thresholds.json` and the process exits non-zero if any exceeds
+//! its budget. Set `BENCH_GATE=0` to skip the check (e.g. when profiling),
+//! `BENCH_QUICK=1` to use a 2-driver fixture while iterating on a bench.
+
+use criterion::{black_box, BenchmarkId, Criterion, Throughput};
+use f1_replay_lib::bench::*;
+use std::collections::BTreeMap;
+use std::path::{Path, PathBuf};
+use std::time::{Duration, Instant, SystemTime};
+
+const THRESHOLDS: &str = include_str!("thresholds.json");
+
+fn fixture() -> Fixture {
+    if std::env::var("BENCH_QUICK").is_ok_and(|v| v == "1") {
+        Fixture { drivers: 2, ..Fixture::FULL_RACE }
+    } else {
+        Fixture::FULL_RACE
+    }
+}
+
+fn scenario(base_driver: &str) -> SimulationScenario {
+    SimulationScenario {
+        event_name: EVENT_NAME.to_string(),
+        session: SESSION.to_string(),
+        base_driver: base_driver.to_string(),
+        swap_car_with: None,
+        swap_driver_inputs_with: None,
+        car_params: CarParams::default(),
+        env_params: EnvironmentParams::default(),
+        num_laps: None,
+    }
+}
+
+fn bench_load(c: &mut Criterion, fx: &Fixture) {
+    let dir = std::env::temp_dir().join(format!("f1-replay-bench-{}", std::process::id()));
+    std::fs::create_dir_all(&dir).expect("create bench dir");
+    let db = dir.join("fixture.duckdb");
+    let db = db.to_str().expect("utf-8 temp path");
+    write_fixture_db(db, fx).expect("write fixture db");
+
+    let options = LoadOptions { frame_cache_hz: None, snapshots: false, ..LoadOptions::default() };
+    let mut g = c.benchmark_group("load");
+    g.sample_size(10).measurement_time(Duration::from_secs(30));
+    g.throughput(Throughput::Elements((fx.drivers * fx.samples_per_driver) as u64));
+    g.bench_function("load_session", |b| {
+        b.iter(|| load_session(db, EVENT_NAME, SESSION, &options).expect("load fixture"))
+    });
+    g.finish();
+    let _ = std::fs::remove_dir_all(&dir);
+}
+
+fn bench_spline(c: &mut Criterion, session: &SessionData) {
+    let s = &session.drivers[0].samples;
+    let xs: Vec<f64> = s.xs.iter().map(|&v| v as f64).collect();
+    let spline = Spline::new(&s.times, &xs);
+    let t_end = session.duration_s;
+    let queries: Vec<f64> = (0..100_000).map(|i| (i as f64 * 7_919.0) % t_end).collect();
+
+    let mut g = c.benchmark_group("spline");
+    g.throughput(Throughput::Elements(s.times.len() as u64));
+    g.bench_function("new", |b| b.iter(|| Spline::new(black_box(&s.times), black_box(&xs))));
+    g.throughput(Throughput::Elements(queries.len() as u64));
+    g.bench_function("eval_random", |b| {
+        b.iter(|| queries.iter().map(|&t| spline.eval(t)).sum::<f64>())
+    });
+    g.finish();
+}
+
+fn bench_frames(c: &mut Criterion, session: &SessionData, cached: &SessionData) {
+    // One minute of playback at 60 fps
+    let times: Vec<f64> = (0..3_600).map(|i| 1_800.0 + i as f64 / 60.0).collect();
+    let mut g = c.benchmark_group("frames");
+    g.throughput(Throughput::Elements(times.len() as u64));
+    for (name, s) in [("spline", session), ("frame_cache", cached)] {
+        let mut frame = FrameData::default();
+        g.bench_with_input(BenchmarkId::new("get_frame_at_sweep", name), s, |b, s| {
+            b.iter(|| {
+                times
+                    .iter()
+                    .map(|&t| {
+                        get_frame_into(s, t, &mut frame);
+                        frame.drivers.len()
+                    })
+                    .sum::<usize>()
+            })
+        });
+    }
+    g.finish();
+}
+
+fn bench_export(c: &mut Criterion, cached: &SessionData) {
+    let hz = 2.0;
+    let mut g = c.benchmark_group("frames");
+    g.sample_size(20);
+    g.throughput(Throughput::Elements((cached.duration_s * hz) as u64));
+    g.bench_function("export_bundle", |b| b.iter(|| encode_bundle(black_box(cached), hz).unwrap().len()));
+    g.finish();
+}
+
+fn bench_analysis(c: &mut Criterion, session: &SessionData) {
+    let samples = (session.drivers.len() * session.drivers[0].samples.len()) as u64;
+    let mut g = c.benchmark_group("analysis");
+    g.sample_size(20);
+    g.throughput(Throughput::Elements(samples));
+    g.bench_function("compute_heatmap", |b| {
+        b.iter(|| compute_filtered(&session.drivers, &HeatmapFilter::default()))
+    });
+    g.bench_function("analyze_race", |b| b.iter(|| analyze_race(session)));
+
+    let (a, d) = (&session.drivers[0], &session.drivers[1]);
+    g.throughput(Throughput::Elements(2));
+    g.bench_function("compare_laps_warm", |b| b.iter(|| compare_laps(a, d).expect("compare")));
+    g.throughput(Throughput::Elements(a.samples.len() as u64));
+    g.bench_function("fit_cda", |b| b.iter(|| fit_cda(a)));
+    g.finish();
+
+    let mut g = c.benchmark_group("simulation");
+    let sc = scenario(&a.driver_number);
+    g.throughput(Throughput::Elements(a.laps.len() as u64));
+    g.bench_function("run_simulation", |b| b.iter(|| run_simulation(session, &sc).expect("simulate")));
+
+    // One point-mass lap of the fixture's ~21 km ellipse (~2k grid points)
+    let track = track_index(session).profile().expect("fixture has a reference line");
+    let car = PointMass::baseline(1.1, 1.8);
+    g.throughput(Throughput::Elements(1));
+    g.bench_function("lap_sim", |b| b.iter(|| simulate_lap(track, black_box(&car))));
+    g.finish();
+}
+
+/// `compare_laps` including the fastest-lap extraction it memoises on
+/// first use: the memo is dropped before every timed call.
+fn bench_compare_cold(c: &mut Criterion, session: &mut SessionData) {
+    let mut g = c.benchmark_group("analysis");
+    g.sample_size(20);
+    g.throughput(Throughput::Elements(2));
+    g.bench_function("compare_laps_cold", |b| {
+        b.iter_custom(|iters| {
+            let mut total = Duration::ZERO;
+            for _ in 0..iters {
+                for driver in &mut session.drivers[..2] {
+                    driver.fastest_lap.take();
+                }
+                let start = Instant::now();
+                black_box(compare_laps(&session.drivers[0], &session.drivers[1]).expect("compare"));
+                total += start.elapsed();
+            }
+            total
+        })
+    });
+    g.finish();
+}
+
+// ── Regression gate ──────────────────────────────────────────────────────────
+
+fn criterion_dir() -> PathBuf {
+    if let Some(home) = std::env::var_os("CRITERION_HOME") {
+        return home.into();
+    }
+    let target = std::env::var_os("CARGO_TARGET_DIR")
+        .map(PathBuf::from)
+        .unwrap_or_else(|| Path::new(env!("CARGO_MANIFEST_DIR")).join("target"));
+    target.join("criterion")
+}
+
+/// Mean in nanoseconds from Criterion's `estimates.json`, if this process
+/// wrote it (at or after `since`); older files are a previous run's numbers.
+fn measured_mean_ns(dir: &Path, id: &str, since: SystemTime) -> Result<f64, String> {
+    let path = dir.join(id).join("new").join("estimates.json");
+    let modified = std::fs::metadata(&path).and_then(|m| m.modified()).map_err(|e| format!("{}: {e}", path.display()))?;
+    if modified < since {
+        return Err("not run this time".to_string());
+    }
+    let text = std::fs::read_to_string(&path).map_err(|e| format!("{}: {e}", path.display()))?;
+    let json: serde_json::Value = serde_json::from_str(&text).map_err(|e| format!("{}: {e}", path.display()))?;
+    json["mean"]["point_estimate"]
+        .as_f64()
+        .ok_or_else(|| format!("{}: no mean.point_estimate", path.display()))
+}
+
+/// Compare every budgeted benchmark run since `started` with its threshold
+/// (milliseconds).
+fn check_thresholds(started: SystemTime) -> Result<(), Vec<String>> {
+    let budgets: BTreeMap<String, f64> = serde_json::from_str(THRESHOLDS).expect("thresholds.json is valid");
+    let dir = criterion_dir();
+    let mut failures = Vec::new();
+    println!("\n{:<42} {:>12} {:>12}", "benchmark", "mean ms", "budget ms");
+    for (id, budget_ms) in &budgets {
+        match measured_mean_ns(&dir, id, started) {
+            Ok(ns) => {
+                let ms = ns / 1e6;
+                let verdict = if ms > *budget_ms { "  REGRESSED" } else { "" };
+                println!("{id:<42} {ms:>12.3} {budget_ms:>12.3}{verdict}");
+                if ms > *budget_ms {
+                    failures.push(format!("{id}: {ms:.3} ms exceeds budget of {budget_ms:.3} ms"));
+                }
+            }
+            // A filtered run (`cargo bench -- frames`) skips the other ids; their
+            // estimates on disk are from an earlier run and are not gated
+            Err(e) => println!("{id:<42} {:>12} {budget_ms:>12.3}  ({e})", "-"),
+        }
+    }
+    if failures.is_empty() { Ok(()) } else { Err(failures) }
+}
+
+fn main() {
+    let started = SystemTime::now();
+    let mut c = Criterion::default().configure_from_args();
+    let fx = fixture();
+    let mut session = synthetic_session(&fx, None);
+    let cached = synthetic_session(&fx, Some(LoadOptions::default().frame_cache_hz.unwrap_or(10.0)));
+
+    bench_load(&mut c, &fx);
+    bench_spline(&mut c, &session);
+    bench_frames(&mut c, &session, &cached);
+    bench_export(&mut c, &cached);
+    bench_compare_cold(&mut c, &mut session);
+    bench_analysis(&mut c, &session);
+    c.final_summary();
+
+    if std::env::var("BENCH_GATE").is_ok_and(|v| v == "0") || fx.drivers != Fixture::FULL_RACE.drivers {
+        return;
+    }
+    if let Err(failures) = check_thresholds(started) {
+        eprintln!("\nPerformance regression:");
+        for f in &failures {
+            eprintln!("  {f}");
+        }
+        std::process::exit(1);
+    }
+}
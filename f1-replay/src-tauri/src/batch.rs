@@ -0,0 +1,211 @@
+//! Headless batch runner behind the `sim_cli` binary.
+//!
+//! ```text
+//! sim_cli --db f1.duckdb --scenarios sweep.jsonl --out sweep.f1rlog [--threads N] [--no-snapshots] [--append]
+//! ```
+//!
+//! Scenarios are a JSON array or one JSON object per line, in the same shape
+//! the app sends to `run_simulation` (`carParams` / `envParams` may be left
+//! out for the defaults). Each distinct (event, session) is loaded once, as
+//! the app would load it minus the frame cache, and its scenarios are then
+//! run in chunks on the rayon pool. Every finished chunk is appended to the
+//! replay log as one block, so an interrupted batch keeps what it finished.
+//! A session that fails to load records its load error as a failed run for
+//! each of its scenarios; the rest of the batch carries on.
+//!
+//! `--out` is replaced unless `--append` is given, in which case the new
+//! blocks follow whatever an earlier batch left there.
+
+use crate::replay_log::{ReplayLogWriter, RunRecord};
+use crate::session::{load_session, LoadOptions};
+use crate::simulation::{run_simulation, SimulationScenario};
+use parking_lot::Mutex;
+use rayon::prelude::*;
+use std::collections::BTreeMap;
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::time::Instant;
+
+/// Scenarios per replay-log block (and per unit of work on the pool).
+const CHUNK: usize = 32;
+
+const USAGE: &str =
+    "usage: sim_cli --db <f1.duckdb> --scenarios <file.json|file.jsonl> --out <file.f1rlog> [--threads N] [--no-snapshots] [--append]";
+
+#[derive(Debug, PartialEq)]
+pub struct BatchOptions {
+    pub db_path: String,
+    pub scenarios_path: PathBuf,
+    pub out_path: PathBuf,
+    /// Worker threads (None = one per core)
+    pub threads: Option<usize>,
+    pub snapshots: bool,
+    /// Append to an existing `out_path` instead of replacing it
+    pub append: bool,
+}
+
+#[derive(Debug)]
+pub struct BatchSummary {
+    pub scenarios: usize,
+    pub failed: usize,
+    pub sessions: usize,
+    pub elapsed_s: f64,
+}
+
+pub fn parse_args(args: &[String]) -> Result<BatchOptions, String> {
+    let (mut db, mut scenarios, mut out, mut threads, mut snapshots, mut append) = (None, None, None, None, true, false);
+    let mut it = args.iter();
+    while let Some(arg) = it.next() {
+        let mut value = || it.next().cloned().ok_or_else(|| format!("{arg} needs a value\n{USAGE}"));
+        match arg.as_str() {
+            "--db" => db = Some(value()?),
+            "--scenarios" => scenarios = Some(PathBuf::from(value()?)),
+            "--out" => out = Some(PathBuf::from(value()?)),
+            "--threads" => {
+                let v = value()?;
+                threads = Some(v.parse().ok().filter(|&n| n > 0).ok_or_else(|| format!("Bad --threads value: {v}"))?);
+            }
+            "--no-snapshots" => snapshots = false,
+            "--append" => append = true,
+            "-h" | "--help" => return Err(USAGE.to_string()),
+            other => return Err(format!("Unknown argument: {other}\n{USAGE}")),
+        }
+    }
+    let missing = |name: &str| format!("Missing {name}\n{USAGE}");
+    Ok(BatchOptions {
+        db_path: db.ok_or_else(|| missing("--db"))?,
+        scenarios_path: scenarios.ok_or_else(|| missing("--scenarios"))?,
+        out_path: out.ok_or_else(|| missing("--out"))?,
+        threads,
+        snapshots,
+        append,
+    })
+}
+
+/// Parse a JSON array of scenarios, or JSON lines (blank lines and lines
+/// starting with `//` are skipped).
+pub fn parse_scenarios(text: &str) -> Result<Vec<SimulationScenario>, String> {
+    if text.trim_start().starts_with('[') {
+        return serde_json::from_str(text).map_err(|e| format!("Bad scenario array: {e}"));
+    }
+    text.lines()
+        .enumerate()
+        .filter(|(_, line)| !line.trim().is_empty() && !line.trim_start().starts_with("//"))
+        .map(|(i, line)| serde_json::from_str(line).map_err(|e| format!("Bad scenario on line {}: {e}", i + 1)))
+        .collect()
+}
+
+pub fn load_scenarios(path: &Path) -> Result<Vec<SimulationScenario>, String> {
+    let text = std::fs::read_to_string(path).map_err(|e| format!("Failed to read {}: {e}", path.display()))?;
+    parse_scenarios(&text)
+}
+
+pub fn run_batch(opts: &BatchOptions) -> Result<BatchSummary, String> {
+    let started = Instant::now();
+    if let Some(n) = opts.threads {
+        rayon::ThreadPoolBuilder::new()
+            .num_threads(n)
+            .build_global()
+            .map_err(|e| format!("Failed to start {n} worker threads: {e}"))?;
+    }
+    let scenarios = load_scenarios(&opts.scenarios_path)?;
+
+    // Scenario indices per session, in first-seen order within each
+    let mut by_session: BTreeMap<(&str, &str), Vec<u32>> = BTreeMap::new();
+    for (i, sc) in scenarios.iter().enumerate() {
+        by_session.entry((sc.event_name.as_str(), sc.session.as_str())).or_default().push(i as u32);
+    }
+
+    let writer = if opts.append { ReplayLogWriter::open(&opts.out_path)? } else { ReplayLogWriter::create(&opts.out_path)? };
+    let writer = Mutex::new(writer);
+    let options = LoadOptions { frame_cache_hz: None, snapshots: opts.snapshots, ..LoadOptions::default() };
+    let (done, failed) = (AtomicUsize::new(0), AtomicUsize::new(0));
+
+    for ((event, session), indices) in &by_session {
+        let loaded = Instant::now();
+        let data = match load_session(&opts.db_path, event, session, &options) {
+            Ok(data) => data,
+            Err(e) => {
+                let error = format!("Failed to load {event} {session}: {e}");
+                eprintln!("{error}");
+                for chunk in indices.chunks(CHUNK) {
+                    let runs: Vec<RunRecord> =
+                        chunk.iter().map(|&i| RunRecord { scenario_index: i, outcome: Err(error.as_str()) }).collect();
+                    writer.lock().append(&runs)?;
+                }
+                failed.fetch_add(indices.len(), Ordering::Relaxed);
+                done.fetch_add(indices.len(), Ordering::Relaxed);
+                continue;
+            }
+        };
+        eprintln!("Loaded {event} {session} in {:.1}s, {} scenarios", loaded.elapsed().as_secs_f64(), indices.len());
+
+        indices.par_chunks(CHUNK).try_for_each(|chunk| -> Result<(), String> {
+            let outcomes: Vec<Result<_, String>> =
+                chunk.iter().map(|&i| run_simulation(&data, &scenarios[i as usize])).collect();
+            let runs: Vec<RunRecord> = chunk
+                .iter()
+                .zip(&outcomes)
+                .map(|(&i, o)| RunRecord { scenario_index: i, outcome: o.as_ref().map_err(String::as_str) })
+                .collect();
+            writer.lock().append(&runs)?;
+
+            failed.fetch_add(outcomes.iter().filter(|o| o.is_err()).count(), Ordering::Relaxed);
+            let n = done.fetch_add(chunk.len(), Ordering::Relaxed) + chunk.len();
+            eprintln!("{n}/{} scenarios", scenarios.len());
+            Ok(())
+        })?;
+    }
+    writer.lock().sync()?;
+
+    Ok(BatchSummary {
+        scenarios: scenarios.len(),
+        failed: failed.into_inner(),
+        sessions: by_session.len(),
+        elapsed_s: started.elapsed().as_secs_f64(),
+    })
+}
+
+/// `sim_cli` entry point; `args` excludes the program name.
+pub fn main(args: &[String]) -> Result<(), String> {
+    let opts = parse_args(args)?;
+    let summary = run_batch(&opts)?;
+    eprintln!(
+        "{} scenarios over {} sessions in {:.1}s ({} failed) -> {}",
+        summary.scenarios,
+        summary.sessions,
+        summary.elapsed_s,
+        summary.failed,
+        opts.out_path.display()
+    );
+    Ok(())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_parse_scenarios_and_args() {
+        let line = r#"{"eventName":"Bahrain Grand Prix","session":"R","baseDriver":"1","carParams":{"enginePowerFactor":1.05,"aeroDownforceFactor":1.0,"aeroDragFactor":1.0,"tyreCompound":"SOFT","tyreWearRate":1.0,"fuelLoadKg":95.0}}"#;
+        let jsonl = format!("// power sweep\n{line}\n\n{}\n", r#"{"eventName":"Bahrain Grand Prix","session":"Q","baseDriver":"16","numLaps":3}"#);
+        let parsed = parse_scenarios(&jsonl).unwrap();
+        assert_eq!(parsed.len(), 2);
+        assert_eq!(parsed[0].car_params.engine_power_factor, 1.05);
+        assert_eq!((parsed[1].num_laps, parsed[1].car_params.fuel_load_kg), (Some(3), 95.0));
+
+        let array = parse_scenarios(&format!("[{line}]")).unwrap();
+        assert_eq!(array[0].base_driver, "1");
+        assert!(parse_scenarios("{\"session\":\"R\"}").unwrap_err().contains("line 1"));
+
+        let args: Vec<String> =
+            "--db f1.duckdb --scenarios s.jsonl --out o.f1rlog --threads 8".split(' ').map(String::from).collect();
+        let opts = parse_args(&args).unwrap();
+        assert_eq!((opts.threads, opts.snapshots, opts.append, opts.db_path.as_str()), (Some(8), true, false, "f1.duckdb"));
+        let mut more = args.clone();
+        more.push("--append".to_string());
+        assert!(parse_args(&more).unwrap().append);
+        assert!(parse_args(&args[..4]).unwrap_err().starts_with("Missing --out"));
+        assert!(parse_args(&["--threads".to_string(), "0".to_string()]).is_err());
+    }
+}
@@ -0,0 +1,213 @@
+//! Synthetic race fixtures and the entry points `benches/replay.rs` times.
+//! Only compiled with `--features bench`; nothing here is part of the app.
+//!
+//! Every driver laps the same ellipse with a speed profile that brakes into
+//! four corners, so the fixture exercises the same shapes as a real race
+//! (braking zones, DRS on the straights, a pit stop) while staying fully
+//! deterministic and independent of any recorded data.
+
+pub use crate::frame_cache::FrameCache;
+pub use crate::heatmap::compute_filtered;
+pub use crate::interpolate::Spline;
+pub use crate::lap_index::track_index;
+pub use crate::lap_sim::{simulate as simulate_lap, PointMass};
+pub use crate::race_analysis::analyze_race;
+pub use crate::replay_export::encode_bundle;
+pub use crate::session::{get_frame_into, load_session, DriverData, LoadOptions, SessionData};
+pub use crate::simulation::{run_simulation, CarParams, EnvironmentParams, SimulationScenario};
+pub use crate::telemetry_analysis::{compare_laps, fit_cda};
+pub use crate::types::{FrameData, HeatmapFilter};
+
+use crate::session::{LapRecord, SampleColumns};
+use crate::telemetry_lod::TelemetryLod;
+use crate::types::{Compound, TrackLayout};
+use duckdb::Connection;
+use std::f64::consts::TAU;
+use std::sync::atomic::AtomicUsize;
+use std::sync::OnceLock;
+
+pub const EVENT_NAME: &str = "Synthetic Grand Prix";
+pub const SESSION: &str = "R";
+
+/// Shape of a synthetic race.
+#[derive(Debug, Clone, Copy)]
+pub struct Fixture {
+    pub drivers: usize,
+    pub samples_per_driver: usize,
+    pub laps: u32,
+}
+
+impl Fixture {
+    /// A full race: 20 drivers, ~300k samples each, 57 laps.
+    pub const FULL_RACE: Fixture = Fixture { drivers: 20, samples_per_driver: 300_000, laps: 57 };
+
+    fn lap_time(&self, driver: usize) -> f64 {
+        92.0 + driver as f64 * 0.15
+    }
+
+    pub fn duration_s(&self) -> f64 {
+        self.lap_time(self.drivers.saturating_sub(1)) * self.laps as f64
+    }
+
+    pub fn driver_number(&self, driver: usize) -> String {
+        (driver + 1).to_string()
+    }
+
+    /// Lap the driver pits at the end of: spread across the field.
+    fn pit_lap(&self, driver: usize) -> u32 {
+        (self.laps / 3 + (driver as u32 % 7)).min(self.laps.saturating_sub(1))
+    }
+}
+
+/// One telemetry sample at `t` seconds for `driver`.
+struct Sample {
+    x: f64,
+    y: f64,
+    speed: f64,
+    throttle: f64,
+    brake: f64,
+    gear: u8,
+    drs: u8,
+}
+
+fn sample(fx: &Fixture, driver: usize, t: f64) -> Sample {
+    let phase = (t / fx.lap_time(driver)).fract();
+    let angle = phase * TAU;
+    // Four corners per lap; the car brakes through the first part of each
+    let corner = (phase * 4.0).fract();
+    let braking = corner < 0.12;
+    let speed = if braking { 120.0 + corner / 0.12 * 60.0 } else { 180.0 + (corner - 0.12) * 180.0 };
+    Sample {
+        x: 4_000.0 * angle.cos() + driver as f64 * 3.0,
+        y: 2_500.0 * angle.sin(),
+        speed,
+        throttle: if braking { 0.0 } else { 1.0 },
+        brake: if braking { 1.0 } else { 0.0 },
+        gear: (speed / 45.0).clamp(1.0, 8.0) as u8,
+        drs: if !braking && corner > 0.6 { 12 } else { 0 },
+    }
+}
+
+fn laps(fx: &Fixture, driver: usize) -> Vec<LapRecord> {
+    let pit = fx.pit_lap(driver);
+    (1..=fx.laps)
+        .map(|lap| LapRecord {
+            lap_number: lap,
+            lap_start_time_s: (lap - 1) as f64 * fx.lap_time(driver),
+            position: (driver + 1).min(20) as u8,
+            compound: if lap <= pit { Compound::Medium } else { Compound::Hard },
+            tyre_life: if lap <= pit { lap } else { lap - pit }.min(255) as u8,
+        })
+        .collect()
+}
+
+/// Build a session in memory, as `load_session` would after its queries.
+pub fn synthetic_session(fx: &Fixture, frame_cache_hz: Option<f64>) -> SessionData {
+    let duration_s = fx.duration_s();
+    let dt = duration_s / fx.samples_per_driver as f64;
+    let drivers: Vec<DriverData> = (0..fx.drivers)
+        .map(|d| {
+            let mut s = SampleColumns::default();
+            for i in 0..fx.samples_per_driver {
+                let t = i as f64 * dt;
+                let p = sample(fx, d, t);
+                s.times.push(t);
+                s.xs.push(p.x as f32);
+                s.ys.push(p.y as f32);
+                s.speeds.push(p.speed as f32);
+                s.throttles.push(p.throttle as f32);
+                s.brakes.push(p.brake as f32);
+                s.gears.push(p.gear);
+                s.drs.push(p.drs);
+            }
+            let xs: Vec<f64> = s.xs.iter().map(|&v| v as f64).collect();
+            let ys: Vec<f64> = s.ys.iter().map(|&v| v as f64).collect();
+            DriverData {
+                driver_number: fx.driver_number(d),
+                abbreviation: format!("D{:02}", d + 1),
+                team: String::new(),
+                spline_x: Spline::new(&s.times, &xs),
+                spline_y: Spline::new(&s.times, &ys),
+                lod: TelemetryLod::build(&s),
+                samples: s,
+                laps: laps(fx, d),
+                playback_segment: AtomicUsize::new(0),
+                fastest_lap: OnceLock::new(),
+                lap_index: OnceLock::new(),
+                lap_calibration: OnceLock::new(),
+            }
+        })
+        .collect();
+
+    let frame_cache = frame_cache_hz.map(|hz| FrameCache::build(&drivers, duration_s, hz));
+    SessionData {
+        event_name: EVENT_NAME.to_string(),
+        session: SESSION.to_string(),
+        duration_s,
+        heatmap: compute_filtered(&drivers, &HeatmapFilter::default()),
+        drivers,
+        track_layout: TrackLayout {
+            center_line: Vec::new(),
+            x_min: -4_000.0, x_max: 4_060.0, y_min: -2_500.0, y_max: 2_500.0,
+            duration_s, lap_distance_m: 5_000.0,
+        },
+        frame_cache,
+        race_analysis: OnceLock::new(),
+        track_index: OnceLock::new(),
+    }
+}
+
+/// Write the fixture's tables to a DuckDB file, generated inside DuckDB so
+/// building a full race takes seconds. The formulas mirror `sample`.
+pub fn write_fixture_db(path: &str, fx: &Fixture) -> Result<(), String> {
+    let _ = std::fs::remove_file(path);
+    let conn = Connection::open(path).map_err(|e| format!("Failed to open DuckDB: {e}"))?;
+    let sql = format!(
+        "
+        CREATE TABLE samples AS
+        SELECT d.d AS driver, i.i * {dt} AS t, 92.0 + d.d * 0.15 AS lap_time
+        FROM range({drivers}) d(d), range({n}) i(i);
+
+        CREATE TABLE position_telemetry AS
+        SELECT '{event}' AS EventName, '{session}' AS Session, CAST(driver + 1 AS VARCHAR) AS DriverNumber,
+               t AS SessionTime,
+               4000.0 * cos(2 * pi() * (t / lap_time - floor(t / lap_time))) + driver * 3.0 AS X,
+               2500.0 * sin(2 * pi() * (t / lap_time - floor(t / lap_time))) AS Y
+        FROM samples;
+
+        CREATE TABLE car_telemetry AS
+        WITH c AS (
+            SELECT driver, t, (4 * (t / lap_time - floor(t / lap_time))) % 1.0 AS corner FROM samples
+        )
+        SELECT '{event}' AS EventName, '{session}' AS Session, CAST(driver + 1 AS VARCHAR) AS DriverNumber,
+               t AS SessionTime,
+               CASE WHEN corner < 0.12 THEN 120.0 + corner / 0.12 * 60.0 ELSE 180.0 + (corner - 0.12) * 180.0 END AS Speed,
+               CASE WHEN corner < 0.12 THEN 0.0 ELSE 1.0 END AS Throttle,
+               corner < 0.12 AS Brake,
+               CAST(least(8, greatest(1, floor(
+                   CASE WHEN corner < 0.12 THEN 120.0 + corner / 0.12 * 60.0 ELSE 180.0 + (corner - 0.12) * 180.0 END
+                   / 45.0))) AS INTEGER) AS nGear,
+               CASE WHEN corner > 0.6 THEN 12 ELSE 0 END AS DRS
+        FROM c;
+
+        CREATE TABLE laps AS
+        SELECT '{event}' AS EventName, '{session}' AS Session, CAST(d.d + 1 AS VARCHAR) AS DriverNumber,
+               'Driver ' || (d.d + 1) AS Driver, '' AS Team,
+               l.l AS LapNumber, (l.l - 1) * (92.0 + d.d * 0.15) AS LapStartTime,
+               least(d.d + 1, 20) AS Position,
+               CASE WHEN l.l <= {pit_base} + d.d % 7 THEN 'MEDIUM' ELSE 'HARD' END AS Compound,
+               CASE WHEN l.l <= {pit_base} + d.d % 7 THEN l.l ELSE l.l - ({pit_base} + d.d % 7) END AS TyreLife
+        FROM range({drivers}) d(d), range(1, {laps_end}) l(l);
+
+        DROP TABLE samples;
+        ",
+        dt = fx.duration_s() / fx.samples_per_driver as f64,
+        drivers = fx.drivers,
+        n = fx.samples_per_driver,
+        event = EVENT_NAME,
+        session = SESSION,
+        pit_base = fx.laps / 3,
+        laps_end = fx.laps + 1,
+    );
+    conn.execute_batch(&sql).map_err(|e| format!("Failed to write fixture: {e}"))
+}
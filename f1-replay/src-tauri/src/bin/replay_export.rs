@@ -0,0 +1,9 @@
+//! Replay bundle exporter: see `f1_replay_lib::replay_export`.
+
+fn main() {
+    let args: Vec<String> = std::env::args().skip(1).collect();
+    if let Err(e) = f1_replay_lib::replay_export::main(&args) {
+        eprintln!("{e}");
+        std::process::exit(1);
+    }
+}
@@ -0,0 +1,9 @@
+//! Headless batch runner: see `f1_replay_lib::batch`.
+
+fn main() {
+    let args: Vec<String> = std::env::args().skip(1).collect();
+    if let Err(e) = f1_replay_lib::batch::main(&args) {
+        eprintln!("{e}");
+        std::process::exit(1);
+    }
+}
@@ -1,39 +1,68 @@
+use crate::frame_wire;
+use crate::heatmap;
+use crate::lap_index;
+use crate::live::{LiveChunk, LiveSession, LiveStatus};
+use crate::monte_carlo::{self, MonteCarloConfig, MonteCarloResult};
+use crate::perf::{self, PerfStats};
 use crate::race_analysis;
-use crate::session::{get_frame_at, load_session, AppState};
-use crate::simulation::{self, SimulationResult, SimulationScenario};
+use crate::replay_export::{self, ExportSummary};
+use crate::replay_log::{LoggedRun, ReplayLogSummary};
+use crate::session::{get_frame_into, load_session, AppState, SessionData};
+use crate::session_cache::{prefetch_candidates, session_key, SessionKey, PREFETCH_COUNT};
+use crate::simulation::{self, SimulationResult, SimulationScenario, SweepRequest, SweepResult};
 use crate::telemetry_analysis;
+use crate::telemetry_lod::telemetry_window;
 use crate::types::*;
 use duckdb::Connection;
-use parking_lot::Mutex;
+use std::path::Path;
 use std::sync::Arc;
+use std::time::{Duration, Instant};
+use tauri::ipc::{Channel, InvokeResponseBody, Response};
 use tauri::State;
 
-pub type AppStateHandle = Arc<Mutex<AppState>>;
+pub type AppStateHandle = Arc<AppState>;
+
+/// Run `f` on a snapshot of the current session on the blocking pool, so
+/// heavy analyses don't occupy an async worker while playback polls frames.
+async fn with_session_blocking<T, F>(state: &AppState, f: F) -> Result<T, String>
+where
+    T: Send + 'static,
+    F: FnOnce(&SessionData) -> Result<T, String> + Send + 'static,
+{
+    let session = state.session()?;
+    tokio::task::spawn_blocking(move || f(&session))
+        .await
+        .map_err(|e| format!("Task error: {e}"))?
+}
 
 // ── get_sessions ─────────────────────────────────────────────────────────────
 
 #[tauri::command]
+#[tracing::instrument(skip_all)]
 pub async fn get_sessions(state: State<'_, AppStateHandle>) -> Result<Vec<SessionInfo>, String> {
-    let db_path = state.lock().db_path.clone();
+    let db_path = state.db_path.clone();
 
     tokio::task::spawn_blocking(move || {
         let conn = Connection::open(&db_path).map_err(|e| format!("Failed to open DuckDB: {e}"))?;
-
-        // Try the sessions table first
-        let primary_result = query_sessions_table(&conn);
-
-        match primary_result {
-            Ok(sessions) if !sessions.is_empty() => Ok(sessions),
-            _ => {
-                // Fall back: derive sessions from laps or position_telemetry
-                query_sessions_fallback(&conn)
-            }
-        }
+        list_sessions(&conn)
     })
     .await
     .map_err(|e| format!("Task error: {e}"))?
 }
 
+fn list_sessions(conn: &Connection) -> Result<Vec<SessionInfo>, String> {
+    // Try the sessions table first
+    let primary_result = query_sessions_table(conn);
+
+    match primary_result {
+        Ok(sessions) if !sessions.is_empty() => Ok(sessions),
+        _ => {
+            // Fall back: derive sessions from laps or position_telemetry
+            query_sessions_fallback(conn)
+        }
+    }
+}
+
 fn query_sessions_table(conn: &Connection) -> Result<Vec<SessionInfo>, String> {
     let mut stmt = conn
         .prepare(
@@ -124,207 +153,455 @@ fn query_sessions_fallback(conn: &Connection) -> Result<Vec<SessionInfo>, String
 // ── load_session_cmd ─────────────────────────────────────────────────────────
 
 #[tauri::command]
+#[tracing::instrument(skip_all)]
 pub async fn load_session_cmd(
     event_name: String,
     session: String,
     state: State<'_, AppStateHandle>,
 ) -> Result<TrackLayout, String> {
-    let db_path = state.lock().db_path.clone();
-
-    let session_data =
-        tokio::task::spawn_blocking(move || load_session(&db_path, &event_name, &session))
-            .await
-            .map_err(|e| format!("Task join error: {e}"))??;
+    let key = session_key(&event_name, &session);
+    let cached = state.lock_cache().get(&key);
+
+    let session_data = match cached {
+        Some(data) => data,
+        None => {
+            // Joins a prefetch of the same session rather than racing it
+            let handle = state.inner().clone();
+            let load_key = key.clone();
+            tokio::task::spawn_blocking(move || handle.load_cached(&load_key))
+                .await
+                .map_err(|e| format!("Task join error: {e}"))??
+        }
+    };
 
     let layout = session_data.track_layout.clone();
-    state.lock().session = Some(session_data);
+    state.publish_session(session_data);
+    spawn_prefetch(state.inner().clone(), key);
     Ok(layout)
 }
 
+/// Load the sessions next to `key` (same event first) into the cache in the
+/// background, one at a time. Failures are dropped; the session will simply
+/// load on demand instead.
+fn spawn_prefetch(state: AppStateHandle, key: SessionKey) {
+    tokio::task::spawn_blocking(move || {
+        let Ok(conn) = Connection::open(&state.db_path) else {
+            return;
+        };
+        let Ok(sessions) = list_sessions(&conn) else {
+            return;
+        };
+        drop(conn);
+
+        for next in prefetch_candidates(&sessions, &key, PREFETCH_COUNT) {
+            if !state.lock_cache().begin_load(&next) {
+                continue;
+            }
+            let loaded = load_session(&state.db_path, &next.0, &next.1, &state.load_options);
+            let mut cache = state.lock_cache();
+            if let Ok(data) = loaded {
+                cache.insert_prefetched(next.clone(), Arc::new(data));
+            }
+            state.end_cache_load(&mut cache, &next);
+        }
+    });
+}
+
 // ── get_speed_heatmap ─────────────────────────────────────────────────────────
 
 #[tauri::command]
+#[tracing::instrument(skip_all)]
 pub async fn get_speed_heatmap(state: State<'_, AppStateHandle>) -> Result<Vec<HeatCell>, String> {
-    let heatmap = state
-        .lock()
-        .session
-        .as_ref()
-        .ok_or_else(|| "No session loaded".to_string())?
-        .heatmap
-        .clone();
-    Ok(heatmap)
+    if let Some(live) = state.live().as_ref() {
+        return Ok(live.heatmap());
+    }
+    Ok(state.session()?.heatmap.clone())
+}
+
+// ── get_heatmap ───────────────────────────────────────────────────────────────
+
+/// Heatmap over a subset of drivers and laps, for any channel. Binned on
+/// demand; the unfiltered speed heatmap is precomputed at load.
+#[tauri::command]
+#[tracing::instrument(skip_all)]
+pub async fn get_heatmap(filter: HeatmapFilter, state: State<'_, AppStateHandle>) -> Result<Vec<HeatCell>, String> {
+    with_session_blocking(&state, move |session| Ok(heatmap::compute_filtered(&session.drivers, &filter))).await
 }
 
 // ── get_frame ─────────────────────────────────────────────────────────────────
 
 #[tauri::command]
+#[tracing::instrument(skip_all)]
 pub async fn get_frame(time_s: f64, state: State<'_, AppStateHandle>) -> Result<FrameData, String> {
-    let locked = state.lock();
-    let session = locked
-        .session
-        .as_ref()
-        .ok_or_else(|| "No session loaded".to_string())?;
-    Ok(get_frame_at(session, time_s))
+    let mut frame = FrameData::default();
+    current_frame(&state, time_s, &mut frame)?;
+    Ok(frame)
+}
+
+/// Frame from the live session while one is streaming in, else from the
+/// loaded session.
+fn current_frame(state: &AppState, time_s: f64, out: &mut FrameData) -> Result<(), String> {
+    if let Some(live) = state.live().as_ref() {
+        live.frame_into(time_s, out);
+        return Ok(());
+    }
+    let session = state.session()?;
+    get_frame_into(&session, time_s, out);
+    Ok(())
+}
+
+// ── get_frame_packed ──────────────────────────────────────────────────────────
+
+/// Same frame as `get_frame`, encoded with `frame_wire` and returned as raw bytes.
+#[tauri::command]
+#[tracing::instrument(skip_all)]
+pub async fn get_frame_packed(time_s: f64, state: State<'_, AppStateHandle>) -> Result<Response, String> {
+    let mut frame = FrameData::default();
+    current_frame(&state, time_s, &mut frame)?;
+    let mut buf = Vec::new();
+    tracing::info_span!("frame_wire.encode").in_scope(|| frame_wire::encode_frame(&frame, &mut buf));
+    Ok(Response::new(buf))
+}
+
+// ── stream_frames / stop_frame_stream ────────────────────────────────────────
+
+const STREAM_DEFAULT_FPS: f64 = 60.0;
+
+/// Push packed frames over `on_frame` from `start_s`, advancing session time at
+/// `speed` × wall clock, until the session ends or another stream starts or
+/// `stop_frame_stream` is called. Returns immediately. Over a live session
+/// the stream holds at the live edge until the session is finished.
+#[tauri::command]
+#[tracing::instrument(skip_all)]
+pub async fn stream_frames(
+    start_s: f64,
+    speed: f64,
+    fps: Option<f64>,
+    on_frame: Channel<InvokeResponseBody>,
+    state: State<'_, AppStateHandle>,
+) -> Result<(), String> {
+    let handle = state.inner().clone();
+    let session = if handle.live().is_some() { None } else { Some(handle.session()?) };
+    let stream_id = handle.next_frame_stream();
+    let fps = fps.filter(|f| f.is_finite() && *f > 0.0).unwrap_or(STREAM_DEFAULT_FPS);
+
+    tokio::spawn(async move {
+        // Reused every tick, so building and encoding a frame allocate nothing
+        let mut frame = FrameData::default();
+        let (mut encoded, mut last_sent) = (Vec::new(), Vec::new());
+        let started = Instant::now();
+        let mut ticker = tokio::time::interval(Duration::from_secs_f64(1.0 / fps));
+        ticker.set_missed_tick_behavior(tokio::time::MissedTickBehavior::Skip);
+
+        loop {
+            ticker.tick().await;
+            if !handle.frame_stream_is_current(stream_id) {
+                break;
+            }
+            let _tick = tracing::info_span!("stream_frame").entered();
+            let wanted_s = start_s + started.elapsed().as_secs_f64() * speed;
+            let finished = match &session {
+                Some(session) => {
+                    let time_s = wanted_s.min(session.duration_s);
+                    get_frame_into(session, time_s, &mut frame);
+                    time_s >= session.duration_s
+                }
+                None => match handle.live().as_ref() {
+                    Some(live) => {
+                        live.frame_into(wanted_s, &mut frame);
+                        false
+                    }
+                    None => break,
+                },
+            };
+            tracing::info_span!("frame_wire.encode").in_scope(|| frame_wire::encode_frame(&frame, &mut encoded));
+            // A live stream holding at the edge repeats its frame; send only
+            // changes. The channel owns what it sends, so a changed frame is
+            // still one exact-size copy out of the stream's buffer.
+            if encoded != last_sent {
+                std::mem::swap(&mut encoded, &mut last_sent);
+                if on_frame.send(InvokeResponseBody::Raw(last_sent.clone())).is_err() {
+                    break;
+                }
+            }
+            if finished {
+                break;
+            }
+        }
+    });
+
+    Ok(())
+}
+
+#[tauri::command]
+#[tracing::instrument(skip_all)]
+pub async fn stop_frame_stream(state: State<'_, AppStateHandle>) -> Result<(), String> {
+    state.next_frame_stream();
+    Ok(())
 }
 
 // ── get_driver_telemetry ──────────────────────────────────────────────────────
 
 #[tauri::command]
+#[tracing::instrument(skip_all)]
 pub async fn get_driver_telemetry(
     driver_number: String,
     time_start: f64,
     time_end: f64,
+    pixel_width: Option<usize>,
     state: State<'_, AppStateHandle>,
 ) -> Result<DriverTelemetry, String> {
-    let locked = state.lock();
-    let session = locked
-        .session
-        .as_ref()
-        .ok_or_else(|| "No session loaded".to_string())?;
-
-    let driver = session
-        .drivers
-        .iter()
-        .find(|d| d.driver_number == driver_number)
-        .ok_or_else(|| format!("Driver {driver_number} not found"))?;
-
-    // Collect samples in [time_start, time_end]
-    let filtered: Vec<&crate::session::RawSample> = driver
-        .samples
-        .iter()
-        .filter(|s| s.session_time >= time_start && s.session_time <= time_end)
-        .collect();
-
-    let times: Vec<f64> = filtered.iter().map(|s| s.session_time).collect();
-    let speeds: Vec<f32> = filtered.iter().map(|s| s.speed).collect();
-    let gears: Vec<u8> = filtered.iter().map(|s| s.gear).collect();
-    let throttles: Vec<f32> = filtered.iter().map(|s| s.throttle).collect();
-    let brakes: Vec<f32> = filtered.iter().map(|s| s.brake).collect();
-
-    Ok(DriverTelemetry {
-        driver_number,
-        times,
-        speeds,
-        gears,
-        throttles,
-        brakes,
-    })
+    let session = state.session()?;
+    let driver = session.driver(&driver_number)?;
+
+    Ok(telemetry_window(driver_number, &driver.samples, &driver.lod, time_start, time_end, pixel_width))
 }
 
 // ── get_driver_meta ────────────────────────────────────────────────────────────
 
 #[tauri::command]
+#[tracing::instrument(skip_all)]
 pub async fn get_driver_meta(state: State<'_, AppStateHandle>) -> Result<Vec<DriverMeta>, String> {
-    let locked = state.lock();
-    let session = locked
-        .session
-        .as_ref()
-        .ok_or_else(|| "No session loaded".to_string())?;
-
-    let meta: Vec<DriverMeta> = session
-        .drivers
-        .iter()
-        .map(|d| DriverMeta {
-            driver_number: d.driver_number.clone(),
-            abbreviation: d.abbreviation.clone(),
-            team: d.team.clone(),
-        })
-        .collect();
-
-    Ok(meta)
+    if let Some(live) = state.live().as_ref() {
+        return Ok(live.driver_meta());
+    }
+    Ok(state.session()?.driver_meta())
 }
 
 // ── run_simulation ────────────────────────────────────────────────────────────
 
 #[tauri::command]
+#[tracing::instrument(skip_all)]
 pub async fn run_simulation(
     scenario: SimulationScenario,
     state: State<'_, AppStateHandle>,
 ) -> Result<SimulationResult, String> {
-    let locked = state.lock();
-    let session = locked
-        .session
-        .as_ref()
-        .ok_or_else(|| "No session loaded".to_string())?;
-    simulation::run_simulation(session, &scenario)
+    with_session_blocking(&state, move |session| simulation::run_simulation(session, &scenario)).await
+}
+
+// ── run_parameter_sweep ───────────────────────────────────────────────────────
+
+#[tauri::command]
+#[tracing::instrument(skip_all)]
+pub async fn run_parameter_sweep(
+    request: SweepRequest,
+    state: State<'_, AppStateHandle>,
+) -> Result<SweepResult, String> {
+    with_session_blocking(&state, move |session| simulation::run_parameter_sweep(session, &request)).await
+}
+
+// ── run_monte_carlo ───────────────────────────────────────────────────────────
+
+#[tauri::command]
+#[tracing::instrument(skip_all)]
+pub async fn run_monte_carlo(
+    config: MonteCarloConfig,
+    state: State<'_, AppStateHandle>,
+) -> Result<MonteCarloResult, String> {
+    with_session_blocking(&state, move |session| monte_carlo::run_monte_carlo(session, &config)).await
 }
 
 // ── compare_drivers_cmd ───────────────────────────────────────────────────────
 
 #[tauri::command]
+#[tracing::instrument(skip_all)]
 pub async fn compare_drivers_cmd(
     driver_a: String,
     driver_b: String,
     state: State<'_, AppStateHandle>,
 ) -> Result<DriverComparison, String> {
-    let locked = state.lock();
-    let session = locked
-        .session
-        .as_ref()
-        .ok_or_else(|| "No session loaded".to_string())?;
-    simulation::compare_drivers(session, &driver_a, &driver_b)
+    with_session_blocking(&state, move |session| {
+        simulation::compare_drivers(session, &driver_a, &driver_b)
+    })
+    .await
 }
 
 // ── compare_laps_cmd ─────────────────────────────────────────────────────────
 
 /// Distance-normalised fastest-lap comparison with per-channel telemetry overlay.
 #[tauri::command]
+#[tracing::instrument(skip_all)]
 pub async fn compare_laps_cmd(
     driver_a: String,
     driver_b: String,
     state: State<'_, AppStateHandle>,
 ) -> Result<LapComparison, String> {
-    let locked = state.lock();
-    let session = locked
-        .session
-        .as_ref()
-        .ok_or_else(|| "No session loaded".to_string())?;
-
-    let a = session
-        .drivers
-        .iter()
-        .find(|d| d.driver_number == driver_a)
-        .ok_or_else(|| format!("Driver {driver_a} not found"))?;
-    let b = session
-        .drivers
-        .iter()
-        .find(|d| d.driver_number == driver_b)
-        .ok_or_else(|| format!("Driver {driver_b} not found"))?;
-
-    telemetry_analysis::compare_laps(a, b)
+    with_session_blocking(&state, move |session| {
+        let a = session.driver(&driver_a)?;
+        let b = session.driver(&driver_b)?;
+        telemetry_analysis::compare_laps(a, b)
+    })
+    .await
 }
 
 // ── get_aero_fit_cmd ──────────────────────────────────────────────────────────
 
 /// Fit Cd*A from braking telemetry for a single driver.
 #[tauri::command]
+#[tracing::instrument(skip_all)]
 pub async fn get_aero_fit_cmd(
     driver_number: String,
     state: State<'_, AppStateHandle>,
 ) -> Result<AeroFitResult, String> {
-    let locked = state.lock();
-    let session = locked
-        .session
-        .as_ref()
-        .ok_or_else(|| "No session loaded".to_string())?;
+    with_session_blocking(&state, move |session| {
+        Ok(telemetry_analysis::fit_cda(session.driver(&driver_number)?))
+    })
+    .await
+}
 
-    let driver = session
-        .drivers
-        .iter()
-        .find(|d| d.driver_number == driver_number)
-        .ok_or_else(|| format!("Driver {driver_number} not found"))?;
+// ── get_lap_delta_matrix ──────────────────────────────────────────────────────
 
-    Ok(telemetry_analysis::fit_cda(driver))
+#[tauri::command]
+#[tracing::instrument(skip_all)]
+pub async fn get_lap_delta_matrix(state: State<'_, AppStateHandle>) -> Result<LapDeltaMatrix, String> {
+    with_session_blocking(&state, |session| Ok(telemetry_analysis::lap_delta_matrix(&session.drivers))).await
 }
 
 // ── get_race_analysis ───────────────────────────────────────────────────────
 
 #[tauri::command]
+#[tracing::instrument(skip_all)]
 pub async fn get_race_analysis(state: State<'_, AppStateHandle>) -> Result<RaceAnalysis, String> {
-    let locked = state.lock();
-    let session = locked
-        .session
-        .as_ref()
-        .ok_or_else(|| "No session loaded".to_string())?;
-    Ok(race_analysis::analyze_race(session))
+    with_session_blocking(&state, |session| Ok(race_analysis::cached_analysis(session).clone())).await
+}
+
+// ── get_track_positions / get_gap_chart ──────────────────────────────────────
+
+/// Every car's lap and distance along the reference lap at `time_s`, leader first.
+#[tauri::command]
+#[tracing::instrument(skip_all)]
+pub async fn get_track_positions(time_s: f64, state: State<'_, AppStateHandle>) -> Result<Vec<TrackPosition>, String> {
+    let session = state.session()?;
+    Ok(lap_index::field_at(&session, time_s))
+}
+
+/// Gap to the leader and interval to the car ahead for the whole field at
+/// `points` (default 500) times over the window.
+#[tauri::command]
+#[tracing::instrument(skip_all)]
+pub async fn get_gap_chart(
+    time_start: f64,
+    time_end: f64,
+    points: Option<usize>,
+    state: State<'_, AppStateHandle>,
+) -> Result<GapChart, String> {
+    with_session_blocking(&state, move |session| Ok(lap_index::gap_chart(session, time_start, time_end, points))).await
+}
+
+// ── Live sessions ────────────────────────────────────────────────────────────
+
+/// Start streaming a running session in. Replaces any live session already
+/// in progress; frames, the speed heatmap and driver meta come from it
+/// until `finish_live_session`.
+#[tauri::command]
+#[tracing::instrument(skip_all)]
+pub async fn start_live_session(
+    event_name: String,
+    session: String,
+    state: State<'_, AppStateHandle>,
+) -> Result<(), String> {
+    *state.live_mut() = Some(LiveSession::new(&event_name, &session));
+    state.next_frame_stream();
+    Ok(())
+}
+
+/// Append one chunk of telemetry. Validation happens before the write lock,
+/// which is then held only for the O(chunk) append.
+#[tauri::command]
+#[tracing::instrument(skip_all)]
+pub async fn ingest_live_chunk(chunk: LiveChunk, state: State<'_, AppStateHandle>) -> Result<LiveStatus, String> {
+    LiveSession::validate(&chunk)?;
+    let mut live = state.live_mut();
+    let live = live.as_mut().ok_or_else(|| "No live session started".to_string())?;
+    live.ingest(chunk);
+    Ok(live.status())
+}
+
+#[tauri::command]
+#[tracing::instrument(skip_all)]
+pub async fn get_live_status(state: State<'_, AppStateHandle>) -> Result<Option<LiveStatus>, String> {
+    Ok(state.live().as_ref().map(LiveSession::status))
+}
+
+/// End the live session and publish it as a regular, fully built session
+/// (chart pyramids, track outline, frame cache), also kept in the cache.
+#[tauri::command]
+#[tracing::instrument(skip_all)]
+pub async fn finish_live_session(state: State<'_, AppStateHandle>) -> Result<TrackLayout, String> {
+    // Checked under the same lock as the take, so a session that cannot be
+    // finished stays in place for the client to keep streaming or retry
+    let live = {
+        let mut live = state.live_mut();
+        live.as_ref().ok_or_else(|| "No live session started".to_string())?.check_finish()?;
+        live.take().ok_or_else(|| "No live session started".to_string())?
+    };
+    let options = state.load_options.clone();
+    let data = tokio::task::spawn_blocking(move || live.finish(&options))
+        .await
+        .map_err(|e| format!("Task join error: {e}"))??;
+
+    let data = Arc::new(data);
+    let layout = data.track_layout.clone();
+    state.lock_cache().insert(session_key(&data.event_name, &data.session), data.clone());
+    state.publish_session(data);
+    Ok(layout)
+}
+
+// ── open_replay_log / get_replay_log_run ─────────────────────────────────────
+
+/// List the runs of a `sim_cli` replay log, keeping it open for
+/// `get_replay_log_run`.
+#[tauri::command]
+#[tracing::instrument(skip_all)]
+pub async fn open_replay_log(state: State<'_, AppStateHandle>, path: String) -> Result<ReplayLogSummary, String> {
+    let state = state.inner().clone();
+    tokio::task::spawn_blocking(move || Ok(state.replay_log(Path::new(&path))?.summary()))
+        .await
+        .map_err(|e| format!("Task join error: {e}"))?
+}
+
+/// One scenario's laps from a replay log (its latest run if re-run).
+#[tauri::command]
+#[tracing::instrument(skip_all)]
+pub async fn get_replay_log_run(
+    state: State<'_, AppStateHandle>,
+    path: String,
+    scenario_index: u32,
+) -> Result<LoggedRun, String> {
+    let state = state.inner().clone();
+    tokio::task::spawn_blocking(move || state.replay_log(Path::new(&path))?.run(scenario_index))
+        .await
+        .map_err(|e| format!("Task join error: {e}"))?
+}
+
+// ── export_replay ────────────────────────────────────────────────────────────
+
+/// Write the current session as a replay bundle for `static/replay-player.html`.
+#[tauri::command]
+#[tracing::instrument(skip_all)]
+pub async fn export_replay(
+    path: String,
+    hz: Option<f64>,
+    state: State<'_, AppStateHandle>,
+) -> Result<ExportSummary, String> {
+    let hz = hz.unwrap_or(replay_export::DEFAULT_EXPORT_HZ);
+    with_session_blocking(&state, move |session| replay_export::export_to_file(session, hz, Path::new(&path))).await
+}
+
+// ── get_perf_stats / export_perf_trace ──────────────────────────────────────
+
+/// Rolling p50/p99 latency of every traced span (commands, load phases,
+/// lock waits, frame encoding).
+#[tauri::command]
+#[tracing::instrument(skip_all)]
+pub async fn get_perf_stats() -> Result<PerfStats, String> {
+    Ok(perf::recorder().stats())
+}
+
+/// The most recent spans as Chrome Trace Event JSON, for chrome://tracing
+/// or Perfetto.
+#[tauri::command]
+#[tracing::instrument(skip_all)]
+pub async fn export_perf_trace() -> Result<String, String> {
+    Ok(perf::recorder().chrome_trace())
 }
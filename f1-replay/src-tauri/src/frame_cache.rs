@@ -0,0 +1,201 @@
+//! Precomputed playback frames on a uniform time grid.
+//!
+//! `get_frame` runs once per animation frame for every driver. Sampling each
+//! driver's splines and ASOF lookups once per grid step at load time turns
+//! playback into two row reads and a lerp per driver, with no searches.
+
+use crate::session::{driver_frame_from_state, driver_states_at_many, DriverData, DriverState};
+use crate::types::{DriverId, FrameData};
+use rayon::prelude::*;
+use std::f32::consts::PI;
+
+/// Default grid rate of the playback cache (rows per second of session time).
+pub const FRAME_CACHE_HZ: f64 = 10.0;
+
+pub struct FrameCache {
+    hz: f64,
+    n_drivers: usize,
+    n_rows: usize,
+    /// Row-major: `rows[k * n_drivers + d]` is driver `d` at `t = k / hz`.
+    rows: Vec<DriverState>,
+}
+
+impl FrameCache {
+    /// Sample every driver at `hz` over `[0, duration_s]`, one rayon task per driver.
+    pub fn build(drivers: &[DriverData], duration_s: f64, hz: f64) -> Self {
+        let hz = if hz.is_finite() && hz > 0.0 { hz } else { FRAME_CACHE_HZ };
+        let n_rows = (duration_s.max(0.0) * hz).ceil() as usize + 1;
+        let n_drivers = drivers.len();
+
+        // Build one column per driver in parallel, then interleave row-major.
+        // The grid is monotonic, so every lookup is a short forward walk.
+        let grid: Vec<f64> = (0..n_rows).map(|k| k as f64 / hz).collect();
+        let columns: Vec<Vec<DriverState>> = drivers
+            .par_iter()
+            .map(|d| driver_states_at_many(d, &grid))
+            .collect();
+
+        let mut rows = Vec::with_capacity(n_rows * n_drivers);
+        for k in 0..n_rows {
+            rows.extend(columns.iter().map(|col| col[k]));
+        }
+
+        FrameCache { hz, n_drivers, n_rows, rows }
+    }
+
+    pub fn heap_bytes(&self) -> usize {
+        self.rows.len() * std::mem::size_of::<DriverState>()
+    }
+
+    /// Write the frame at `time_s`, interpolated between the two nearest grid
+    /// rows, into `out` (reusing its buffer). `drivers` must be the slice the
+    /// cache was built from.
+    pub fn frame_into(&self, drivers: &[DriverData], time_s: f64, out: &mut FrameData) {
+        debug_assert_eq!(drivers.len(), self.n_drivers);
+
+        let (k0, k1, frac) = self.bracket(time_s);
+        let n = self.n_drivers;
+        let row0 = &self.rows[k0 * n..(k0 + 1) * n];
+        let row1 = &self.rows[k1 * n..(k1 + 1) * n];
+
+        out.time_s = time_s;
+        out.drivers.clear();
+        out.drivers.extend(
+            drivers
+                .iter()
+                .zip(row0.iter().zip(row1.iter()))
+                .enumerate()
+                .map(|(id, (d, (a, b)))| driver_frame_from_state(id as DriverId, d, &lerp_state(a, b, frac))),
+        );
+    }
+
+    /// Grid rows either side of `time_s` and the fraction between them.
+    fn bracket(&self, time_s: f64) -> (usize, usize, f32) {
+        let last = (self.n_rows - 1) as f64;
+        let pos = time_s * self.hz;
+        let pos = if pos.is_finite() { pos.clamp(0.0, last) } else { 0.0 };
+        let k0 = pos.floor() as usize;
+        let k1 = (k0 + 1).min(self.n_rows - 1);
+        (k0, k1, (pos - k0 as f64) as f32)
+    }
+}
+
+/// Continuous channels are lerped; discrete ones (gear, DRS, lap) hold the
+/// earlier row, matching the ASOF semantics of the uncached path.
+fn lerp_state(a: &DriverState, b: &DriverState, frac: f32) -> DriverState {
+    let lerp = |p: f32, q: f32| p + (q - p) * frac;
+    DriverState {
+        x: lerp(a.x, b.x),
+        y: lerp(a.y, b.y),
+        heading: lerp_angle(a.heading, b.heading, frac),
+        speed: lerp(a.speed, b.speed),
+        throttle: lerp(a.throttle, b.throttle),
+        brake: lerp(a.brake, b.brake),
+        lap_idx: a.lap_idx,
+        gear: a.gear,
+        drs_active: a.drs_active,
+    }
+}
+
+/// Interpolate along the shorter arc so headings near ±π don't spin.
+fn lerp_angle(a: f32, b: f32, frac: f32) -> f32 {
+    let mut d = b - a;
+    if d > PI {
+        d -= 2.0 * PI;
+    } else if d < -PI {
+        d += 2.0 * PI;
+    }
+    a + d * frac
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::interpolate::SplineCursor;
+    use crate::session::{driver_state_at, LapRecord, RawSample, SampleColumns};
+    use crate::test_fixtures;
+    use crate::types::Compound;
+
+    fn frame_at(cache: &FrameCache, drivers: &[DriverData], t: f64) -> FrameData {
+        let mut frame = FrameData::default();
+        cache.frame_into(drivers, t, &mut frame);
+        frame
+    }
+
+    /// Driver moving along +X at 10 units/s, sampled at 4 Hz for 60 s.
+    fn straight_line_driver() -> DriverData {
+        let mut samples = SampleColumns::default();
+        for i in 0..=240 {
+            let t = i as f64 * 0.25;
+            samples.push(RawSample {
+                session_time: t, x: (t * 10.0) as f32, y: 5.0, speed: 36.0, gear: 4,
+                throttle: 0.5, brake: 0.0, drs: 0,
+            });
+        }
+        let laps = vec![
+            LapRecord { lap_number: 1, lap_start_time_s: 0.0, position: 3, compound: Compound::Soft, tyre_life: 1 },
+            LapRecord { lap_number: 2, lap_start_time_s: 30.0, position: 2, compound: Compound::Soft, tyre_life: 2 },
+        ];
+        let mut driver = test_fixtures::driver("1", samples, laps);
+        driver.abbreviation = "VER".to_string();
+        driver.team = "Red Bull Racing".to_string();
+        driver
+    }
+
+    #[test]
+    fn test_cache_matches_direct_evaluation() {
+        let drivers = vec![straight_line_driver()];
+        let cache = FrameCache::build(&drivers, 60.0, FRAME_CACHE_HZ);
+        for &t in &[0.0, 1.23, 29.99, 30.05, 59.9] {
+            let cached = &frame_at(&cache, &drivers, t).drivers[0];
+            let state = driver_state_at(&drivers[0], t, &mut SplineCursor::default());
+            let direct = driver_frame_from_state(0, &drivers[0], &state);
+            assert!((cached.x - direct.x).abs() < 1e-2, "t={t}: {} vs {}", cached.x, direct.x);
+            assert!((cached.y - direct.y).abs() < 1e-3);
+            assert!((cached.speed - direct.speed).abs() < 1e-3);
+        }
+    }
+
+    #[test]
+    fn test_batch_states_match_single_lookups() {
+        let driver = straight_line_driver();
+        let times: Vec<f64> = (0..700).map(|k| k as f64 * 0.0917 - 2.0).collect();
+        let batch = driver_states_at_many(&driver, &times);
+        for (&t, b) in times.iter().zip(&batch) {
+            let one = driver_state_at(&driver, t, &mut SplineCursor::default());
+            assert_eq!((b.x, b.y, b.heading, b.speed), (one.x, one.y, one.heading, one.speed), "t={t}");
+            assert_eq!((b.lap_idx, b.gear, b.drs_active), (one.lap_idx, one.gear, one.drs_active), "t={t}");
+        }
+    }
+
+    #[test]
+    fn test_cache_clamps_out_of_range_time() {
+        let drivers = vec![straight_line_driver()];
+        let cache = FrameCache::build(&drivers, 60.0, FRAME_CACHE_HZ);
+        let before = frame_at(&cache, &drivers, -5.0);
+        let after = frame_at(&cache, &drivers, 1e9);
+        let nan = frame_at(&cache, &drivers, f64::NAN);
+        assert!((before.drivers[0].x - 0.0).abs() < 1e-3);
+        assert!((after.drivers[0].x - 600.0).abs() < 1e-2);
+        assert!(nan.drivers[0].x.is_finite());
+    }
+
+    #[test]
+    fn test_cache_holds_discrete_channels() {
+        let drivers = vec![straight_line_driver()];
+        let cache = FrameCache::build(&drivers, 60.0, FRAME_CACHE_HZ);
+        let f = &frame_at(&cache, &drivers, 35.0).drivers[0];
+        assert_eq!(f.position, 2);
+        assert_eq!(f.tyre_life, 2);
+        assert_eq!(f.compound, Compound::Soft);
+        assert_eq!(f.gear, 4);
+    }
+
+    #[test]
+    fn test_lerp_angle_wraps() {
+        let a = PI - 0.1;
+        let b = -PI + 0.1;
+        let mid = lerp_angle(a, b, 0.5);
+        assert!((mid.abs() - PI).abs() < 1e-4, "expected ±π, got {mid}");
+    }
+}
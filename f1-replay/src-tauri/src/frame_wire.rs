@@ -0,0 +1,95 @@
+//! Fixed-layout binary encoding of `FrameData` for playback IPC.
+//!
+//! Everything is little-endian. Driver identity is not sent: record `i` is
+//! driver `i` of `get_driver_meta`, which the frontend fetches once per session.
+//!
+//! ```text
+//! header  16 bytes   0 f64 time_s   8 u32 driver_count   12 u32 record_bytes
+//! record  32 bytes   0 f32 x         4 f32 y            8 f32 heading
+//!                   12 f32 speed    16 f32 throttle     20 f32 brake
+//!                   24 u8 gear      25 u8 position      26 u8 tyre_life
+//!                   27 u8 flags (bit 0 DRS open, bit 1 in pit)
+//!                   28 u8 compound code (`Compound::code`), 29..32 pad
+//! ```
+//!
+//! Keep `src/lib/frameWire.ts` in sync with this layout.
+
+use crate::types::{DriverFrame, FrameData};
+
+pub const HEADER_BYTES: usize = 16;
+pub const RECORD_BYTES: usize = 32;
+
+pub const FLAG_DRS: u8 = 1 << 0;
+pub const FLAG_IN_PIT: u8 = 1 << 1;
+
+/// Append the encoded frame to `out` (cleared first).
+pub fn encode_frame(frame: &FrameData, out: &mut Vec<u8>) {
+    out.clear();
+    out.reserve(HEADER_BYTES + frame.drivers.len() * RECORD_BYTES);
+
+    out.extend_from_slice(&frame.time_s.to_le_bytes());
+    out.extend_from_slice(&(frame.drivers.len() as u32).to_le_bytes());
+    out.extend_from_slice(&(RECORD_BYTES as u32).to_le_bytes());
+
+    for d in &frame.drivers {
+        encode_record(d, out);
+    }
+}
+
+fn encode_record(d: &DriverFrame, out: &mut Vec<u8>) {
+    for v in [d.x, d.y, d.heading, d.speed, d.throttle, d.brake] {
+        out.extend_from_slice(&v.to_le_bytes());
+    }
+    let mut flags = 0u8;
+    if d.drs_active {
+        flags |= FLAG_DRS;
+    }
+    if d.is_in_pit {
+        flags |= FLAG_IN_PIT;
+    }
+    out.extend_from_slice(&[d.gear, d.position, d.tyre_life, flags]);
+    out.extend_from_slice(&[d.compound.code(), 0, 0, 0]);
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::types::Compound;
+
+    fn frame(compound: Compound) -> DriverFrame {
+        DriverFrame {
+            driver_id: 0,
+            x: 1.5, y: -2.0, heading: 0.25, speed: 301.0, gear: 8,
+            throttle: 1.0, brake: 0.0, drs_active: true, position: 3,
+            compound, tyre_life: 12, is_in_pit: false,
+        }
+    }
+
+    #[test]
+    fn test_encode_layout() {
+        let fd = FrameData { time_s: 123.5, drivers: vec![frame(Compound::Medium), frame(Compound::parse("C5"))] };
+        let mut buf = Vec::new();
+        encode_frame(&fd, &mut buf);
+        assert_eq!(buf.len(), HEADER_BYTES + 2 * RECORD_BYTES);
+        assert_eq!(f64::from_le_bytes(buf[0..8].try_into().unwrap()), 123.5);
+        assert_eq!(u32::from_le_bytes(buf[8..12].try_into().unwrap()), 2);
+        assert_eq!(u32::from_le_bytes(buf[12..16].try_into().unwrap()), RECORD_BYTES as u32);
+
+        let r = &buf[HEADER_BYTES..HEADER_BYTES + RECORD_BYTES];
+        assert_eq!(f32::from_le_bytes(r[12..16].try_into().unwrap()), 301.0);
+        assert_eq!(r[24], 8);
+        assert_eq!(r[25], 3);
+        assert_eq!(r[26], 12);
+        assert_eq!(r[27], FLAG_DRS);
+        assert_eq!(r[28], 2);
+        // Unknown compound falls back to code 0
+        assert_eq!(buf[HEADER_BYTES + RECORD_BYTES + 28], 0);
+    }
+
+    #[test]
+    fn test_encode_reuses_buffer() {
+        let mut buf = vec![0xAA; 500];
+        encode_frame(&FrameData { time_s: 0.0, drivers: vec![] }, &mut buf);
+        assert_eq!(buf.len(), HEADER_BYTES);
+    }
+}
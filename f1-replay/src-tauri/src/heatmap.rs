@@ -1,70 +1,270 @@
-use crate::types::HeatCell;
-use std::collections::HashMap;
+use crate::session::{DriverData, SampleColumns};
+use crate::types::{HeatCell, HeatChannel, HeatmapFilter};
+use rayon::prelude::*;
+use std::ops::Range;
 
 const BIN_SIZE: f32 = 60.0;
 
-/// Compute a speed heatmap from track position + speed data.
-///
-/// - Bins positions into BIN_SIZE-unit cells
-/// - Averages speed per bin
-/// - Normalises: speed_norm = (speed - p5) / (p95 - p5), clamped [0,1]
-/// - Drops cells with fewer than 5 samples
-/// - Sorts by speed_norm ascending (slowest first, so fast cells render on top)
+/// Bin all samples in one pass; see `HeatBins::finish` for the output rules.
+#[cfg(test)]
 pub fn compute_heatmap(positions: &[(f32, f32)], speeds: &[f32]) -> Vec<HeatCell> {
     assert_eq!(positions.len(), speeds.len());
 
-    // Accumulate speed sums and counts per bin
-    let mut bins: HashMap<(i32, i32), (f64, u32)> = HashMap::new();
-
-    for (&(px, py), &spd) in positions.iter().zip(speeds.iter()) {
-        let bx = (px / BIN_SIZE).floor() as i32;
-        let by = (py / BIN_SIZE).floor() as i32;
-        let entry = bins.entry((bx, by)).or_insert((0.0, 0));
-        entry.0 += spd as f64;
-        entry.1 += 1;
-    }
-
-    // Filter cells with >= 5 samples and compute average speed
-    let mut cells: Vec<(f32, f32, f32)> = bins
-        .into_iter()
-        .filter(|(_, (_, count))| *count >= 5)
-        .map(|((bx, by), (sum, count))| {
-            let cx = (bx as f32 + 0.5) * BIN_SIZE;
-            let cy = (by as f32 + 0.5) * BIN_SIZE;
-            let avg_speed = (sum / count as f64) as f32;
-            (cx, cy, avg_speed)
-        })
+    let xs: Vec<f32> = positions.iter().map(|p| p.0).collect();
+    let ys: Vec<f32> = positions.iter().map(|p| p.1).collect();
+    let mut bins = HeatBins::new(HeatGrid::covering(&xs, &ys));
+    bins.add(&xs, &ys, speeds);
+    bins.finish()
+}
+
+/// Heatmap of `filter.channel` over the selected drivers and laps. Each
+/// driver's slice is binned into its own dense partial on the rayon pool and
+/// the partials are summed, so nothing is flattened into session-wide copies.
+pub fn compute_filtered(drivers: &[DriverData], filter: &HeatmapFilter) -> Vec<HeatCell> {
+    let slices: Vec<(&DriverData, Range<usize>)> = drivers
+        .iter()
+        .filter(|d| filter.drivers.as_ref().map_or(true, |sel| sel.contains(&d.driver_number)))
+        .map(|d| (d, lap_sample_range(d, filter.lap_start, filter.lap_end)))
+        .filter(|(_, range)| !range.is_empty())
         .collect();
 
-    if cells.is_empty() {
+    let Some(grid) = slices
+        .par_iter()
+        .map(|(d, r)| HeatGrid::covering(&d.samples.xs[r.clone()], &d.samples.ys[r.clone()]))
+        .reduce_with(HeatGrid::union)
+    else {
+        return vec![];
+    };
+
+    slices
+        .par_iter()
+        .map(|(d, r)| {
+            let s = &d.samples;
+            let values = match filter.channel {
+                HeatChannel::Speed => &s.speeds[r.clone()],
+                HeatChannel::Throttle => &s.throttles[r.clone()],
+                HeatChannel::Brake => &s.brakes[r.clone()],
+            };
+            let mut bins = HeatBins::new(grid);
+            bins.add(&s.xs[r.clone()], &s.ys[r.clone()], values);
+            bins
+        })
+        .reduce_with(HeatBins::merge)
+        .map_or_else(Vec::new, |bins| bins.finish())
+}
+
+/// One driver's share of the load-time heatmap (speed over every lap), on
+/// the driver's own grid so it can be binned as soon as their rows arrive.
+pub fn driver_partial(samples: &SampleColumns) -> HeatBins {
+    let mut bins = HeatBins::new(HeatGrid::covering(&samples.xs, &samples.ys));
+    bins.add(&samples.xs, &samples.ys, &samples.speeds);
+    bins
+}
+
+/// Sum `driver_partial`s into the heatmap `compute_filtered` gives for the
+/// default filter, laying them out on the union of their grids.
+pub fn merge_partials(partials: Vec<HeatBins>) -> Vec<HeatCell> {
+    let Some(grid) = partials.iter().map(HeatBins::grid).reduce(HeatGrid::union) else {
         return vec![];
+    };
+    partials
+        .into_par_iter()
+        .map(|bins| bins.regrid(grid))
+        .reduce_with(HeatBins::merge)
+        .map_or_else(Vec::new, |bins| bins.finish())
+}
+
+/// Samples from the start of lap `lap_start` up to the end of lap `lap_end`
+/// (both inclusive, either open-ended when `None`). Drivers without lap data
+/// match no lap filter.
+fn lap_sample_range(d: &DriverData, lap_start: Option<u32>, lap_end: Option<u32>) -> Range<usize> {
+    if lap_start.is_none() && lap_end.is_none() {
+        return 0..d.samples.len();
     }
+    if d.laps.is_empty() {
+        return 0..0;
+    }
+    // Laps are sorted by number
+    let t_start = match lap_start {
+        Some(first) => match d.laps.get(d.laps.partition_point(|l| l.lap_number < first)) {
+            Some(lap) => lap.lap_start_time_s,
+            None => return 0..0,
+        },
+        None => f64::NEG_INFINITY,
+    };
+    let t_end = lap_end
+        .and_then(|last| d.laps.get(d.laps.partition_point(|l| l.lap_number <= last)))
+        .map_or(f64::INFINITY, |l| l.lap_start_time_s);
+    d.samples.range(t_start, t_end)
+}
 
-    // Collect speeds for percentile computation
-    let mut sorted_speeds: Vec<f32> = cells.iter().map(|&(_, _, s)| s).collect();
-    sorted_speeds.sort_by(|a, b| a.partial_cmp(b).unwrap());
+fn bin(v: f32) -> i32 {
+    (v / BIN_SIZE).floor() as i32
+}
 
-    let p5 = percentile(&sorted_speeds, 5.0);
-    let p95 = percentile(&sorted_speeds, 95.0);
-    let range = p95 - p5;
+/// A dense rectangle of BIN_SIZE cells, in bin coordinates.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct HeatGrid {
+    bx0: i32,
+    by0: i32,
+    nx: usize,
+    ny: usize,
+}
 
-    // Normalise speeds
-    let mut result: Vec<HeatCell> = cells
-        .into_iter()
-        .map(|(cx, cy, spd)| {
-            let norm = if range > 0.1 {
-                ((spd - p5) / range).clamp(0.0, 1.0)
-            } else {
-                0.5
-            };
-            HeatCell { x: cx, y: cy, speed_norm: norm }
-        })
-        .collect();
+impl HeatGrid {
+    /// The smallest grid holding every (x, y) sample.
+    pub fn covering(xs: &[f32], ys: &[f32]) -> Self {
+        let (x_min, x_max) = xs.iter().fold((f32::INFINITY, f32::NEG_INFINITY), |(lo, hi), &x| (lo.min(x), hi.max(x)));
+        let (y_min, y_max) = ys.iter().fold((f32::INFINITY, f32::NEG_INFINITY), |(lo, hi), &y| (lo.min(y), hi.max(y)));
+        if !(x_min <= x_max && y_min <= y_max) {
+            return HeatGrid { bx0: 0, by0: 0, nx: 0, ny: 0 };
+        }
+        let (bx0, by0) = (bin(x_min), bin(y_min));
+        HeatGrid {
+            bx0,
+            by0,
+            nx: (bin(x_max) - bx0 + 1) as usize,
+            ny: (bin(y_max) - by0 + 1) as usize,
+        }
+    }
+
+    pub fn union(self, other: HeatGrid) -> HeatGrid {
+        if self.nx == 0 || self.ny == 0 {
+            return other;
+        }
+        if other.nx == 0 || other.ny == 0 {
+            return self;
+        }
+        let bx0 = self.bx0.min(other.bx0);
+        let by0 = self.by0.min(other.by0);
+        let bx1 = (self.bx0 + self.nx as i32).max(other.bx0 + other.nx as i32);
+        let by1 = (self.by0 + self.ny as i32).max(other.by0 + other.ny as i32);
+        HeatGrid { bx0, by0, nx: (bx1 - bx0) as usize, ny: (by1 - by0) as usize }
+    }
+
+    fn len(&self) -> usize {
+        self.nx * self.ny
+    }
+
+    fn index(&self, px: f32, py: f32) -> Option<usize> {
+        let bx = usize::try_from(bin(px) - self.bx0).ok().filter(|&bx| bx < self.nx)?;
+        let by = usize::try_from(bin(py) - self.by0).ok().filter(|&by| by < self.ny)?;
+        Some(by * self.nx + bx)
+    }
+}
+
+/// Per-cell value sums and sample counts on a dense grid. Partials built on
+/// the same grid from disjoint sample sets (e.g. one per driver on different
+/// threads) merge into the same result as binning everything at once.
+#[derive(Debug)]
+pub struct HeatBins {
+    grid: HeatGrid,
+    sums: Vec<f64>,
+    counts: Vec<u32>,
+}
+
+impl HeatBins {
+    pub fn new(grid: HeatGrid) -> Self {
+        HeatBins { grid, sums: vec![0.0; grid.len()], counts: vec![0; grid.len()] }
+    }
+
+    /// Accumulate one driver's columns. Samples outside the grid are skipped.
+    pub fn add(&mut self, xs: &[f32], ys: &[f32], values: &[f32]) {
+        for ((&px, &py), &v) in xs.iter().zip(ys.iter()).zip(values.iter()) {
+            if let Some(i) = self.grid.index(px, py) {
+                self.sums[i] += v as f64;
+                self.counts[i] += 1;
+            }
+        }
+    }
+
+    pub fn grid(&self) -> HeatGrid {
+        self.grid
+    }
+
+    /// The same bins laid out on `grid`, which must contain the current grid.
+    /// Lets a live session grow its heatmap as cars reach new parts of the track.
+    pub fn regrid(self, grid: HeatGrid) -> HeatBins {
+        if grid == self.grid {
+            return self;
+        }
+        assert_eq!(grid.union(self.grid), grid, "regrid target must contain the current grid");
+        let mut out = HeatBins::new(grid);
+        let (dx, dy) = ((self.grid.bx0 - grid.bx0) as usize, (self.grid.by0 - grid.by0) as usize);
+        for row in 0..self.grid.ny {
+            let src = row * self.grid.nx..(row + 1) * self.grid.nx;
+            let dst = (row + dy) * grid.nx + dx;
+            out.sums[dst..dst + self.grid.nx].copy_from_slice(&self.sums[src.clone()]);
+            out.counts[dst..dst + self.grid.nx].copy_from_slice(&self.counts[src]);
+        }
+        out
+    }
+
+    pub fn merge(mut self, other: HeatBins) -> HeatBins {
+        assert_eq!(self.grid, other.grid, "merging heat bins from different grids");
+        for (sum, s) in self.sums.iter_mut().zip(&other.sums) {
+            *sum += s;
+        }
+        for (count, c) in self.counts.iter_mut().zip(&other.counts) {
+            *count += c;
+        }
+        self
+    }
+
+    /// Compute the heatmap from the accumulated bins.
+    ///
+    /// - Bins positions into BIN_SIZE-unit cells
+    /// - Averages the channel value per bin
+    /// - Normalises: speed_norm = (value - p5) / (p95 - p5), clamped [0,1]
+    /// - Drops cells with fewer than 5 samples
+    /// - Sorts by speed_norm ascending (slowest first, so fast cells render on top)
+    pub fn finish(&self) -> Vec<HeatCell> {
+        let grid = self.grid;
+        // Filter cells with >= 5 samples and compute average value
+        let cells: Vec<(f32, f32, f32)> = (0..grid.len())
+            .filter(|&i| self.counts[i] >= 5)
+            .map(|i| {
+                let bx = grid.bx0 + (i % grid.nx) as i32;
+                let by = grid.by0 + (i / grid.nx) as i32;
+                let cx = (bx as f32 + 0.5) * BIN_SIZE;
+                let cy = (by as f32 + 0.5) * BIN_SIZE;
+                let avg = (self.sums[i] / self.counts[i] as f64) as f32;
+                (cx, cy, avg)
+            })
+            .collect();
+
+        if cells.is_empty() {
+            return vec![];
+        }
+
+        // Collect speeds for percentile computation
+        let mut sorted_speeds: Vec<f32> = cells.iter().map(|&(_, _, s)| s).collect();
+        sorted_speeds.sort_by(f32::total_cmp);
 
-    // Sort ascending by speed_norm (slowest first = rendered first = underneath)
-    result.sort_by(|a, b| a.speed_norm.partial_cmp(&b.speed_norm).unwrap());
+        let p5 = percentile(&sorted_speeds, 5.0);
+        let p95 = percentile(&sorted_speeds, 95.0);
+        let range = p95 - p5;
 
-    result
+        // Normalise speeds
+        let mut result: Vec<HeatCell> = cells
+            .into_iter()
+            .map(|(cx, cy, spd)| {
+                // Any real spread is normalised: channels differ in scale
+                // (km/h speeds, 0..1 throttle and brake)
+                let norm = if range > f32::EPSILON {
+                    ((spd - p5) / range).clamp(0.0, 1.0)
+                } else {
+                    0.5
+                };
+                HeatCell { x: cx, y: cy, speed_norm: norm }
+            })
+            .collect();
+
+        // Sort ascending by speed_norm (slowest first = rendered first = underneath)
+        result.sort_by(|a, b| a.speed_norm.total_cmp(&b.speed_norm));
+
+        result
+    }
 }
 
 fn percentile(sorted: &[f32], p: f64) -> f32 {
@@ -78,6 +278,29 @@ fn percentile(sorted: &[f32], p: f64) -> f32 {
 #[cfg(test)]
 mod tests {
     use super::*;
+    use crate::session::{LapRecord, RawSample, SampleColumns};
+    use crate::test_fixtures;
+    use crate::types::Compound;
+
+    /// 100 samples per lap over three laps, each lap in its own cell column
+    /// at x = lap * 1000, braking on every sample of lap 2.
+    fn driver(number: &str, speed: f32) -> DriverData {
+        let mut samples = SampleColumns::default();
+        for i in 0..300 {
+            let lap = i / 100 + 1;
+            samples.push(RawSample {
+                session_time: i as f64, x: (lap * 1000) as f32, y: 0.0, speed,
+                gear: 5, throttle: 1.0, brake: if lap == 2 { 1.0 } else { 0.0 }, drs: 0,
+            });
+        }
+        let laps = (1..=3)
+            .map(|n| LapRecord {
+                lap_number: n, lap_start_time_s: (n as f64 - 1.0) * 100.0,
+                position: 1, compound: Compound::Soft, tyre_life: n as u8,
+            })
+            .collect();
+        test_fixtures::driver(number, samples, laps)
+    }
 
     #[test]
     fn test_heatmap_empty() {
@@ -128,4 +351,114 @@ mod tests {
         let fast_cell = cells.iter().max_by(|a, b| a.speed_norm.partial_cmp(&b.speed_norm).unwrap());
         assert!(slow_cell.unwrap().speed_norm < fast_cell.unwrap().speed_norm);
     }
+
+    #[test]
+    fn test_heatmap_small_range_channel_is_normalised() {
+        // Two zones on a 0..1 channel whose spread is under 0.1
+        let mut positions: Vec<(f32, f32)> = (0..20).map(|_| (0.0, 0.0)).collect();
+        positions.extend((0..20).map(|_| (10000.0, 0.0)));
+        let mut values = vec![0.02f32; 20];
+        values.extend(vec![0.08f32; 20]);
+
+        let cells = compute_heatmap(&positions, &values);
+        let norms: Vec<f32> = cells.iter().map(|c| c.speed_norm).collect();
+        assert_eq!(norms, [0.0, 1.0]);
+    }
+
+    #[test]
+    fn test_heatmap_merged_partials_match_single_pass() {
+        let xs: Vec<f32> = (0..200).map(|i| (i % 40) as f32 * 30.0).collect();
+        let ys: Vec<f32> = (0..200).map(|i| (i / 40) as f32 * 30.0).collect();
+        let speeds: Vec<f32> = (0..200).map(|i| 80.0 + i as f32).collect();
+
+        let grid = HeatGrid::covering(&xs[..90], &ys[..90]).union(HeatGrid::covering(&xs[90..], &ys[90..]));
+        assert_eq!(grid, HeatGrid::covering(&xs, &ys));
+        let mut a = HeatBins::new(grid);
+        a.add(&xs[..90], &ys[..90], &speeds[..90]);
+        let mut b = HeatBins::new(grid);
+        b.add(&xs[90..], &ys[90..], &speeds[90..]);
+        let a = a.merge(b);
+
+        let positions: Vec<(f32, f32)> = xs.iter().copied().zip(ys.iter().copied()).collect();
+        let single = compute_heatmap(&positions, &speeds);
+        let merged = a.finish();
+        assert_eq!(merged.len(), single.len());
+        let key = |c: &HeatCell| (c.x as i32, c.y as i32, (c.speed_norm * 1e4) as i32);
+        let mut m: Vec<_> = merged.iter().map(key).collect();
+        let mut s: Vec<_> = single.iter().map(key).collect();
+        m.sort();
+        s.sort();
+        assert_eq!(m, s);
+    }
+
+    #[test]
+    fn test_regrid_while_growing_matches_single_pass() {
+        // A spiral outwards, so every chunk extends the grid
+        let n = 600;
+        let xs: Vec<f32> = (0..n).map(|i| (i as f32 * 0.05).cos() * i as f32 * 4.0).collect();
+        let ys: Vec<f32> = (0..n).map(|i| (i as f32 * 0.05).sin() * i as f32 * 4.0).collect();
+        let speeds: Vec<f32> = (0..n).map(|i| 100.0 + (i % 50) as f32).collect();
+
+        let mut bins = HeatBins::new(HeatGrid::covering(&[], &[]));
+        for start in (0..n).step_by(75) {
+            let r = start..(start + 75).min(n);
+            let grid = bins.grid().union(HeatGrid::covering(&xs[r.clone()], &ys[r.clone()]));
+            bins = bins.regrid(grid);
+            bins.add(&xs[r.clone()], &ys[r.clone()], &speeds[r]);
+        }
+        assert_eq!(bins.grid(), HeatGrid::covering(&xs, &ys));
+
+        let positions: Vec<(f32, f32)> = xs.iter().copied().zip(ys.iter().copied()).collect();
+        let single = compute_heatmap(&positions, &speeds);
+        let grown = bins.finish();
+        let key = |c: &HeatCell| (c.x as i32, c.y as i32, (c.speed_norm * 1e4) as i32);
+        assert_eq!(grown.iter().map(key).collect::<Vec<_>>(), single.iter().map(key).collect::<Vec<_>>());
+    }
+
+    #[test]
+    fn test_filtered_by_driver_lap_and_channel() {
+        let drivers = vec![driver("1", 300.0), driver("44", 100.0)];
+
+        let all = compute_filtered(&drivers, &HeatmapFilter::default());
+        assert_eq!(all.len(), 3);
+
+        let lap_two = HeatmapFilter { lap_start: Some(2), lap_end: Some(2), ..Default::default() };
+        let cells = compute_filtered(&drivers, &lap_two);
+        assert_eq!(cells.len(), 1);
+        assert_eq!(cells[0].x, (bin(2000.0) as f32 + 0.5) * BIN_SIZE);
+
+        // One driver, one lap onwards, brake channel: lap 2 brakes, lap 3 does not
+        let filter = HeatmapFilter {
+            drivers: Some(vec!["44".to_string()]),
+            lap_start: Some(2),
+            lap_end: None,
+            channel: HeatChannel::Brake,
+        };
+        let cells = compute_filtered(&drivers, &filter);
+        assert_eq!(cells.len(), 2);
+        assert_eq!(cells[0].speed_norm, 0.0);
+        assert_eq!(cells[1].speed_norm, 1.0);
+        assert_eq!(cells[1].x, (bin(2000.0) as f32 + 0.5) * BIN_SIZE);
+
+        let nobody = HeatmapFilter { drivers: Some(vec![]), ..Default::default() };
+        assert!(compute_filtered(&drivers, &nobody).is_empty());
+        let past_the_flag = HeatmapFilter { lap_start: Some(4), ..Default::default() };
+        assert!(compute_filtered(&drivers, &past_the_flag).is_empty());
+    }
+
+    #[test]
+    fn test_driver_partials_match_default_filter() {
+        // The second driver is off the first one's grid
+        let mut far = driver("44", 100.0);
+        far.samples.ys.iter_mut().for_each(|y| *y = 5_000.0);
+        let drivers = vec![driver("1", 300.0), far];
+
+        let partials = drivers.iter().map(|d| driver_partial(&d.samples)).collect();
+        let key = |c: &HeatCell| (c.x, c.y, c.speed_norm);
+        let merged: Vec<_> = merge_partials(partials).iter().map(key).collect();
+        let filtered: Vec<_> = compute_filtered(&drivers, &HeatmapFilter::default()).iter().map(key).collect();
+        assert_eq!(merged.len(), 6);
+        assert_eq!(merged, filtered);
+        assert!(merge_partials(vec![]).is_empty());
+    }
 }
@@ -1,3 +1,27 @@
+/// Segments a `SplineCursor` walks before giving up and binary searching.
+const CURSOR_MAX_WALK: usize = 16;
+
+/// Trailing segments `Spline::extend` re-solves. 0.27^32 ≈ 1e-18, so the
+/// fixed second derivative at the window start is exact in f64.
+const EXTEND_WINDOW: usize = 32;
+
+/// Remembered segment index for repeated, mostly-monotonic `Spline` lookups.
+/// The index is only a hint: any value is valid for any spline.
+#[derive(Debug, Clone, Copy, Default)]
+pub struct SplineCursor {
+    seg: usize,
+}
+
+impl SplineCursor {
+    pub fn at(seg: usize) -> Self {
+        SplineCursor { seg }
+    }
+
+    pub fn segment(&self) -> usize {
+        self.seg
+    }
+}
+
 /// Natural cubic spline interpolation using the Thomas algorithm (tridiagonal solver).
 #[derive(Debug, Clone)]
 pub struct Spline {
@@ -9,6 +33,11 @@ pub struct Spline {
 }
 
 impl Spline {
+    /// Heap footprint of the knots and coefficients.
+    pub fn heap_bytes(&self) -> usize {
+        (self.ts.len() + 4 * self.a.len()) * std::mem::size_of::<f64>()
+    }
+
     /// Compute a natural cubic spline from sorted (ts, ys) pairs.
     /// ts must be strictly increasing.
     pub fn new(ts: &[f64], ys: &[f64]) -> Self {
@@ -49,89 +78,77 @@ impl Spline {
             };
         }
 
-        // Number of intervals
-        let m = n - 1;
-
-        // Step sizes
-        let h: Vec<f64> = (0..m).map(|i| ts[i + 1] - ts[i]).collect();
-
-        // Set up the tridiagonal system for the second derivatives (sigma).
-        // For a natural spline: sigma[0] = 0, sigma[n-1] = 0.
-        // Interior equations: h[i-1]*sigma[i-1] + 2*(h[i-1]+h[i])*sigma[i] + h[i]*sigma[i+1]
-        //   = 3 * ((ys[i+1]-ys[i])/h[i] - (ys[i]-ys[i-1])/h[i-1])
-        // We solve for sigma[1..n-2] (the interior nodes).
-
-        let interior = n - 2; // number of unknowns
-
-        let mut diag = vec![0.0f64; interior];
-        let mut upper = vec![0.0f64; interior - 1];
-        let mut lower = vec![0.0f64; interior - 1];
-        let mut rhs = vec![0.0f64; interior];
+        let [a, b, c, d] = solve_segments(ts, ys, 0.0);
+        Spline { ts: ts.to_vec(), a, b, c, d }
+    }
 
-        for i in 0..interior {
-            let gi = i + 1; // global index
-            diag[i] = 2.0 * (h[gi - 1] + h[gi]);
-            rhs[i] = 3.0 * ((ys[gi + 1] - ys[gi]) / h[gi] - (ys[gi] - ys[gi - 1]) / h[gi - 1]);
+    /// Append knots after the current last one, as new telemetry arrives.
+    /// `ts` must be strictly increasing and later than every existing knot.
+    ///
+    /// A natural spline's second derivatives depend on every knot, but the
+    /// influence of the new end decays by ~0.27 per knot, so only the last
+    /// `EXTEND_WINDOW` segments are re-solved, with the second derivative at
+    /// the window's first knot held fixed. Beyond that the result matches a
+    /// full `Spline::new` to rounding, at O(window + new) cost.
+    pub fn extend(&mut self, ts: &[f64], ys: &[f64]) {
+        assert_eq!(ts.len(), ys.len(), "ts and ys must have equal length");
+        if ts.is_empty() {
+            return;
         }
-        for i in 0..interior - 1 {
-            let gi = i + 1;
-            upper[i] = h[gi];
-            lower[i] = h[gi];
-        }
-
-        // Thomas algorithm (forward sweep + back substitution)
-        let mut c_prime = vec![0.0f64; interior];
-        let mut d_prime = vec![0.0f64; interior];
+        let n = self.ts.len();
+        assert!(n == 0 || ts[0] > self.ts[n - 1], "extend() knots must follow the existing ones");
 
-        // When interior == 1 there are no off-diagonal entries; skip c_prime[0]
-        if interior > 1 {
-            c_prime[0] = upper[0] / diag[0];
+        if n < EXTEND_WINDOW + 2 {
+            let mut all_ys = self.knot_values_from(0);
+            let mut all_ts = std::mem::take(&mut self.ts);
+            all_ts.extend_from_slice(ts);
+            all_ys.extend_from_slice(ys);
+            *self = Spline::new(&all_ts, &all_ys);
+            return;
         }
-        d_prime[0] = rhs[0] / diag[0];
 
-        for i in 1..interior {
-            let denom = diag[i] - lower[i - 1] * c_prime[i - 1];
-            if i < interior - 1 {
-                c_prime[i] = upper[i] / denom;
-            }
-            d_prime[i] = (rhs[i] - lower[i - 1] * d_prime[i - 1]) / denom;
-        }
+        // Re-solve from knot `s`; segments before it are unchanged
+        let s = n - 1 - EXTEND_WINDOW;
+        let mut window_ts = self.ts[s..].to_vec();
+        window_ts.extend_from_slice(ts);
+        let mut window_ys = self.knot_values_from(s);
+        window_ys.extend_from_slice(ys);
+        let [a, b, c, d] = solve_segments(&window_ts, &window_ys, self.c[s]);
 
-        // Back substitution
-        let mut sigma = vec![0.0f64; n];
-        sigma[n - 1] = 0.0; // natural BC
-        sigma[interior] = d_prime[interior - 1]; // sigma[n-2]
-        for i in (0..interior - 1).rev() {
-            sigma[i + 1] = d_prime[i] - c_prime[i] * sigma[i + 2];
+        self.ts.extend_from_slice(ts);
+        for (coef, fresh) in [(&mut self.a, a), (&mut self.b, b), (&mut self.c, c), (&mut self.d, d)] {
+            coef.truncate(s);
+            coef.extend(fresh);
         }
-        sigma[0] = 0.0; // natural BC
-
-        // Compute spline coefficients for each segment i in [0, m):
-        // S_i(t) = a_i + b_i*(t-t_i) + c_i*(t-t_i)^2 + d_i*(t-t_i)^3
-        let mut a_v = vec![0.0f64; m];
-        let mut b_v = vec![0.0f64; m];
-        let mut c_v = vec![0.0f64; m];
-        let mut d_v = vec![0.0f64; m];
+    }
 
-        for i in 0..m {
-            a_v[i] = ys[i];
-            b_v[i] = (ys[i + 1] - ys[i]) / h[i]
-                - h[i] * (2.0 * sigma[i] + sigma[i + 1]) / 3.0;
-            c_v[i] = sigma[i];
-            d_v[i] = (sigma[i + 1] - sigma[i]) / (3.0 * h[i]);
+    /// The value at knots `from..`. `a` holds all but the last for splines
+    /// of three or more knots; the last is the final segment's end value.
+    fn knot_values_from(&self, from: usize) -> Vec<f64> {
+        let mut ys = self.a[from..].to_vec();
+        if self.a.len() < self.ts.len() {
+            let last = self.a.len() - 1;
+            ys.push(self.eval_segment(last, self.ts[last + 1]));
         }
+        ys
+    }
+
+    /// Knots and coefficients `[ts, a, b, c, d]`, for serialisation.
+    pub fn parts(&self) -> [&[f64]; 5] {
+        [&self.ts, &self.a, &self.b, &self.c, &self.d]
+    }
 
-        Spline {
-            ts: ts.to_vec(),
-            a: a_v,
-            b: b_v,
-            c: c_v,
-            d: d_v,
+    /// Rebuild a spline from `parts()` without re-solving the system.
+    pub fn from_parts(ts: Vec<f64>, a: Vec<f64>, b: Vec<f64>, c: Vec<f64>, d: Vec<f64>) -> Result<Self, String> {
+        let m = a.len();
+        if b.len() != m || c.len() != m || d.len() != m || m > ts.len() || (m == 0) != ts.is_empty() {
+            return Err(format!("Inconsistent spline parts: {} knots, {m} segments", ts.len()));
         }
+        Ok(Spline { ts, a, b, c, d })
     }
 
     /// Evaluate the spline at time t.
-    /// Clamps t to [t_0, t_n] (no extrapolation).
+    /// Clamps t to [t_0, t_n] (no extrapolation); NaN evaluates at t_0.
     pub fn eval(&self, t: f64) -> f64 {
         let n = self.ts.len();
         if n == 0 {
@@ -141,22 +158,95 @@ impl Spline {
             return self.a[0];
         }
 
-        // Clamp
-        let t = t.clamp(self.ts[0], self.ts[n - 1]);
+        let t = self.clamp_t(t);
+        self.eval_segment(self.segment_index(t), t)
+    }
 
-        // Binary search for the segment index i such that ts[i] <= t < ts[i+1]
-        let m = self.a.len(); // number of segments = n - 1
-        let i = match self.ts.binary_search_by(|v| v.partial_cmp(&t).unwrap()) {
-            Ok(idx) => {
-                // Exact match: use this segment, but cap at last segment
-                idx.min(m - 1)
+    /// Evaluate at `t`, starting the segment search from `cursor` and leaving
+    /// the cursor on the segment containing `t`.
+    ///
+    /// Playback time moves forward a few segments per frame, so the local walk
+    /// almost always finishes in one or two steps; only a jump further than
+    /// `CURSOR_MAX_WALK` segments falls back to a binary search.
+    pub fn eval_hint(&self, t: f64, cursor: &mut SplineCursor) -> f64 {
+        let n = self.ts.len();
+        if n == 0 {
+            return 0.0;
+        }
+        if n == 1 {
+            return self.a[0];
+        }
+
+        let t = self.clamp_t(t);
+        cursor.seg = self.locate(t, cursor.seg);
+        self.eval_segment(cursor.seg, t)
+    }
+
+    /// Evaluate at two nearby times (e.g. a position and its heading
+    /// look-ahead) with one search. The cursor is left on `t0`'s segment.
+    pub fn eval_pair(&self, t0: f64, t1: f64, cursor: &mut SplineCursor) -> (f64, f64) {
+        let v0 = self.eval_hint(t0, cursor);
+        let mut ahead = *cursor;
+        let v1 = self.eval_hint(t1, &mut ahead);
+        (v0, v1)
+    }
+
+    /// Evaluate at every `ts[k]` into `out[k]`. Sorted times walk the
+    /// segments forward once, a step or two per point; unsorted times are
+    /// still correct, falling back to a binary search on long jumps.
+    pub fn eval_many(&self, ts: &[f64], out: &mut [f64]) {
+        assert_eq!(ts.len(), out.len(), "eval_many output length mismatch");
+        match self.ts.len() {
+            0 => out.fill(0.0),
+            1 => out.fill(self.a[0]),
+            _ => {
+                let mut seg = 0;
+                for (o, &t) in out.iter_mut().zip(ts) {
+                    let t = self.clamp_t(t);
+                    seg = self.locate(t, seg);
+                    *o = self.eval_segment(seg, t);
+                }
             }
-            Err(idx) => {
-                // idx is the insertion point; the segment is idx-1
-                if idx == 0 { 0 } else { (idx - 1).min(m - 1) }
+        }
+    }
+
+    fn clamp_t(&self, t: f64) -> f64 {
+        let n = self.ts.len();
+        if t.is_nan() {
+            self.ts[0]
+        } else {
+            t.clamp(self.ts[0], self.ts[n - 1])
+        }
+    }
+
+    /// Segment index i such that ts[i] <= t < ts[i+1], capped at the last
+    /// segment. `t` must already be clamped.
+    fn segment_index(&self, t: f64) -> usize {
+        let m = self.a.len(); // number of segments = n - 1
+        let idx = self.ts.partition_point(|&v| v <= t);
+        idx.saturating_sub(1).min(m - 1)
+    }
+
+    /// Like `segment_index`, but walks locally from `hint` first.
+    fn locate(&self, t: f64, hint: usize) -> usize {
+        let m = self.a.len();
+        let mut i = hint.min(m - 1);
+        for _ in 0..CURSOR_MAX_WALK {
+            if t < self.ts[i] {
+                if i == 0 {
+                    return 0;
+                }
+                i -= 1;
+            } else if i + 1 < m && t >= self.ts[i + 1] {
+                i += 1;
+            } else {
+                return i;
             }
-        };
+        }
+        self.segment_index(t)
+    }
 
+    fn eval_segment(&self, i: usize, t: f64) -> f64 {
         let dt = t - self.ts[i];
         self.a[i] + self.b[i] * dt + self.c[i] * dt * dt + self.d[i] * dt * dt * dt
     }
@@ -167,6 +257,89 @@ impl Spline {
     }
 }
 
+/// Solve for the segment coefficients `[a, b, c, d]` of a cubic spline
+/// through (ts, ys), at least three points, with second-derivative term
+/// `c_start` at the first knot and a natural (zero) end at the last.
+///
+/// Interior equations, with `sigma` the `c` coefficient at each knot:
+///   h[i-1]*sigma[i-1] + 2*(h[i-1]+h[i])*sigma[i] + h[i]*sigma[i+1]
+///     = 3 * ((ys[i+1]-ys[i])/h[i] - (ys[i]-ys[i-1])/h[i-1])
+/// solved for sigma[1..n-2] with the Thomas algorithm.
+fn solve_segments(ts: &[f64], ys: &[f64], c_start: f64) -> [Vec<f64>; 4] {
+    let n = ts.len();
+    debug_assert!(n >= 3);
+
+    // Number of intervals
+    let m = n - 1;
+
+    // Step sizes
+    let h: Vec<f64> = (0..m).map(|i| ts[i + 1] - ts[i]).collect();
+
+    let interior = n - 2; // number of unknowns
+
+    let mut diag = vec![0.0f64; interior];
+    let mut upper = vec![0.0f64; interior - 1];
+    let mut lower = vec![0.0f64; interior - 1];
+    let mut rhs = vec![0.0f64; interior];
+
+    for i in 0..interior {
+        let gi = i + 1; // global index
+        diag[i] = 2.0 * (h[gi - 1] + h[gi]);
+        rhs[i] = 3.0 * ((ys[gi + 1] - ys[gi]) / h[gi] - (ys[gi] - ys[gi - 1]) / h[gi - 1]);
+    }
+    // The known first value moves to the right-hand side
+    rhs[0] -= h[0] * c_start;
+    for i in 0..interior - 1 {
+        let gi = i + 1;
+        upper[i] = h[gi];
+        lower[i] = h[gi];
+    }
+
+    // Thomas algorithm (forward sweep + back substitution)
+    let mut c_prime = vec![0.0f64; interior];
+    let mut d_prime = vec![0.0f64; interior];
+
+    // When interior == 1 there are no off-diagonal entries; skip c_prime[0]
+    if interior > 1 {
+        c_prime[0] = upper[0] / diag[0];
+    }
+    d_prime[0] = rhs[0] / diag[0];
+
+    for i in 1..interior {
+        let denom = diag[i] - lower[i - 1] * c_prime[i - 1];
+        if i < interior - 1 {
+            c_prime[i] = upper[i] / denom;
+        }
+        d_prime[i] = (rhs[i] - lower[i - 1] * d_prime[i - 1]) / denom;
+    }
+
+    // Back substitution
+    let mut sigma = vec![0.0f64; n];
+    sigma[n - 1] = 0.0; // natural BC
+    sigma[interior] = d_prime[interior - 1]; // sigma[n-2]
+    for i in (0..interior - 1).rev() {
+        sigma[i + 1] = d_prime[i] - c_prime[i] * sigma[i + 2];
+    }
+    sigma[0] = c_start;
+
+    // Compute spline coefficients for each segment i in [0, m):
+    // S_i(t) = a_i + b_i*(t-t_i) + c_i*(t-t_i)^2 + d_i*(t-t_i)^3
+    let mut a_v = vec![0.0f64; m];
+    let mut b_v = vec![0.0f64; m];
+    let mut c_v = vec![0.0f64; m];
+    let mut d_v = vec![0.0f64; m];
+
+    for i in 0..m {
+        a_v[i] = ys[i];
+        b_v[i] = (ys[i + 1] - ys[i]) / h[i]
+            - h[i] * (2.0 * sigma[i] + sigma[i + 1]) / 3.0;
+        c_v[i] = sigma[i];
+        d_v[i] = (sigma[i + 1] - sigma[i]) / (3.0 * h[i]);
+    }
+
+    [a_v, b_v, c_v, d_v]
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -234,6 +407,41 @@ mod tests {
         assert!((s.eval(5.0) - 10.0).abs() < 1e-6);
     }
 
+    #[test]
+    fn test_spline_nan_does_not_panic() {
+        let s = Spline::new(&[0.0, 1.0, 2.0], &[3.0, 4.0, 5.0]);
+        assert_eq!(s.eval(f64::NAN), 3.0);
+        let mut cursor = SplineCursor::default();
+        assert_eq!(s.eval_hint(f64::NAN, &mut cursor), 3.0);
+    }
+
+    #[test]
+    fn test_cursor_matches_eval() {
+        let ts: Vec<f64> = (0..500).map(|i| i as f64 * 0.27).collect();
+        let ys: Vec<f64> = ts.iter().map(|t| (t * 0.3).sin() * 100.0).collect();
+        let s = Spline::new(&ts, &ys);
+        let mut cursor = SplineCursor::default();
+        // Forward sweep, a backward step, a big jump and out-of-range values
+        let probes = [0.0, 0.1, 0.5, 3.3, 3.2, 100.0, 2.0, 134.0, 500.0, -1.0, 13.5];
+        for &t in &probes {
+            let want = s.eval(t);
+            let got = s.eval_hint(t, &mut cursor);
+            assert_eq!(got, want, "t={t}");
+        }
+    }
+
+    #[test]
+    fn test_eval_pair_leaves_cursor_on_first_time() {
+        let ts: Vec<f64> = (0..100).map(|i| i as f64).collect();
+        let ys: Vec<f64> = ts.iter().map(|t| t * 2.0).collect();
+        let s = Spline::new(&ts, &ys);
+        let mut cursor = SplineCursor::default();
+        let (a, b) = s.eval_pair(10.5, 12.5, &mut cursor);
+        assert!((a - 21.0).abs() < 1e-9);
+        assert!((b - 25.0).abs() < 1e-9);
+        assert_eq!(cursor.segment(), 10);
+    }
+
     #[test]
     fn test_spline_non_uniform_spacing() {
         // Non-uniform: 0, 0.1, 5.0, 5.1, 10.0
@@ -244,4 +452,49 @@ mod tests {
         assert!((s.eval(2.5) - 2.5).abs() < 0.5);
         assert!((s.eval(7.5) - 7.5).abs() < 0.5);
     }
+
+    #[test]
+    fn test_eval_many_matches_eval() {
+        let ts: Vec<f64> = (0..50).map(|i| i as f64 * 0.3).collect();
+        let ys: Vec<f64> = ts.iter().map(|t| (t * 0.7).sin() * 100.0).collect();
+        let s = Spline::new(&ts, &ys);
+        // Sorted, with points outside the knots, then a shuffled order
+        let mut queries: Vec<f64> = (0..400).map(|i| i as f64 * 0.04 - 1.0).collect();
+        let mut out = vec![0.0; queries.len()];
+        for _ in 0..2 {
+            s.eval_many(&queries, &mut out);
+            for (&q, &v) in queries.iter().zip(&out) {
+                assert_eq!(v, s.eval(q), "t = {q}");
+            }
+            queries.reverse();
+            queries.rotate_left(137);
+        }
+        let empty = Spline::new(&[], &[]);
+        empty.eval_many(&[1.0, 2.0], &mut out[..2]);
+        assert_eq!(out[..2], [0.0, 0.0]);
+    }
+
+    #[test]
+    fn test_extend_matches_full_solve() {
+        let ts: Vec<f64> = (0..400).map(|i| i as f64 * 0.27 + (i as f64 * 1.3).sin() * 0.05).collect();
+        let ys: Vec<f64> = ts.iter().map(|t| (t * 0.4).sin() * 500.0 + t * 3.0).collect();
+        let full = Spline::new(&ts, &ys);
+
+        // From empty, in chunks of mixed sizes (including ones below the window)
+        let mut live = Spline::new(&[], &[]);
+        let mut at = 0;
+        for len in [1, 2, 5, 40, 3, 100, 1, 97, 151].into_iter().cycle() {
+            let end = (at + len).min(ts.len());
+            live.extend(&ts[at..end], &ys[at..end]);
+            at = end;
+            if at == ts.len() {
+                break;
+            }
+        }
+        assert_eq!(live.parts()[0], full.parts()[0]);
+        for k in 0..4_000 {
+            let t = k as f64 * 0.027;
+            assert!((live.eval(t) - full.eval(t)).abs() < 1e-9, "t = {t}");
+        }
+    }
 }
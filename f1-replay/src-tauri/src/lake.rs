@@ -0,0 +1,227 @@
+//! Where a session's telemetry lives: the DuckDB tables or the
+//! Hive-partitioned Parquet lake written by `main.py --telemetry-lake`.
+//!
+//! ```text
+//! <db stem>.lake/{position,car,merged}_telemetry/year=Y/event=E/session=S/driver=D/*.parquet
+//! ```
+//!
+//! `event` and `session` are slugs (`partition_slug`). The partition columns
+//! replace `Year`, `Session` and `DriverNumber` inside the files, so
+//! `TelemetrySource` renames them back and queries written against the
+//! DuckDB tables run unchanged over the lake. Sessions the lake does not
+//! hold are read from the tables.
+//!
+//! Ingest also materialises `merged_telemetry` (position ASOF JOIN car,
+//! aligned and clamped). When that exists for a session, readers scan it
+//! instead of joining at load time.
+
+use duckdb::Connection;
+use std::path::{Path, PathBuf};
+use std::time::SystemTime;
+
+/// Relations to read a session's telemetry from, substituted for the
+/// `{position}`, `{car}` and `{merged}` placeholders in query templates.
+#[derive(Debug, Clone, PartialEq)]
+pub struct TelemetrySource {
+    pub position: String,
+    pub car: String,
+    /// Pre-joined telemetry, when ingest materialised it for this session.
+    pub merged: Option<String>,
+}
+
+impl TelemetrySource {
+    /// The lake partitions for this session when both telemetry tables are
+    /// present there, otherwise the DuckDB tables.
+    pub fn resolve(db_path: &str, event_name: &str, session: &str) -> Self {
+        let root = lake_dir(db_path);
+        let event = partition_slug(event_name);
+        let session = partition_slug(session);
+        let in_lake = |table: &str| has_session(&root.join(table), &event, &session);
+
+        let mut source = if in_lake("position_telemetry") && in_lake("car_telemetry") {
+            TelemetrySource {
+                position: lake_relation(&root, "position_telemetry", &event, &session),
+                car: lake_relation(&root, "car_telemetry", &event, &session),
+                merged: None,
+            }
+        } else {
+            TelemetrySource::tables()
+        };
+        if in_lake("merged_telemetry") {
+            source.merged = Some(lake_relation(&root, "merged_telemetry", &event, &session));
+        }
+        source
+    }
+
+    /// Fall back to the `merged_telemetry` table when the lake did not
+    /// provide merged rows and the table has this session.
+    pub fn with_merged_table(mut self, conn: &Connection, event_name: &str, session: &str) -> Self {
+        if self.merged.is_none() && merged_table_has(conn, event_name, session) {
+            self.merged = Some("merged_telemetry".to_string());
+        }
+        self
+    }
+
+    pub fn tables() -> Self {
+        TelemetrySource {
+            position: "position_telemetry".to_string(),
+            car: "car_telemetry".to_string(),
+            merged: None,
+        }
+    }
+
+    pub fn apply(&self, template: &str) -> String {
+        let sql = template.replace("{position}", &self.position).replace("{car}", &self.car);
+        match &self.merged {
+            Some(merged) => sql.replace("{merged}", merged),
+            None => sql,
+        }
+    }
+}
+
+pub fn lake_dir(db_path: &str) -> PathBuf {
+    Path::new(db_path).with_extension("lake")
+}
+
+/// Partition value for a free-text field: runs of anything but ASCII
+/// letters and digits become one `_`. Must match the `regexp_replace` in
+/// `main.py`.
+pub fn partition_slug(value: &str) -> String {
+    let mut out = String::with_capacity(value.len());
+    let mut in_gap = false;
+    for c in value.chars() {
+        if c.is_ascii_alphanumeric() {
+            out.push(c);
+            in_gap = false;
+        } else if !in_gap {
+            out.push('_');
+            in_gap = true;
+        }
+    }
+    out
+}
+
+/// Whether `relation` (a `TelemetrySource` field) is a DuckDB table rather
+/// than a `read_parquet` over the lake, which is always parenthesised.
+pub fn is_table(relation: &str) -> bool {
+    !relation.starts_with('(')
+}
+
+/// Every file under this session's partitions of every lake table, with its
+/// size and modification time, sorted by path. Ingest rewrites a session's
+/// partitions rather than editing files in place, so this changes whenever
+/// the session's lake rows do, without reading any of them.
+pub fn session_files(db_path: &str, event_name: &str, session: &str) -> Vec<(PathBuf, u64, SystemTime)> {
+    let root = lake_dir(db_path);
+    let (event, session) = (partition_slug(event_name), partition_slug(session));
+    let entries = |dir: &Path| std::fs::read_dir(dir).into_iter().flatten().flatten().map(|e| e.path());
+
+    let mut files: Vec<(PathBuf, u64, SystemTime)> = ["position_telemetry", "car_telemetry", "merged_telemetry"]
+        .iter()
+        .flat_map(|table| entries(&root.join(table)).collect::<Vec<_>>())
+        .map(|year| year.join(format!("event={event}")).join(format!("session={session}")))
+        .flat_map(|dir| entries(&dir).collect::<Vec<_>>())
+        .flat_map(|driver| entries(&driver).collect::<Vec<_>>())
+        .filter_map(|file| {
+            let meta = std::fs::metadata(&file).ok().filter(|m| m.is_file())?;
+            Some((file, meta.len(), meta.modified().ok()?))
+        })
+        .collect();
+    files.sort();
+    files
+}
+
+fn merged_table_has(conn: &Connection, event_name: &str, session: &str) -> bool {
+    let table_exists = conn
+        .prepare("SELECT COUNT(*) FROM information_schema.tables WHERE table_name = 'merged_telemetry'")
+        .and_then(|mut stmt| stmt.query_row([], |row| row.get::<i64>(0)))
+        .is_ok_and(|n| n > 0);
+    table_exists
+        && conn
+            .prepare("SELECT COUNT(*) FROM (SELECT 1 FROM merged_telemetry WHERE EventName = ? AND Session = ? LIMIT 1)")
+            .and_then(|mut stmt| stmt.query_row([event_name, session], |row| row.get::<i64>(0)))
+            .is_ok_and(|n| n > 0)
+}
+
+/// Whether any `year=*/event=<event>/session=<session>` directory exists.
+fn has_session(table_dir: &Path, event: &str, session: &str) -> bool {
+    let Ok(years) = std::fs::read_dir(table_dir) else {
+        return false;
+    };
+    years.flatten().any(|year| {
+        year.path()
+            .join(format!("event={event}"))
+            .join(format!("session={session}"))
+            .is_dir()
+    })
+}
+
+/// `read_parquet` over one session's partitions, exposing the same columns
+/// as the DuckDB table. `event` and `session` are slugs, so the only text
+/// needing SQL escaping is the lake path itself.
+fn lake_relation(root: &Path, table: &str, event: &str, session: &str) -> String {
+    let glob = root
+        .join(table)
+        .join("year=*")
+        .join(format!("event={event}"))
+        .join(format!("session={session}"))
+        .join("driver=*")
+        .join("*.parquet");
+    let glob = glob.to_string_lossy().replace('\'', "''");
+    format!(
+        "(SELECT * EXCLUDE (year, event, session, driver), \
+                CAST(year AS INTEGER) AS Year, \
+                CAST(session AS VARCHAR) AS Session, \
+                CAST(driver AS VARCHAR) AS DriverNumber \
+         FROM read_parquet('{glob}', hive_partitioning = true))"
+    )
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_partition_slug_collapses_runs() {
+        assert_eq!(partition_slug("Las Vegas Grand Prix"), "Las_Vegas_Grand_Prix");
+        assert_eq!(partition_slug("São Paulo  GP"), "S_o_Paulo_GP");
+        assert_eq!(partition_slug("FP1"), "FP1");
+    }
+
+    #[test]
+    fn test_resolve_falls_back_to_tables() {
+        let src = TelemetrySource::resolve("/nonexistent/f1.duckdb", "Monza", "R");
+        assert_eq!(src, TelemetrySource::tables());
+        assert_eq!(src.apply("SELECT * FROM {position} JOIN {car}"), "SELECT * FROM position_telemetry JOIN car_telemetry");
+    }
+
+    #[test]
+    fn test_resolve_uses_lake_partitions() {
+        let root = std::env::temp_dir().join(format!("f1-lake-test-{}", std::process::id()));
+        let db = root.join("f1.duckdb");
+        for table in ["position_telemetry", "car_telemetry", "merged_telemetry"] {
+            let dir = root.join(format!("f1.lake/{table}/year=2024/event=Las_Vegas_Grand_Prix/session=R"));
+            std::fs::create_dir_all(dir).unwrap();
+        }
+        let src = TelemetrySource::resolve(db.to_str().unwrap(), "Las Vegas Grand Prix", "R");
+        assert!(src.position.contains("read_parquet("));
+        assert!(src.position.contains("event=Las_Vegas_Grand_Prix"));
+        assert!(src.car.contains("car_telemetry"));
+        assert!(src.merged.as_deref().is_some_and(|m| m.contains("merged_telemetry")));
+        assert!(src.apply("FROM {merged}").contains("read_parquet("));
+        // Only some sessions may be in the lake
+        assert_eq!(TelemetrySource::resolve(db.to_str().unwrap(), "Las Vegas Grand Prix", "Q"), TelemetrySource::tables());
+        assert!(!is_table(&src.position) && is_table(&TelemetrySource::tables().position));
+
+        let db = db.to_str().unwrap();
+        assert!(session_files(db, "Las Vegas Grand Prix", "R").is_empty());
+        let driver = root.join("f1.lake/car_telemetry/year=2024/event=Las_Vegas_Grand_Prix/session=R/driver=1");
+        std::fs::create_dir_all(&driver).unwrap();
+        std::fs::write(driver.join("data_0.parquet"), b"PAR1").unwrap();
+        let files = session_files(db, "Las Vegas Grand Prix", "R");
+        assert_eq!(files.len(), 1);
+        assert_eq!((files[0].0.file_name().unwrap(), files[0].1), ("data_0.parquet".as_ref(), 4));
+        assert!(session_files(db, "Las Vegas Grand Prix", "Q").is_empty());
+        std::fs::remove_dir_all(root).unwrap();
+    }
+}
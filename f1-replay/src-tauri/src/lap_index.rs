@@ -0,0 +1,531 @@
+//! Distance indexes over laps and the circuit.
+//!
+//! `LapIndex` (one per driver) holds every sample's arc length since the
+//! start of its lap and the sample range of each lap, so a lap's telemetry is
+//! a slice rather than a time filter plus a fresh distance pass.
+//!
+//! `TrackIndex` (one per session) projects every sample onto a reference lap
+//! and unwraps the projection into a monotone race distance. "Where is
+//! everyone on the lap" is then one search per driver, and "when did this
+//! car reach lap N, distance d" is a binary search over race distance, which
+//! is all the running gap and interval charts need. It also keeps the
+//! reference line's curvature profile for `lap_sim`.
+
+use crate::lap_sim::TrackProfile;
+use crate::session::{DriverData, LapRecord, SampleColumns, SessionData};
+use crate::telemetry_analysis::compute_distances;
+use crate::types::{DriverGaps, DriverId, GapChart, TrackPosition};
+use rayon::prelude::*;
+use std::ops::Range;
+
+/// Green-flag lap times; anything outside (SC, in- and out-laps) is never
+/// used for distance telemetry or as the reference lap.
+pub const MIN_LAP_S: f64 = 60.0;
+pub const MAX_LAP_S: f64 = 200.0;
+
+/// Edge of the reference line's lookup grid cells (metres).
+const GRID_CELL_M: f32 = 50.0;
+/// A projection within this distance of the previous sample's part of the
+/// lap is kept, even where another part of the circuit runs closer.
+const HINT_TOLERANCE_M: f32 = 25.0;
+/// Reference segments searched behind and ahead of the previous sample's.
+const HINT_BEHIND: usize = 2;
+const HINT_AHEAD: usize = 16;
+
+pub const DEFAULT_GAP_POINTS: usize = 500;
+const MAX_GAP_POINTS: usize = 5_000;
+
+// ── Per-driver lap index ─────────────────────────────────────────────────────
+
+#[derive(Debug, Default)]
+pub struct LapIndex {
+    /// Arc length (m) of each sample since its lap's first sample. Samples
+    /// before the first lap count from the first sample.
+    lap_distance: Vec<f32>,
+    /// `offsets[i]..offsets[i + 1]` are the samples of `laps[i]`.
+    offsets: Vec<u32>,
+}
+
+impl LapIndex {
+    pub fn build(samples: &SampleColumns, laps: &[LapRecord]) -> Self {
+        let n = samples.len();
+        let mut offsets: Vec<u32> = Vec::with_capacity(laps.len() + 1);
+        for lap in laps {
+            let start = samples.times.partition_point(|&t| t < lap.lap_start_time_s) as u32;
+            offsets.push(start.max(offsets.last().copied().unwrap_or(0)));
+        }
+        if !laps.is_empty() {
+            offsets.push(n as u32);
+        }
+
+        let cuts: Vec<usize> = std::iter::once(0)
+            .chain(offsets.iter().take(laps.len()).map(|&o| o as usize))
+            .chain(std::iter::once(n))
+            .collect();
+        let mut lap_distance = Vec::with_capacity(n);
+        for w in cuts.windows(2) {
+            lap_distance.extend(compute_distances(&samples.xs[w[0]..w[1]], &samples.ys[w[0]..w[1]]));
+        }
+
+        LapIndex { lap_distance, offsets }
+    }
+
+    /// Position of lap `lap_number` in `laps` (sorted by lap number): a direct
+    /// slot when the numbers are consecutive, else a binary search.
+    pub fn lap_position(laps: &[LapRecord], lap_number: u32) -> Option<usize> {
+        let guess = lap_number.checked_sub(laps.first()?.lap_number)? as usize;
+        if laps.get(guess).is_some_and(|l| l.lap_number == lap_number) {
+            return Some(guess);
+        }
+        laps.binary_search_by_key(&lap_number, |l| l.lap_number).ok()
+    }
+
+    /// Samples of `laps[lap]`.
+    pub fn lap_samples(&self, lap: usize) -> Range<usize> {
+        self.offsets[lap] as usize..self.offsets[lap + 1] as usize
+    }
+
+    /// Distances of `lap_samples(lap)` from the lap's first sample.
+    pub fn lap_distances(&self, lap: usize) -> &[f32] {
+        &self.lap_distance[self.lap_samples(lap)]
+    }
+
+    pub fn heap_bytes(&self) -> usize {
+        self.lap_distance.len() * 4 + self.offsets.len() * 4
+    }
+}
+
+/// The driver's lap index; the first call builds it.
+pub fn lap_index(driver: &DriverData) -> &LapIndex {
+    driver.lap_index.get_or_init(|| LapIndex::build(&driver.samples, &driver.laps))
+}
+
+// ── Reference line ───────────────────────────────────────────────────────────
+
+/// One lap of the circuit as a closed polyline, with a uniform grid over its
+/// segments for nearest-point queries.
+pub struct ReferenceLine {
+    /// The last point repeats the first.
+    points: Vec<[f32; 2]>,
+    /// Distance along the line at each point; the last is the lap length.
+    dist: Vec<f32>,
+    origin: [f32; 2],
+    cols: usize,
+    rows: usize,
+    /// Segments overlapping cell `c` are `segs[cell_start[c]..cell_start[c + 1]]`.
+    cell_start: Vec<u32>,
+    segs: Vec<u32>,
+}
+
+impl ReferenceLine {
+    /// The driver's fastest green-flag lap, or `None` without one.
+    pub fn from_driver(driver: &DriverData) -> Option<Self> {
+        let index = lap_index(driver);
+        let laps = &driver.laps;
+        let lap_time = |i: usize| laps[i + 1].lap_start_time_s - laps[i].lap_start_time_s;
+        let best = (0..laps.len().saturating_sub(1))
+            .filter(|&i| (MIN_LAP_S..=MAX_LAP_S).contains(&lap_time(i)) && index.lap_samples(i).len() >= 10)
+            .min_by(|&a, &b| lap_time(a).total_cmp(&lap_time(b)))?;
+
+        let s = &driver.samples;
+        let mut points: Vec<[f32; 2]> = index.lap_samples(best).map(|i| [s.xs[i], s.ys[i]]).collect();
+        points.push(points[0]);
+        Self::from_points(points)
+    }
+
+    fn from_points(points: Vec<[f32; 2]>) -> Option<Self> {
+        let xs: Vec<f32> = points.iter().map(|p| p[0]).collect();
+        let ys: Vec<f32> = points.iter().map(|p| p[1]).collect();
+        let dist = compute_distances(&xs, &ys);
+        if *dist.last()? < 100.0 {
+            return None;
+        }
+
+        let min = |v: &[f32]| v.iter().copied().fold(f32::INFINITY, f32::min);
+        let max = |v: &[f32]| v.iter().copied().fold(f32::NEG_INFINITY, f32::max);
+        let origin = [min(&xs), min(&ys)];
+        let cols = ((max(&xs) - origin[0]) / GRID_CELL_M) as usize + 1;
+        let rows = ((max(&ys) - origin[1]) / GRID_CELL_M) as usize + 1;
+
+        let mut line = ReferenceLine { points, dist, origin, cols, rows, cell_start: Vec::new(), segs: Vec::new() };
+
+        // Bin every segment into each cell its bounding box overlaps
+        let mut cells: Vec<Vec<u32>> = vec![Vec::new(); cols * rows];
+        for seg in 0..line.points.len() - 1 {
+            let [a, b] = [line.points[seg], line.points[seg + 1]];
+            let (c0, r0) = line.cell_of([a[0].min(b[0]), a[1].min(b[1])]);
+            let (c1, r1) = line.cell_of([a[0].max(b[0]), a[1].max(b[1])]);
+            for r in r0..=r1 {
+                for c in c0..=c1 {
+                    cells[r * cols + c].push(seg as u32);
+                }
+            }
+        }
+        line.cell_start.push(0);
+        for cell in cells {
+            line.segs.extend(cell);
+            line.cell_start.push(line.segs.len() as u32);
+        }
+        Some(line)
+    }
+
+    pub fn length_m(&self) -> f32 {
+        *self.dist.last().expect("reference lines have points")
+    }
+
+    /// `n` points evenly spaced along the line from its start, interpolated
+    /// between the recorded ones.
+    pub fn resample(&self, n: usize) -> Vec<[f32; 2]> {
+        let step = self.length_m() / n as f32;
+        let mut seg = 0;
+        (0..n)
+            .map(|k| {
+                let d = k as f32 * step;
+                while seg + 2 < self.dist.len() && self.dist[seg + 1] <= d {
+                    seg += 1;
+                }
+                let (d0, d1) = (self.dist[seg], self.dist[seg + 1]);
+                let t = if d1 > d0 { ((d - d0) / (d1 - d0)).clamp(0.0, 1.0) } else { 0.0 };
+                let [a, b] = [self.points[seg], self.points[seg + 1]];
+                [a[0] + (b[0] - a[0]) * t, a[1] + (b[1] - a[1]) * t]
+            })
+            .collect()
+    }
+
+    /// Grid cell containing `p`, clamped to the grid.
+    fn cell_of(&self, p: [f32; 2]) -> (usize, usize) {
+        let c = ((p[0] - self.origin[0]) / GRID_CELL_M).max(0.0) as usize;
+        let r = ((p[1] - self.origin[1]) / GRID_CELL_M).max(0.0) as usize;
+        (c.min(self.cols - 1), r.min(self.rows - 1))
+    }
+
+    /// Squared distance from `p` to segment `seg` and the distance along the
+    /// line of the nearest point on it.
+    fn project_onto(&self, seg: usize, p: [f32; 2]) -> (f32, f32) {
+        let [a, b] = [self.points[seg], self.points[seg + 1]];
+        let (abx, aby) = (b[0] - a[0], b[1] - a[1]);
+        let len2 = abx * abx + aby * aby;
+        let t = if len2 < 1e-6 { 0.0 } else { (((p[0] - a[0]) * abx + (p[1] - a[1]) * aby) / len2).clamp(0.0, 1.0) };
+        let (dx, dy) = (a[0] + t * abx - p[0], a[1] + t * aby - p[1]);
+        (dx * dx + dy * dy, self.dist[seg] + t * (self.dist[seg + 1] - self.dist[seg]))
+    }
+
+    fn nearest(&self, p: [f32; 2], segs: impl Iterator<Item = usize>) -> Option<(f32, usize, f32)> {
+        segs.map(|seg| {
+            let (d2, along) = self.project_onto(seg, p);
+            (d2, seg, along)
+        })
+        .min_by(|a, b| a.0.total_cmp(&b.0))
+    }
+
+    /// Nearest point of the line to `p` as (segment, distance along the line).
+    /// `hint` is the previous sample's segment; staying near it keeps the
+    /// projection on the right part of the lap where the circuit doubles back.
+    pub fn project(&self, p: [f32; 2], hint: Option<usize>) -> (usize, f32) {
+        let n_seg = self.points.len() - 1;
+        if let Some(h) = hint {
+            let window = (0..=HINT_BEHIND + HINT_AHEAD).map(|k| (h + n_seg + k - HINT_BEHIND) % n_seg);
+            if let Some((d2, seg, along)) = self.nearest(p, window) {
+                if d2 <= HINT_TOLERANCE_M * HINT_TOLERANCE_M {
+                    return (seg, along);
+                }
+            }
+        }
+
+        // Anything within one cell of `p` is binned in its 3×3 neighbourhood,
+        // so a hit that close is the true nearest; otherwise scan everything.
+        let (c, r) = self.cell_of(p);
+        let neighbourhood = (r.saturating_sub(1)..=(r + 1).min(self.rows - 1)).flat_map(|r| {
+            (c.saturating_sub(1)..=(c + 1).min(self.cols - 1)).flat_map(move |c| {
+                let cell = r * self.cols + c;
+                self.segs[self.cell_start[cell] as usize..self.cell_start[cell + 1] as usize].iter().map(|&s| s as usize)
+            })
+        });
+        match self.nearest(p, neighbourhood) {
+            Some((d2, seg, along)) if d2 <= GRID_CELL_M * GRID_CELL_M => (seg, along),
+            _ => {
+                let (_, seg, along) = self.nearest(p, 0..n_seg).expect("reference lines have segments");
+                (seg, along)
+            }
+        }
+    }
+
+    /// Monotone race distance at each of the driver's samples: the unwrapped
+    /// projection, shifted by whole laps so lap 1 starts within half a lap of 0.
+    fn race_distances(&self, driver: &DriverData) -> Vec<f32> {
+        let s = &driver.samples;
+        let lap_m = self.length_m() as f64;
+        let mut out: Vec<f64> = Vec::with_capacity(s.len());
+        let (mut hint, mut prev, mut unwrapped, mut furthest) = (None, 0.0_f64, 0.0_f64, f64::NEG_INFINITY);
+        for i in 0..s.len() {
+            let (seg, along) = self.project([s.xs[i], s.ys[i]], hint);
+            let along = along as f64;
+            if hint.is_none() {
+                unwrapped = along;
+            } else {
+                let mut step = along - prev;
+                if step > lap_m / 2.0 {
+                    step -= lap_m;
+                } else if step < -lap_m / 2.0 {
+                    step += lap_m;
+                }
+                unwrapped += step;
+            }
+            hint = Some(seg);
+            prev = along;
+            // Cars don't reverse; projection noise backwards is held
+            furthest = furthest.max(unwrapped);
+            out.push(furthest);
+        }
+
+        let anchor = driver
+            .laps
+            .iter()
+            .find(|l| l.lap_number == 1)
+            .and_then(|l| s.asof_index(l.lap_start_time_s))
+            .or_else(|| (!out.is_empty()).then_some(0));
+        let shift = anchor.map_or(0.0, |i| -lap_m * (out[i] / lap_m).round());
+        out.into_iter().map(|d| (d + shift) as f32).collect()
+    }
+}
+
+/// Reference line from the layout driver's fastest lap, falling back to any
+/// driver with a green-flag lap.
+pub fn reference_line(drivers: &[DriverData]) -> Option<ReferenceLine> {
+    let layout = drivers.iter().find(|d| d.driver_number == "1").or_else(|| drivers.first());
+    layout.into_iter().chain(drivers).find_map(ReferenceLine::from_driver)
+}
+
+// ── Session track index ──────────────────────────────────────────────────────
+
+pub struct TrackIndex {
+    reference: Option<ReferenceLine>,
+    /// Race distance (m) at each sample, per driver in session order; empty
+    /// without a reference line.
+    race_distance: Vec<Vec<f32>>,
+    /// The reference line as `lap_sim` sees it.
+    profile: Option<TrackProfile>,
+}
+
+impl TrackIndex {
+    pub fn build(drivers: &[DriverData]) -> Self {
+        let reference = reference_line(drivers);
+        let race_distance = match &reference {
+            Some(line) => drivers.par_iter().map(|d| line.race_distances(d)).collect(),
+            None => vec![Vec::new(); drivers.len()],
+        };
+        let profile = reference.as_ref().and_then(TrackProfile::from_reference);
+        TrackIndex { reference, race_distance, profile }
+    }
+
+    pub fn lap_length_m(&self) -> Option<f32> {
+        self.reference.as_ref().map(ReferenceLine::length_m)
+    }
+
+    pub fn profile(&self) -> Option<&TrackProfile> {
+        self.profile.as_ref()
+    }
+
+    /// The reference lap as `n` evenly spaced points, for drawing the track.
+    pub fn outline(&self, n: usize) -> Option<Vec<[f32; 2]>> {
+        self.reference.as_ref().map(|r| r.resample(n))
+    }
+
+    pub fn heap_bytes(&self) -> usize {
+        let reference = self.reference.as_ref().map_or(0, |r| r.points.len() * 12 + (r.segs.len() + r.cell_start.len()) * 4);
+        let profile = self.profile.as_ref().map_or(0, TrackProfile::heap_bytes);
+        reference + profile + self.race_distance.iter().map(|d| d.len() * 4).sum::<usize>()
+    }
+
+    /// Race distance of driver `id` at `time_s`, interpolated between
+    /// samples; `None` outside the driver's data.
+    pub fn distance_at(&self, id: usize, samples: &SampleColumns, time_s: f64) -> Option<f64> {
+        let rd = self.race_distance.get(id).filter(|d| !d.is_empty())?;
+        let ts = &samples.times;
+        if !(ts[0]..=ts[ts.len() - 1]).contains(&time_s) {
+            return None;
+        }
+        let i = ts.partition_point(|&t| t <= time_s).saturating_sub(1);
+        let Some(&t1) = ts.get(i + 1) else {
+            return Some(rd[i] as f64);
+        };
+        let frac = if t1 > ts[i] { (time_s - ts[i]) / (t1 - ts[i]) } else { 0.0 };
+        Some(rd[i] as f64 + (rd[i + 1] - rd[i]) as f64 * frac)
+    }
+
+    /// When driver `id` first reached `distance_m`, interpolated between
+    /// samples; `None` if it never did. Lap N, distance d along it, is
+    /// `(N - 1) * lap_length_m() + d`.
+    pub fn time_at_distance(&self, id: usize, samples: &SampleColumns, distance_m: f64) -> Option<f64> {
+        let rd = self.race_distance.get(id)?;
+        let j = rd.partition_point(|&d| (d as f64) < distance_m);
+        let ts = &samples.times;
+        match j {
+            _ if j == rd.len() => None,
+            0 => Some(ts[0]),
+            _ => {
+                let (d0, d1) = (rd[j - 1] as f64, rd[j] as f64);
+                let frac = if d1 > d0 { (distance_m - d0) / (d1 - d0) } else { 1.0 };
+                Some(ts[j - 1] + (ts[j] - ts[j - 1]) * frac)
+            }
+        }
+    }
+}
+
+/// The session's track index; built at load, or on the first call.
+pub fn track_index(session: &SessionData) -> &TrackIndex {
+    session.track_index.get_or_init(|| TrackIndex::build(&session.drivers))
+}
+
+// ── Queries ──────────────────────────────────────────────────────────────────
+
+/// Every driver with data at `time_s`, leader first.
+pub fn field_at(session: &SessionData, time_s: f64) -> Vec<TrackPosition> {
+    let index = track_index(session);
+    let Some(lap_m) = index.lap_length_m().map(f64::from) else {
+        return Vec::new();
+    };
+    let mut field: Vec<TrackPosition> = session
+        .drivers
+        .iter()
+        .enumerate()
+        .filter_map(|(id, d)| {
+            let race_distance_m = index.distance_at(id, &d.samples, time_s)?;
+            Some(TrackPosition {
+                driver_id: id as DriverId,
+                driver_number: d.driver_number.clone(),
+                position: 0,
+                lap: ((race_distance_m / lap_m).floor() as i64 + 1).max(1) as u32,
+                lap_distance_m: race_distance_m.rem_euclid(lap_m) as f32,
+                race_distance_m,
+            })
+        })
+        .collect();
+    field.sort_by(|a, b| b.race_distance_m.total_cmp(&a.race_distance_m));
+    for (rank, p) in field.iter_mut().enumerate() {
+        p.position = (rank + 1).min(u8::MAX as usize) as u8;
+    }
+    field
+}
+
+/// Gap to the leader and to the car ahead for every driver, at `points`
+/// evenly spaced times over `[time_start, time_end]`. A gap is how long ago
+/// the other car passed the point this one is at now.
+pub fn gap_chart(session: &SessionData, time_start: f64, time_end: f64, points: Option<usize>) -> GapChart {
+    let index = track_index(session);
+    let n = points.unwrap_or(DEFAULT_GAP_POINTS).clamp(2, MAX_GAP_POINTS);
+    let (t0, t1) = (time_start.min(time_end), time_start.max(time_end));
+    let times: Vec<f64> = (0..n).map(|k| t0 + (t1 - t0) * k as f64 / (n - 1) as f64).collect();
+
+    // One column (all drivers) per time, in parallel; transposed below
+    let columns: Vec<Vec<(Option<f32>, Option<f32>)>> = times
+        .par_iter()
+        .map(|&t| {
+            let mut order: Vec<(usize, f64)> = session
+                .drivers
+                .iter()
+                .enumerate()
+                .filter_map(|(id, d)| Some((id, index.distance_at(id, &d.samples, t)?)))
+                .collect();
+            order.sort_by(|a, b| b.1.total_cmp(&a.1));
+
+            let mut column = vec![(None, None); session.drivers.len()];
+            let behind = |ahead: usize, distance_m: f64| {
+                let passed = index.time_at_distance(ahead, &session.drivers[ahead].samples, distance_m)?;
+                Some((t - passed).max(0.0) as f32)
+            };
+            for (k, &(id, distance_m)) in order.iter().enumerate() {
+                column[id] = match k {
+                    0 => (Some(0.0), Some(0.0)),
+                    _ => (behind(order[0].0, distance_m), behind(order[k - 1].0, distance_m)),
+                };
+            }
+            column
+        })
+        .collect();
+
+    let drivers = session
+        .drivers
+        .iter()
+        .enumerate()
+        .map(|(id, d)| DriverGaps {
+            driver_id: id as DriverId,
+            driver_number: d.driver_number.clone(),
+            gap_to_leader_s: columns.iter().map(|c| c[id].0).collect(),
+            interval_s: columns.iter().map(|c| c[id].1).collect(),
+        })
+        .collect();
+    GapChart { times, drivers }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::test_fixtures;
+    use crate::types::Compound;
+    use std::f64::consts::TAU;
+
+    const LAP_S: f64 = 80.0;
+    const RADIUS: f64 = 1_000.0;
+
+    /// Laps a circle of `RADIUS` once every `LAP_S` seconds, `delay_s` behind
+    /// a car that started at t = 0, sampled at 4 Hz. Lap 1 starts at t = 0
+    /// with the car just short of the line.
+    fn circle_driver(number: &str, delay_s: f64, laps: u32) -> DriverData {
+        // Start 5% of a lap before the line
+        let samples = test_fixtures::circle_samples(RADIUS, LAP_S, laps as f64 * LAP_S - 0.25, 4.0, -0.05 - delay_s / LAP_S);
+        let mut lap_records = test_fixtures::laps(laps, LAP_S, Compound::Medium);
+        for lap in &mut lap_records[1..] {
+            lap.lap_start_time_s += 0.05 * LAP_S + delay_s;
+            lap.tyre_life = lap.lap_number as u8;
+        }
+        test_fixtures::driver(number, samples, lap_records)
+    }
+
+    fn session(drivers: Vec<DriverData>) -> SessionData {
+        SessionData { duration_s: 5.0 * LAP_S, ..test_fixtures::session(drivers) }
+    }
+
+    #[test]
+    fn test_lap_index_slices_match_time_windows() {
+        let d = circle_driver("1", 0.0, 5);
+        let index = lap_index(&d);
+        for (i, lap) in d.laps.iter().enumerate() {
+            assert_eq!(LapIndex::lap_position(&d.laps, lap.lap_number), Some(i));
+            let t_end = d.laps.get(i + 1).map_or(f64::MAX, |l| l.lap_start_time_s);
+            let range = d.samples.range(lap.lap_start_time_s, t_end);
+            assert_eq!(index.lap_samples(i), range);
+            assert_eq!(index.lap_distances(i), compute_distances(&d.samples.xs[range.clone()], &d.samples.ys[range]));
+        }
+        assert_eq!(LapIndex::lap_position(&d.laps, 9), None);
+    }
+
+    #[test]
+    fn test_field_positions_and_gaps() {
+        let s = session(vec![circle_driver("1", 0.0, 5), circle_driver("2", 2.0, 5)]);
+        let index = track_index(&s);
+        let lap_m = index.lap_length_m().unwrap() as f64;
+        assert!((lap_m - TAU * RADIUS).abs() < 0.01 * lap_m, "lap length {lap_m}");
+
+        // Lap 1 starts just short of the line
+        let start = index.distance_at(0, &s.drivers[0].samples, 0.0).unwrap();
+        assert!((start + 0.05 * lap_m).abs() < 5.0, "start distance {start}");
+
+        let field = field_at(&s, 2.5 * LAP_S);
+        assert_eq!(field.iter().map(|p| p.driver_number.as_str()).collect::<Vec<_>>(), ["1", "2"]);
+        assert_eq!((field[0].lap, field[0].position), (3, 1));
+        assert!((field[0].lap_distance_m as f64 - 0.45 * lap_m).abs() < 5.0);
+
+        // Driver 1 reached 0.45 of lap 3 at the instant queried
+        let t = index.time_at_distance(0, &s.drivers[0].samples, 2.45 * lap_m).unwrap();
+        assert!((t - 2.5 * LAP_S).abs() < 0.05, "t={t}");
+
+        let chart = gap_chart(&s, LAP_S, 4.0 * LAP_S, Some(50));
+        assert_eq!(chart.times.len(), 50);
+        for (leader, chaser) in chart.drivers[0].gap_to_leader_s.iter().zip(&chart.drivers[1].gap_to_leader_s) {
+            assert_eq!(*leader, Some(0.0));
+            assert!((chaser.unwrap() - 2.0).abs() < 0.05, "gap {chaser:?}");
+        }
+        assert_eq!(chart.drivers[1].interval_s, chart.drivers[1].gap_to_leader_s);
+    }
+}
@@ -0,0 +1,304 @@
+//! Point-mass lap-time simulation over the session's reference line.
+//!
+//! The track is the reference line resampled onto the same uniform
+//! `SAMPLE_STEP` grid `build_lap_telemetry` uses, reduced to one curvature
+//! per point. A lap is three passes over flat `f32` arrays:
+//!
+//! 1. the cornering limit at every point, where lateral grip (tyre friction
+//!    on weight plus downforce) equals the centripetal force;
+//! 2. a forward pass accelerating out of each limit under power, drag,
+//!    rolling resistance and what grip the corner leaves (friction circle);
+//! 3. a backward pass braking into each limit the same way.
+//!
+//! The lap starts at the slowest corner, where the speed is known, so the
+//! closed lap needs no iteration. Pass 1 and the time integral have no
+//! loop-carried dependency; passes 2 and 3 are first-order recurrences over
+//! contiguous arrays, carried as v² to keep square roots off the recurrence.
+//! A ~5 km lap is ~500 points, a few tens of microseconds.
+
+use crate::lap_index::ReferenceLine;
+use crate::telemetry_analysis::{AIR_DENSITY, CAR_MASS_KG, SAMPLE_STEP};
+use std::cell::RefCell;
+
+const G: f32 = 9.81;
+/// Points either side of the one whose curvature is measured (a 60 m chord
+/// smooths out position noise without flattening hairpins).
+const CURVATURE_SPAN: usize = 3;
+/// Speed cap, m/s: the "limit" on straights, above any car's drag-limited
+/// top speed so it never decides a lap.
+const MAX_SPEED_MS: f32 = 110.0;
+/// Curvature above which a point counts as cornering (radius < 250 m).
+const CORNER_CURVATURE: f32 = 1.0 / 250.0;
+
+/// Per-point track data the solver runs over.
+pub struct TrackProfile {
+    /// |κ| in 1/m at each grid point, starting at the reference line's origin.
+    curvature: Vec<f32>,
+    /// Distance between consecutive points; the lap length divided evenly.
+    step_m: f32,
+}
+
+impl TrackProfile {
+    pub fn from_reference(line: &ReferenceLine) -> Option<Self> {
+        let n = (line.length_m() / SAMPLE_STEP).round() as usize;
+        if n < 4 * CURVATURE_SPAN {
+            return None;
+        }
+        let step_m = line.length_m() / n as f32;
+        let points = line.resample(n);
+        let at = |i: isize| points[i.rem_euclid(n as isize) as usize];
+        let k = CURVATURE_SPAN as isize;
+        let raw: Vec<f32> = (0..n as isize).map(|i| menger_curvature(at(i - k), at(i), at(i + k))).collect();
+        // Three-point moving average over the closed lap
+        let curvature = (0..n).map(|i| (raw[(i + n - 1) % n] + raw[i] + raw[(i + 1) % n]) / 3.0).collect();
+        Some(TrackProfile { curvature, step_m })
+    }
+
+    pub fn len(&self) -> usize {
+        self.curvature.len()
+    }
+
+    pub fn heap_bytes(&self) -> usize {
+        self.curvature.len() * 4
+    }
+}
+
+/// Curvature of the circle through three points (0 when collinear).
+fn menger_curvature(a: [f32; 2], b: [f32; 2], c: [f32; 2]) -> f32 {
+    let cross = (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+    let d = |p: [f32; 2], q: [f32; 2]| ((p[0] - q[0]).powi(2) + (p[1] - q[1]).powi(2)).sqrt();
+    let denom = d(a, b) * d(b, c) * d(c, a);
+    if denom < 1e-6 { 0.0 } else { 2.0 * cross.abs() / denom }
+}
+
+/// Vehicle constants for one simulated lap, SI units.
+#[derive(Debug, Clone, Copy)]
+pub struct PointMass {
+    pub mass_kg: f32,
+    pub power_w: f32,
+    /// Drag coefficient × frontal area, m²
+    pub cda: f32,
+    /// Lift (downforce) coefficient × area, m²
+    pub cla: f32,
+    /// Tyre friction coefficient
+    pub mu: f32,
+    pub c_roll: f32,
+    pub air_density: f32,
+}
+
+impl PointMass {
+    /// Typical F1 car (with half a race's fuel) with the given drag area and
+    /// friction.
+    pub fn baseline(cda: f32, mu: f32) -> Self {
+        PointMass {
+            mass_kg: CAR_MASS_KG as f32 + 50.0,
+            power_w: 750_000.0,
+            cda,
+            cla: 3.0 * cda,
+            mu,
+            c_roll: 0.015,
+            air_density: AIR_DENSITY as f32,
+        }
+    }
+}
+
+/// What the solver reports for one lap.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct LapProfile {
+    pub lap_time_s: f64,
+    /// Time through each third of the lap by distance
+    pub sector_s: [f64; 3],
+    pub max_speed_kmh: f64,
+    /// Mean speed over cornering points
+    pub corner_speed_kmh: f64,
+}
+
+/// Solver buffers, reused across laps on the same thread.
+#[derive(Default)]
+struct Scratch {
+    /// Track curvature and the cornering limit (as v²), rotated to start
+    /// (and end) at the slowest corner.
+    kappa: Vec<f32>,
+    limit: Vec<f32>,
+    /// v² during the passes, then v.
+    speed: Vec<f32>,
+    /// Time from the slowest corner to each point.
+    elapsed: Vec<f64>,
+}
+
+thread_local!(static SCRATCH: RefCell<Scratch> = RefCell::default());
+
+/// Simulate one flying lap of `track` in `car`.
+pub fn simulate(track: &TrackProfile, car: &PointMass) -> LapProfile {
+    SCRATCH.with(|s| solve(track, car, &mut s.borrow_mut()))
+}
+
+fn solve(track: &TrackProfile, car: &PointMass, s: &mut Scratch) -> LapProfile {
+    let n = track.len();
+    let ds = track.step_m;
+    let m = car.mass_kg;
+    let half_rho = 0.5 * car.air_density;
+    let (drag_k, lift_k) = (half_rho * car.cda, half_rho * car.cla);
+
+    // Pass 1: cornering limit, m v² κ = μ (m g + lift_k v²)
+    let lat_k = car.mu * lift_k / m;
+    let cap2 = MAX_SPEED_MS * MAX_SPEED_MS;
+    let limit2 = |k: f32| {
+        let denom = k - lat_k;
+        if denom > car.mu * G / cap2 { car.mu * G / denom } else { cap2 }
+    };
+    // Rotate both to start at the slowest corner, with that point repeated
+    // at the end so the passes index straight through
+    s.limit.clear();
+    s.limit.extend(track.curvature.iter().map(|&k| limit2(k)));
+    let start = (0..n).min_by(|&a, &b| s.limit[a].total_cmp(&s.limit[b])).unwrap_or(0);
+    s.limit.rotate_left(start);
+    s.limit.push(s.limit[0]);
+    s.kappa.clear();
+    s.kappa.extend_from_slice(&track.curvature[start..]);
+    s.kappa.extend_from_slice(&track.curvature[..=start]);
+
+    // The passes carry v² so the only square root on the loop-carried path
+    // is the friction circle's. Longitudinal grip left at v² = u through
+    // curvature k:
+    let grip_long = |u: f32, k: f32| {
+        let normal = m * G + lift_k * u;
+        let lat = m * u * k;
+        ((car.mu * normal).powi(2) - lat * lat).max(0.0).sqrt()
+    };
+    let rolling = car.c_roll * m * G;
+    // Force to change in v² over one step: Δu = 2 a ds = F (2 ds / m)
+    let du_per_n = 2.0 * ds / m;
+
+    // Pass 2: accelerate forward from the slowest corner
+    s.speed.clear();
+    s.speed.resize(n + 1, 0.0);
+    s.speed[0] = s.limit[0];
+    for i in 0..n {
+        let (u, k) = (s.speed[i], s.kappa[i]);
+        let drive = (car.power_w / u.sqrt().max(1.0)).min(grip_long(u, k));
+        let force = drive - drag_k * u - rolling;
+        s.speed[i + 1] = (u + force * du_per_n).max(0.0).min(s.limit[i + 1]);
+    }
+    // The lap closes at its own start
+    s.speed[n] = s.speed[n].min(s.speed[0]);
+
+    // Pass 3: brake backward into every limit
+    for i in (0..n).rev() {
+        let (u, k) = (s.speed[i + 1], s.kappa[i + 1]);
+        let force = grip_long(u, k) + drag_k * u + rolling;
+        s.speed[i] = s.speed[i].min(u + force * du_per_n);
+    }
+    for u in &mut s.speed {
+        *u = u.sqrt();
+    }
+
+    // Time over each step at the mean of its end speeds, accumulated
+    s.elapsed.clear();
+    s.elapsed.push(0.0);
+    for i in 0..n {
+        let dt = 2.0 * ds / (s.speed[i] + s.speed[i + 1]).max(1e-3);
+        s.elapsed.push(s.elapsed[i] + dt as f64);
+    }
+    let lap_time_s = s.elapsed[n];
+
+    // Sectors are thirds of the lap from the reference line's origin, which
+    // sits at rotated index `n - start`
+    let since_origin = |o: usize| (s.elapsed[(o + n - start) % n] - s.elapsed[(n - start) % n]).rem_euclid(lap_time_s);
+    let (t1, t2) = (since_origin(n / 3), since_origin(2 * n / 3));
+    let sector_s = [t1, t2 - t1, lap_time_s - t2];
+
+    let v = &s.speed[..n];
+    let max_speed = v.iter().copied().fold(0.0f32, f32::max);
+    let (corner_sum, corner_n) = v
+        .iter()
+        .zip(&s.kappa)
+        .filter(|(_, &k)| k > CORNER_CURVATURE)
+        .fold((0.0f32, 0usize), |(sum, c), (&v, _)| (sum + v, c + 1));
+    let corner_speed = if corner_n == 0 { max_speed } else { corner_sum / corner_n as f32 };
+
+    LapProfile {
+        lap_time_s,
+        sector_s,
+        max_speed_kmh: max_speed as f64 * 3.6,
+        corner_speed_kmh: corner_speed as f64 * 3.6,
+    }
+}
+
+/// Friction bounds `calibrate_mu` searches within.
+const MU_RANGE: (f32, f32) = (0.2, 5.0);
+
+/// Friction at which `car` laps `track` in `lap_time_s`, by bisection (lap
+/// time falls monotonically with grip); a bound of `MU_RANGE` when the
+/// target is out of reach.
+pub fn calibrate_mu(track: &TrackProfile, car: &PointMass, lap_time_s: f64) -> f32 {
+    let (mut lo, mut hi) = MU_RANGE;
+    let time = |mu: f32| simulate(track, &PointMass { mu, ..*car }).lap_time_s;
+    // 20 halvings leave the bracket ~5e-6 wide
+    for _ in 0..20 {
+        let mid = 0.5 * (lo + hi);
+        if time(mid) > lap_time_s {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    0.5 * (lo + hi)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// A closed track from (length m, curvature) pieces on a 10 m grid.
+    fn track(pieces: &[(f32, f32)]) -> TrackProfile {
+        let curvature = pieces
+            .iter()
+            .flat_map(|&(len, k)| std::iter::repeat(k).take((len / SAMPLE_STEP) as usize))
+            .collect();
+        TrackProfile { curvature, step_m: SAMPLE_STEP }
+    }
+
+    fn gain(track: &TrackProfile, tweak: impl Fn(&mut PointMass)) -> f64 {
+        let base = PointMass::baseline(1.1, 1.8);
+        let mut car = base;
+        tweak(&mut car);
+        1.0 - simulate(track, &car).lap_time_s / simulate(track, &base).lap_time_s
+    }
+
+    #[test]
+    fn test_constant_radius_runs_at_the_cornering_limit() {
+        let ring = track(&[(2_000.0, 1.0 / 100.0)]);
+        let car = PointMass::baseline(1.1, 1.8);
+        let lap = simulate(&ring, &car);
+
+        // At the limit no grip is left to hold off drag, so the car settles
+        // a fraction below it
+        let lift_k = 0.5 * car.air_density * car.cla;
+        let v = (car.mu * G / (0.01 - car.mu * lift_k / car.mass_kg)).sqrt();
+        assert!((lap.lap_time_s - 2_000.0 / v as f64).abs() < 0.01 * lap.lap_time_s, "{lap:?} vs {v} m/s");
+        assert!(lap.max_speed_kmh <= v as f64 * 3.6 + 0.01 && lap.corner_speed_kmh > v as f64 * 3.6 * 0.99);
+        assert!((lap.sector_s.iter().sum::<f64>() - lap.lap_time_s).abs() < 1e-9);
+        assert!(lap.sector_s.iter().all(|&s| (s - lap.lap_time_s / 3.0).abs() < 0.01 * lap.lap_time_s));
+    }
+
+    #[test]
+    fn test_changes_matter_where_the_track_uses_them() {
+        // Same length: two long straights and two hairpins vs. continuous sweepers
+        let fast = track(&[(2_200.0, 0.0), (300.0, 1.0 / 30.0), (2_200.0, 0.0), (300.0, 1.0 / 30.0)]);
+        let twisty = track(&[(250.0, 0.0), (1_000.0, 1.0 / 120.0)].repeat(4));
+
+        let power = |c: &mut PointMass| c.power_w *= 1.1;
+        let downforce = |c: &mut PointMass| c.cla *= 1.1;
+        let (fast_power, twisty_power) = (gain(&fast, power), gain(&twisty, power));
+        let (fast_df, twisty_df) = (gain(&fast, downforce), gain(&twisty, downforce));
+        assert!(fast_power > 0.0 && twisty_power >= 0.0);
+        assert!(fast_power > 2.0 * twisty_power, "power: {fast_power} vs {twisty_power}");
+        assert!(twisty_df > 2.0 * fast_df, "downforce: {twisty_df} vs {fast_df}");
+
+        // Calibration recovers the grip that produced a lap time
+        let target = simulate(&twisty, &PointMass::baseline(1.1, 2.2)).lap_time_s;
+        let mu = calibrate_mu(&twisty, &PointMass::baseline(1.1, 1.0), target);
+        assert!((mu - 2.2).abs() < 1e-3, "{mu}");
+    }
+}
@@ -1,20 +1,39 @@
+#[cfg(feature = "bench")]
+pub mod bench;
+pub mod batch;
 mod commands;
+mod frame_cache;
+mod frame_wire;
 mod heatmap;
 mod interpolate;
+mod lake;
+mod lap_index;
+mod lap_sim;
+mod live;
+mod monte_carlo;
+mod perf;
 mod race_analysis;
+pub mod replay_export;
+mod replay_log;
+mod resample;
 mod session;
+mod session_cache;
+mod snapshot;
 mod simulation;
 mod telemetry_analysis;
+mod telemetry_lod;
+#[cfg(test)]
+mod test_fixtures;
 mod types;
 
-use parking_lot::Mutex;
 use session::AppState;
 use std::sync::Arc;
 
 #[cfg_attr(mobile, tauri::mobile_entry_point)]
 pub fn run() {
+    perf::install();
     let db_path = "/Users/willbates/code/formula-1-simulations/f1.duckdb".to_string();
-    let state = Arc::new(Mutex::new(AppState::new(db_path)));
+    let state = Arc::new(AppState::new(db_path));
 
     tauri::Builder::default()
         .manage(state)
@@ -22,14 +41,32 @@ pub fn run() {
             commands::get_sessions,
             commands::load_session_cmd,
             commands::get_speed_heatmap,
+            commands::get_heatmap,
             commands::get_frame,
+            commands::get_frame_packed,
+            commands::stream_frames,
+            commands::stop_frame_stream,
             commands::get_driver_telemetry,
             commands::get_driver_meta,
             commands::run_simulation,
+            commands::run_parameter_sweep,
+            commands::run_monte_carlo,
             commands::compare_drivers_cmd,
             commands::compare_laps_cmd,
+            commands::get_lap_delta_matrix,
             commands::get_aero_fit_cmd,
             commands::get_race_analysis,
+            commands::get_track_positions,
+            commands::get_gap_chart,
+            commands::start_live_session,
+            commands::ingest_live_chunk,
+            commands::get_live_status,
+            commands::finish_live_session,
+            commands::open_replay_log,
+            commands::get_replay_log_run,
+            commands::export_replay,
+            commands::get_perf_stats,
+            commands::export_perf_trace,
         ])
         .run(tauri::generate_context!())
         .expect("error while running tauri application");
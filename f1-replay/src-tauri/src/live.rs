@@ -0,0 +1,428 @@
+//! Streaming ingest for a session that is still running.
+//!
+//! A `LiveSession` owns a growing `SessionData`. Each `LiveChunk` appends
+//! new samples per driver, extends the position splines with a windowed
+//! re-solve (`Spline::extend`) and bins the new samples into a heatmap
+//! whose grid grows with the track, so ingest costs O(chunk) however long
+//! the session has run. Frames are served up to the live edge, the latest
+//! time every active driver has reported.
+//!
+//! When the session ends, `finish` builds what the live path skips (chart
+//! pyramids, track outline, frame cache) and the result is published like
+//! any loaded session.
+
+use crate::frame_cache::FrameCache;
+use crate::heatmap::{HeatBins, HeatGrid};
+use crate::interpolate::Spline;
+use crate::lap_index::TrackIndex;
+use crate::session::{get_frame_into, session_track_layout, DriverData, LapRecord, LoadOptions, SampleColumns, SessionData};
+use crate::telemetry_lod::TelemetryLod;
+use crate::types::{Compound, DriverMeta, FrameData, HeatCell, TrackLayout};
+use rayon::prelude::*;
+use serde::{Deserialize, Serialize};
+use std::sync::atomic::AtomicUsize;
+use std::sync::OnceLock;
+
+/// Drivers silent for longer than this behind the newest sample (retired,
+/// in the garage, dropped feed) no longer hold back the live edge.
+const STALE_AFTER_S: f64 = 5.0;
+
+// ── Input types ──────────────────────────────────────────────────────────────
+
+/// New telemetry for one or more drivers, in receive order. Samples at or
+/// before a driver's last ingested time are ignored, so overlapping chunks
+/// from a feed that re-sends its tail are harmless.
+#[derive(Debug, Clone, Deserialize)]
+#[serde(rename_all = "camelCase")]
+pub struct LiveChunk {
+    pub drivers: Vec<DriverChunk>,
+}
+
+/// Sample columns as stored in `SampleColumns`: throttle and brake 0–1,
+/// `times` strictly increasing session seconds.
+#[derive(Debug, Clone, Deserialize)]
+#[serde(rename_all = "camelCase")]
+pub struct DriverChunk {
+    pub driver_number: String,
+    #[serde(default)]
+    pub abbreviation: Option<String>,
+    #[serde(default)]
+    pub team: Option<String>,
+    pub times: Vec<f64>,
+    pub xs: Vec<f32>,
+    pub ys: Vec<f32>,
+    pub speeds: Vec<f32>,
+    pub throttles: Vec<f32>,
+    pub brakes: Vec<f32>,
+    pub gears: Vec<u8>,
+    pub drs: Vec<u8>,
+    /// Laps started since the last chunk; a lap number already held replaces it
+    #[serde(default)]
+    pub laps: Vec<LiveLap>,
+}
+
+#[derive(Debug, Clone, Deserialize)]
+#[serde(rename_all = "camelCase")]
+pub struct LiveLap {
+    pub lap_number: u32,
+    pub lap_start_time_s: f64,
+    pub position: u8,
+    pub compound: Compound,
+    pub tyre_life: u8,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct LiveStatus {
+    pub event_name: String,
+    pub session: String,
+    pub drivers: usize,
+    pub samples: usize,
+    pub chunks: u64,
+    /// Latest time frames are served for
+    pub live_edge_s: f64,
+    /// Newest sample from any driver
+    pub duration_s: f64,
+    pub x_min: f32,
+    pub x_max: f32,
+    pub y_min: f32,
+    pub y_max: f32,
+}
+
+impl DriverChunk {
+    fn validate(&self) -> Result<(), String> {
+        let n = self.times.len();
+        let lens = [self.xs.len(), self.ys.len(), self.speeds.len(), self.throttles.len(), self.brakes.len(), self.gears.len(), self.drs.len()];
+        if lens.iter().any(|&l| l != n) {
+            return Err(format!("Driver {}: chunk columns have different lengths", self.driver_number));
+        }
+        if self.times.iter().any(|t| !t.is_finite()) || self.times.windows(2).any(|w| w[1] <= w[0]) {
+            return Err(format!("Driver {}: chunk times must be finite and strictly increasing", self.driver_number));
+        }
+        // A NaN or infinite coordinate would size the heatmap grid from a
+        // saturated bin while the live write lock is held
+        let columns = [("xs", &self.xs), ("ys", &self.ys), ("speeds", &self.speeds), ("throttles", &self.throttles), ("brakes", &self.brakes)];
+        if let Some((name, _)) = columns.iter().find(|(_, col)| col.iter().any(|v| !v.is_finite())) {
+            return Err(format!("Driver {}: chunk {name} must be finite", self.driver_number));
+        }
+        Ok(())
+    }
+}
+
+// ── Live session ─────────────────────────────────────────────────────────────
+
+pub struct LiveSession {
+    data: SessionData,
+    heat: HeatBins,
+    live_edge_s: f64,
+    chunks: u64,
+}
+
+impl LiveSession {
+    pub fn new(event_name: &str, session: &str) -> Self {
+        LiveSession {
+            data: SessionData {
+                event_name: event_name.to_string(),
+                session: session.to_string(),
+                duration_s: 0.0,
+                drivers: Vec::new(),
+                heatmap: Vec::new(),
+                track_layout: TrackLayout {
+                    center_line: Vec::new(),
+                    x_min: f32::INFINITY,
+                    x_max: f32::NEG_INFINITY,
+                    y_min: f32::INFINITY,
+                    y_max: f32::NEG_INFINITY,
+                    duration_s: 0.0,
+                    lap_distance_m: 0.0,
+                },
+                frame_cache: None,
+                race_analysis: OnceLock::new(),
+                track_index: OnceLock::new(),
+            },
+            heat: HeatBins::new(HeatGrid::covering(&[], &[])),
+            live_edge_s: 0.0,
+            chunks: 0,
+        }
+    }
+
+    /// Check a chunk without touching the session, so callers can validate
+    /// before taking the write lock.
+    pub fn validate(chunk: &LiveChunk) -> Result<(), String> {
+        chunk.drivers.iter().try_for_each(DriverChunk::validate)
+    }
+
+    /// Append a validated chunk.
+    pub fn ingest(&mut self, chunk: LiveChunk) {
+        for driver in chunk.drivers {
+            self.ingest_driver(driver);
+        }
+        self.chunks += 1;
+        self.data.duration_s = self.newest_sample_s();
+        self.data.track_layout.duration_s = self.data.duration_s;
+        self.live_edge_s = self.compute_live_edge();
+    }
+
+    /// New drivers are appended, so the `DriverId`s (and frame_wire record
+    /// order) a client took from `driver_meta` stay valid for the stream.
+    fn ingest_driver(&mut self, chunk: DriverChunk) {
+        let idx = match self.data.drivers.iter().position(|d| d.driver_number == chunk.driver_number) {
+            Some(i) => i,
+            None => {
+                self.data.drivers.push(empty_driver(&chunk.driver_number));
+                self.data.drivers.len() - 1
+            }
+        };
+        let d = &mut self.data.drivers[idx];
+        if let Some(abbreviation) = chunk.abbreviation {
+            d.abbreviation = abbreviation;
+        }
+        if let Some(team) = chunk.team {
+            d.team = team;
+        }
+        merge_laps(&mut d.laps, chunk.laps);
+        // Rebuilt from the grown columns when next needed
+        d.lap_index.take();
+        d.lap_calibration.take();
+
+        // New samples only, filtered like the load queries (no (0, 0) fixes)
+        let last = d.samples.times.last().copied().unwrap_or(f64::NEG_INFINITY);
+        let keep: Vec<usize> = (chunk.times.partition_point(|&t| t <= last)..chunk.times.len())
+            .filter(|&i| chunk.xs[i] != 0.0 && chunk.ys[i] != 0.0)
+            .collect();
+        if keep.is_empty() {
+            return;
+        }
+
+        let s = &mut d.samples;
+        let from = s.len();
+        s.times.extend(keep.iter().map(|&i| chunk.times[i]));
+        s.xs.extend(keep.iter().map(|&i| chunk.xs[i]));
+        s.ys.extend(keep.iter().map(|&i| chunk.ys[i]));
+        s.speeds.extend(keep.iter().map(|&i| chunk.speeds[i]));
+        s.throttles.extend(keep.iter().map(|&i| chunk.throttles[i].clamp(0.0, 1.0)));
+        s.brakes.extend(keep.iter().map(|&i| chunk.brakes[i].clamp(0.0, 1.0)));
+        s.gears.extend(keep.iter().map(|&i| chunk.gears[i].min(8)));
+        s.drs.extend(keep.iter().map(|&i| chunk.drs[i]));
+
+        let (ts, xs, ys) = (&s.times[from..], &s.xs[from..], &s.ys[from..]);
+        d.spline_x.extend(ts, &xs.iter().map(|&v| v as f64).collect::<Vec<_>>());
+        d.spline_y.extend(ts, &ys.iter().map(|&v| v as f64).collect::<Vec<_>>());
+
+        let grid = self.heat.grid().union(HeatGrid::covering(xs, ys));
+        self.heat = std::mem::replace(&mut self.heat, HeatBins::new(HeatGrid::covering(&[], &[]))).regrid(grid);
+        self.heat.add(xs, ys, &s.speeds[from..]);
+
+        let layout = &mut self.data.track_layout;
+        for (&x, &y) in xs.iter().zip(ys) {
+            layout.x_min = layout.x_min.min(x);
+            layout.x_max = layout.x_max.max(x);
+            layout.y_min = layout.y_min.min(y);
+            layout.y_max = layout.y_max.max(y);
+        }
+    }
+
+    fn newest_sample_s(&self) -> f64 {
+        self.data.drivers.iter().filter_map(|d| d.samples.times.last().copied()).fold(0.0, f64::max)
+    }
+
+    /// Oldest last-sample time among drivers that are still reporting.
+    fn compute_live_edge(&self) -> f64 {
+        let newest = self.newest_sample_s();
+        self.data
+            .drivers
+            .iter()
+            .filter_map(|d| d.samples.times.last().copied())
+            .filter(|&t| t >= newest - STALE_AFTER_S)
+            .fold(newest, f64::min)
+    }
+
+    /// Frame at `time_s`, held at the live edge, written into `out`. Cost is
+    /// independent of how much has been ingested (spline cursor walk plus
+    /// ASOF search).
+    pub fn frame_into(&self, time_s: f64, out: &mut FrameData) {
+        get_frame_into(&self.data, time_s.min(self.live_edge_s), out)
+    }
+
+    pub fn heatmap(&self) -> Vec<HeatCell> {
+        self.heat.finish()
+    }
+
+    pub fn driver_meta(&self) -> Vec<DriverMeta> {
+        self.data.driver_meta()
+    }
+
+    /// Bounds are reported as 0 until the first sample arrives (they start
+    /// at ±infinity, which JSON cannot carry).
+    pub fn status(&self) -> LiveStatus {
+        let layout = &self.data.track_layout;
+        let seen = layout.x_min <= layout.x_max;
+        let bound = |v: f32| if seen { v } else { 0.0 };
+        LiveStatus {
+            event_name: self.data.event_name.clone(),
+            session: self.data.session.clone(),
+            drivers: self.data.drivers.len(),
+            samples: self.data.drivers.iter().map(|d| d.samples.len()).sum(),
+            chunks: self.chunks,
+            live_edge_s: self.live_edge_s,
+            duration_s: self.data.duration_s,
+            x_min: bound(layout.x_min),
+            x_max: bound(layout.x_max),
+            y_min: bound(layout.y_min),
+            y_max: bound(layout.y_max),
+        }
+    }
+
+    /// Whether `finish` can succeed. Lets callers check before giving up the
+    /// session, so a failed finish never loses what was streamed.
+    pub fn check_finish(&self) -> Result<(), String> {
+        if self.data.drivers.iter().all(|d| d.samples.is_empty()) {
+            return Err("No position data received for this session".to_string());
+        }
+        Ok(())
+    }
+
+    /// Complete the session: chart pyramids, track layout, frame cache and
+    /// distance indexes as `load_session` would build them. The heatmap is
+    /// already binned. Drivers are put in driver-number order like a loaded
+    /// session, so clients refetch `get_driver_meta` as after any load.
+    pub fn finish(self, options: &LoadOptions) -> Result<SessionData, String> {
+        self.check_finish()?;
+        let LiveSession { mut data, heat, .. } = self;
+        data.drivers.retain(|d| !d.samples.is_empty());
+        data.drivers.sort_by(|a, b| a.driver_number.cmp(&b.driver_number));
+        data.drivers.par_iter_mut().for_each(|d| d.lod = TelemetryLod::build(&d.samples));
+        data.heatmap = heat.finish();
+        data.track_layout = session_track_layout(&data.drivers, data.duration_s);
+        data.frame_cache = options.frame_cache_hz.map(|hz| FrameCache::build(&data.drivers, data.duration_s, hz));
+        data.track_index = OnceLock::from(TrackIndex::build(&data.drivers));
+        Ok(data)
+    }
+}
+
+fn empty_driver(driver_number: &str) -> DriverData {
+    DriverData {
+        driver_number: driver_number.to_string(),
+        abbreviation: driver_number.to_string(),
+        team: String::new(),
+        spline_x: Spline::new(&[], &[]),
+        spline_y: Spline::new(&[], &[]),
+        samples: SampleColumns::default(),
+        lod: TelemetryLod::default(),
+        laps: Vec::new(),
+        playback_segment: AtomicUsize::new(0),
+        fastest_lap: OnceLock::new(),
+        lap_index: OnceLock::new(),
+        lap_calibration: OnceLock::new(),
+    }
+}
+
+/// Insert or replace laps by number, keeping `laps` sorted.
+fn merge_laps(laps: &mut Vec<LapRecord>, new: Vec<LiveLap>) {
+    for lap in new {
+        let record = LapRecord {
+            lap_number: lap.lap_number,
+            lap_start_time_s: lap.lap_start_time_s,
+            position: lap.position.clamp(1, 20),
+            compound: lap.compound,
+            tyre_life: lap.tyre_life,
+        };
+        match laps.binary_search_by_key(&lap.lap_number, |l| l.lap_number) {
+            Ok(i) => laps[i] = record,
+            Err(i) => laps.insert(i, record),
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::heatmap;
+    use crate::types::HeatmapFilter;
+
+    fn chunk(driver: &str, times: std::ops::Range<usize>, dt: f64, offset: f32) -> DriverChunk {
+        let ts: Vec<f64> = times.map(|i| i as f64 * dt).collect();
+        let angle = |t: f64| (t * 0.1) as f32;
+        DriverChunk {
+            driver_number: driver.to_string(),
+            abbreviation: None,
+            team: None,
+            xs: ts.iter().map(|&t| 1_000.0 * angle(t).cos() + offset).collect(),
+            ys: ts.iter().map(|&t| 800.0 * angle(t).sin() + 1.0).collect(),
+            speeds: ts.iter().map(|&t| 200.0 + (t as f32 % 30.0)).collect(),
+            throttles: vec![1.0; ts.len()],
+            brakes: vec![0.0; ts.len()],
+            gears: vec![7; ts.len()],
+            drs: vec![0; ts.len()],
+            laps: Vec::new(),
+            times: ts,
+        }
+    }
+
+    #[test]
+    fn test_incremental_ingest_matches_batch_build() {
+        let mut live = LiveSession::new("Live GP", "R");
+        // Before any sample: JSON-safe bounds, and nothing to finish yet
+        let empty = live.status();
+        assert_eq!((empty.x_min, empty.x_max, empty.y_min, empty.y_max), (0.0, 0.0, 0.0, 0.0));
+        assert!(serde_json::to_value(&empty).unwrap()["x_min"].is_number());
+        assert!(live.check_finish().is_err());
+
+        // Overlapping chunks: each re-sends the previous chunk's last 5 samples
+        for start in (0..2_000).step_by(95) {
+            live.ingest(LiveChunk {
+                drivers: vec![chunk("44", start..start + 100, 0.25, 0.0), chunk("1", start..start + 100, 0.25, 30.0)],
+            });
+        }
+        let status = live.status();
+        // The last chunk starts at 1995
+        assert_eq!((status.drivers, status.samples), (2, 2 * 2_095));
+        // Ids follow first appearance, so "44" keeps id 0 while streaming
+        assert_eq!(live.data.drivers[0].driver_number, "44");
+
+        // Splines and heatmap equal a from-scratch build over the same samples
+        for d in &live.data.drivers {
+            let xs: Vec<f64> = d.samples.xs.iter().map(|&v| v as f64).collect();
+            let full = Spline::new(&d.samples.times, &xs);
+            for k in 0..1_000 {
+                let t = k as f64 * 0.5;
+                assert!((d.spline_x.eval(t) - full.eval(t)).abs() < 1e-6, "t = {t}");
+            }
+        }
+        let batch = heatmap::compute_filtered(&live.data.drivers, &HeatmapFilter::default());
+        let key = |c: &HeatCell| (c.x as i32, c.y as i32, (c.speed_norm * 1e4) as i32);
+        assert_eq!(live.heatmap().iter().map(key).collect::<Vec<_>>(), batch.iter().map(key).collect::<Vec<_>>());
+
+        // Frames past the edge hold at it; finishing builds a normal session
+        let mut frame = FrameData::default();
+        live.frame_into(1e9, &mut frame);
+        assert_eq!(frame.time_s, live.status().live_edge_s);
+        let session = live.finish(&LoadOptions { frame_cache_hz: None, ..LoadOptions::default() }).unwrap();
+        assert!(!session.track_layout.center_line.is_empty());
+        assert_eq!(session.drivers[0].driver_number, "1");
+    }
+
+    #[test]
+    fn test_live_edge_ignores_stalled_drivers() {
+        let mut live = LiveSession::new("Live GP", "R");
+        live.ingest(LiveChunk { drivers: vec![chunk("1", 1..101, 0.1, 0.0), chunk("2", 1..81, 0.1, 0.0)] });
+        assert!((live.status().live_edge_s - 8.0).abs() < 1e-9);
+
+        // Driver 2 stops reporting; once it is STALE_AFTER_S behind it is dropped
+        live.ingest(LiveChunk { drivers: vec![chunk("1", 101..200, 0.1, 0.0)] });
+        assert!((live.status().live_edge_s - 19.9).abs() < 1e-9);
+
+        let bad = LiveChunk { drivers: vec![DriverChunk { gears: vec![], ..chunk("3", 0..10, 0.1, 0.0) }] };
+        assert!(LiveSession::validate(&bad).is_err());
+        let mut nan = chunk("3", 0..10, 0.1, 0.0);
+        nan.xs[4] = f32::NAN;
+        assert!(LiveSession::validate(&LiveChunk { drivers: vec![nan] }).unwrap_err().contains("xs"));
+        let mut inf = chunk("3", 0..10, 0.1, 0.0);
+        inf.speeds[2] = f32::INFINITY;
+        assert!(LiveSession::validate(&LiveChunk { drivers: vec![inf] }).is_err());
+
+        // A driver joining late gets the next id; existing ids don't move
+        live.ingest(LiveChunk { drivers: vec![chunk("10", 200..210, 0.1, 0.0)] });
+        let numbers: Vec<_> = live.driver_meta().into_iter().map(|m| m.driver_number).collect();
+        assert_eq!(numbers, ["1", "2", "10"]);
+    }
+}
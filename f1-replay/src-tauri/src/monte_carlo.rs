@@ -0,0 +1,462 @@
+//! Monte Carlo strategy simulation over the `run_simulation` lap model.
+//!
+//! Every run draws a strategy (pit lap, second-stint compound) and race noise
+//! (safety cars, degradation rate, lap-time scatter), then is placed against
+//! the rest of the field's actual race times. Runs are evaluated in batches
+//! laid out struct-of-arrays, laps outer and runs inner, so the per-lap work
+//! is a tight loop over contiguous columns. Each batch owns its RNG, seeded
+//! from the run seed and the batch index, so results are reproducible and do
+//! not depend on how rayon schedules the batches.
+
+use crate::race_analysis::pitted_after;
+use crate::session::{DriverData, SessionData};
+use crate::types::Compound;
+use crate::simulation::{
+    compound_grip_factor, extract_lap_times, tyre_degradation_per_lap, ScenarioModel, SimulationScenario,
+};
+use rand::rngs::SmallRng;
+use rand::{Rng, SeedableRng};
+use rayon::prelude::*;
+use serde::{Deserialize, Serialize};
+use std::collections::HashMap;
+
+/// Runs per batch (one RNG and one set of columns each).
+const BATCH: usize = 256;
+const MAX_ITERATIONS: usize = 1_000_000;
+const HISTOGRAM_BINS: usize = 40;
+/// Safety-car laps run this much slower than the green-flag lap.
+const SAFETY_CAR_SLOWDOWN: f64 = 0.4;
+/// Share of the pit loss still paid when stopping under a safety car.
+const SAFETY_CAR_PIT_FACTOR: f64 = 0.5;
+/// `pit_lap` value for runs that never stop.
+const NO_STOP: u32 = u32::MAX;
+
+// ── Parameter and result types ────────────────────────────────────────────────
+
+#[derive(Debug, Clone, Serialize, Deserialize)]
+#[serde(rename_all = "camelCase")]
+pub struct MonteCarloConfig {
+    /// Car, environment and driver model shared by every run
+    pub scenario: SimulationScenario,
+    pub iterations: usize,
+    #[serde(default)]
+    pub seed: u64,
+    /// Inclusive lap window the single pit stop is drawn from (None = no stop)
+    #[serde(default)]
+    pub pit_window: Option<[u32; 2]>,
+    /// Compounds the second stint is drawn from (empty = base compound)
+    #[serde(default)]
+    pub compounds: Vec<Compound>,
+    /// Green-flag pit stop time loss in seconds
+    #[serde(default = "default_pit_loss_s")]
+    pub pit_loss_s: f64,
+    /// Probability of a safety car on any given lap
+    #[serde(default)]
+    pub safety_car_prob: f64,
+    /// Relative standard deviation of the tyre degradation rate per run
+    #[serde(default)]
+    pub degradation_noise: f64,
+    /// Standard deviation of lap-to-lap time scatter in seconds
+    #[serde(default)]
+    pub lap_noise_s: f64,
+}
+
+fn default_pit_loss_s() -> f64 {
+    22.0
+}
+
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct Distribution {
+    pub mean: f64,
+    pub std_dev: f64,
+    pub min: f64,
+    pub p5: f64,
+    pub p50: f64,
+    pub p95: f64,
+    pub max: f64,
+    pub histogram_start: f64,
+    pub histogram_bin_width: f64,
+    pub histogram: Vec<u32>,
+}
+
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct StrategyOutcome {
+    /// Lap at the end of which the car pits (None = no stop)
+    pub pit_lap: Option<u32>,
+    pub compound: Compound,
+    pub runs: usize,
+    pub mean_time_s: f64,
+    pub mean_position: f64,
+}
+
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct MonteCarloResult {
+    pub iterations: usize,
+    pub num_laps: usize,
+    /// Other drivers with a full set of laps to be ranked against
+    pub field_size: usize,
+    pub finish_time_s: Distribution,
+    /// `position_probabilities[k]`: share of runs finishing P(k + 1)
+    pub position_probabilities: Vec<f64>,
+    /// Mean outcome per drawn strategy, best mean time first
+    pub strategies: Vec<StrategyOutcome>,
+}
+
+// ── Hoisted invariants ────────────────────────────────────────────────────────
+
+/// Everything that is the same for every run, computed once.
+struct Invariants {
+    /// Green-flag lap time on the base compound before degradation.
+    lap_base: Vec<f64>,
+    /// Index 0 is the base stint's compound.
+    compounds: Vec<Compound>,
+    /// Lap time multiplier of each compound relative to the base compound.
+    grip_ratio: Vec<f64>,
+    /// Degradation per lap of tyre age for each compound, in seconds.
+    deg_per_lap: Vec<f64>,
+    /// Compound indices the second stint may use.
+    stint2: Vec<u8>,
+    pit_window: Option<(u32, u32)>,
+    /// Field's race times over the same laps, ascending.
+    field: Vec<f64>,
+}
+
+impl Invariants {
+    fn new(session: &SessionData, model: &ScenarioModel, config: &MonteCarloConfig) -> Self {
+        let n = model.num_laps;
+        let lap_factor = model.factors.overall_lap_factor * model.car_delta * model.driver_delta;
+        // Every run makes its own stop, so the real ones come out of the baseline
+        let lap_base = without_stops(model.base_driver)[..n].iter().map(|t| t * lap_factor).collect();
+
+        let mut compounds = vec![model.compound];
+        for c in &config.compounds {
+            if !compounds.contains(c) {
+                compounds.push(*c);
+            }
+        }
+        let base_grip = compound_grip_factor(model.compound);
+        let wear = config.scenario.car_params.tyre_wear_rate;
+        let grip_ratio = compounds.iter().map(|&c| compound_grip_factor(c) / base_grip).collect();
+        let deg_per_lap = compounds.iter().map(|&c| tyre_degradation_per_lap(c, wear)).collect();
+        let stint2 = if config.compounds.is_empty() {
+            vec![0]
+        } else {
+            config
+                .compounds
+                .iter()
+                .map(|c| compounds.iter().position(|k| k == c).unwrap_or(0) as u8)
+                .collect()
+        };
+
+        // A stop on the last lap (or later) would never run the second stint
+        let pit_window = config.pit_window.and_then(|[lo, hi]| {
+            let (lo, hi) = (lo.max(1), hi.min(n.saturating_sub(1) as u32));
+            (lo <= hi).then_some((lo, hi))
+        });
+
+        let mut field: Vec<f64> = session
+            .drivers
+            .iter()
+            .filter(|d| d.driver_number != model.base_driver.driver_number)
+            .filter_map(|d| {
+                let laps = extract_lap_times(d);
+                (laps.len() >= n).then(|| laps[..n].iter().sum())
+            })
+            .collect();
+        field.sort_by(f64::total_cmp);
+
+        Invariants { lap_base, compounds, grip_ratio, deg_per_lap, stint2, pit_window, field }
+    }
+}
+
+/// `extract_lap_times` with the laps into and out of each real pit stop
+/// replaced by the mean of the nearest clean lap on either side.
+fn without_stops(driver: &DriverData) -> Vec<f64> {
+    let laps = &driver.laps;
+    let pitted = |i: usize| laps.get(i + 1).is_some_and(|next| pitted_after(&laps[i], next));
+    let (mut times, mut clean) = (Vec::new(), Vec::new());
+    // Same lap filter as `extract_lap_times`, so indices line up with it
+    for i in 0..laps.len().saturating_sub(1) {
+        let dt = laps[i + 1].lap_start_time_s - laps[i].lap_start_time_s;
+        if dt > 60.0 && dt < 200.0 {
+            times.push(dt);
+            clean.push(!pitted(i) && !(i > 0 && pitted(i - 1)));
+        }
+    }
+
+    let original = times.clone();
+    for k in (0..times.len()).filter(|&k| !clean[k]) {
+        let before = (0..k).rev().find(|&j| clean[j]).map(|j| original[j]);
+        let after = (k + 1..times.len()).find(|&j| clean[j]).map(|j| original[j]);
+        times[k] = match (before, after) {
+            (Some(a), Some(b)) => (a + b) / 2.0,
+            (Some(t), None) | (None, Some(t)) => t,
+            (None, None) => original[k],
+        };
+    }
+    times
+}
+
+// ── Batched evaluation ────────────────────────────────────────────────────────
+
+/// One batch of runs, struct-of-arrays.
+#[derive(Default)]
+struct Batch {
+    pit_lap: Vec<u32>,
+    stint2: Vec<u8>,
+    deg_scale: Vec<f64>,
+    /// Race time including safety-car laps.
+    total: Vec<f64>,
+    /// Time lost behind the safety car, which the field loses too.
+    neutralised: Vec<f64>,
+    position: Vec<u16>,
+}
+
+fn run_batch(inv: &Invariants, config: &MonteCarloConfig, batch_idx: usize, runs: usize) -> Batch {
+    let mut rng = SmallRng::seed_from_u64(config.seed ^ (batch_idx as u64).wrapping_mul(0x9E37_79B9_7F4A_7C15));
+    let sc_prob = config.safety_car_prob;
+
+    let mut b = Batch {
+        pit_lap: (0..runs)
+            .map(|_| inv.pit_window.map_or(NO_STOP, |(lo, hi)| rng.random_range(lo..=hi)))
+            .collect(),
+        stint2: (0..runs).map(|_| inv.stint2[rng.random_range(0..inv.stint2.len())]).collect(),
+        deg_scale: (0..runs)
+            .map(|_| (1.0 + config.degradation_noise * standard_normal(&mut rng)).max(0.0))
+            .collect(),
+        total: vec![0.0; runs],
+        neutralised: vec![0.0; runs],
+        position: Vec::new(),
+    };
+
+    for (i, &base) in inv.lap_base.iter().enumerate() {
+        let lap_number = i as u32 + 1;
+        for r in 0..runs {
+            let pit = b.pit_lap[r];
+            let (compound, age) = if lap_number > pit {
+                (b.stint2[r] as usize, lap_number - pit - 1)
+            } else {
+                (0, i as u32)
+            };
+            let mut t = base * inv.grip_ratio[compound] + inv.deg_per_lap[compound] * b.deg_scale[r] * age as f64;
+            if config.lap_noise_s > 0.0 {
+                t += config.lap_noise_s * standard_normal(&mut rng);
+            }
+
+            let safety_car = sc_prob > 0.0 && rng.random_bool(sc_prob);
+            if safety_car {
+                let slow = base * SAFETY_CAR_SLOWDOWN;
+                t += slow;
+                b.neutralised[r] += slow;
+            }
+            if lap_number == pit {
+                t += config.pit_loss_s * if safety_car { SAFETY_CAR_PIT_FACTOR } else { 1.0 };
+            }
+            b.total[r] += t;
+        }
+    }
+
+    b.position = b
+        .total
+        .iter()
+        .zip(&b.neutralised)
+        .map(|(total, sc)| 1 + inv.field.partition_point(|&f| f < total - sc) as u16)
+        .collect();
+    b
+}
+
+/// Box–Muller; one of the pair is discarded to keep the RNG stream simple.
+fn standard_normal(rng: &mut SmallRng) -> f64 {
+    let u1: f64 = 1.0 - rng.random::<f64>(); // (0, 1], keeps ln finite
+    let u2: f64 = rng.random();
+    (-2.0 * u1.ln()).sqrt() * (std::f64::consts::TAU * u2).cos()
+}
+
+// ── Entry point ───────────────────────────────────────────────────────────────
+
+pub fn run_monte_carlo(session: &SessionData, config: &MonteCarloConfig) -> Result<MonteCarloResult, String> {
+    if config.iterations == 0 || config.iterations > MAX_ITERATIONS {
+        return Err(format!("iterations must be between 1 and {MAX_ITERATIONS}"));
+    }
+    if !(0.0..=1.0).contains(&config.safety_car_prob) {
+        return Err(format!("safetyCarProb must be within [0, 1], got {}", config.safety_car_prob));
+    }
+    if config.degradation_noise < 0.0 || config.lap_noise_s < 0.0 || config.pit_loss_s < 0.0 {
+        return Err("Noise levels and pit loss must not be negative".to_string());
+    }
+
+    let model = ScenarioModel::resolve(session, &config.scenario)?;
+    let inv = Invariants::new(session, &model, config);
+
+    let n_batches = config.iterations.div_ceil(BATCH);
+    let batches: Vec<Batch> = (0..n_batches)
+        .into_par_iter()
+        .map(|k| run_batch(&inv, config, k, BATCH.min(config.iterations - k * BATCH)))
+        .collect();
+
+    let mut totals = Vec::with_capacity(config.iterations);
+    let mut position_counts = vec![0usize; inv.field.len() + 1];
+    let mut by_strategy: HashMap<(u32, u8), (usize, f64, f64)> = HashMap::new();
+    for b in &batches {
+        totals.extend_from_slice(&b.total);
+        for r in 0..b.total.len() {
+            position_counts[b.position[r] as usize - 1] += 1;
+            let compound = if b.pit_lap[r] == NO_STOP { 0 } else { b.stint2[r] };
+            let entry = by_strategy.entry((b.pit_lap[r], compound)).or_insert((0, 0.0, 0.0));
+            entry.0 += 1;
+            entry.1 += b.total[r];
+            entry.2 += b.position[r] as f64;
+        }
+    }
+
+    let mut strategies: Vec<StrategyOutcome> = by_strategy
+        .into_iter()
+        .map(|((pit_lap, compound), (runs, time_sum, pos_sum))| StrategyOutcome {
+            pit_lap: (pit_lap != NO_STOP).then_some(pit_lap),
+            compound: inv.compounds[compound as usize],
+            runs,
+            mean_time_s: time_sum / runs as f64,
+            mean_position: pos_sum / runs as f64,
+        })
+        .collect();
+    strategies.sort_by(|a, b| a.mean_time_s.total_cmp(&b.mean_time_s));
+
+    let iterations = config.iterations;
+    Ok(MonteCarloResult {
+        iterations,
+        num_laps: model.num_laps,
+        field_size: inv.field.len(),
+        finish_time_s: distribution(totals),
+        position_probabilities: position_counts.iter().map(|&c| c as f64 / iterations as f64).collect(),
+        strategies,
+    })
+}
+
+fn distribution(mut values: Vec<f64>) -> Distribution {
+    values.sort_by(f64::total_cmp);
+    let n = values.len();
+    let mean = values.iter().sum::<f64>() / n as f64;
+    let var = values.iter().map(|v| (v - mean).powi(2)).sum::<f64>() / n as f64;
+    let pct = |p: f64| values[((p / 100.0) * (n - 1) as f64).round() as usize];
+
+    let (min, max) = (values[0], values[n - 1]);
+    let width = ((max - min) / HISTOGRAM_BINS as f64).max(1e-9);
+    let mut histogram = vec![0u32; HISTOGRAM_BINS];
+    for v in &values {
+        let bin = (((v - min) / width) as usize).min(HISTOGRAM_BINS - 1);
+        histogram[bin] += 1;
+    }
+
+    Distribution {
+        mean,
+        std_dev: var.sqrt(),
+        min,
+        p5: pct(5.0),
+        p50: pct(50.0),
+        p95: pct(95.0),
+        max,
+        histogram_start: min,
+        histogram_bin_width: width,
+        histogram,
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::session::SampleColumns;
+    use crate::simulation::{run_simulation, CarParams, EnvironmentParams};
+    use crate::test_fixtures;
+
+    fn driver(number: &str, lap_time: f64) -> DriverData {
+        test_fixtures::driver(number, SampleColumns::default(), test_fixtures::laps(31, lap_time, Compound::Medium))
+    }
+
+    fn session() -> SessionData {
+        test_fixtures::session(vec![driver("1", 80.0), driver("16", 80.5), driver("44", 81.0), driver("55", 82.0)])
+    }
+
+    fn config(iterations: usize) -> MonteCarloConfig {
+        MonteCarloConfig {
+            scenario: SimulationScenario {
+                event_name: "Monza".to_string(),
+                session: "R".to_string(),
+                base_driver: "16".to_string(),
+                swap_car_with: None,
+                swap_driver_inputs_with: None,
+                car_params: CarParams::default(),
+                env_params: EnvironmentParams::default(),
+                num_laps: None,
+            },
+            iterations,
+            seed: 7,
+            pit_window: None,
+            compounds: Vec::new(),
+            pit_loss_s: 22.0,
+            safety_car_prob: 0.0,
+            degradation_noise: 0.0,
+            lap_noise_s: 0.0,
+        }
+    }
+
+    #[test]
+    fn test_noise_free_runs_match_run_simulation() {
+        let session = session();
+        let cfg = config(300);
+        let mc = run_monte_carlo(&session, &cfg).unwrap();
+        let single = run_simulation(&session, &cfg.scenario).unwrap();
+        assert!((mc.finish_time_s.mean - single.total_time_s).abs() < 1e-6);
+        assert!(mc.finish_time_s.std_dev < 1e-6);
+        assert_eq!(mc.strategies.len(), 1);
+        assert_eq!(mc.position_probabilities.len(), 4);
+        assert!((mc.position_probabilities.iter().sum::<f64>() - 1.0).abs() < 1e-9);
+    }
+
+    #[test]
+    fn test_real_stop_is_not_counted_twice() {
+        // The base driver lost 12 s into and 10 s out of a real stop after lap 15
+        let mut session_with_stop = session();
+        let base = &mut session_with_stop.drivers[1];
+        for lap in &mut base.laps[15..] {
+            lap.lap_start_time_s += 12.0;
+            lap.compound = Compound::Hard;
+        }
+        for lap in &mut base.laps[16..] {
+            lap.lap_start_time_s += 10.0;
+        }
+        assert_eq!(extract_lap_times(base)[14..16], [92.5, 90.5]);
+        assert_eq!(without_stops(base), vec![80.5; 30]);
+
+        // Runs only pay for the stop they draw, as if the real race had none
+        let cfg = MonteCarloConfig { pit_window: Some([15, 15]), ..config(10) };
+        let with_stop = run_monte_carlo(&session_with_stop, &cfg).unwrap();
+        let clean = run_monte_carlo(&session(), &cfg).unwrap();
+        assert!((with_stop.finish_time_s.mean - clean.finish_time_s.mean).abs() < 1e-6);
+    }
+
+    #[test]
+    fn test_noisy_runs_are_reproducible_and_spread() {
+        let session = session();
+        let cfg = MonteCarloConfig {
+            iterations: 1_000,
+            pit_window: Some([10, 20]),
+            compounds: vec![Compound::Hard, Compound::Soft],
+            safety_car_prob: 0.05,
+            degradation_noise: 0.2,
+            lap_noise_s: 0.3,
+            ..config(0)
+        };
+        let a = run_monte_carlo(&session, &cfg).unwrap();
+        let b = run_monte_carlo(&session, &cfg).unwrap();
+        assert_eq!(a.finish_time_s.mean, b.finish_time_s.mean);
+        assert_eq!(a.finish_time_s.histogram, b.finish_time_s.histogram);
+        assert!(a.finish_time_s.std_dev > 0.0);
+        assert!(a.finish_time_s.p5 <= a.finish_time_s.p50 && a.finish_time_s.p50 <= a.finish_time_s.p95);
+        assert_eq!(a.finish_time_s.histogram.iter().sum::<u32>(), 1_000);
+        assert!(a.strategies.iter().all(|s| s.pit_lap.is_some_and(|p| (10..=20).contains(&p))));
+        assert_eq!(a.strategies.iter().map(|s| s.runs).sum::<usize>(), 1_000);
+
+        assert!(run_monte_carlo(&session, &MonteCarloConfig { safety_car_prob: 1.5, ..cfg.clone() }).is_err());
+        assert!(run_monte_carlo(&session, &MonteCarloConfig { iterations: 0, ..cfg }).is_err());
+    }
+}
@@ -0,0 +1,263 @@
+//! Span timing for the hot paths.
+//!
+//! `PerfLayer` is a `tracing` layer that times every span from creation to
+//! close and hands the duration to a `PerfRecorder`. The recorder keeps a
+//! rolling window per span name for `get_perf_stats` and a bounded buffer of
+//! recent spans that `chrome_trace` renders in the Trace Event format
+//! (chrome://tracing, Perfetto). Async command spans therefore measure wall
+//! time including awaits; lock waits are their own `lock_wait.*` spans.
+//!
+//! Once the windows and trace buffer have filled, recording a span does not
+//! allocate, so instrumenting the playback path leaves it allocation-free.
+
+use parking_lot::Mutex;
+use serde::Serialize;
+use std::collections::{HashMap, VecDeque};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, OnceLock};
+use std::time::{Duration, Instant};
+use tracing::span::{Attributes, Id};
+use tracing::Subscriber;
+use tracing_subscriber::layer::{Context, Layer};
+use tracing_subscriber::registry::LookupSpan;
+
+/// Durations kept per span name for the percentiles.
+pub const STATS_WINDOW: usize = 512;
+/// Most recent spans kept for trace export (~2 MB).
+pub const TRACE_CAPACITY: usize = 50_000;
+
+#[derive(Debug, Clone, Serialize)]
+pub struct SpanStats {
+    pub name: String,
+    /// Spans closed since startup
+    pub count: u64,
+    /// Over the last `window` spans
+    pub window: usize,
+    pub last_ms: f64,
+    pub mean_ms: f64,
+    pub p50_ms: f64,
+    pub p99_ms: f64,
+    pub max_ms: f64,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct PerfStats {
+    /// Sorted by name
+    pub spans: Vec<SpanStats>,
+}
+
+/// Ring of the latest `STATS_WINDOW` durations for one span name.
+#[derive(Default)]
+struct Window {
+    ms: Vec<f32>,
+    next: usize,
+    count: u64,
+    last_ms: f32,
+}
+
+impl Window {
+    fn push(&mut self, ms: f32) {
+        if self.ms.len() < STATS_WINDOW {
+            self.ms.push(ms);
+        } else {
+            self.ms[self.next] = ms;
+        }
+        self.next = (self.next + 1) % STATS_WINDOW;
+        self.count += 1;
+        self.last_ms = ms;
+    }
+
+    fn stats(&self, name: &str) -> SpanStats {
+        let mut sorted = self.ms.clone();
+        sorted.sort_unstable_by(f32::total_cmp);
+        // Nearest rank
+        let pct = |p: f64| sorted[((p * sorted.len() as f64).ceil() as usize).clamp(1, sorted.len()) - 1] as f64;
+        SpanStats {
+            name: name.to_string(),
+            count: self.count,
+            window: sorted.len(),
+            last_ms: self.last_ms as f64,
+            mean_ms: sorted.iter().map(|&v| v as f64).sum::<f64>() / sorted.len() as f64,
+            p50_ms: pct(0.50),
+            p99_ms: pct(0.99),
+            max_ms: *sorted.last().expect("windows are created with a sample") as f64,
+        }
+    }
+}
+
+struct TraceEvent {
+    name: &'static str,
+    start_us: u64,
+    dur_us: u64,
+    tid: u64,
+}
+
+/// Spans open at once we reserve room for up front.
+const OPEN_SPANS: usize = 256;
+
+#[derive(Default)]
+struct Inner {
+    windows: HashMap<&'static str, Window>,
+    trace: VecDeque<TraceEvent>,
+    /// Creation time of each open span by id. Kept here rather than in span
+    /// extensions, which box every value they store.
+    open: HashMap<u64, Instant>,
+}
+
+pub struct PerfRecorder {
+    epoch: Instant,
+    inner: Mutex<Inner>,
+}
+
+impl Default for PerfRecorder {
+    fn default() -> Self {
+        let inner = Inner { open: HashMap::with_capacity(OPEN_SPANS), ..Inner::default() };
+        PerfRecorder { epoch: Instant::now(), inner: Mutex::new(inner) }
+    }
+}
+
+impl PerfRecorder {
+    fn open(&self, id: u64) {
+        self.inner.lock().open.insert(id, Instant::now());
+    }
+
+    /// Record the span opened as `id`, if `open` saw it.
+    fn close(&self, id: u64, name: &'static str) {
+        let started = self.inner.lock().open.remove(&id);
+        if let Some(start) = started {
+            self.record(name, start, start.elapsed());
+        }
+    }
+
+    pub fn record(&self, name: &'static str, start: Instant, duration: Duration) {
+        let event = TraceEvent {
+            name,
+            start_us: start.saturating_duration_since(self.epoch).as_micros() as u64,
+            dur_us: duration.as_micros() as u64,
+            tid: thread_id(),
+        };
+        let mut inner = self.inner.lock();
+        inner.windows.entry(name).or_default().push(duration.as_secs_f32() * 1e3);
+        if inner.trace.len() == TRACE_CAPACITY {
+            inner.trace.pop_front();
+        }
+        inner.trace.push_back(event);
+    }
+
+    pub fn stats(&self) -> PerfStats {
+        let inner = self.inner.lock();
+        let mut spans: Vec<SpanStats> = inner.windows.iter().map(|(name, w)| w.stats(name)).collect();
+        spans.sort_by(|a, b| a.name.cmp(&b.name));
+        PerfStats { spans }
+    }
+
+    /// The buffered spans as a Trace Event Format JSON document.
+    pub fn chrome_trace(&self) -> String {
+        let inner = self.inner.lock();
+        let events: Vec<serde_json::Value> = inner
+            .trace
+            .iter()
+            .map(|e| {
+                serde_json::json!({
+                    "name": e.name, "cat": "span", "ph": "X",
+                    "ts": e.start_us, "dur": e.dur_us, "pid": 1, "tid": e.tid,
+                })
+            })
+            .collect();
+        serde_json::json!({ "traceEvents": events, "displayTimeUnit": "ms" }).to_string()
+    }
+}
+
+/// Small stable per-thread id for the trace's `tid` lanes.
+fn thread_id() -> u64 {
+    static NEXT: AtomicU64 = AtomicU64::new(1);
+    thread_local!(static ID: u64 = NEXT.fetch_add(1, Ordering::Relaxed));
+    ID.with(|id| *id)
+}
+
+/// The process-wide recorder `install` feeds.
+pub fn recorder() -> &'static Arc<PerfRecorder> {
+    static RECORDER: OnceLock<Arc<PerfRecorder>> = OnceLock::new();
+    RECORDER.get_or_init(Arc::default)
+}
+
+/// Route all spans to `recorder()`. Call once at startup; a second call (or
+/// another global subscriber) is ignored.
+pub fn install() {
+    use tracing_subscriber::layer::SubscriberExt;
+    let subscriber = tracing_subscriber::registry().with(PerfLayer::new(recorder().clone()));
+    let _ = tracing::subscriber::set_global_default(subscriber);
+}
+
+// ── Layer ────────────────────────────────────────────────────────────────────
+
+pub struct PerfLayer {
+    recorder: Arc<PerfRecorder>,
+}
+
+impl PerfLayer {
+    pub fn new(recorder: Arc<PerfRecorder>) -> Self {
+        PerfLayer { recorder }
+    }
+}
+
+impl<S> Layer<S> for PerfLayer
+where
+    S: Subscriber + for<'a> LookupSpan<'a>,
+{
+    fn on_new_span(&self, _attrs: &Attributes<'_>, id: &Id, _ctx: Context<'_, S>) {
+        self.recorder.open(id.into_u64());
+    }
+
+    fn on_close(&self, id: Id, ctx: Context<'_, S>) {
+        if let Some(span) = ctx.span(&id) {
+            self.recorder.close(id.into_u64(), span.name());
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use tracing_subscriber::layer::SubscriberExt;
+
+    #[test]
+    fn test_window_percentiles() {
+        let mut w = Window::default();
+        for ms in 1..=100 {
+            w.push(ms as f32);
+        }
+        let s = w.stats("x");
+        assert_eq!((s.count, s.window), (100, 100));
+        assert_eq!((s.p50_ms, s.p99_ms, s.max_ms, s.last_ms), (50.0, 99.0, 100.0, 100.0));
+
+        // Past the window only the latest durations count
+        for _ in 0..STATS_WINDOW {
+            w.push(2.0);
+        }
+        let s = w.stats("x");
+        assert_eq!((s.count, s.window), (100 + STATS_WINDOW as u64, STATS_WINDOW));
+        assert_eq!((s.p99_ms, s.max_ms), (2.0, 2.0));
+    }
+
+    #[test]
+    fn test_layer_records_nested_spans() {
+        let recorder = Arc::new(PerfRecorder::default());
+        let subscriber = tracing_subscriber::registry().with(PerfLayer::new(recorder.clone()));
+        tracing::subscriber::with_default(subscriber, || {
+            for _ in 0..3 {
+                let _outer = tracing::info_span!("outer").entered();
+                let _inner = tracing::info_span!("lock_wait.test").entered();
+            }
+        });
+
+        let stats = recorder.stats();
+        let names: Vec<(&str, u64)> = stats.spans.iter().map(|s| (s.name.as_str(), s.count)).collect();
+        assert_eq!(names, [("lock_wait.test", 3), ("outer", 3)]);
+
+        let trace: serde_json::Value = serde_json::from_str(&recorder.chrome_trace()).unwrap();
+        let events = trace["traceEvents"].as_array().unwrap();
+        assert_eq!(events.len(), 6);
+        assert!(events.iter().all(|e| e["ph"] == "X" && e["dur"].is_u64()));
+    }
+}
@@ -1,8 +1,20 @@
-use crate::session::{DriverData, LapRecord, SessionData};
+use crate::session::{DriverData, LapRecord, SampleColumns, SessionData};
 use crate::types::{DriverAnalysis, RaceAnalysis, RaceInsight, StintAnalysis};
+use rayon::prelude::*;
+
+/// The session's race analysis, computed on the first call and shared by
+/// every later one.
+pub fn cached_analysis(session: &SessionData) -> &RaceAnalysis {
+    session.race_analysis.get_or_init(|| analyze_race(session))
+}
 
 pub fn analyze_race(session: &SessionData) -> RaceAnalysis {
-    let mut drivers: Vec<DriverAnalysis> = session.drivers.iter().map(analyze_driver).collect();
+    // Per-driver passes are independent; keep the driver order for stints
+    let per_driver: Vec<(DriverAnalysis, Vec<StintAnalysis>)> =
+        session.drivers.par_iter().map(analyze_driver).collect();
+    let (mut drivers, stints): (Vec<DriverAnalysis>, Vec<Vec<StintAnalysis>>) = per_driver.into_iter().unzip();
+    let stints: Vec<StintAnalysis> = stints.into_iter().flatten().collect();
+
     let mut all_laps: Vec<f64> = drivers.iter().filter_map(|d| d.median_lap_s).collect();
     all_laps.sort_by(f64::total_cmp);
 
@@ -15,8 +27,6 @@ pub fn analyze_race(session: &SessionData) -> RaceAnalysis {
     score_drivers(&mut drivers, median_race_pace_s);
     drivers.sort_by(|a, b| b.performance_score.total_cmp(&a.performance_score));
 
-    let stints: Vec<StintAnalysis> = session.drivers.iter().flat_map(build_stints).collect();
-
     let insights = build_insights(&drivers, &stints, median_race_pace_s);
 
     RaceAnalysis {
@@ -33,38 +43,23 @@ pub fn analyze_race(session: &SessionData) -> RaceAnalysis {
     }
 }
 
-fn analyze_driver(driver: &DriverData) -> DriverAnalysis {
-    let lap_times = valid_lap_times(driver);
+fn analyze_driver(driver: &DriverData) -> (DriverAnalysis, Vec<StintAnalysis>) {
+    let LapPass { mut lap_times, pit_laps, stints } = LapPass::run(driver);
     let fastest_lap_s = lap_times.iter().copied().min_by(f64::total_cmp);
-    let median_lap_s = {
-        let mut times = lap_times.clone();
-        times.sort_by(f64::total_cmp);
-        median(&times)
-    };
     let consistency_s = lap_stddev(&lap_times);
+    // Order no longer matters, so the median can reorder in place
+    let median_lap_s = median_in_place(&mut lap_times);
     let first_position = driver.laps.first().map(|l| l.position).unwrap_or(20);
     let final_position = driver
         .laps
         .last()
         .map(|l| l.position)
         .unwrap_or(first_position);
-    let pit_laps = pit_laps(driver);
-
-    let moving_samples: Vec<_> = driver.samples.iter().filter(|s| s.speed > 20.0).collect();
-    let sample_count = moving_samples.len().max(1) as f32;
-    let max_speed_kmh = driver.samples.iter().map(|s| s.speed).fold(0.0, f32::max);
-    let avg_speed_kmh = moving_samples.iter().map(|s| s.speed).sum::<f32>() / sample_count;
-    let avg_throttle_pct =
-        moving_samples.iter().map(|s| s.throttle).sum::<f32>() * 100.0 / sample_count;
-    let avg_brake_pct = moving_samples.iter().map(|s| s.brake).sum::<f32>() * 100.0 / sample_count;
-    let drs_usage_pct = moving_samples
-        .iter()
-        .filter(|s| matches!(s.drs, 10 | 12 | 14))
-        .count() as f32
-        * 100.0
-        / sample_count;
 
-    DriverAnalysis {
+    let stats = SampleStats::of(&driver.samples);
+    let sample_count = stats.moving.max(1) as f32;
+
+    let analysis = DriverAnalysis {
         driver_number: driver.driver_number.clone(),
         abbreviation: driver.abbreviation.clone(),
         team: driver.team.clone(),
@@ -74,13 +69,105 @@ fn analyze_driver(driver: &DriverData) -> DriverAnalysis {
         fastest_lap_s,
         median_lap_s,
         consistency_s,
-        max_speed_kmh,
-        avg_speed_kmh,
-        avg_throttle_pct,
-        avg_brake_pct,
-        drs_usage_pct,
+        max_speed_kmh: stats.max_speed,
+        avg_speed_kmh: stats.speed_sum / sample_count,
+        avg_throttle_pct: stats.throttle_sum * 100.0 / sample_count,
+        avg_brake_pct: stats.brake_sum * 100.0 / sample_count,
+        drs_usage_pct: stats.drs_open as f32 * 100.0 / sample_count,
         pit_laps,
         performance_score: 0.0,
+    };
+    (analysis, stints)
+}
+
+/// Telemetry sums over samples where the car is moving (> 20 km/h),
+/// gathered in one pass over the columns.
+#[derive(Default)]
+struct SampleStats {
+    /// Over every sample, moving or not.
+    max_speed: f32,
+    moving: usize,
+    speed_sum: f32,
+    throttle_sum: f32,
+    brake_sum: f32,
+    drs_open: usize,
+}
+
+impl SampleStats {
+    fn of(s: &SampleColumns) -> Self {
+        let mut st = SampleStats::default();
+        let columns = s.speeds.iter().zip(&s.throttles).zip(&s.brakes).zip(&s.drs);
+        for (((&speed, &throttle), &brake), &drs) in columns {
+            st.max_speed = st.max_speed.max(speed);
+            if speed > 20.0 {
+                st.moving += 1;
+                st.speed_sum += speed;
+                st.throttle_sum += throttle;
+                st.brake_sum += brake;
+                st.drs_open += matches!(drs, 10 | 12 | 14) as usize;
+            }
+        }
+        st
+    }
+}
+
+/// Whether the car stopped for tyres between `lap` and the one after it.
+pub(crate) fn pitted_after(lap: &LapRecord, next: &LapRecord) -> bool {
+    lap.compound != next.compound || next.tyre_life < lap.tyre_life
+}
+
+/// Valid lap times, pit laps and stints from one walk over the laps.
+struct LapPass {
+    lap_times: Vec<f64>,
+    pit_laps: Vec<u32>,
+    stints: Vec<StintAnalysis>,
+}
+
+impl LapPass {
+    fn run(driver: &DriverData) -> Self {
+        let laps = &driver.laps;
+        let mut pass = LapPass { lap_times: Vec::with_capacity(laps.len()), pit_laps: Vec::new(), stints: Vec::new() };
+        let mut stint_start = 0;
+        let mut stint_time = 0.0;
+        let mut stint_timed = 0;
+
+        for (i, lap) in laps.iter().enumerate() {
+            if i > stint_start && lap.compound != laps[stint_start].compound {
+                pass.push_stint(driver, &laps[stint_start..i], stint_time, stint_timed);
+                stint_start = i;
+                stint_time = 0.0;
+                stint_timed = 0;
+            }
+            let Some(next) = laps.get(i + 1) else { break };
+
+            let dt = next.lap_start_time_s - lap.lap_start_time_s;
+            if (60.0..200.0).contains(&dt) {
+                pass.lap_times.push(dt);
+                stint_time += dt;
+                stint_timed += 1;
+            }
+            if pitted_after(lap, next) {
+                pass.pit_laps.push(next.lap_number);
+            }
+        }
+        pass.push_stint(driver, &laps[stint_start..], stint_time, stint_timed);
+        pass
+    }
+
+    fn push_stint(&mut self, driver: &DriverData, laps: &[LapRecord], time_sum: f64, timed: usize) {
+        let (Some(first), Some(last)) = (laps.first(), laps.last()) else {
+            return;
+        };
+        self.stints.push(StintAnalysis {
+            driver_number: driver.driver_number.clone(),
+            start_lap: first.lap_number,
+            end_lap: last.lap_number,
+            compound: first.compound,
+            laps: laps.len(),
+            avg_lap_s: (timed > 0).then(|| time_sum / timed as f64),
+            tyre_life_start: first.tyre_life,
+            tyre_life_end: last.tyre_life,
+        });
     }
 }
 
@@ -106,57 +193,6 @@ fn score_drivers(drivers: &mut [DriverAnalysis], field_median: Option<f64>) {
     }
 }
 
-fn build_stints(driver: &DriverData) -> Vec<StintAnalysis> {
-    let mut stints = Vec::new();
-    let mut current: Vec<&LapRecord> = Vec::new();
-    let mut current_compound = String::new();
-
-    for lap in &driver.laps {
-        if current.is_empty() || lap.compound == current_compound {
-            if current.is_empty() {
-                current_compound = lap.compound.clone();
-            }
-            current.push(lap);
-            continue;
-        }
-
-        push_stint(driver, &current, &mut stints);
-        current.clear();
-        current_compound = lap.compound.clone();
-        current.push(lap);
-    }
-
-    push_stint(driver, &current, &mut stints);
-    stints
-}
-
-fn push_stint(driver: &DriverData, laps: &[&LapRecord], stints: &mut Vec<StintAnalysis>) {
-    if laps.is_empty() {
-        return;
-    }
-
-    let start_lap = laps.first().unwrap().lap_number;
-    let end_lap = laps.last().unwrap().lap_number;
-    let compound = laps.first().unwrap().compound.clone();
-    let lap_times = lap_times_for_range(driver, start_lap, end_lap);
-    let avg_lap_s = if lap_times.is_empty() {
-        None
-    } else {
-        Some(lap_times.iter().sum::<f64>() / lap_times.len() as f64)
-    };
-
-    stints.push(StintAnalysis {
-        driver_number: driver.driver_number.clone(),
-        start_lap,
-        end_lap,
-        compound,
-        laps: laps.len(),
-        avg_lap_s,
-        tyre_life_start: laps.first().unwrap().tyre_life,
-        tyre_life_end: laps.last().unwrap().tyre_life,
-    });
-}
-
 fn build_insights(
     drivers: &[DriverAnalysis],
     stints: &[StintAnalysis],
@@ -242,50 +278,6 @@ fn build_insights(
     insights
 }
 
-fn valid_lap_times(driver: &DriverData) -> Vec<f64> {
-    let mut times = Vec::new();
-    for i in 0..driver.laps.len().saturating_sub(1) {
-        let lap = &driver.laps[i];
-        let next = &driver.laps[i + 1];
-        let dt = next.lap_start_time_s - lap.lap_start_time_s;
-        if (60.0..200.0).contains(&dt) {
-            times.push(dt);
-        }
-    }
-    times
-}
-
-fn lap_times_for_range(driver: &DriverData, start_lap: u32, end_lap: u32) -> Vec<f64> {
-    let mut times = Vec::new();
-    for i in 0..driver.laps.len().saturating_sub(1) {
-        let lap = &driver.laps[i];
-        if lap.lap_number < start_lap || lap.lap_number > end_lap {
-            continue;
-        }
-        let dt = driver.laps[i + 1].lap_start_time_s - lap.lap_start_time_s;
-        if (60.0..200.0).contains(&dt) {
-            times.push(dt);
-        }
-    }
-    times
-}
-
-fn pit_laps(driver: &DriverData) -> Vec<u32> {
-    driver
-        .laps
-        .windows(2)
-        .filter_map(|pair| {
-            let a = &pair[0];
-            let b = &pair[1];
-            if a.compound != b.compound || b.tyre_life < a.tyre_life {
-                Some(b.lap_number)
-            } else {
-                None
-            }
-        })
-        .collect()
-}
-
 fn lap_stddev(values: &[f64]) -> Option<f64> {
     if values.len() < 2 {
         return None;
@@ -295,6 +287,21 @@ fn lap_stddev(values: &[f64]) -> Option<f64> {
     Some(variance.sqrt())
 }
 
+/// Median of unsorted values, reordering them; O(n) selection rather than
+/// a full sort.
+fn median_in_place(values: &mut [f64]) -> Option<f64> {
+    if values.is_empty() {
+        return None;
+    }
+    let (len, mid) = (values.len(), values.len() / 2);
+    let (below, &mut upper, _) = values.select_nth_unstable_by(mid, f64::total_cmp);
+    if len % 2 == 1 {
+        return Some(upper);
+    }
+    let lower = below.iter().copied().max_by(f64::total_cmp).unwrap();
+    Some((lower + upper) / 2.0)
+}
+
 fn median(values: &[f64]) -> Option<f64> {
     if values.is_empty() {
         return None;
@@ -312,3 +319,47 @@ fn format_optional_time(value: Option<f64>) -> String {
         .map(|v| format!("{v:.3}s"))
         .unwrap_or_else(|| "unavailable".to_string())
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::test_fixtures;
+    use crate::types::Compound;
+
+    fn lap(lap_number: u32, start: f64, compound: Compound, tyre_life: u8) -> LapRecord {
+        LapRecord { lap_number, lap_start_time_s: start, position: 3, compound, tyre_life }
+    }
+
+    #[test]
+    fn test_lap_pass_splits_stints_and_pits() {
+        let laps = vec![
+            lap(1, 0.0, Compound::Medium, 1),
+            lap(2, 90.0, Compound::Medium, 2),
+            lap(3, 180.0, Compound::Medium, 3),
+            // In-lap plus stop: over the valid range
+            lap(4, 400.0, Compound::Hard, 1),
+            lap(5, 491.0, Compound::Hard, 2),
+            lap(6, 583.0, Compound::Hard, 3),
+        ];
+        let mut driver = test_fixtures::driver("4", SampleColumns::default(), laps);
+        driver.abbreviation = "NOR".to_string();
+        let pass = LapPass::run(&driver);
+        assert_eq!(pass.lap_times, vec![90.0, 90.0, 91.0, 92.0]);
+        assert_eq!(pass.pit_laps, vec![4]);
+        assert_eq!(pass.stints.len(), 2);
+        assert_eq!((pass.stints[0].start_lap, pass.stints[0].end_lap, pass.stints[0].laps), (1, 3, 3));
+        assert_eq!(pass.stints[0].avg_lap_s, Some(90.0));
+        assert_eq!((pass.stints[1].start_lap, pass.stints[1].end_lap), (4, 6));
+        assert_eq!(pass.stints[1].avg_lap_s, Some(91.5));
+    }
+
+    #[test]
+    fn test_median_in_place_matches_sorted_median() {
+        for values in [vec![3.0, 1.0, 2.0], vec![4.0, 1.0, 3.0, 2.0], vec![5.0], vec![2.0, 1.0]] {
+            let mut sorted = values.clone();
+            sorted.sort_by(f64::total_cmp);
+            assert_eq!(median_in_place(&mut values.clone()), median(&sorted));
+        }
+        assert_eq!(median_in_place(&mut []), None);
+    }
+}
@@ -0,0 +1,425 @@
+//! Self-contained replay bundles: a whole session's playback at a fixed
+//! rate, for `static/replay-player.html` or any other reader.
+//!
+//! ```text
+//! replay_export --db f1.duckdb --event "Las Vegas Grand Prix" --session R --out vegas_r.f1replay [--hz 2] [--no-snapshots]
+//! ```
+//!
+//! Everything is little-endian. Frame `k` is the session at `t = k / hz`,
+//! sampled through `get_frame_into` (so from the frame cache when the
+//! session has one), and record `i` of a frame is driver `i` of `drivers`.
+//! Frames follow the metadata back to back, so a reader can play whatever
+//! prefix has arrived while the rest is still downloading. Values that only
+//! change once a lap (position, tyres) are in `laps` rather than in every
+//! record, and heading is left to the reader to take from the motion.
+//!
+//! ```text
+//! header  16 bytes   "F1RPLY\0\0" | u32 version | u32 meta_bytes
+//! meta    JSON `BundleMeta`, space-padded to a multiple of 8 bytes
+//! frames  frame_count * drivers * RECORD_BYTES
+//! record  8 bytes    0 u16 x   2 u16 y   4 u16 speed (0.1 km/h)
+//!                    6 u8 gear 7 u8 flags (`frame_wire::FLAG_DRS`, `FLAG_IN_PIT`)
+//! ```
+//!
+//! Positions are quantised over the track bounds: world `x = origin[0] +
+//! qx * scale[0]`, likewise `y`. Keep the player's decoder in sync.
+
+use crate::frame_wire::{FLAG_DRS, FLAG_IN_PIT};
+use crate::lap_index;
+use crate::session::{get_frame_into, load_session, LoadOptions, SessionData};
+use crate::types::{Compound, DriverFrame, DriverMeta, FrameData, HeatCell};
+use rayon::prelude::*;
+use serde::{Deserialize, Serialize};
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::time::Instant;
+
+pub const BUNDLE_MAGIC: &[u8; 8] = b"F1RPLY\0\0";
+pub const BUNDLE_VERSION: u32 = 1;
+pub const HEADER_BYTES: usize = 16;
+pub const RECORD_BYTES: usize = 8;
+
+pub const DEFAULT_EXPORT_HZ: f64 = 2.0;
+const MAX_EXPORT_HZ: f64 = 50.0;
+/// Frames encoded per rayon task.
+const FRAMES_PER_TASK: usize = 256;
+/// Share of the track extent added on each side before quantising, so the
+/// pit lane and run-off just outside the reference driver's bounds still fit.
+const BOUNDS_MARGIN: f32 = 0.05;
+/// Track outline density (points per metre of lap) and its cap.
+const OUTLINE_POINTS_PER_M: f32 = 0.2;
+const MAX_OUTLINE_POINTS: usize = 2_000;
+
+const USAGE: &str = "usage: replay_export --db <f1.duckdb> --event <name> --session <R|Q|...> --out <file.f1replay> [--hz N] [--no-snapshots]";
+
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct BundleMeta {
+    pub version: u32,
+    pub event_name: String,
+    pub session: String,
+    pub duration_s: f64,
+    pub hz: f64,
+    pub frame_count: u32,
+    pub record_bytes: u32,
+    pub origin: [f32; 2],
+    pub scale: [f32; 2],
+    pub lap_distance_m: f32,
+    pub drivers: Vec<DriverMeta>,
+    /// Per driver, in `drivers` order; the lap in progress at `t` is the
+    /// last one with `start_s <= t`, or the first before it.
+    pub laps: Vec<Vec<BundleLap>>,
+    /// One lap of the circuit, for drawing the track
+    pub outline: Vec<[f32; 2]>,
+    pub heatmap: Vec<HeatCell>,
+}
+
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct BundleLap {
+    pub lap_number: u32,
+    pub start_s: f64,
+    pub position: u8,
+    pub compound: Compound,
+    pub tyre_life: u8,
+}
+
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct ExportSummary {
+    pub path: String,
+    pub bytes: u64,
+    pub frames: u32,
+    pub drivers: u32,
+    pub elapsed_ms: f64,
+}
+
+/// Maps world coordinates onto the u16 grid described by `origin` / `scale`.
+struct Quantizer {
+    origin: [f32; 2],
+    inv_scale: [f32; 2],
+}
+
+impl Quantizer {
+    fn axis(&self, v: f32, axis: usize) -> u16 {
+        ((v - self.origin[axis]) * self.inv_scale[axis]).round().clamp(0.0, u16::MAX as f32) as u16
+    }
+}
+
+/// `origin` and `scale` covering the session's track bounds plus a margin.
+fn quantization(session: &SessionData) -> ([f32; 2], [f32; 2]) {
+    let l = &session.track_layout;
+    let axis = |lo: f32, hi: f32| {
+        let (lo, hi) = if lo.is_finite() && hi.is_finite() && hi > lo { (lo, hi) } else { (-10_000.0, 10_000.0) };
+        let pad = (hi - lo) * BOUNDS_MARGIN;
+        (lo - pad, (hi - lo + 2.0 * pad) / u16::MAX as f32)
+    };
+    let (x0, sx) = axis(l.x_min, l.x_max);
+    let (y0, sy) = axis(l.y_min, l.y_max);
+    ([x0, y0], [sx, sy])
+}
+
+/// The reference lap, or a thinned copy of the layout's center line when
+/// the session has no clean lap to build one from.
+fn outline(session: &SessionData) -> Vec<[f32; 2]> {
+    let index = lap_index::track_index(session);
+    let n = index
+        .lap_length_m()
+        .map_or(0, |m| ((m * OUTLINE_POINTS_PER_M) as usize).clamp(64, MAX_OUTLINE_POINTS));
+    index.outline(n).unwrap_or_else(|| {
+        let line = &session.track_layout.center_line;
+        line.iter().step_by(line.len().div_ceil(MAX_OUTLINE_POINTS).max(1)).copied().collect()
+    })
+}
+
+fn encode_record(d: &DriverFrame, q: &Quantizer, out: &mut [u8]) {
+    let speed = (d.speed * 10.0).round().clamp(0.0, u16::MAX as f32) as u16;
+    let mut flags = 0u8;
+    if d.drs_active {
+        flags |= FLAG_DRS;
+    }
+    if d.is_in_pit {
+        flags |= FLAG_IN_PIT;
+    }
+    out[0..2].copy_from_slice(&q.axis(d.x, 0).to_le_bytes());
+    out[2..4].copy_from_slice(&q.axis(d.y, 1).to_le_bytes());
+    out[4..6].copy_from_slice(&speed.to_le_bytes());
+    out[6..8].copy_from_slice(&[d.gear, flags]);
+}
+
+/// Frames `t = 0, 1/hz, …` up to and including `duration_s`.
+fn frame_count(duration_s: f64, hz: f64) -> usize {
+    (duration_s.max(0.0) * hz).floor() as usize + 1
+}
+
+/// Encode the whole session at `hz` frames per second of session time.
+pub fn encode_bundle(session: &SessionData, hz: f64) -> Result<Vec<u8>, String> {
+    if !(hz.is_finite() && hz > 0.0 && hz <= MAX_EXPORT_HZ) {
+        return Err(format!("Export rate must be in (0, {MAX_EXPORT_HZ}] Hz, got {hz}"));
+    }
+    if session.drivers.is_empty() {
+        return Err(format!("{} {} has no drivers to export", session.event_name, session.session));
+    }
+    let frame_count = frame_count(session.duration_s, hz);
+    let frame_bytes = session.drivers.len() * RECORD_BYTES;
+    let (origin, scale) = quantization(session);
+
+    let meta = BundleMeta {
+        version: BUNDLE_VERSION,
+        event_name: session.event_name.clone(),
+        session: session.session.clone(),
+        duration_s: session.duration_s,
+        hz,
+        frame_count: frame_count as u32,
+        record_bytes: RECORD_BYTES as u32,
+        origin,
+        scale,
+        lap_distance_m: session.track_layout.lap_distance_m,
+        drivers: session.driver_meta(),
+        laps: session
+            .drivers
+            .iter()
+            .map(|d| {
+                d.laps
+                    .iter()
+                    .map(|l| BundleLap {
+                        lap_number: l.lap_number,
+                        start_s: l.lap_start_time_s,
+                        position: l.position,
+                        compound: l.compound,
+                        tyre_life: l.tyre_life,
+                    })
+                    .collect()
+            })
+            .collect(),
+        outline: outline(session),
+        heatmap: session.heatmap.clone(),
+    };
+    let mut json = serde_json::to_vec(&meta).map_err(|e| format!("Failed to encode bundle metadata: {e}"))?;
+    json.resize(json.len().next_multiple_of(8), b' ');
+
+    let frames_at = HEADER_BYTES + json.len();
+    let mut out = Vec::with_capacity(frames_at + frame_count * frame_bytes);
+    out.extend_from_slice(BUNDLE_MAGIC);
+    out.extend_from_slice(&BUNDLE_VERSION.to_le_bytes());
+    out.extend_from_slice(&(json.len() as u32).to_le_bytes());
+    out.extend_from_slice(&json);
+    out.resize(frames_at + frame_count * frame_bytes, 0);
+
+    let q = Quantizer { origin, inv_scale: [1.0 / scale[0], 1.0 / scale[1]] };
+    out[frames_at..]
+        .par_chunks_mut(FRAMES_PER_TASK * frame_bytes)
+        .enumerate()
+        .for_each(|(task, chunk)| {
+            let mut frame = FrameData::default();
+            for (j, rows) in chunk.chunks_exact_mut(frame_bytes).enumerate() {
+                let k = task * FRAMES_PER_TASK + j;
+                get_frame_into(session, k as f64 / hz, &mut frame);
+                for (d, rec) in frame.drivers.iter().zip(rows.chunks_exact_mut(RECORD_BYTES)) {
+                    encode_record(d, &q, rec);
+                }
+            }
+        });
+    Ok(out)
+}
+
+/// Encode `session` and write it to `path` (through a temporary file, so a
+/// player never sees a half-written bundle under the final name). The
+/// temporary name is unique per process and call, so concurrent exports to
+/// the same path never share one.
+pub fn export_to_file(session: &SessionData, hz: f64, path: &Path) -> Result<ExportSummary, String> {
+    static TMP_COUNTER: AtomicU64 = AtomicU64::new(0);
+
+    let started = Instant::now();
+    let bytes = encode_bundle(session, hz)?;
+    let n = TMP_COUNTER.fetch_add(1, Ordering::Relaxed);
+    let tmp = path.with_extension(format!("f1replay.{}.{n}.tmp", std::process::id()));
+    if let Err(e) = std::fs::write(&tmp, &bytes) {
+        let _ = std::fs::remove_file(&tmp);
+        return Err(format!("Failed to write {}: {e}", tmp.display()));
+    }
+    std::fs::rename(&tmp, path).map_err(|e| {
+        let _ = std::fs::remove_file(&tmp);
+        format!("Failed to publish {}: {e}", path.display())
+    })?;
+
+    Ok(ExportSummary {
+        path: path.display().to_string(),
+        bytes: bytes.len() as u64,
+        frames: frame_count(session.duration_s, hz) as u32,
+        drivers: session.drivers.len() as u32,
+        elapsed_ms: started.elapsed().as_secs_f64() * 1e3,
+    })
+}
+
+#[derive(Debug, PartialEq)]
+pub struct ExportOptions {
+    pub db_path: String,
+    pub event_name: String,
+    pub session: String,
+    pub out_path: PathBuf,
+    pub hz: f64,
+    pub snapshots: bool,
+}
+
+pub fn parse_args(args: &[String]) -> Result<ExportOptions, String> {
+    let (mut db, mut event, mut session, mut out, mut hz, mut snapshots) = (None, None, None, None, DEFAULT_EXPORT_HZ, true);
+    let mut it = args.iter();
+    while let Some(arg) = it.next() {
+        let mut value = || it.next().cloned().ok_or_else(|| format!("{arg} needs a value\n{USAGE}"));
+        match arg.as_str() {
+            "--db" => db = Some(value()?),
+            "--event" => event = Some(value()?),
+            "--session" => session = Some(value()?),
+            "--out" => out = Some(PathBuf::from(value()?)),
+            "--hz" => {
+                let v = value()?;
+                hz = v.parse().ok().filter(|&h: &f64| h > 0.0 && h <= MAX_EXPORT_HZ).ok_or_else(|| format!("Bad --hz value: {v}"))?;
+            }
+            "--no-snapshots" => snapshots = false,
+            "-h" | "--help" => return Err(USAGE.to_string()),
+            other => return Err(format!("Unknown argument: {other}\n{USAGE}")),
+        }
+    }
+    let missing = |name: &str| format!("Missing {name}\n{USAGE}");
+    Ok(ExportOptions {
+        db_path: db.ok_or_else(|| missing("--db"))?,
+        event_name: event.ok_or_else(|| missing("--event"))?,
+        session: session.ok_or_else(|| missing("--session"))?,
+        out_path: out.ok_or_else(|| missing("--out"))?,
+        hz,
+        snapshots,
+    })
+}
+
+/// `replay_export` entry point; `args` excludes the program name.
+pub fn main(args: &[String]) -> Result<(), String> {
+    let opts = parse_args(args)?;
+    let started = Instant::now();
+    let options = LoadOptions { snapshots: opts.snapshots, ..LoadOptions::default() };
+    let session = load_session(&opts.db_path, &opts.event_name, &opts.session, &options)
+        .map_err(|e| format!("Failed to load {} {}: {e}", opts.event_name, opts.session))?;
+    eprintln!("Loaded {} {} in {:.1}s", opts.event_name, opts.session, started.elapsed().as_secs_f64());
+
+    let summary = export_to_file(&session, opts.hz, &opts.out_path)?;
+    eprintln!(
+        "{} frames x {} drivers at {} Hz in {:.0}ms, {:.1} MB -> {}",
+        summary.frames,
+        summary.drivers,
+        opts.hz,
+        summary.elapsed_ms,
+        summary.bytes as f64 / 1e6,
+        summary.path
+    );
+    Ok(())
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::frame_cache::FrameCache;
+    use crate::session::{DriverData, LapRecord};
+    use crate::test_fixtures;
+    use crate::telemetry_lod::TelemetryLod;
+    use crate::types::TrackLayout;
+
+    /// Drivers circling a 1 km-radius track at 4 Hz for 100 s, one lap each,
+    /// each a quarter turn behind the last.
+    fn circling_session(n: usize, frame_cache_hz: Option<f64>) -> SessionData {
+        let duration_s = 100.0;
+        let drivers: Vec<DriverData> = (0..n)
+            .map(|d| {
+                let mut s = test_fixtures::circle_samples(1_000.0, duration_s, duration_s, 4.0, d as f64 / 4.0);
+                for drs in &mut s.drs[201..] {
+                    *drs = 12;
+                }
+                let lap = LapRecord { lap_number: 1, lap_start_time_s: 0.0, position: d as u8 + 1, compound: Compound::Soft, tyre_life: 4 };
+                let mut driver = test_fixtures::driver(&(d + 1).to_string(), s, vec![lap]);
+                driver.abbreviation = format!("D{:02}", d + 1);
+                driver.team = "McLaren".to_string();
+                driver.lod = TelemetryLod::build(&driver.samples);
+                driver
+            })
+            .collect();
+        SessionData {
+            event_name: "Test Grand Prix".to_string(),
+            heatmap: vec![HeatCell { x: 0.0, y: 1_000.0, speed_norm: 0.5 }],
+            track_layout: TrackLayout {
+                center_line: vec![[1_000.0, 0.0], [0.0, 1_000.0]],
+                x_min: -1_000.0,
+                x_max: 1_000.0,
+                y_min: -1_000.0,
+                y_max: 1_000.0,
+                duration_s,
+                lap_distance_m: 6_283.0,
+            },
+            frame_cache: frame_cache_hz.map(|hz| FrameCache::build(&drivers, duration_s, hz)),
+            ..test_fixtures::session(drivers)
+        }
+    }
+
+    /// Reader side of the format, as the player implements it.
+    fn decode(bytes: &[u8]) -> (BundleMeta, &[u8]) {
+        assert_eq!(&bytes[..8], BUNDLE_MAGIC);
+        assert_eq!(u32::from_le_bytes(bytes[8..12].try_into().unwrap()), BUNDLE_VERSION);
+        let meta_bytes = u32::from_le_bytes(bytes[12..16].try_into().unwrap()) as usize;
+        assert_eq!(meta_bytes % 8, 0);
+        let meta: BundleMeta = serde_json::from_slice(&bytes[HEADER_BYTES..HEADER_BYTES + meta_bytes]).unwrap();
+        (meta, &bytes[HEADER_BYTES + meta_bytes..])
+    }
+
+    /// Every record of `bytes` decodes to `session`'s frame at its time,
+    /// within one quantisation step.
+    fn assert_frames_match(session: &SessionData, bytes: &[u8]) {
+        let (meta, frames) = decode(bytes);
+        let (frame_count, n) = (meta.frame_count as usize, meta.drivers.len());
+        assert_eq!(frames.len(), frame_count * n * RECORD_BYTES);
+        let mut expected = FrameData::default();
+        for k in 0..frame_count {
+            get_frame_into(session, k as f64 / meta.hz, &mut expected);
+            for (i, want) in expected.drivers.iter().enumerate() {
+                let rec = &frames[(k * n + i) * RECORD_BYTES..][..RECORD_BYTES];
+                let u16_at = |o: usize| u16::from_le_bytes([rec[o], rec[o + 1]]) as f32;
+                let x = meta.origin[0] + u16_at(0) * meta.scale[0];
+                let y = meta.origin[1] + u16_at(2) * meta.scale[1];
+                assert!(
+                    (x - want.x).abs() <= meta.scale[0] && (y - want.y).abs() <= meta.scale[1],
+                    "k={k} i={i}: ({x}, {y}) vs ({}, {})", want.x, want.y
+                );
+                assert!((u16_at(4) / 10.0 - want.speed).abs() <= 0.05);
+                assert_eq!(rec[6], want.gear);
+                assert_eq!((rec[7] & FLAG_DRS != 0, rec[7] & FLAG_IN_PIT != 0), (want.drs_active, want.is_in_pit));
+            }
+        }
+    }
+
+    #[test]
+    fn test_bundle_round_trips_frames() {
+        let session = circling_session(3, Some(10.0));
+        let bytes = encode_bundle(&session, 4.0).unwrap();
+        let (meta, _) = decode(&bytes);
+        assert_eq!((meta.frame_count, meta.drivers.len(), meta.record_bytes), (401, 3, 8));
+        assert_eq!((meta.laps[2][0].position, meta.laps[2][0].compound), (3, Compound::Soft));
+        assert!(!meta.outline.is_empty() && meta.heatmap.len() == 1);
+        assert_frames_match(&session, &bytes);
+
+        // Without the frame cache the same frames come from the splines
+        let uncached_session = circling_session(3, None);
+        let uncached = encode_bundle(&uncached_session, 4.0).unwrap();
+        assert_frames_match(&uncached_session, &uncached);
+        assert!(encode_bundle(&session, 0.0).is_err());
+    }
+
+    #[test]
+    fn test_parse_args() {
+        let args: Vec<String> = ["--db", "f1.duckdb", "--event", "Las Vegas Grand Prix", "--session", "R", "--out", "v.f1replay"]
+            .map(String::from)
+            .to_vec();
+        let opts = parse_args(&args).unwrap();
+        assert_eq!((opts.event_name.as_str(), opts.hz, opts.snapshots), ("Las Vegas Grand Prix", DEFAULT_EXPORT_HZ, true));
+
+        let mut more = args.clone();
+        more.extend(["--hz", "10", "--no-snapshots"].map(String::from));
+        assert_eq!(parse_args(&more).unwrap().hz, 10.0);
+        more[9] = "0".to_string();
+        assert!(parse_args(&more).unwrap_err().contains("--hz"));
+        assert!(parse_args(&args[..6]).unwrap_err().starts_with("Missing --out"));
+    }
+}
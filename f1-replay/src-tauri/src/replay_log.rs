@@ -0,0 +1,573 @@
+//! Append-only columnar log of batch simulation results.
+//!
+//! A log is a 16-byte file header followed by self-contained blocks, each
+//! holding the results of a batch of scenario runs:
+//!
+//! ```text
+//! header   "F1RLOG\0\0" | u32 version | u32 reserved
+//! block    u32 magic "BLK1" | u32 n_runs | u32 n_laps | u32 reserved
+//!          u64 payload_bytes | u64 FNV-1a checksum of the payload
+//! payload  run columns, then lap columns, then the run text, each
+//!          column little-endian and padded to 8 bytes:
+//!            f64 total_time_s, f64 total_delta_s,
+//!            f32 fastest_lap_s, f32 avg_lap_s,
+//!            u32 scenario_index, u32 lap_end, u32 text_end, u8 status
+//!            f32 lap_time_s, f32 delta_s, f32 fuel_kg,
+//!            u16 lap_number, u8 compound, u8 tyre_life
+//!            utf-8 text (description, or the error of a failed run)
+//! ```
+//!
+//! `lap_end` / `text_end` are exclusive offsets into the block's lap rows and
+//! text, so run `i` spans `[end[i-1], end[i])`. Blocks are written with one
+//! `write_all` each; a crash mid-write leaves at most one torn trailing block,
+//! which readers skip and `ReplayLogWriter::open` truncates before appending.
+//! Every column starts 8-aligned relative to the block, and the reader only
+//! needs a `&[u8]`, so the viewer reads a log straight out of a memory map
+//! (`OpenReplayLog`).
+
+use crate::simulation::{SimulatedLap, SimulationResult};
+use crate::types::Compound;
+use serde::Serialize;
+use memmap2::Mmap;
+use std::fs::{File, OpenOptions};
+use std::io::Write;
+use std::path::{Path, PathBuf};
+use std::time::SystemTime;
+
+const MAGIC: &[u8; 8] = b"F1RLOG\0\0";
+const BLOCK_MAGIC: &[u8; 4] = b"BLK1";
+pub const REPLAY_LOG_VERSION: u32 = 1;
+const HEADER_BYTES: usize = 16;
+const BLOCK_HEADER_BYTES: usize = 32;
+
+/// Outcome of one scenario run.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Serialize)]
+#[serde(rename_all = "lowercase")]
+#[repr(u8)]
+pub enum RunStatus {
+    Ok = 0,
+    Failed = 1,
+}
+
+/// One scenario's row in the log: its result, or the error it failed with.
+pub struct RunRecord<'a> {
+    pub scenario_index: u32,
+    pub outcome: Result<&'a SimulationResult, &'a str>,
+}
+
+// ── Writing ──────────────────────────────────────────────────────────────────
+
+/// Encode `runs` as one block.
+pub fn encode_block(runs: &[RunRecord]) -> Vec<u8> {
+    let laps: Vec<&SimulatedLap> =
+        runs.iter().flat_map(|r| r.outcome.map(|res| res.laps.as_slice()).unwrap_or_default()).collect();
+
+    let mut p = Vec::new();
+    let results: Vec<Option<&SimulationResult>> = runs.iter().map(|r| r.outcome.ok()).collect();
+    column(&mut p, results.iter().map(|r| r.map_or(f64::NAN, |res| res.total_time_s)), f64::to_le_bytes);
+    column(
+        &mut p,
+        results.iter().map(|r| r.map_or(f64::NAN, |res| res.delta_summary.total_time_delta_s)),
+        f64::to_le_bytes,
+    );
+    column(&mut p, results.iter().map(|r| r.map_or(f32::NAN, |res| res.fastest_lap_s as f32)), f32::to_le_bytes);
+    column(&mut p, results.iter().map(|r| r.map_or(f32::NAN, |res| res.avg_lap_time_s as f32)), f32::to_le_bytes);
+    column(&mut p, runs.iter().map(|r| r.scenario_index), u32::to_le_bytes);
+    let mut lap_end = 0u32;
+    column(
+        &mut p,
+        results.iter().map(|r| {
+            lap_end += r.map_or(0, |res| res.laps.len() as u32);
+            lap_end
+        }),
+        u32::to_le_bytes,
+    );
+    let text: Vec<&str> = runs.iter().map(|r| r.outcome.map_or_else(|e| e, |res| &res.delta_summary.description)).collect();
+    let mut text_end = 0u32;
+    column(
+        &mut p,
+        text.iter().map(|t| {
+            text_end += t.len() as u32;
+            text_end
+        }),
+        u32::to_le_bytes,
+    );
+    let status = |r: &RunRecord| if r.outcome.is_ok() { RunStatus::Ok } else { RunStatus::Failed } as u8;
+    column(&mut p, runs.iter().map(status), u8::to_le_bytes);
+
+    column(&mut p, laps.iter().map(|l| l.lap_time_s as f32), f32::to_le_bytes);
+    column(&mut p, laps.iter().map(|l| l.delta_to_baseline_s as f32), f32::to_le_bytes);
+    column(&mut p, laps.iter().map(|l| l.fuel_remaining_kg as f32), f32::to_le_bytes);
+    column(&mut p, laps.iter().map(|l| l.lap_number.min(u16::MAX as u32) as u16), u16::to_le_bytes);
+    column(&mut p, laps.iter().map(|l| l.compound.code()), u8::to_le_bytes);
+    column(&mut p, laps.iter().map(|l| l.tyre_life.min(255) as u8), u8::to_le_bytes);
+
+    for t in &text {
+        p.extend_from_slice(t.as_bytes());
+    }
+    pad8(&mut p);
+
+    let mut block = Vec::with_capacity(BLOCK_HEADER_BYTES + p.len());
+    block.extend_from_slice(BLOCK_MAGIC);
+    block.extend_from_slice(&(runs.len() as u32).to_le_bytes());
+    block.extend_from_slice(&(laps.len() as u32).to_le_bytes());
+    block.extend_from_slice(&0u32.to_le_bytes());
+    block.extend_from_slice(&(p.len() as u64).to_le_bytes());
+    block.extend_from_slice(&fnv1a(&p).to_le_bytes());
+    block.extend_from_slice(&p);
+    block
+}
+
+fn column<T, const N: usize>(out: &mut Vec<u8>, values: impl Iterator<Item = T>, bytes: fn(T) -> [u8; N]) {
+    for v in values {
+        out.extend_from_slice(&bytes(v));
+    }
+    pad8(out);
+}
+
+fn pad8(out: &mut Vec<u8>) {
+    out.resize(out.len().next_multiple_of(8), 0);
+}
+
+fn fnv1a(bytes: &[u8]) -> u64 {
+    bytes.iter().fold(0xcbf2_9ce4_8422_2325, |h, &b| (h ^ b as u64).wrapping_mul(0x0100_0000_01b3))
+}
+
+/// Appends blocks to a log file. Safe to share behind a mutex: every block
+/// reaches the file in a single write.
+pub struct ReplayLogWriter {
+    file: File,
+}
+
+impl ReplayLogWriter {
+    /// Create `path` as a new, empty log, replacing whatever was there. The
+    /// old file is unlinked rather than truncated, so readers that mapped it
+    /// keep their copy.
+    pub fn create(path: &Path) -> Result<Self, String> {
+        let _ = std::fs::remove_file(path);
+        let mut file = File::create(path).map_err(|e| format!("Failed to create replay log {}: {e}", path.display()))?;
+        file.write_all(&header()).map_err(|e| format!("Failed to write replay log header: {e}"))?;
+        Ok(ReplayLogWriter { file })
+    }
+
+    /// Open `path` for appending, creating it (with a header) if it is new or
+    /// empty. A torn block left by an interrupted writer is cut off first.
+    pub fn open(path: &Path) -> Result<Self, String> {
+        let mut file = OpenOptions::new()
+            .read(true)
+            .append(true)
+            .create(true)
+            .open(path)
+            .map_err(|e| format!("Failed to open replay log {}: {e}", path.display()))?;
+        let existing = std::fs::read(path).map_err(|e| format!("Failed to read replay log {}: {e}", path.display()))?;
+        if existing.is_empty() {
+            file.write_all(&header()).map_err(|e| format!("Failed to write replay log header: {e}"))?;
+        } else {
+            let log = ReplayLog::parse(&existing)?;
+            if log.valid_bytes < existing.len() {
+                file.set_len(log.valid_bytes as u64).map_err(|e| format!("Failed to truncate replay log: {e}"))?;
+            }
+        }
+        Ok(ReplayLogWriter { file })
+    }
+
+    pub fn append(&mut self, runs: &[RunRecord]) -> Result<(), String> {
+        self.file.write_all(&encode_block(runs)).map_err(|e| format!("Failed to append to replay log: {e}"))
+    }
+
+    pub fn sync(&mut self) -> Result<(), String> {
+        self.file.sync_data().map_err(|e| format!("Failed to sync replay log: {e}"))
+    }
+}
+
+fn header() -> [u8; HEADER_BYTES] {
+    let mut h = [0u8; HEADER_BYTES];
+    h[..8].copy_from_slice(MAGIC);
+    h[8..12].copy_from_slice(&REPLAY_LOG_VERSION.to_le_bytes());
+    h
+}
+
+// ── Reading ──────────────────────────────────────────────────────────────────
+
+/// A parsed view over log bytes; nothing is copied until a run is decoded.
+pub struct ReplayLog<'a> {
+    pub blocks: Vec<Block<'a>>,
+    /// Length of the well-formed prefix; less than the input when the last
+    /// block is torn or corrupt.
+    pub valid_bytes: usize,
+}
+
+impl<'a> ReplayLog<'a> {
+    pub fn parse(bytes: &'a [u8]) -> Result<Self, String> {
+        if bytes.len() < HEADER_BYTES || &bytes[..8] != MAGIC {
+            return Err("Not a replay log".to_string());
+        }
+        let version = u32::from_le_bytes(bytes[8..12].try_into().unwrap());
+        if version != REPLAY_LOG_VERSION {
+            return Err(format!("Replay log version {version}, expected {REPLAY_LOG_VERSION}"));
+        }
+        Ok(Self::walk(bytes, Block::parse))
+    }
+
+    /// Blocks from the end of the header until `block` rejects one.
+    fn walk(bytes: &'a [u8], block: fn(&'a [u8]) -> Option<(Block<'a>, usize)>) -> Self {
+        let mut blocks = Vec::new();
+        let mut pos = HEADER_BYTES;
+        while let Some((b, len)) = block(&bytes[pos..]) {
+            blocks.push(b);
+            pos += len;
+        }
+        ReplayLog { blocks, valid_bytes: pos }
+    }
+}
+
+/// The column slices of one block.
+pub struct Block<'a> {
+    n_runs: usize,
+    total_time: &'a [u8],
+    total_delta: &'a [u8],
+    fastest: &'a [u8],
+    avg: &'a [u8],
+    scenario: &'a [u8],
+    lap_end: &'a [u8],
+    text_end: &'a [u8],
+    status: &'a [u8],
+    lap_time: &'a [u8],
+    lap_delta: &'a [u8],
+    fuel: &'a [u8],
+    lap_number: &'a [u8],
+    compound: &'a [u8],
+    tyre_life: &'a [u8],
+    text: &'a [u8],
+}
+
+impl<'a> Block<'a> {
+    /// The block at the start of `bytes` and its encoded length, or `None`
+    /// if it is missing, torn or fails its checksum.
+    fn parse(bytes: &'a [u8]) -> Option<(Self, usize)> {
+        let (block, end) = Self::layout(bytes)?;
+        let checksum = u64::from_le_bytes(bytes[24..32].try_into().unwrap());
+        (fnv1a(&bytes[BLOCK_HEADER_BYTES..end]) == checksum).then_some((block, end))
+    }
+
+    /// `parse` without the checksum, for blocks already verified once.
+    fn layout(bytes: &'a [u8]) -> Option<(Self, usize)> {
+        let head = bytes.get(..BLOCK_HEADER_BYTES)?;
+        if &head[..4] != BLOCK_MAGIC {
+            return None;
+        }
+        let u32_at = |o: usize| u32::from_le_bytes(head[o..o + 4].try_into().unwrap()) as usize;
+        let u64_at = |o: usize| u64::from_le_bytes(head[o..o + 8].try_into().unwrap());
+        let (n_runs, n_laps) = (u32_at(4), u32_at(8));
+        let payload_bytes = usize::try_from(u64_at(16)).ok()?;
+        let end = BLOCK_HEADER_BYTES.checked_add(payload_bytes)?;
+        let payload = bytes.get(BLOCK_HEADER_BYTES..end)?;
+
+        let mut rest = payload;
+        let mut take = |n: usize, width: usize| -> Option<&'a [u8]> {
+            let len = n.checked_mul(width)?;
+            let col = rest.get(..len)?;
+            rest = rest.get(len.next_multiple_of(8).min(rest.len())..)?;
+            Some(col)
+        };
+        let mut block = Block {
+            n_runs,
+            total_time: take(n_runs, 8)?,
+            total_delta: take(n_runs, 8)?,
+            fastest: take(n_runs, 4)?,
+            avg: take(n_runs, 4)?,
+            scenario: take(n_runs, 4)?,
+            lap_end: take(n_runs, 4)?,
+            text_end: take(n_runs, 4)?,
+            status: take(n_runs, 1)?,
+            lap_time: take(n_laps, 4)?,
+            lap_delta: take(n_laps, 4)?,
+            fuel: take(n_laps, 4)?,
+            lap_number: take(n_laps, 2)?,
+            compound: take(n_laps, 1)?,
+            tyre_life: take(n_laps, 1)?,
+            text: &[],
+        };
+        // Offsets must be monotone and in range for `run` to slice safely
+        let text_len = if n_runs == 0 { 0 } else { u32_le(block.text_end, n_runs - 1) as usize };
+        block.text = take(text_len, 1)?;
+        let monotone = |col: &[u8], max: usize| {
+            (0..n_runs).try_fold(0u32, |prev, i| Some(u32_le(col, i)).filter(|&v| v >= prev)).is_some_and(|last| last as usize <= max)
+        };
+        if !monotone(block.lap_end, n_laps) || !monotone(block.text_end, text_len) {
+            return None;
+        }
+        Some((block, end))
+    }
+
+    pub fn run(&self, i: usize) -> RunView {
+        let (lap_start, lap_end) = Self::span(self.lap_end, i);
+        let (text_start, text_end) = Self::span(self.text_end, i);
+        RunView {
+            scenario_index: u32_le(self.scenario, i),
+            status: if self.status[i] == RunStatus::Ok as u8 { RunStatus::Ok } else { RunStatus::Failed },
+            total_time_s: f64_le(self.total_time, i),
+            total_delta_s: f64_le(self.total_delta, i),
+            fastest_lap_s: f32_le(self.fastest, i),
+            avg_lap_s: f32_le(self.avg, i),
+            lap_count: (lap_end - lap_start) as u32,
+            text: String::from_utf8_lossy(&self.text[text_start..text_end]).into_owned(),
+        }
+    }
+
+    pub fn laps(&self, i: usize) -> Vec<LoggedLap> {
+        let (start, end) = Self::span(self.lap_end, i);
+        (start..end)
+            .map(|j| LoggedLap {
+                lap_number: u16::from_le_bytes(self.lap_number[j * 2..j * 2 + 2].try_into().unwrap()),
+                lap_time_s: f32_le(self.lap_time, j),
+                delta_to_baseline_s: f32_le(self.lap_delta, j),
+                fuel_remaining_kg: f32_le(self.fuel, j),
+                compound: Compound::from_code(self.compound[j]),
+                tyre_life: self.tyre_life[j],
+            })
+            .collect()
+    }
+
+    /// Run `i`'s `[start, end)` range from an exclusive-end offset column.
+    fn span(ends: &[u8], i: usize) -> (usize, usize) {
+        let start = if i == 0 { 0 } else { u32_le(ends, i - 1) as usize };
+        (start, u32_le(ends, i) as usize)
+    }
+}
+
+fn u32_le(col: &[u8], i: usize) -> u32 {
+    u32::from_le_bytes(col[i * 4..i * 4 + 4].try_into().unwrap())
+}
+
+fn f32_le(col: &[u8], i: usize) -> f32 {
+    f32::from_le_bytes(col[i * 4..i * 4 + 4].try_into().unwrap())
+}
+
+fn f64_le(col: &[u8], i: usize) -> f64 {
+    f64::from_le_bytes(col[i * 8..i * 8 + 8].try_into().unwrap())
+}
+
+/// One run's row. Totals are NaN for failed runs; `text` is the result's
+/// description or the error.
+#[derive(Debug, Clone, Serialize)]
+pub struct RunView {
+    pub scenario_index: u32,
+    pub status: RunStatus,
+    pub total_time_s: f64,
+    pub total_delta_s: f64,
+    pub fastest_lap_s: f32,
+    pub avg_lap_s: f32,
+    pub lap_count: u32,
+    pub text: String,
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Serialize)]
+pub struct LoggedLap {
+    pub lap_number: u16,
+    pub lap_time_s: f32,
+    pub delta_to_baseline_s: f32,
+    pub fuel_remaining_kg: f32,
+    pub compound: Compound,
+    pub tyre_life: u8,
+}
+
+/// What the viewer lists when it opens a log.
+#[derive(Debug, Clone, Serialize)]
+pub struct ReplayLogSummary {
+    pub blocks: usize,
+    /// Bytes past the last well-formed block (a torn write)
+    pub trailing_bytes: usize,
+    /// In file order; a re-run scenario appears once per run
+    pub runs: Vec<RunView>,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct LoggedRun {
+    pub run: RunView,
+    pub laps: Vec<LoggedLap>,
+}
+
+impl ReplayLog<'_> {
+    pub fn summary(&self, file_len: usize) -> ReplayLogSummary {
+        ReplayLogSummary {
+            blocks: self.blocks.len(),
+            trailing_bytes: file_len - self.valid_bytes,
+            runs: self.blocks.iter().flat_map(|b| (0..b.n_runs).map(move |i| b.run(i))).collect(),
+        }
+    }
+
+    /// The latest run of `scenario_index`, with its laps.
+    pub fn find(&self, scenario_index: u32) -> Option<LoggedRun> {
+        self.blocks.iter().rev().find_map(|b| {
+            let i = (0..b.n_runs).rev().find(|&i| u32_le(b.scenario, i) == scenario_index)?;
+            Some(LoggedRun { run: b.run(i), laps: b.laps(i) })
+        })
+    }
+}
+
+/// A log mapped and verified once, so a viewer paging through its runs
+/// neither re-reads the file nor re-checks its blocks.
+pub struct OpenReplayLog {
+    path: PathBuf,
+    /// Length and modification time when mapped
+    stamp: (u64, SystemTime),
+    map: Mmap,
+    valid_bytes: usize,
+}
+
+impl OpenReplayLog {
+    pub fn open(path: &Path) -> Result<Self, String> {
+        let file = File::open(path).map_err(|e| format!("Failed to read replay log {}: {e}", path.display()))?;
+        let stamp = stamp(&file).map_err(|e| format!("Failed to read replay log {}: {e}", path.display()))?;
+        // SAFETY: logs are only appended to, and `ReplayLogWriter` replaces
+        // rather than truncates them, so the mapped prefix never changes.
+        // `ReplayLogWriter::open` only cuts a torn tail, which readers skip.
+        let map = unsafe { Mmap::map(&file) }.map_err(|e| format!("Failed to map replay log {}: {e}", path.display()))?;
+        let valid_bytes = ReplayLog::parse(&map)?.valid_bytes;
+        Ok(OpenReplayLog { path: path.to_path_buf(), stamp, map, valid_bytes })
+    }
+
+    /// Whether this is the log at `path` and the file has not changed since.
+    pub fn is_current(&self, path: &Path) -> bool {
+        self.path == path && File::open(path).and_then(|f| stamp(&f)).is_ok_and(|s| s == self.stamp)
+    }
+
+    pub fn log(&self) -> ReplayLog<'_> {
+        ReplayLog::walk(&self.map[..self.valid_bytes], Block::layout)
+    }
+
+    /// Every run in the log, without laps.
+    pub fn summary(&self) -> ReplayLogSummary {
+        self.log().summary(self.map.len())
+    }
+
+    /// The latest run of `scenario_index`.
+    pub fn run(&self, scenario_index: u32) -> Result<LoggedRun, String> {
+        self.log()
+            .find(scenario_index)
+            .ok_or_else(|| format!("Scenario {scenario_index} is not in {}", self.path.display()))
+    }
+}
+
+fn stamp(file: &File) -> std::io::Result<(u64, SystemTime)> {
+    let meta = file.metadata()?;
+    Ok((meta.len(), meta.modified()?))
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::simulation::{CarParams, DeltaSummary, EnvironmentParams, SimulationScenario};
+
+    fn result(laps: u32, description: &str) -> SimulationResult {
+        let laps: Vec<SimulatedLap> = (1..=laps)
+            .map(|n| SimulatedLap {
+                lap_number: n,
+                lap_time_s: 90.0 + n as f64 * 0.1,
+                sector1_s: 30.0,
+                sector2_s: 30.0,
+                sector3_s: 30.0,
+                max_speed_kmh: 320.0,
+                avg_speed_kmh: 210.0,
+                tyre_life: n,
+                compound: if n < 3 { Compound::Soft } else { Compound::Hard },
+                fuel_remaining_kg: 100.0 - n as f64,
+                delta_to_baseline_s: -0.25,
+            })
+            .collect();
+        SimulationResult {
+            scenario: SimulationScenario {
+                event_name: "Test GP".to_string(),
+                session: "R".to_string(),
+                base_driver: "1".to_string(),
+                swap_car_with: None,
+                swap_driver_inputs_with: None,
+                car_params: CarParams::default(),
+                env_params: EnvironmentParams::default(),
+                num_laps: None,
+            },
+            total_time_s: laps.iter().map(|l| l.lap_time_s).sum(),
+            fastest_lap_s: laps.first().map_or(0.0, |l| l.lap_time_s),
+            avg_lap_time_s: 90.5,
+            delta_summary: DeltaSummary {
+                total_time_delta_s: -0.25 * laps.len() as f64,
+                avg_lap_delta_s: -0.25,
+                straight_speed_delta_kmh: 2.0,
+                corner_speed_delta_kmh: 0.0,
+                description: description.to_string(),
+            },
+            laps,
+        }
+    }
+
+    #[test]
+    fn test_round_trip_and_append() {
+        let path = std::env::temp_dir().join(format!("f1-replay-log-test-{}.f1rlog", std::process::id()));
+        let _ = std::fs::remove_file(&path);
+        let (a, b) = (result(4, "faster on straights"), result(2, "ü"));
+
+        let mut w = ReplayLogWriter::open(&path).unwrap();
+        w.append(&[
+            RunRecord { scenario_index: 0, outcome: Ok(&a) },
+            RunRecord { scenario_index: 1, outcome: Err("Driver 99 not found") },
+        ])
+        .unwrap();
+        drop(w);
+        // Reopening appends after the existing blocks
+        ReplayLogWriter::open(&path).unwrap().append(&[RunRecord { scenario_index: 2, outcome: Ok(&b) }]).unwrap();
+
+        let summary = OpenReplayLog::open(&path).unwrap().summary();
+        assert_eq!((summary.blocks, summary.trailing_bytes), (2, 0));
+        let runs: Vec<(u32, RunStatus, u32, &str)> =
+            summary.runs.iter().map(|r| (r.scenario_index, r.status, r.lap_count, r.text.as_str())).collect();
+        assert_eq!(
+            runs,
+            [(0, RunStatus::Ok, 4, "faster on straights"), (1, RunStatus::Failed, 0, "Driver 99 not found"), (2, RunStatus::Ok, 2, "ü")]
+        );
+        assert!(summary.runs[1].total_time_s.is_nan());
+        assert!((summary.runs[0].total_time_s - a.total_time_s).abs() < 1e-9);
+
+        let log = OpenReplayLog::open(&path).unwrap();
+        assert!(log.is_current(&path));
+        let run = log.run(0).unwrap();
+        let laps: Vec<(u16, Compound, u8)> = run.laps.iter().map(|l| (l.lap_number, l.compound, l.tyre_life)).collect();
+        assert_eq!(laps, [(1, Compound::Soft, 1), (2, Compound::Soft, 2), (3, Compound::Hard, 3), (4, Compound::Hard, 4)]);
+        assert_eq!(run.laps[3].lap_time_s, 90.4f32);
+        assert!(log.run(7).is_err());
+
+        // Creating replaces the old log instead of appending to it
+        ReplayLogWriter::create(&path).unwrap().append(&[RunRecord { scenario_index: 9, outcome: Ok(&b) }]).unwrap();
+        let summary = OpenReplayLog::open(&path).unwrap().summary();
+        let ids: Vec<u32> = summary.runs.iter().map(|r| r.scenario_index).collect();
+        assert_eq!((summary.blocks, ids), (1, vec![9]));
+        // The earlier mapping still sees the log it opened
+        assert!(!log.is_current(&path));
+        assert_eq!(log.run(0).unwrap().laps.len(), 4);
+        let _ = std::fs::remove_file(&path);
+    }
+
+    #[test]
+    fn test_torn_block_is_skipped_and_truncated() {
+        let path = std::env::temp_dir().join(format!("f1-replay-log-torn-{}.f1rlog", std::process::id()));
+        let _ = std::fs::remove_file(&path);
+        let a = result(3, "x");
+        ReplayLogWriter::open(&path).unwrap().append(&[RunRecord { scenario_index: 5, outcome: Ok(&a) }]).unwrap();
+        let good_len = std::fs::metadata(&path).unwrap().len() as usize;
+
+        // Simulate a writer killed halfway through its second block
+        let torn = encode_block(&[RunRecord { scenario_index: 6, outcome: Ok(&a) }]);
+        let mut bytes = std::fs::read(&path).unwrap();
+        bytes.extend_from_slice(&torn[..torn.len() / 2]);
+        std::fs::write(&path, &bytes).unwrap();
+
+        let summary = OpenReplayLog::open(&path).unwrap().summary();
+        assert_eq!((summary.runs.len(), summary.trailing_bytes), (1, bytes.len() - good_len));
+
+        ReplayLogWriter::open(&path).unwrap().append(&[RunRecord { scenario_index: 6, outcome: Ok(&a) }]).unwrap();
+        let summary = OpenReplayLog::open(&path).unwrap().summary();
+        let ids: Vec<u32> = summary.runs.iter().map(|r| r.scenario_index).collect();
+        assert_eq!((ids, summary.trailing_bytes), (vec![5, 6], 0));
+        let _ = std::fs::remove_file(&path);
+    }
+}
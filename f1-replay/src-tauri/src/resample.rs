@@ -0,0 +1,109 @@
+//! Batch resampling kernels over sorted series.
+//!
+//! Resampling several channels onto the same target axis repeats the same
+//! search for every channel. `LinearPlan` does the search once, as a single
+//! forward merge over the sorted source and target axes, and leaves each
+//! channel a branch-free gather-and-lerp loop. `AsofCursor` is the same
+//! forward walk for sample-and-hold lookups.
+
+/// Precomputed bracketing segment and fraction for each target point of a
+/// linear resample from sorted `xs`.
+#[derive(Debug, Clone)]
+pub struct LinearPlan {
+    lo: Vec<u32>,
+    frac: Vec<f32>,
+}
+
+impl LinearPlan {
+    /// Plan a resample of series sampled at non-decreasing `xs` (at least two
+    /// points) onto non-decreasing `targets`. Targets outside `xs` clamp to
+    /// the end values; where `xs` repeats, the later sample wins.
+    pub fn new(xs: &[f32], targets: impl IntoIterator<Item = f32>) -> Self {
+        assert!(xs.len() >= 2, "resampling needs at least two source points");
+        let targets = targets.into_iter();
+        let mut lo = Vec::with_capacity(targets.size_hint().0);
+        let mut frac = Vec::with_capacity(targets.size_hint().0);
+
+        let last_seg = xs.len() - 2;
+        let mut j = 0usize;
+        for t in targets {
+            while j < last_seg && xs[j + 1] <= t {
+                j += 1;
+            }
+            let (x0, x1) = (xs[j], xs[j + 1]);
+            let f = if (x1 - x0).abs() < 1e-6 { 0.0 } else { (t - x0) / (x1 - x0) };
+            lo.push(j as u32);
+            frac.push(f.clamp(0.0, 1.0));
+        }
+        LinearPlan { lo, frac }
+    }
+
+    /// Linearly interpolate `ys` (aligned with the planned `xs`).
+    pub fn lerp(&self, ys: &[f32]) -> Vec<f32> {
+        self.lo
+            .iter()
+            .zip(&self.frac)
+            .map(|(&i, &f)| {
+                let (y0, y1) = (ys[i as usize], ys[i as usize + 1]);
+                y0 + (y1 - y0) * f
+            })
+            .collect()
+    }
+
+    /// Nearest-neighbour resample for discrete channels.
+    pub fn nearest<T: Copy>(&self, ys: &[T]) -> Vec<T> {
+        self.lo
+            .iter()
+            .zip(&self.frac)
+            .map(|(&i, &f)| ys[i as usize + (f >= 0.5) as usize])
+            .collect()
+    }
+}
+
+/// Forward-only ASOF lookup into sorted knots for non-decreasing queries.
+/// Each query costs amortised O(1) instead of a binary search.
+#[derive(Debug, Clone, Copy, Default)]
+pub struct AsofCursor {
+    /// Number of knots at or before the last query.
+    passed: usize,
+}
+
+impl AsofCursor {
+    /// Index of the last knot `<= q`, or 0 when `q` precedes every knot;
+    /// the same as `partition_point(|k| k <= q).saturating_sub(1)`.
+    pub fn seek(&mut self, knots: &[f64], q: f64) -> usize {
+        while self.passed < knots.len() && knots[self.passed] <= q {
+            self.passed += 1;
+        }
+        self.passed.saturating_sub(1)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_linear_plan_matches_pointwise_lerp() {
+        let xs = [0.0_f32, 10.0, 10.0, 25.0, 40.0];
+        let ys = [0.0_f32, 100.0, 150.0, 300.0, 0.0];
+        let plan = LinearPlan::new(&xs, (0..6).map(|k| k as f32 * 10.0));
+        let out = plan.lerp(&ys);
+        // At the repeated x = 10 the later sample wins; past the end clamps
+        let expected = [0.0, 150.0, 250.0, 200.0, 0.0, 0.0];
+        for (o, e) in out.iter().zip(expected) {
+            assert!((o - e).abs() < 1e-3, "{out:?}");
+        }
+        assert_eq!(plan.nearest(&[1u8, 2, 3, 4, 5]), vec![1, 3, 4, 4, 5, 5]);
+    }
+
+    #[test]
+    fn test_asof_cursor_matches_partition_point() {
+        let knots = [1.0, 2.0, 2.0, 5.0, 9.0];
+        let mut cursor = AsofCursor::default();
+        for q in [0.0, 0.5, 1.0, 1.5, 2.0, 4.9, 5.0, 8.0, 9.0, 100.0] {
+            let expected = knots.partition_point(|&k| k <= q).saturating_sub(1);
+            assert_eq!(cursor.seek(&knots, q), expected, "q = {q}");
+        }
+    }
+}
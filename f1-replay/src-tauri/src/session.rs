@@ -1,12 +1,32 @@
-use crate::heatmap;
-use crate::interpolate::Spline;
+use crate::frame_cache::{FrameCache, FRAME_CACHE_HZ};
+use crate::heatmap::{self, HeatBins};
+use crate::session_cache::{SessionCache, SessionKey, SESSION_CACHE_BUDGET_BYTES};
+use crate::snapshot::{self, SessionSnapshot};
+use crate::interpolate::{Spline, SplineCursor};
+use crate::lap_index::{self, LapIndex, TrackIndex};
+use crate::lake::TelemetrySource;
+use crate::live::LiveSession;
+use crate::replay_log::OpenReplayLog;
+use crate::resample::AsofCursor;
+use crate::simulation::LapCalibration;
+use crate::telemetry_analysis::FastestLap;
+use crate::telemetry_lod::TelemetryLod;
 use crate::types::*;
+use duckdb::arrow::array::{Array, Float64Array, Int32Array, StringArray};
+use duckdb::arrow::record_batch::RecordBatch;
 use duckdb::Connection;
 use rayon::prelude::*;
+use parking_lot::{Condvar, Mutex, MutexGuard, RwLock, RwLockReadGuard, RwLockWriteGuard};
 use std::collections::HashMap;
+use std::path::Path;
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use std::sync::{Arc, OnceLock};
 
 // ── Raw data structures loaded from DuckDB ──────────────────────────────────
 
+/// One telemetry row, for building `SampleColumns` a sample at a time in
+/// test fixtures. Loading appends whole Arrow column slices instead.
+#[cfg(test)]
 pub struct RawSample {
     pub session_time: f64,
     pub x: f32,
@@ -15,14 +35,79 @@ pub struct RawSample {
     pub gear: u8,
     pub throttle: f32,
     pub brake: f32,
-    pub drs: i64,
+    pub drs: u8,
+}
+
+/// Columnar (struct-of-arrays) telemetry for one driver, sorted by session time.
+/// Every column has the same length; index `i` across columns is one sample.
+#[derive(Debug, Clone, Default)]
+pub struct SampleColumns {
+    pub times: Vec<f64>,
+    pub xs: Vec<f32>,
+    pub ys: Vec<f32>,
+    pub speeds: Vec<f32>,
+    pub throttles: Vec<f32>,
+    pub brakes: Vec<f32>,
+    pub gears: Vec<u8>,
+    pub drs: Vec<u8>,
+}
+
+impl SampleColumns {
+    #[cfg(test)]
+    pub fn push(&mut self, s: RawSample) {
+        self.times.push(s.session_time);
+        self.xs.push(s.x);
+        self.ys.push(s.y);
+        self.speeds.push(s.speed);
+        self.throttles.push(s.throttle);
+        self.brakes.push(s.brake);
+        self.gears.push(s.gear);
+        self.drs.push(s.drs);
+    }
+
+    pub fn len(&self) -> usize {
+        self.times.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.times.is_empty()
+    }
+
+    /// Index range of samples with `t_start <= time <= t_end`.
+    pub fn range_inclusive(&self, t_start: f64, t_end: f64) -> std::ops::Range<usize> {
+        let lo = self.times.partition_point(|&t| t < t_start);
+        let hi = self.times.partition_point(|&t| t <= t_end).max(lo);
+        lo..hi
+    }
+
+    /// Index range of samples with `t_start <= time < t_end`.
+    pub fn range(&self, t_start: f64, t_end: f64) -> std::ops::Range<usize> {
+        let lo = self.times.partition_point(|&t| t < t_start);
+        let hi = self.times.partition_point(|&t| t < t_end).max(lo);
+        lo..hi
+    }
+
+    pub fn heap_bytes(&self) -> usize {
+        // f64 time, five f32 channels, two u8 channels per sample
+        self.len() * (8 + 5 * 4 + 2)
+    }
+
+    /// Index of the last sample at or before `time_s` (the first sample if
+    /// `time_s` precedes the data).
+    pub fn asof_index(&self, time_s: f64) -> Option<usize> {
+        if self.times.is_empty() {
+            return None;
+        }
+        let idx = self.times.partition_point(|&t| t <= time_s);
+        Some(idx.saturating_sub(1))
+    }
 }
 
 pub struct LapRecord {
     pub lap_number: u32,
     pub lap_start_time_s: f64,
     pub position: u8,
-    pub compound: String,
+    pub compound: Compound,
     pub tyre_life: u8,
 }
 
@@ -32,8 +117,19 @@ pub struct DriverData {
     pub team: String,
     pub spline_x: Spline,
     pub spline_y: Spline,
-    pub samples: Vec<RawSample>,
+    pub samples: SampleColumns,
+    /// Downsampling pyramid over `samples` for chart windows.
+    pub lod: TelemetryLod,
     pub laps: Vec<LapRecord>,
+    /// Last spline segment used by uncached playback; a hint shared by
+    /// `spline_x` and `spline_y`, which are built on the same knots.
+    pub playback_segment: AtomicUsize,
+    /// Memoised on first comparison; see `telemetry_analysis::fastest_lap`.
+    pub fastest_lap: OnceLock<Option<FastestLap>>,
+    /// Built at load; see `lap_index::lap_index`.
+    pub lap_index: OnceLock<LapIndex>,
+    /// Memoised on first simulation; see `simulation::LapCalibration`.
+    pub lap_calibration: OnceLock<LapCalibration>,
 }
 
 pub struct SessionData {
@@ -43,223 +139,358 @@ pub struct SessionData {
     pub drivers: Vec<DriverData>,
     pub heatmap: Vec<HeatCell>,
     pub track_layout: TrackLayout,
+    /// Uniform-grid playback cache; `None` when disabled in `LoadOptions`.
+    pub frame_cache: Option<FrameCache>,
+    /// Filled on first request; see `race_analysis::cached_analysis`.
+    pub race_analysis: OnceLock<RaceAnalysis>,
+    /// Built at load; see `lap_index::track_index`.
+    pub track_index: OnceLock<TrackIndex>,
+}
+
+impl SessionData {
+    /// Rough heap footprint, used to budget the session cache. Includes the
+    /// lazily built caches filled so far, so it grows as the session is used.
+    pub fn heap_bytes(&self) -> usize {
+        let drivers: usize = self
+            .drivers
+            .iter()
+            .map(|d| {
+                d.samples.heap_bytes()
+                    + d.lod.heap_bytes()
+                    + d.spline_x.heap_bytes()
+                    + d.spline_y.heap_bytes()
+                    + d.laps.len() * std::mem::size_of::<LapRecord>()
+                    + d.lap_index.get().map_or(0, LapIndex::heap_bytes)
+                    + d.fastest_lap.get().and_then(Option::as_ref).map_or(0, FastestLap::heap_bytes)
+            })
+            .sum();
+        drivers
+            + self.heatmap.len() * std::mem::size_of::<HeatCell>()
+            + self.track_layout.center_line.len() * std::mem::size_of::<[f32; 2]>()
+            + self.frame_cache.as_ref().map_or(0, FrameCache::heap_bytes)
+            + self.track_index.get().map_or(0, TrackIndex::heap_bytes)
+            + self.race_analysis.get().map_or(0, RaceAnalysis::heap_bytes)
+    }
+
+    /// Driver identities in `DriverId` order.
+    pub fn driver_meta(&self) -> Vec<DriverMeta> {
+        self.drivers
+            .iter()
+            .enumerate()
+            .map(|(i, d)| DriverMeta {
+                driver_id: i as DriverId,
+                driver_number: d.driver_number.clone(),
+                abbreviation: d.abbreviation.clone(),
+                team: d.team.clone(),
+            })
+            .collect()
+    }
+
+    pub fn driver(&self, driver_number: &str) -> Result<&DriverData, String> {
+        self.drivers
+            .iter()
+            .find(|d| d.driver_number == driver_number)
+            .ok_or_else(|| format!("Driver {driver_number} not found"))
+    }
+}
+
+/// Upper bound on the default `LoadOptions::query_workers`; beyond this DuckDB
+/// is scan-bound and extra connections only add memory.
+const MAX_QUERY_WORKERS: usize = 8;
+
+/// Knobs for `load_session`.
+#[derive(Debug, Clone)]
+pub struct LoadOptions {
+    /// Grid rate of the precomputed playback cache; `None` disables it and
+    /// `get_frame_into` evaluates splines directly.
+    pub frame_cache_hz: Option<f64>,
+    /// Read and write the on-disk session snapshot next to the database.
+    pub snapshots: bool,
+    /// DuckDB connections used to fetch drivers concurrently; 1 issues a
+    /// single ordered query for the whole session.
+    pub query_workers: usize,
+}
+
+impl Default for LoadOptions {
+    fn default() -> Self {
+        LoadOptions {
+            frame_cache_hz: Some(FRAME_CACHE_HZ),
+            snapshots: true,
+            query_workers: std::thread::available_parallelism()
+                .map_or(1, |n| n.get())
+                .min(MAX_QUERY_WORKERS),
+        }
+    }
 }
 
 // ── App state ────────────────────────────────────────────────────────────────
 
+/// Shared application state. Loaded sessions are published as immutable
+/// `Arc` snapshots: readers clone the `Arc` under a momentary read lock and
+/// then work lock-free, so long analyses never stall playback and loading a
+/// new session never blocks readers of the old one.
 pub struct AppState {
     pub db_path: String,
-    pub session: Option<SessionData>,
+    pub load_options: LoadOptions,
+    session: RwLock<Option<Arc<SessionData>>>,
+    /// Recently loaded and prefetched sessions, including the current one.
+    pub cache: Mutex<SessionCache>,
+    /// Signalled whenever a cache load claim (`SessionCache::begin_load`) ends.
+    cache_loaded: Condvar,
+    /// Bumped to cancel the running `stream_frames` task, if any.
+    frame_stream_id: AtomicU64,
+    /// A session being streamed in, if any. Unlike loaded sessions it grows
+    /// in place: ingest holds the write lock only to append one chunk, and
+    /// frame reads hold the read lock for one frame.
+    live: RwLock<Option<LiveSession>>,
+    /// The replay log the viewer has open, if any.
+    replay_log: Mutex<Option<Arc<OpenReplayLog>>>,
 }
 
 impl AppState {
     pub fn new(db_path: String) -> Self {
-        AppState { db_path, session: None }
+        AppState {
+            db_path,
+            load_options: LoadOptions::default(),
+            session: RwLock::new(None),
+            cache: Mutex::new(SessionCache::new(SESSION_CACHE_BUDGET_BYTES)),
+            cache_loaded: Condvar::new(),
+            frame_stream_id: AtomicU64::new(0),
+            live: RwLock::new(None),
+            replay_log: Mutex::new(None),
+        }
+    }
+
+    pub fn live(&self) -> RwLockReadGuard<'_, Option<LiveSession>> {
+        tracing::info_span!("lock_wait.live").in_scope(|| self.live.read())
+    }
+
+    pub fn live_mut(&self) -> RwLockWriteGuard<'_, Option<LiveSession>> {
+        tracing::info_span!("lock_wait.live").in_scope(|| self.live.write())
+    }
+
+    /// The log at `path`, mapped on first use and whenever the file changes.
+    pub fn replay_log(&self, path: &Path) -> Result<Arc<OpenReplayLog>, String> {
+        if let Some(log) = self.replay_log.lock().as_ref().filter(|log| log.is_current(path)) {
+            return Ok(log.clone());
+        }
+        let log = Arc::new(OpenReplayLog::open(path)?);
+        *self.replay_log.lock() = Some(log.clone());
+        Ok(log)
+    }
+
+    /// Snapshot of the current session.
+    pub fn session(&self) -> Result<Arc<SessionData>, String> {
+        let guard = tracing::info_span!("lock_wait.session").in_scope(|| self.session.read());
+        guard.clone().ok_or_else(|| "No session loaded".to_string())
+    }
+
+    /// Lock the session cache, timing the wait as `lock_wait.cache`.
+    pub fn lock_cache(&self) -> MutexGuard<'_, SessionCache> {
+        tracing::info_span!("lock_wait.cache").in_scope(|| self.cache.lock())
+    }
+
+    /// Release a `begin_load` claim on `key` and wake anyone waiting for it.
+    pub fn end_cache_load(&self, cache: &mut SessionCache, key: &SessionKey) {
+        cache.end_load(key);
+        self.cache_loaded.notify_all();
+    }
+
+    /// The cached session for `key`, loading it on a miss. If a prefetch (or
+    /// another command) is already loading `key`, waits for that load instead
+    /// of building the session a second time. Blocks; call off the async runtime.
+    pub fn load_cached(&self, key: &SessionKey) -> Result<Arc<SessionData>, String> {
+        let mut cache = self.lock_cache();
+        loop {
+            if let Some(data) = cache.get(key) {
+                return Ok(data);
+            }
+            if cache.begin_load(key) {
+                break;
+            }
+            tracing::info_span!("lock_wait.cache_load").in_scope(|| self.cache_loaded.wait(&mut cache));
+        }
+        drop(cache);
+
+        let loaded = load_session(&self.db_path, &key.0, &key.1, &self.load_options).map(Arc::new);
+        let mut cache = self.lock_cache();
+        if let Ok(data) = &loaded {
+            cache.insert(key.clone(), data.clone());
+        }
+        self.end_cache_load(&mut cache, key);
+        loaded
+    }
+
+    /// Replace the current session and cancel any stream over the old one.
+    pub fn publish_session(&self, session: Arc<SessionData>) {
+        *tracing::info_span!("lock_wait.session").in_scope(|| self.session.write()) = Some(session);
+        self.next_frame_stream();
+    }
+
+    /// Start a new frame-stream generation, cancelling the previous stream.
+    pub fn next_frame_stream(&self) -> u64 {
+        self.frame_stream_id.fetch_add(1, Ordering::Relaxed) + 1
+    }
+
+    pub fn frame_stream_is_current(&self, stream_id: u64) -> bool {
+        self.frame_stream_id.load(Ordering::Relaxed) == stream_id
     }
 }
 
 // ── Intermediate struct for parallel spline building ─────────────────────────
 
-struct DriverRaw {
+/// One driver's telemetry with splines and the chart pyramid built, before laps
+/// are attached.
+struct FetchedDriver {
     driver_number: String,
-    abbreviation: String,
-    team: String,
-    samples: Vec<RawSample>,
-    laps: Vec<LapRecord>,
+    samples: SampleColumns,
+    spline_x: Spline,
+    spline_y: Spline,
+    lod: TelemetryLod,
+    heat: HeatBins,
+}
+
+fn fetch_driver(driver_number: String, samples: SampleColumns) -> FetchedDriver {
+    let (spline_x, spline_y) = tracing::info_span!("load_session.splines").in_scope(|| {
+        let ts = &samples.times;
+        let xs: Vec<f64> = samples.xs.iter().map(|&x| x as f64).collect();
+        let ys: Vec<f64> = samples.ys.iter().map(|&y| y as f64).collect();
+        (Spline::new(ts, &xs), Spline::new(ts, &ys))
+    });
+
+    let lod = tracing::info_span!("load_session.lod").in_scope(|| TelemetryLod::build(&samples));
+    let heat = heatmap::driver_partial(&samples);
+
+    FetchedDriver { driver_number, samples, spline_x, spline_y, lod, heat }
 }
 
 // ── Session loading ──────────────────────────────────────────────────────────
 
+#[tracing::instrument(skip_all)]
 pub fn load_session(
     db_path: &str,
     event_name: &str,
     session: &str,
+    options: &LoadOptions,
 ) -> Result<SessionData, String> {
     let conn = Connection::open(db_path)
         .map_err(|e| format!("Failed to open DuckDB: {e}"))?;
 
-    // ── 1. Query combined position + car telemetry via ASOF JOIN ─────────────
-    let pos_query = "
-        SELECT p.DriverNumber, p.SessionTime, p.X, p.Y,
-               c.Speed, c.nGear, c.Throttle, c.Brake, c.DRS
-        FROM position_telemetry p
-        ASOF JOIN car_telemetry c
-            ON p.DriverNumber = c.DriverNumber
-            AND p.EventName = c.EventName
-            AND p.Session = c.Session
-            AND p.SessionTime >= c.SessionTime
-        WHERE p.EventName = ? AND p.Session = ?
-        AND p.X != 0 AND p.Y != 0
-        ORDER BY p.DriverNumber, p.SessionTime
-    ";
-
-    let mut stmt = conn
-        .prepare(pos_query)
-        .map_err(|e| format!("Failed to prepare position query: {e}"))?;
-
-    let mut driver_samples: HashMap<String, Vec<RawSample>> = HashMap::new();
-
-    let mut rows = stmt
-        .query([event_name, session])
-        .map_err(|e| format!("Failed to query positions: {e}"))?;
-
-    while let Some(row) = rows.next().map_err(|e| format!("Row error: {e}"))? {
-        let driver_number: String = row.get(0).map_err(|e| format!("Col 0: {e}"))?;
-        let session_time: f64 = row.get(1).map_err(|e| format!("Col 1: {e}"))?;
-        let x: f64 = row.get(2).map_err(|e| format!("Col 2: {e}"))?;
-        let y: f64 = row.get(3).map_err(|e| format!("Col 3: {e}"))?;
-        let speed: f64 = row.get(4).unwrap_or(0.0);
-        let gear: i32 = row.get(5).unwrap_or(0);
-        let throttle: f64 = row.get(6).unwrap_or(0.0);
-        let brake: f64 = row.get(7).unwrap_or(0.0);
-        let drs: i64 = row.get(8).unwrap_or(0);
-
-        let sample = RawSample {
-            session_time,
-            x: x as f32,
-            y: y as f32,
-            speed: speed as f32,
-            gear: gear.clamp(0, 8) as u8,
-            throttle: (throttle as f32).clamp(0.0, 1.0),
-            brake: (brake as f32).clamp(0.0, 1.0),
-            drs,
-        };
-
-        driver_samples.entry(driver_number).or_default().push(sample);
-    }
-
-    if driver_samples.is_empty() {
-        return Err("No position data found for this session".to_string());
-    }
-
-    // ── 2. Query laps ─────────────────────────────────────────────────────────
-    let laps_query = "
-        SELECT DriverNumber, Driver, Team, LapNumber,
-               COALESCE(LapStartTime, 0.0) as LapStartTime,
-               COALESCE(CAST(Position AS INTEGER), 20) as Position,
-               COALESCE(Compound, 'HARD') as Compound,
-               COALESCE(CAST(TyreLife AS INTEGER), 0) as TyreLife
-        FROM laps
-        WHERE EventName = ? AND Session = ?
-        ORDER BY DriverNumber, LapNumber
-    ";
-
-    let mut lap_stmt = conn
-        .prepare(laps_query)
-        .map_err(|e| format!("Failed to prepare laps query: {e}"))?;
-
-    let mut driver_laps: HashMap<String, Vec<LapRecord>> = HashMap::new();
-    let mut driver_abbr: HashMap<String, String> = HashMap::new();
-    let mut driver_team: HashMap<String, String> = HashMap::new();
-
-    let mut lap_rows = lap_stmt
-        .query([event_name, session])
-        .map_err(|e| format!("Failed to query laps: {e}"))?;
-
-    while let Some(row) = lap_rows.next().map_err(|e| format!("Lap row error: {e}"))? {
-        let driver_number: String = row.get(0).map_err(|e| format!("Lap col 0: {e}"))?;
-        let driver_name: String = row.get(1).unwrap_or_default();
-        let team: String = row.get(2).unwrap_or_default();
-        let lap_number: i32 = row.get(3).unwrap_or(0);
-        let lap_start_time: f64 = row.get(4).unwrap_or(0.0);
-        let position: i32 = row.get(5).unwrap_or(20);
-        let compound: String = row.get(6).unwrap_or_else(|_| "HARD".to_string());
-        let tyre_life: i32 = row.get(7).unwrap_or(0);
-
-        let abbr = abbreviate_driver_name(&driver_name, &driver_number);
-        driver_abbr.entry(driver_number.clone()).or_insert(abbr);
-        driver_team.entry(driver_number.clone()).or_insert(team);
-
-        driver_laps.entry(driver_number.clone()).or_default().push(LapRecord {
-            lap_number: lap_number as u32,
-            lap_start_time_s: lap_start_time,
-            position: position.clamp(1, 20) as u8,
-            compound,
-            tyre_life: tyre_life.clamp(0, 255) as u8,
-        });
-    }
-
-    // ── 3. Overall session duration ───────────────────────────────────────────
-    let duration_s = driver_samples
-        .values()
-        .flat_map(|s| s.last())
-        .map(|s| s.session_time)
-        .fold(0.0_f64, f64::max);
-
-    // ── 4. Heatmap from all positions ─────────────────────────────────────────
-    let all_positions: Vec<(f32, f32)> = driver_samples
-        .values()
-        .flat_map(|s| s.iter().map(|r| (r.x, r.y)))
-        .collect();
-    let all_speeds: Vec<f32> = driver_samples
-        .values()
-        .flat_map(|s| s.iter().map(|r| r.speed))
-        .collect();
-    let heatmap = heatmap::compute_heatmap(&all_positions, &all_speeds);
-
-    // ── 5. Track layout (use driver "1" or first driver) ─────────────────────
-    let ref_driver = if driver_samples.contains_key("1") {
-        "1".to_string()
+    // Reuse the on-disk snapshot when the session's source rows are unchanged.
+    // Snapshots are best effort: any failure falls back to a full build.
+    let source = TelemetrySource::resolve(db_path, event_name, session).with_merged_table(&conn, event_name, session);
+    let fingerprint = if options.snapshots {
+        snapshot::source_fingerprint(&conn, db_path, &source, event_name, session).ok()
     } else {
-        let mut keys: Vec<&String> = driver_samples.keys().collect();
-        keys.sort();
-        keys.first().copied().cloned().unwrap_or_default()
+        None
     };
+    let snap_path = snapshot::snapshot_path(db_path, event_name, session);
 
-    let track_layout = if let Some(ref_samples) = driver_samples.get(&ref_driver) {
-        build_track_layout(ref_samples, duration_s)
-    } else {
-        TrackLayout {
-            center_line: vec![],
-            x_min: -7734.0,
-            x_max: 3879.0,
-            y_min: -1722.0,
-            y_max: 17775.0,
-            duration_s,
-            lap_distance_m: 6201.0, // Las Vegas GP circuit length
+    let cached = fingerprint.and_then(|fp| {
+        tracing::info_span!("load_session.snapshot_read").in_scope(|| snapshot::read(&snap_path, fp, event_name, session))
+    });
+    let built = match cached {
+        Some(snap) => snap,
+        None => {
+            let snap = build_session(&conn, &source, event_name, session, options)?;
+            if let Some(fp) = fingerprint {
+                let _ = snapshot::write(&snap_path, fp, &snap);
+            }
+            snap
         }
     };
+    let SessionSnapshot { event_name, session, duration_s, drivers, heatmap, track_layout } = built;
 
-    // ── 6. Build DriverRaw vec, then parallel spline construction ─────────────
-    let mut driver_numbers: Vec<String> = driver_samples.keys().cloned().collect();
-    driver_numbers.sort();
+    // Optional playback cache on a uniform time grid, and the distance
+    // indexes (lap indexes first: the track index's reference lap uses one)
+    let (frame_cache, track_index) = rayon::join(
+        || {
+            options
+                .frame_cache_hz
+                .map(|hz| tracing::info_span!("load_session.frame_cache").in_scope(|| FrameCache::build(&drivers, duration_s, hz)))
+        },
+        || {
+            tracing::info_span!("load_session.track_index").in_scope(|| {
+                drivers.par_iter().for_each(|d| {
+                    lap_index::lap_index(d);
+                });
+                TrackIndex::build(&drivers)
+            })
+        },
+    );
 
-    // Consume the HashMap into a vec of DriverRaw for rayon
-    let raw_drivers: Vec<DriverRaw> = driver_numbers
-        .into_iter()
-        .filter_map(|num| {
-            let samples = driver_samples.remove(&num)?;
-            let abbreviation = driver_abbr.get(&num).cloned().unwrap_or_else(|| num.clone());
-            let team = driver_team.get(&num).cloned().unwrap_or_default();
-            let laps = driver_laps.remove(&num).unwrap_or_default();
-            Some(DriverRaw { driver_number: num, abbreviation, team, samples, laps })
-        })
-        .collect();
+    Ok(SessionData {
+        event_name,
+        session,
+        duration_s,
+        drivers,
+        heatmap,
+        track_layout,
+        frame_cache,
+        race_analysis: OnceLock::new(),
+        track_index: OnceLock::from(track_index),
+    })
+}
 
-    // Parallel spline building
-    let drivers: Vec<DriverData> = raw_drivers
-        .into_par_iter()
-        .map(|raw| {
-            let ts: Vec<f64> = raw.samples.iter().map(|s| s.session_time).collect();
-            let xs: Vec<f64> = raw.samples.iter().map(|s| s.x as f64).collect();
-            let ys: Vec<f64> = raw.samples.iter().map(|s| s.y as f64).collect();
+/// Query DuckDB and build everything but the frame cache.
+fn build_session(
+    conn: &Connection,
+    source: &TelemetrySource,
+    event_name: &str,
+    session: &str,
+    options: &LoadOptions,
+) -> Result<SessionSnapshot, String> {
+    // ── 1–2. Telemetry (→ splines) and laps ──────────────────────────────────
+    let (fetched, mut driver_laps) = if options.query_workers > 1 {
+        fetch_fan_out(conn, source, event_name, session, options.query_workers)?
+    } else {
+        let fetched: Vec<FetchedDriver> = read_telemetry(conn, source, event_name, session, None)?
+            .into_par_iter()
+            .map(|(num, samples)| fetch_driver(num, samples))
+            .collect();
+        (fetched, read_laps(conn, event_name, session)?)
+    };
+    if fetched.is_empty() {
+        return Err("No position data found for this session".to_string());
+    }
 
-            let spline_x = Spline::new(&ts, &xs);
-            let spline_y = Spline::new(&ts, &ys);
+    // ── 3. Overall session duration ───────────────────────────────────────────
+    let duration_s = fetched
+        .iter()
+        .flat_map(|d| d.samples.times.last().copied())
+        .fold(0.0_f64, f64::max);
 
+    // ── 4. Attach laps and identity ───────────────────────────────────────────
+    let mut heat_partials = Vec::with_capacity(fetched.len());
+    let drivers: Vec<DriverData> = fetched
+        .into_iter()
+        .map(|d| {
+            heat_partials.push(d.heat);
+            let laps = driver_laps.remove(&d.driver_number).unwrap_or_default();
             DriverData {
-                driver_number: raw.driver_number,
-                abbreviation: raw.abbreviation,
-                team: raw.team,
-                spline_x,
-                spline_y,
-                samples: raw.samples,
-                laps: raw.laps,
+                abbreviation: laps.abbreviation.unwrap_or_else(|| d.driver_number.clone()),
+                team: laps.team,
+                driver_number: d.driver_number,
+                spline_x: d.spline_x,
+                spline_y: d.spline_y,
+                samples: d.samples,
+                lod: d.lod,
+                laps: laps.laps,
+                playback_segment: AtomicUsize::new(0),
+                fastest_lap: OnceLock::new(),
+                lap_index: OnceLock::new(),
+                lap_calibration: OnceLock::new(),
             }
         })
         .collect();
 
-    Ok(SessionData {
+    // ── 5–6. Speed heatmap (binned per driver during the fetch), track layout ─
+    let (heatmap, track_layout) = rayon::join(
+        || tracing::info_span!("load_session.heatmap").in_scope(|| heatmap::merge_partials(heat_partials)),
+        || session_track_layout(&drivers, duration_s),
+    );
+
+    Ok(SessionSnapshot {
         event_name: event_name.to_string(),
         session: session.to_string(),
         duration_s,
@@ -269,54 +500,466 @@ pub fn load_session(
     })
 }
 
-// ── Frame computation ────────────────────────────────────────────────────────
+/// Fetch each driver with its own query on a pool of `workers` connections,
+/// building splines and the chart pyramid as soon as that driver's rows arrive.
+/// Laps load on a separate connection at the same time. DuckDB never has to
+/// produce one globally sorted result, and spline work starts with the first
+/// driver instead of after the last row.
+fn fetch_fan_out(
+    conn: &Connection,
+    source: &TelemetrySource,
+    event_name: &str,
+    session: &str,
+    workers: usize,
+) -> Result<(Vec<FetchedDriver>, HashMap<String, DriverLaps>), String> {
+    let numbers = read_driver_numbers(conn, source, event_name, session)?;
+    let workers = workers.clamp(1, numbers.len().max(1));
 
-pub fn get_frame_at(session: &SessionData, time_s: f64) -> FrameData {
-    let drivers: Vec<DriverFrame> = session
-        .drivers
-        .iter()
-        .map(|d| build_driver_frame(d, time_s))
+    let clone = || conn.try_clone().map_err(|e| format!("Failed to open DuckDB connection: {e}"));
+    let laps_conn = clone()?;
+    let pool: Vec<Connection> = (0..workers).map(|_| clone()).collect::<Result<_, _>>()?;
+
+    let (laps, fetched) = rayon::join(
+        move || read_laps(&laps_conn, event_name, session),
+        || {
+            // Worker w takes drivers w, w + workers, ... on its own connection
+            pool.into_par_iter()
+                .enumerate()
+                .map(|(w, conn)| {
+                    numbers
+                        .iter()
+                        .enumerate()
+                        .skip(w)
+                        .step_by(workers)
+                        .map(|(i, num)| {
+                            let samples = read_telemetry(&conn, source, event_name, session, Some(num))?
+                                .pop()
+                                .map(|(_, s)| s)
+                                .unwrap_or_default();
+                            Ok((i, fetch_driver(num.clone(), samples)))
+                        })
+                        .collect::<Result<Vec<_>, String>>()
+                })
+                .collect::<Result<Vec<_>, String>>()
+        },
+    );
+
+    // Restore driver-number order and drop drivers with no usable positions
+    let mut fetched: Vec<(usize, FetchedDriver)> = fetched?.into_iter().flatten().collect();
+    fetched.sort_by_key(|(i, _)| *i);
+    let fetched = fetched
+        .into_iter()
+        .map(|(_, d)| d)
+        .filter(|d| !d.samples.is_empty())
         .collect();
 
-    FrameData { time_s, drivers }
+    Ok((fetched, laps?))
 }
 
-fn build_driver_frame(driver: &DriverData, time_s: f64) -> DriverFrame {
-    let x = driver.spline_x.eval(time_s) as f32;
-    let y = driver.spline_y.eval(time_s) as f32;
+// ── Arrow readers ────────────────────────────────────────────────────────────
+//
+// Both queries are read as Arrow record batches and decoded a column slice at
+// a time. Results are sorted by DriverNumber, so per-driver partitions are
+// found by run-length over that column instead of hashing every row. Nullable
+// channels are COALESCEd and every column is CAST in SQL so each one has a
+// single Arrow type to downcast to. Telemetry queries are templates over
+// `{position}` and `{car}`, filled in by `TelemetrySource`.
 
-    // Heading: atan2 of the forward direction (0.1s lookahead)
-    let x2 = driver.spline_x.eval(time_s + 0.1) as f32;
-    let y2 = driver.spline_y.eval(time_s + 0.1) as f32;
-    let heading = (y2 - y).atan2(x2 - x);
+/// Combined position + car telemetry via ASOF JOIN.
+const TELEMETRY_QUERY: &str = "
+    SELECT CAST(p.DriverNumber AS VARCHAR),
+           CAST(p.SessionTime AS DOUBLE),
+           CAST(p.X AS DOUBLE),
+           CAST(p.Y AS DOUBLE),
+           CAST(COALESCE(c.Speed, 0) AS DOUBLE),
+           CAST(COALESCE(c.nGear, 0) AS INTEGER),
+           CAST(COALESCE(c.Throttle, 0) AS DOUBLE),
+           CAST(COALESCE(c.Brake, 0) AS DOUBLE),
+           CAST(COALESCE(c.DRS, 0) AS INTEGER)
+    FROM {position} p
+    ASOF JOIN {car} c
+        ON p.DriverNumber = c.DriverNumber
+        AND p.EventName = c.EventName
+        AND p.Session = c.Session
+        AND p.SessionTime >= c.SessionTime
+    WHERE p.EventName = ? AND p.Session = ?
+    AND p.X != 0 AND p.Y != 0
+    ORDER BY p.DriverNumber, p.SessionTime
+";
 
-    // ASOF telemetry lookup
-    let sample = asof_sample(&driver.samples, time_s);
+/// Same as `TELEMETRY_QUERY` for one driver. Both join inputs are filtered
+/// up front so each per-driver query only scans that driver's rows.
+const DRIVER_TELEMETRY_QUERY: &str = "
+    SELECT CAST(p.DriverNumber AS VARCHAR),
+           CAST(p.SessionTime AS DOUBLE),
+           CAST(p.X AS DOUBLE),
+           CAST(p.Y AS DOUBLE),
+           CAST(COALESCE(c.Speed, 0) AS DOUBLE),
+           CAST(COALESCE(c.nGear, 0) AS INTEGER),
+           CAST(COALESCE(c.Throttle, 0) AS DOUBLE),
+           CAST(COALESCE(c.Brake, 0) AS DOUBLE),
+           CAST(COALESCE(c.DRS, 0) AS INTEGER)
+    FROM (
+        SELECT * FROM {position}
+        WHERE EventName = ? AND Session = ? AND CAST(DriverNumber AS VARCHAR) = ?
+          AND X != 0 AND Y != 0
+    ) p
+    ASOF JOIN (
+        SELECT * FROM {car}
+        WHERE EventName = ? AND Session = ? AND CAST(DriverNumber AS VARCHAR) = ?
+    ) c
+        ON p.SessionTime >= c.SessionTime
+    ORDER BY p.SessionTime
+";
 
-    // ASOF lap lookup
-    let lap = asof_lap(&driver.laps, time_s);
+/// Pre-aligned rows from the `merged_telemetry` table written at ingest:
+/// already joined, filtered and clamped exactly like `TELEMETRY_QUERY`
+/// plus the clamps in `read_telemetry`, so this is a plain range scan.
+const MERGED_TELEMETRY_QUERY: &str = "
+    SELECT CAST(DriverNumber AS VARCHAR),
+           CAST(SessionTime AS DOUBLE),
+           CAST(X AS DOUBLE),
+           CAST(Y AS DOUBLE),
+           CAST(Speed AS DOUBLE),
+           CAST(nGear AS INTEGER),
+           CAST(Throttle AS DOUBLE),
+           CAST(Brake AS DOUBLE),
+           CAST(DRS AS INTEGER)
+    FROM {merged}
+    WHERE EventName = ? AND Session = ?
+    ORDER BY DriverNumber, SessionTime
+";
 
-    let (speed, gear, throttle, brake, drs) = sample
-        .map(|s| (s.speed, s.gear, s.throttle, s.brake, s.drs))
-        .unwrap_or((0.0, 1, 0.0, 0.0, 0));
+const DRIVER_MERGED_TELEMETRY_QUERY: &str = "
+    SELECT CAST(DriverNumber AS VARCHAR),
+           CAST(SessionTime AS DOUBLE),
+           CAST(X AS DOUBLE),
+           CAST(Y AS DOUBLE),
+           CAST(Speed AS DOUBLE),
+           CAST(nGear AS INTEGER),
+           CAST(Throttle AS DOUBLE),
+           CAST(Brake AS DOUBLE),
+           CAST(DRS AS INTEGER)
+    FROM {merged}
+    WHERE EventName = ? AND Session = ? AND CAST(DriverNumber AS VARCHAR) = ?
+    ORDER BY SessionTime
+";
 
-    let drs_active = matches!(drs, 10 | 12 | 14);
-    let is_in_pit = speed < 20.0;
+const DRIVER_NUMBERS_QUERY: &str = "
+    SELECT DISTINCT CAST(DriverNumber AS VARCHAR)
+    FROM {position}
+    WHERE EventName = ? AND Session = ?
+    ORDER BY 1
+";
 
-    let (position, compound, tyre_life) = lap
-        .map(|l| (l.position, l.compound.clone(), l.tyre_life))
-        .unwrap_or((20, "HARD".to_string(), 0));
+const LAPS_QUERY: &str = "
+    SELECT CAST(DriverNumber AS VARCHAR),
+           CAST(COALESCE(Driver, '') AS VARCHAR),
+           CAST(COALESCE(Team, '') AS VARCHAR),
+           CAST(COALESCE(LapNumber, 0) AS INTEGER),
+           CAST(COALESCE(LapStartTime, 0.0) AS DOUBLE),
+           COALESCE(CAST(Position AS INTEGER), 20),
+           CAST(COALESCE(Compound, 'HARD') AS VARCHAR),
+           COALESCE(CAST(TyreLife AS INTEGER), 0)
+    FROM laps
+    WHERE EventName = ? AND Session = ?
+    ORDER BY DriverNumber, LapNumber
+";
 
-    DriverFrame {
-        driver_number: driver.driver_number.clone(),
+/// Per-driver sample columns, sorted by driver number. With `driver` set,
+/// only that driver is queried. Reads `merged_telemetry` when the source has
+/// it for this session, otherwise runs the ASOF JOIN.
+fn read_telemetry(
+    conn: &Connection,
+    source: &TelemetrySource,
+    event_name: &str,
+    session: &str,
+    driver: Option<&str>,
+) -> Result<Vec<(String, SampleColumns)>, String> {
+    let merged = source.merged.is_some();
+    let query = source.apply(match (merged, driver.is_some()) {
+        (true, true) => DRIVER_MERGED_TELEMETRY_QUERY,
+        (true, false) => MERGED_TELEMETRY_QUERY,
+        (false, true) => DRIVER_TELEMETRY_QUERY,
+        (false, false) => TELEMETRY_QUERY,
+    });
+    let query_span = tracing::info_span!("load_session.query").entered();
+    let mut stmt = conn
+        .prepare(&query)
+        .map_err(|e| format!("Failed to prepare position query: {e}"))?;
+    let batches = match driver {
+        Some(d) if merged => stmt.query_arrow([event_name, session, d]),
+        Some(d) => stmt.query_arrow([event_name, session, d, event_name, session, d]),
+        None => stmt.query_arrow([event_name, session]),
+    }
+    .map_err(|e| format!("Failed to query positions: {e}"))?;
+    drop(query_span);
+
+    // Record batches stream in as they are decoded, so this includes
+    // DuckDB's time producing them
+    let _decode = tracing::info_span!("load_session.decode").entered();
+    let mut drivers: Vec<(String, SampleColumns)> = Vec::new();
+    for batch in batches {
+        let numbers = column::<StringArray>(&batch, 0)?;
+        let times = column::<Float64Array>(&batch, 1)?.values();
+        let xs = column::<Float64Array>(&batch, 2)?.values();
+        let ys = column::<Float64Array>(&batch, 3)?.values();
+        let speeds = column::<Float64Array>(&batch, 4)?.values();
+        let gears = column::<Int32Array>(&batch, 5)?.values();
+        let throttles = column::<Float64Array>(&batch, 6)?.values();
+        let brakes = column::<Float64Array>(&batch, 7)?.values();
+        let drs = column::<Int32Array>(&batch, 8)?.values();
+
+        for run in driver_runs(numbers) {
+            let number = numbers.value(run.start);
+            // A driver's rows may continue from the previous batch
+            if drivers.last().map_or(true, |(n, _)| n != number) {
+                drivers.push((number.to_string(), SampleColumns::default()));
+            }
+            let cols = &mut drivers.last_mut().expect("pushed above").1;
+
+            cols.times.extend_from_slice(&times[run.clone()]);
+            cols.xs.extend(xs[run.clone()].iter().map(|&v| v as f32));
+            cols.ys.extend(ys[run.clone()].iter().map(|&v| v as f32));
+            cols.speeds.extend(speeds[run.clone()].iter().map(|&v| v as f32));
+            cols.gears.extend(gears[run.clone()].iter().map(|&v| v.clamp(0, 8) as u8));
+            cols.throttles.extend(throttles[run.clone()].iter().map(|&v| (v as f32).clamp(0.0, 1.0)));
+            cols.brakes.extend(brakes[run.clone()].iter().map(|&v| (v as f32).clamp(0.0, 1.0)));
+            cols.drs.extend(drs[run].iter().map(|&v| v.clamp(0, 255) as u8));
+        }
+    }
+
+    Ok(drivers)
+}
+
+fn read_driver_numbers(
+    conn: &Connection,
+    source: &TelemetrySource,
+    event_name: &str,
+    session: &str,
+) -> Result<Vec<String>, String> {
+    let mut stmt = conn
+        .prepare(&source.apply(DRIVER_NUMBERS_QUERY))
+        .map_err(|e| format!("Failed to prepare driver query: {e}"))?;
+    let batches = stmt
+        .query_arrow([event_name, session])
+        .map_err(|e| format!("Failed to query drivers: {e}"))?;
+
+    let mut numbers = Vec::new();
+    for batch in batches {
+        let col = column::<StringArray>(&batch, 0)?;
+        numbers.extend((0..col.len()).map(|i| col.value(i).to_string()));
+    }
+    Ok(numbers)
+}
+
+/// One driver's lap table plus the identity fields the laps table carries.
+#[derive(Default)]
+struct DriverLaps {
+    abbreviation: Option<String>,
+    team: String,
+    laps: Vec<LapRecord>,
+}
+
+fn read_laps(
+    conn: &Connection,
+    event_name: &str,
+    session: &str,
+) -> Result<HashMap<String, DriverLaps>, String> {
+    let _span = tracing::info_span!("load_session.laps").entered();
+    let mut stmt = conn
+        .prepare(LAPS_QUERY)
+        .map_err(|e| format!("Failed to prepare laps query: {e}"))?;
+    let batches = stmt
+        .query_arrow([event_name, session])
+        .map_err(|e| format!("Failed to query laps: {e}"))?;
+
+    let mut drivers: HashMap<String, DriverLaps> = HashMap::new();
+    for batch in batches {
+        let numbers = column::<StringArray>(&batch, 0)?;
+        let names = column::<StringArray>(&batch, 1)?;
+        let teams = column::<StringArray>(&batch, 2)?;
+        let lap_numbers = column::<Int32Array>(&batch, 3)?.values();
+        let start_times = column::<Float64Array>(&batch, 4)?.values();
+        let positions = column::<Int32Array>(&batch, 5)?.values();
+        let compounds = column::<StringArray>(&batch, 6)?;
+        let tyre_lives = column::<Int32Array>(&batch, 7)?.values();
+
+        for run in driver_runs(numbers) {
+            let number = numbers.value(run.start);
+            let entry = drivers.entry(number.to_string()).or_insert_with(|| DriverLaps {
+                abbreviation: Some(abbreviate_driver_name(names.value(run.start), number)),
+                team: teams.value(run.start).to_string(),
+                laps: Vec::new(),
+            });
+            entry.laps.extend(run.map(|i| LapRecord {
+                lap_number: lap_numbers[i].max(0) as u32,
+                lap_start_time_s: start_times[i],
+                position: positions[i].clamp(1, 20) as u8,
+                compound: Compound::parse(compounds.value(i)),
+                tyre_life: tyre_lives[i].clamp(0, 255) as u8,
+            }));
+        }
+    }
+
+    Ok(drivers)
+}
+
+/// Downcast column `i` of `batch` to its concrete Arrow array type.
+fn column<T: 'static>(batch: &RecordBatch, i: usize) -> Result<&T, String> {
+    batch
+        .column(i)
+        .as_any()
+        .downcast_ref::<T>()
+        .ok_or_else(|| format!("Unexpected Arrow type for column {i}"))
+}
+
+/// Maximal runs of equal driver numbers in a sorted column.
+fn driver_runs(numbers: &StringArray) -> Vec<std::ops::Range<usize>> {
+    let n_rows = numbers.len();
+    let mut runs = Vec::new();
+    let mut start = 0;
+    for i in 1..=n_rows {
+        if i == n_rows || numbers.value(i) != numbers.value(start) {
+            runs.push(start..i);
+            start = i;
+        }
+    }
+    runs
+}
+
+// ── Frame computation ────────────────────────────────────────────────────────
+
+/// Sentinel `DriverState::lap_idx` for a driver with no lap records.
+pub const NO_LAP: u16 = u16::MAX;
+
+/// One driver's playback state at an instant, with no owned strings.
+/// `lap_idx` indexes `DriverData::laps` (or is `NO_LAP`).
+#[derive(Debug, Clone, Copy, Default)]
+pub struct DriverState {
+    pub x: f32,
+    pub y: f32,
+    pub heading: f32,
+    pub speed: f32,
+    pub throttle: f32,
+    pub brake: f32,
+    pub lap_idx: u16,
+    pub gear: u8,
+    pub drs_active: bool,
+}
+
+/// Overwrite `out` with the frame at `time_s`. Playback keeps one `FrameData`
+/// per stream: once its `drivers` has room for the field, building a frame
+/// makes no heap allocations.
+#[tracing::instrument(skip_all)]
+pub fn get_frame_into(session: &SessionData, time_s: f64, out: &mut FrameData) {
+    if let Some(cache) = &session.frame_cache {
+        return cache.frame_into(&session.drivers, time_s, out);
+    }
+
+    out.time_s = time_s;
+    out.drivers.clear();
+    out.drivers.extend(session.drivers.iter().enumerate().map(|(id, d)| {
+        let mut cursor = SplineCursor::at(d.playback_segment.load(Ordering::Relaxed));
+        let state = driver_state_at(d, time_s, &mut cursor);
+        d.playback_segment.store(cursor.segment(), Ordering::Relaxed);
+        driver_frame_from_state(id as DriverId, d, &state)
+    }));
+}
+
+/// How far ahead the second position sample for the heading is taken.
+const HEADING_LOOKAHEAD_S: f64 = 0.1;
+
+/// Evaluate a driver's splines and ASOF lookups at `time_s`. `cursor` is the
+/// spline segment hint carried between calls by the caller.
+pub fn driver_state_at(driver: &DriverData, time_s: f64, cursor: &mut SplineCursor) -> DriverState {
+    // Position and heading look-ahead share one segment search
+    let (x, x2) = driver.spline_x.eval_pair(time_s, time_s + HEADING_LOOKAHEAD_S, cursor);
+    let (y, y2) = driver.spline_y.eval_pair(time_s, time_s + HEADING_LOOKAHEAD_S, cursor);
+
+    state_from_lookups(
+        driver,
+        [x, y, x2, y2],
+        driver.samples.asof_index(time_s),
+        asof_lap_index(&driver.laps, time_s),
+    )
+}
+
+/// `driver_state_at` for each of the non-decreasing `times`, evaluating the
+/// splines in batches and walking the ASOF lookups forward.
+pub fn driver_states_at_many(driver: &DriverData, times: &[f64]) -> Vec<DriverState> {
+    let n = times.len();
+    let ahead: Vec<f64> = times.iter().map(|t| t + HEADING_LOOKAHEAD_S).collect();
+    let mut coords = vec![0.0; 4 * n];
+    let (xs, rest) = coords.split_at_mut(n);
+    let (ys, rest) = rest.split_at_mut(n);
+    let (xs2, ys2) = rest.split_at_mut(n);
+    driver.spline_x.eval_many(times, xs);
+    driver.spline_y.eval_many(times, ys);
+    driver.spline_x.eval_many(&ahead, xs2);
+    driver.spline_y.eval_many(&ahead, ys2);
+
+    let lap_starts: Vec<f64> = driver.laps.iter().map(|l| l.lap_start_time_s).collect();
+    let (mut sample_cursor, mut lap_cursor) = (AsofCursor::default(), AsofCursor::default());
+    (0..n)
+        .map(|k| {
+            let t = times[k];
+            let sample = (!driver.samples.is_empty()).then(|| sample_cursor.seek(&driver.samples.times, t));
+            let lap = (!lap_starts.is_empty()).then(|| lap_cursor.seek(&lap_starts, t));
+            state_from_lookups(driver, [xs[k], ys[k], xs2[k], ys2[k]], sample, lap)
+        })
+        .collect()
+}
+
+/// Assemble a `DriverState` from spline positions `[x, y, x_ahead, y_ahead]`
+/// and the ASOF sample and lap indices.
+fn state_from_lookups(driver: &DriverData, pos: [f64; 4], sample: Option<usize>, lap: Option<usize>) -> DriverState {
+    let [x, y, x2, y2] = pos.map(|v| v as f32);
+    let heading = (y2 - y).atan2(x2 - x);
+
+    let lap_idx = lap
+        .map(|i| i.min(NO_LAP as usize - 1) as u16)
+        .unwrap_or(NO_LAP);
+
+    let s = &driver.samples;
+    let (speed, gear, throttle, brake, drs) = sample
+        .map(|i| (s.speeds[i], s.gears[i], s.throttles[i], s.brakes[i], s.drs[i]))
+        .unwrap_or((0.0, 1, 0.0, 0.0, 0));
+
+    DriverState {
         x,
         y,
         heading,
         speed,
-        gear,
         throttle,
         brake,
-        drs_active,
+        lap_idx,
+        gear,
+        drs_active: matches!(drs, 10 | 12 | 14),
+    }
+}
+
+/// Expand a `DriverState` into the serialisable per-driver frame for the
+/// driver at index `id` of the session.
+pub fn driver_frame_from_state(id: DriverId, driver: &DriverData, state: &DriverState) -> DriverFrame {
+    let is_in_pit = state.speed < 20.0;
+
+    let (position, compound, tyre_life) = driver
+        .laps
+        .get(state.lap_idx as usize)
+        .map(|l| (l.position, l.compound, l.tyre_life))
+        .unwrap_or((20, Compound::Hard, 0));
+
+    DriverFrame {
+        driver_id: id,
+        x: state.x,
+        y: state.y,
+        heading: state.heading,
+        speed: state.speed,
+        gear: state.gear,
+        throttle: state.throttle,
+        brake: state.brake,
+        drs_active: state.drs_active,
         position,
         compound,
         tyre_life,
@@ -326,56 +969,67 @@ fn build_driver_frame(driver: &DriverData, time_s: f64) -> DriverFrame {
 
 // ── ASOF binary search helpers ───────────────────────────────────────────────
 
-fn asof_sample(samples: &[RawSample], time_s: f64) -> Option<&RawSample> {
-    if samples.is_empty() {
-        return None;
-    }
-    let idx = samples.partition_point(|s| s.session_time <= time_s);
-    if idx == 0 {
-        Some(&samples[0])
-    } else {
-        Some(&samples[idx - 1])
-    }
-}
-
-fn asof_lap(laps: &[LapRecord], time_s: f64) -> Option<&LapRecord> {
+fn asof_lap_index(laps: &[LapRecord], time_s: f64) -> Option<usize> {
     if laps.is_empty() {
         return None;
     }
     let idx = laps.partition_point(|l| l.lap_start_time_s <= time_s);
-    if idx == 0 {
-        Some(&laps[0])
-    } else {
-        Some(&laps[idx - 1])
-    }
+    Some(idx.saturating_sub(1))
 }
 
 // ── Track layout builder ─────────────────────────────────────────────────────
 
-fn build_track_layout(samples: &[RawSample], duration_s: f64) -> TrackLayout {
-    let center_line: Vec<[f32; 2]> = samples
+/// Layout traced from driver "1", or the first driver.
+pub fn session_track_layout(drivers: &[DriverData], duration_s: f64) -> TrackLayout {
+    // drivers is sorted by driver number, so the first entry is the fallback
+    let ref_driver = drivers
         .iter()
-        .enumerate()
-        .filter(|(i, _)| i % 20 == 0)
-        .map(|(_, s)| [s.x, s.y])
+        .find(|d| d.driver_number == "1")
+        .or_else(|| drivers.first());
+    match ref_driver {
+        Some(d) => {
+            let lap_distance_m = lap_index::reference_line(drivers).map(|line| line.length_m());
+            build_track_layout(&d.samples, duration_s, lap_distance_m)
+        }
+        None => TrackLayout {
+            center_line: vec![],
+            x_min: -7734.0,
+            x_max: 3879.0,
+            y_min: -1722.0,
+            y_max: 17775.0,
+            duration_s,
+            lap_distance_m: 6201.0, // Las Vegas GP circuit length
+        },
+    }
+}
+
+/// `lap_distance_m` is the reference lap's length when one was found.
+fn build_track_layout(samples: &SampleColumns, duration_s: f64, lap_distance_m: Option<f32>) -> TrackLayout {
+    let (xs, ys) = (&samples.xs, &samples.ys);
+    let center_line: Vec<[f32; 2]> = xs
+        .iter()
+        .zip(ys.iter())
+        .step_by(20)
+        .map(|(&x, &y)| [x, y])
         .collect();
 
-    let x_min = samples.iter().map(|s| s.x).fold(f32::INFINITY, f32::min);
-    let x_max = samples.iter().map(|s| s.x).fold(f32::NEG_INFINITY, f32::max);
-    let y_min = samples.iter().map(|s| s.y).fold(f32::INFINITY, f32::min);
-    let y_max = samples.iter().map(|s| s.y).fold(f32::NEG_INFINITY, f32::max);
+    let x_min = xs.iter().copied().fold(f32::INFINITY, f32::min);
+    let x_max = xs.iter().copied().fold(f32::NEG_INFINITY, f32::max);
+    let y_min = ys.iter().copied().fold(f32::INFINITY, f32::min);
+    let y_max = ys.iter().copied().fold(f32::NEG_INFINITY, f32::max);
 
-    // Estimate one-lap distance from arc length over first ~200 samples (single lap)
-    let lap_distance_m: f32 = {
+    // Without a green-flag lap, estimate from the arc length over the first
+    // ~200 samples
+    let lap_distance_m: f32 = lap_distance_m.unwrap_or_else(|| {
         let lap_end = samples.len().min(200);
         let mut d = 0.0_f32;
         for i in 1..lap_end {
-            let dx = samples[i].x - samples[i-1].x;
-            let dy = samples[i].y - samples[i-1].y;
+            let dx = xs[i] - xs[i-1];
+            let dy = ys[i] - ys[i-1];
             d += (dx*dx + dy*dy).sqrt();
         }
         d
-    };
+    });
 
     TrackLayout { center_line, x_min, x_max, y_min, y_max, duration_s, lap_distance_m }
 }
@@ -394,3 +1048,45 @@ fn abbreviate_driver_name(name: &str, fallback: &str) -> String {
         fallback.to_string()
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn columns(times: &[f64]) -> SampleColumns {
+        let mut cols = SampleColumns::default();
+        for &t in times {
+            cols.push(RawSample {
+                session_time: t, x: 0.0, y: 0.0, speed: t as f32, gear: 3,
+                throttle: 0.0, brake: 0.0, drs: 0,
+            });
+        }
+        cols
+    }
+
+    #[test]
+    fn test_columns_range_bounds() {
+        let cols = columns(&[0.0, 1.0, 2.0, 3.0, 4.0]);
+        assert_eq!(cols.range_inclusive(1.0, 3.0), 1..4);
+        assert_eq!(cols.range(1.0, 3.0), 1..3);
+        assert_eq!(cols.range_inclusive(10.0, 20.0), 5..5);
+        assert_eq!(cols.range_inclusive(3.0, 1.0).len(), 0);
+    }
+
+    #[test]
+    fn test_columns_asof_index() {
+        let cols = columns(&[1.0, 2.0, 3.0]);
+        assert_eq!(cols.asof_index(0.0), Some(0));
+        assert_eq!(cols.asof_index(2.0), Some(1));
+        assert_eq!(cols.asof_index(2.5), Some(1));
+        assert_eq!(cols.asof_index(99.0), Some(2));
+        assert_eq!(SampleColumns::default().asof_index(1.0), None);
+    }
+
+    #[test]
+    fn test_driver_runs_partition_sorted_column() {
+        let numbers = StringArray::from(vec!["1", "1", "11", "11", "11", "4"]);
+        assert_eq!(driver_runs(&numbers), vec![0..2, 2..5, 5..6]);
+        assert!(driver_runs(&StringArray::from(Vec::<&str>::new())).is_empty());
+    }
+}
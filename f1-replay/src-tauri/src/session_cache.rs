@@ -0,0 +1,248 @@
+//! Memory-budgeted LRU of loaded sessions keyed by (EventName, Session).
+//!
+//! Building a session (DuckDB query, splines, frame cache) takes seconds, and
+//! analysts flip between quali and race constantly. Loaded sessions are kept
+//! as shared `Arc` snapshots until their estimated heap footprint pushes the
+//! cache over budget; the least recently used entry is evicted first.
+//! Sessions fill lazy caches (fastest laps, lap and track indexes, race
+//! analysis) after they are inserted, so entries are re-measured on every
+//! lookup and insert before the budget is enforced.
+
+use crate::session::SessionData;
+use crate::types::SessionInfo;
+use std::collections::{HashSet, VecDeque};
+use std::sync::Arc;
+
+/// Default budget for all cached sessions combined. A full race is on the
+/// order of 100 MB including its frame cache.
+pub const SESSION_CACHE_BUDGET_BYTES: usize = 1 << 30;
+
+/// How many neighbouring sessions to prefetch after a load.
+pub const PREFETCH_COUNT: usize = 2;
+
+pub type SessionKey = (String, String);
+
+pub fn session_key(event_name: &str, session: &str) -> SessionKey {
+    (event_name.to_string(), session.to_string())
+}
+
+struct Entry {
+    key: SessionKey,
+    data: Arc<SessionData>,
+    bytes: usize,
+}
+
+pub struct SessionCache {
+    budget_bytes: usize,
+    used_bytes: usize,
+    /// Most recently used first.
+    entries: VecDeque<Entry>,
+    /// Keys currently being loaded by a prefetch task.
+    loading: HashSet<SessionKey>,
+}
+
+impl SessionCache {
+    pub fn new(budget_bytes: usize) -> Self {
+        SessionCache {
+            budget_bytes,
+            used_bytes: 0,
+            entries: VecDeque::new(),
+            loading: HashSet::new(),
+        }
+    }
+
+    /// Look up `key` and mark it most recently used.
+    pub fn get(&mut self, key: &SessionKey) -> Option<Arc<SessionData>> {
+        let idx = self.entries.iter().position(|e| &e.key == key)?;
+        let entry = self.entries.remove(idx)?;
+        let data = entry.data.clone();
+        self.entries.push_front(entry);
+        self.remeasure();
+        self.evict_over_budget();
+        Some(data)
+    }
+
+    pub fn contains(&self, key: &SessionKey) -> bool {
+        self.entries.iter().any(|e| &e.key == key)
+    }
+
+    /// Insert as the most recently used entry.
+    pub fn insert(&mut self, key: SessionKey, data: Arc<SessionData>) {
+        self.insert_at(key, data, 0);
+    }
+
+    /// Insert behind the most recently used entry, so a background prefetch
+    /// can never evict the session the user is looking at.
+    pub fn insert_prefetched(&mut self, key: SessionKey, data: Arc<SessionData>) {
+        self.insert_at(key, data, 1);
+    }
+
+    fn insert_at(&mut self, key: SessionKey, data: Arc<SessionData>, at: usize) {
+        self.remove(&key);
+        let bytes = data.heap_bytes();
+        self.used_bytes += bytes;
+        self.entries.insert(at.min(self.entries.len()), Entry { key, data, bytes });
+        self.remeasure();
+        self.evict_over_budget();
+    }
+
+    /// Refresh every entry's size; lazy caches may have grown since it was taken.
+    fn remeasure(&mut self) {
+        for e in &mut self.entries {
+            e.bytes = e.data.heap_bytes();
+        }
+        self.used_bytes = self.entries.iter().map(|e| e.bytes).sum();
+    }
+
+    fn evict_over_budget(&mut self) {
+        // The front entry is always kept, even when it alone exceeds the budget
+        while self.used_bytes > self.budget_bytes && self.entries.len() > 1 {
+            if let Some(evicted) = self.entries.pop_back() {
+                self.used_bytes -= evicted.bytes;
+            }
+        }
+    }
+
+    fn remove(&mut self, key: &SessionKey) {
+        if let Some(idx) = self.entries.iter().position(|e| &e.key == key) {
+            if let Some(old) = self.entries.remove(idx) {
+                self.used_bytes -= old.bytes;
+            }
+        }
+    }
+
+    /// Claim `key` for a background load. Returns false if it is already
+    /// cached or another task is loading it.
+    pub fn begin_load(&mut self, key: &SessionKey) -> bool {
+        !self.contains(key) && self.loading.insert(key.clone())
+    }
+
+    pub fn end_load(&mut self, key: &SessionKey) {
+        self.loading.remove(key);
+    }
+}
+
+/// Sessions worth prefetching after `key` is opened: other sessions of the
+/// same event first, then the list neighbours of `key`, nearest first.
+pub fn prefetch_candidates(sessions: &[SessionInfo], key: &SessionKey, max: usize) -> Vec<SessionKey> {
+    let Some(pos) = sessions
+        .iter()
+        .position(|s| s.event_name == key.0 && s.session == key.1)
+    else {
+        return Vec::new();
+    };
+
+    let mut by_distance: Vec<usize> = (0..sessions.len()).filter(|&i| i != pos).collect();
+    by_distance.sort_by_key(|&i| (sessions[i].event_name != key.0, i.abs_diff(pos)));
+
+    by_distance
+        .into_iter()
+        .take(max)
+        .map(|i| session_key(&sessions[i].event_name, &sessions[i].session))
+        .collect()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::test_fixtures;
+    use crate::types::{HeatCell, RaceAnalysis, RaceInsight};
+
+    fn session(event: &str, name: &str, heatmap_cells: usize) -> Arc<SessionData> {
+        Arc::new(SessionData {
+            event_name: event.to_string(),
+            session: name.to_string(),
+            heatmap: vec![HeatCell { x: 0.0, y: 0.0, speed_norm: 0.0 }; heatmap_cells],
+            ..test_fixtures::session(Vec::new())
+        })
+    }
+
+    fn info(event: &str, name: &str) -> SessionInfo {
+        SessionInfo { event_name: event.to_string(), session: name.to_string(), year: None }
+    }
+
+    #[test]
+    fn test_lru_evicts_least_recent() {
+        let one = session("Monza", "R", 100).heap_bytes();
+        let mut cache = SessionCache::new(one * 2);
+        cache.insert(session_key("Monza", "Q"), session("Monza", "Q", 100));
+        cache.insert(session_key("Monza", "R"), session("Monza", "R", 100));
+        assert!(cache.get(&session_key("Monza", "Q")).is_some());
+
+        cache.insert(session_key("Monza", "FP2"), session("Monza", "FP2", 100));
+        assert!(!cache.contains(&session_key("Monza", "R")));
+        assert!(cache.contains(&session_key("Monza", "Q")));
+        assert!(cache.contains(&session_key("Monza", "FP2")));
+    }
+
+    #[test]
+    fn test_prefetch_never_evicts_current() {
+        let one = session("Monza", "R", 100).heap_bytes();
+        let mut cache = SessionCache::new(one);
+        cache.insert(session_key("Monza", "R"), session("Monza", "R", 100));
+        cache.insert_prefetched(session_key("Monza", "Q"), session("Monza", "Q", 100));
+        assert!(cache.contains(&session_key("Monza", "R")));
+        assert!(!cache.contains(&session_key("Monza", "Q")));
+    }
+
+    #[test]
+    fn test_lazy_growth_counts_against_budget() {
+        let one = session("Monza", "R", 100).heap_bytes();
+        let mut cache = SessionCache::new(one * 2);
+        let grows = session("Monza", "Q", 100);
+        cache.insert(session_key("Monza", "Q"), grows.clone());
+        cache.insert(session_key("Monza", "R"), session("Monza", "R", 100));
+
+        // Filling a lazy cache after insert pushes the pair over budget
+        let _ = grows.race_analysis.set(RaceAnalysis {
+            event_name: "Monza".to_string(),
+            session: "Q".to_string(),
+            driver_count: 0,
+            valid_lap_count: 0,
+            fastest_driver: None,
+            fastest_lap_s: None,
+            median_race_pace_s: None,
+            drivers: Vec::new(),
+            stints: Vec::new(),
+            insights: (0..100)
+                .map(|_| RaceInsight {
+                    kind: String::new(),
+                    title: String::new(),
+                    detail: String::new(),
+                    driver_number: None,
+                    severity: 0.0,
+                })
+                .collect(),
+        });
+        assert!(cache.get(&session_key("Monza", "R")).is_some());
+        assert!(!cache.contains(&session_key("Monza", "Q")));
+    }
+
+    #[test]
+    fn test_begin_load_dedupes() {
+        let mut cache = SessionCache::new(usize::MAX);
+        let key = session_key("Monza", "R");
+        assert!(cache.begin_load(&key));
+        assert!(!cache.begin_load(&key));
+        cache.end_load(&key);
+        cache.insert(key.clone(), session("Monza", "R", 0));
+        assert!(!cache.begin_load(&key));
+    }
+
+    #[test]
+    fn test_prefetch_candidates_prefer_same_event() {
+        let sessions = vec![
+            info("Imola", "R"),
+            info("Monza", "FP2"),
+            info("Monza", "Q"),
+            info("Monza", "R"),
+            info("Zandvoort", "FP1"),
+        ];
+        let picks = prefetch_candidates(&sessions, &session_key("Monza", "R"), 3);
+        assert_eq!(
+            picks,
+            vec![session_key("Monza", "Q"), session_key("Monza", "FP2"), session_key("Zandvoort", "FP1")]
+        );
+        assert!(prefetch_candidates(&sessions, &session_key("Spa", "R"), 3).is_empty());
+    }
+}
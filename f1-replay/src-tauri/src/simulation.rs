@@ -1,10 +1,17 @@
 //! F1 performance simulation engine.
 //!
 //! Models how changes to car parameters, driver swaps, and weather
-//! affect lap times and race outcomes.
+//! affect lap times and race outcomes. Car changes go through the
+//! point-mass lap model in `lap_sim` when the session has a reference
+//! line and the base driver a green-flag lap to calibrate it against;
+//! otherwise a fixed straights/corners split stands in.
 
+use crate::lap_index::track_index;
+use crate::lap_sim::{self, LapProfile, PointMass, TrackProfile};
 use crate::session::{DriverData, SessionData};
-use crate::types::{DriverComparison, LapDelta};
+use crate::telemetry_analysis::{fit_cda, AIR_DENSITY, CAR_MASS_KG};
+use crate::types::{Compound, DriverComparison, LapDelta};
+use rayon::prelude::*;
 use serde::{Deserialize, Serialize};
 
 // ── Parameter types ───────────────────────────────────────────────────────────
@@ -19,7 +26,7 @@ pub struct CarParams {
     /// Drag reduction multiplier (0.5–1.5, lower = less drag = faster straights)
     pub aero_drag_factor: f64,
     /// Tyre compound override (None = use race data)
-    pub tyre_compound: Option<String>,
+    pub tyre_compound: Option<Compound>,
     /// Tyre degradation rate multiplier (1.0 = normal)
     pub tyre_wear_rate: f64,
     /// Fuel load at race start in kg (typical: 90–105 kg)
@@ -77,7 +84,9 @@ pub struct SimulationScenario {
     pub swap_car_with: Option<String>,
     /// Optional: swap driver inputs with another driver
     pub swap_driver_inputs_with: Option<String>,
+    #[serde(default)]
     pub car_params: CarParams,
+    #[serde(default)]
     pub env_params: EnvironmentParams,
     /// Number of laps to simulate (None = full race)
     pub num_laps: Option<u32>,
@@ -93,7 +102,7 @@ pub struct SimulatedLap {
     pub max_speed_kmh: f64,
     pub avg_speed_kmh: f64,
     pub tyre_life: u32,
-    pub compound: String,
+    pub compound: Compound,
     pub fuel_remaining_kg: f64,
     pub delta_to_baseline_s: f64,
 }
@@ -122,12 +131,16 @@ pub struct DeltaSummary {
 
 /// Core performance model: given car and environment parameters,
 /// compute multiplicative factors on lap time components.
-struct PerfFactors {
-    straight_speed_factor: f64,   // > 1 = faster on straights
-    corner_speed_factor: f64,     // > 1 = faster in corners
-    overall_lap_factor: f64,      // combined lap time multiplier
+pub(crate) struct PerfFactors {
+    pub straight_speed_factor: f64,   // > 1 = faster on straights
+    pub corner_speed_factor: f64,     // > 1 = faster in corners
+    pub overall_lap_factor: f64,      // combined lap time multiplier
+    pub sector_fractions: [f64; 3],   // share of the lap in each sector
 }
 
+/// Sector split when there is no lap model (approximately Las Vegas).
+const DEFAULT_SECTOR_FRACTIONS: [f64; 3] = [0.20, 0.40, 0.40];
+
 fn compute_perf_factors(
     car: &CarParams,
     env: &EnvironmentParams,
@@ -142,13 +155,32 @@ fn compute_perf_factors(
     let corner_speed_factor = car.aero_downforce_factor.powf(0.5)
         / car.aero_drag_factor.powf(0.1);
 
-    // Tyre grip: compound-based multiplier
-    let tyre_factor = compound_grip_factor(car.tyre_compound.as_deref().unwrap_or("HARD"));
-
     // Fuel weight penalty: each additional kg of fuel costs ~0.03s/lap
     let fuel_penalty_per_kg = 0.03 / 90.0; // seconds per kg above baseline
     let fuel_factor = 1.0 + (car.fuel_load_kg - 95.0) * fuel_penalty_per_kg;
 
+    // Combined lap time factor (lower = faster)
+    // Lap time is dominated by ~40% straights + 60% corners
+    let straight_contribution = 0.40 / straight_speed_factor;
+    let corner_contribution = 0.60 / corner_speed_factor;
+    let base_factor = straight_contribution + corner_contribution;
+
+    let overall_lap_factor = base_factor * fuel_factor * conditions_factor(car, env);
+
+    PerfFactors {
+        straight_speed_factor,
+        corner_speed_factor,
+        overall_lap_factor,
+        sector_fractions: DEFAULT_SECTOR_FRACTIONS,
+    }
+}
+
+/// Lap time multiplier for tyres, track temperature and wind, which both
+/// models apply on top of the car.
+fn conditions_factor(car: &CarParams, env: &EnvironmentParams) -> f64 {
+    // Tyre grip: compound-based multiplier
+    let tyre_factor = compound_grip_factor(car.tyre_compound.unwrap_or(Compound::Hard));
+
     // Temperature effects on tyre performance
     let ideal_track_temp = 45.0;
     let temp_diff = (env.track_temp_c - ideal_track_temp).abs();
@@ -161,131 +193,231 @@ fn compute_perf_factors(
             * env.wind_direction_deg.to_radians().cos().abs()
             * 0.5;
 
-    // Combined lap time factor (lower = faster)
-    // Lap time is dominated by ~40% straights + 60% corners
-    let straight_contribution = 0.40 / straight_speed_factor;
-    let corner_contribution = 0.60 / corner_speed_factor;
-    let base_factor = straight_contribution + corner_contribution;
+    tyre_factor * temp_factor * wind_drag_factor
+}
 
-    let overall_lap_factor = base_factor * tyre_factor * fuel_factor * temp_factor * wind_drag_factor;
+// ── Lap physics ───────────────────────────────────────────────────────────────
+
+/// Fitted Cd*A outside this range (m²) is a poor fit rather than a car.
+const CDA_RANGE: (f64, f64) = (0.6, 2.5);
+const DEFAULT_CDA: f64 = 1.1;
+
+/// The base driver's car, calibrated so the default setup reproduces their
+/// fastest green-flag lap on the session's track. Depends only on the driver
+/// and the track, so it is memoised on `DriverData::lap_calibration`.
+#[derive(Debug, Clone, Copy)]
+pub struct LapCalibration {
+    cda: f32,
+    c_roll: f32,
+    mu: f32,
+    baseline: LapProfile,
+}
 
-    PerfFactors {
-        straight_speed_factor,
-        corner_speed_factor,
-        overall_lap_factor,
+/// The point-mass lap model for a scenario: the session's track profile and
+/// the base driver's calibrated car. Car changes are then the ratio of two
+/// simulated laps, so they cost time where the track uses them.
+pub(crate) struct LapPhysics<'a> {
+    track: &'a TrackProfile,
+    calibration: LapCalibration,
+}
+
+impl<'a> LapPhysics<'a> {
+    fn resolve(session: &'a SessionData, base_driver: &DriverData, baseline_laps: &[f64]) -> Option<Self> {
+        let track = track_index(session).profile()?;
+        let fastest = baseline_laps.iter().copied().reduce(f64::min)?;
+        let calibration = *base_driver.lap_calibration.get_or_init(|| calibrate(track, base_driver, fastest));
+        Some(LapPhysics { track, calibration })
     }
+
+    /// Power, drag and downforce scale the baseline car; the mass carries
+    /// half the starting fuel, the stint average.
+    fn point_mass(&self, car: &CarParams, env: &EnvironmentParams) -> PointMass {
+        let cal = &self.calibration;
+        let base = PointMass::baseline(cal.cda, cal.mu);
+        PointMass {
+            mass_kg: (CAR_MASS_KG + car.fuel_load_kg.max(0.0) / 2.0) as f32,
+            power_w: base.power_w * car.engine_power_factor as f32,
+            cda: base.cda * car.aero_drag_factor as f32,
+            cla: base.cla * car.aero_downforce_factor as f32,
+            c_roll: cal.c_roll,
+            // Ideal gas at constant pressure
+            air_density: (AIR_DENSITY * 288.15 / (273.15 + env.air_temp_c)) as f32,
+            ..base
+        }
+    }
+
+    fn perf_factors(&self, car: &CarParams, env: &EnvironmentParams) -> PerfFactors {
+        let lap = lap_sim::simulate(self.track, &self.point_mass(car, env));
+        let base = &self.calibration.baseline;
+        PerfFactors {
+            straight_speed_factor: lap.max_speed_kmh / base.max_speed_kmh,
+            corner_speed_factor: lap.corner_speed_kmh / base.corner_speed_kmh,
+            overall_lap_factor: lap.lap_time_s / base.lap_time_s * conditions_factor(car, env),
+            sector_fractions: lap.sector_s.map(|t| t / lap.lap_time_s),
+        }
+    }
+}
+
+/// Grip is solved against `fastest` with the fitted drag, or with the
+/// baseline car's drag and rolling resistance when the fit is implausible.
+fn calibrate(track: &TrackProfile, driver: &DriverData, fastest: f64) -> LapCalibration {
+    let fit = fit_cda(driver);
+    let (cda, c_roll) = if fit.sample_count > 0 && (CDA_RANGE.0..=CDA_RANGE.1).contains(&fit.cda) {
+        (fit.cda as f32, fit.c_roll as f32)
+    } else {
+        (DEFAULT_CDA as f32, PointMass::baseline(DEFAULT_CDA as f32, 1.0).c_roll)
+    };
+
+    let (car, env) = (CarParams::default(), EnvironmentParams::default());
+    let placeholder = LapProfile { lap_time_s: fastest, sector_s: [0.0; 3], max_speed_kmh: 0.0, corner_speed_kmh: 0.0 };
+    let mut physics = LapPhysics { track, calibration: LapCalibration { cda, c_roll, mu: 1.0, baseline: placeholder } };
+    physics.calibration.mu = lap_sim::calibrate_mu(track, &physics.point_mass(&car, &env), fastest);
+    physics.calibration.baseline = lap_sim::simulate(track, &physics.point_mass(&car, &env));
+    physics.calibration
 }
 
-fn compound_grip_factor(compound: &str) -> f64 {
+pub(crate) fn compound_grip_factor(compound: Compound) -> f64 {
     match compound {
-        "SOFT"   => 0.986,  // fastest but degrades
-        "MEDIUM" => 0.993,
-        "HARD"   => 1.000,  // baseline
-        "INTER"  => 1.020,  // only good in wet
-        "WET"    => 1.060,  // very slow in dry
-        _        => 1.000,
+        Compound::Soft         => 0.986,  // fastest but degrades
+        Compound::Medium       => 0.993,
+        Compound::Hard         => 1.000,  // baseline
+        Compound::Intermediate => 1.020,  // only good in wet
+        Compound::Wet          => 1.060,  // very slow in dry
+        Compound::Unknown      => 1.000,
     }
 }
 
-fn tyre_degradation_per_lap(compound: &str, wear_rate: f64) -> f64 {
+pub(crate) fn tyre_degradation_per_lap(compound: Compound, wear_rate: f64) -> f64 {
     // Time loss per lap due to tyre wear (seconds)
     let base = match compound {
-        "SOFT"   => 0.08,  // fastest degradation
-        "MEDIUM" => 0.04,
-        "HARD"   => 0.02,
-        _        => 0.03,
+        Compound::Soft   => 0.08,  // fastest degradation
+        Compound::Medium => 0.04,
+        Compound::Hard   => 0.02,
+        _                => 0.03,
     };
     base * wear_rate
 }
 
-// ── Main simulation function ──────────────────────────────────────────────────
+// ── Scenario model ────────────────────────────────────────────────────────────
+
+/// Everything about a scenario that does not change from lap to lap,
+/// resolved once per scenario rather than inside any lap loop.
+pub(crate) struct ScenarioModel<'a> {
+    pub base_driver: &'a DriverData,
+    /// Actual lap times of the base driver, the baseline every model scales.
+    pub baseline_laps: Vec<f64>,
+    pub num_laps: usize,
+    pub factors: PerfFactors,
+    pub car_delta: f64,
+    pub driver_delta: f64,
+    /// Compound the base stint runs on.
+    pub compound: Compound,
+    /// `None` falls back to the fixed-split model.
+    pub physics: Option<LapPhysics<'a>>,
+}
 
-pub fn run_simulation(
-    session: &SessionData,
-    scenario: &SimulationScenario,
-) -> Result<SimulationResult, String> {
-    // Get base driver data
-    let base_driver = session.drivers.iter()
-        .find(|d| d.driver_number == scenario.base_driver)
-        .ok_or_else(|| format!("Driver {} not found", scenario.base_driver))?;
-
-    // Get reference car driver (may be swapped)
-    let car_driver = if let Some(ref swap_num) = scenario.swap_car_with {
-        session.drivers.iter()
-            .find(|d| d.driver_number == *swap_num)
-            .unwrap_or(base_driver)
-    } else {
-        base_driver
-    };
+impl<'a> ScenarioModel<'a> {
+    pub fn resolve(session: &'a SessionData, scenario: &SimulationScenario) -> Result<Self, String> {
+        // Get base driver data
+        let base_driver = session.drivers.iter()
+            .find(|d| d.driver_number == scenario.base_driver)
+            .ok_or_else(|| format!("Driver {} not found", scenario.base_driver))?;
+
+        // Get reference car driver (may be swapped)
+        let car_driver = if let Some(ref swap_num) = scenario.swap_car_with {
+            session.drivers.iter()
+                .find(|d| d.driver_number == *swap_num)
+                .unwrap_or(base_driver)
+        } else {
+            base_driver
+        };
+
+        // Get reference input driver (driving style, may be swapped)
+        let input_driver = if let Some(ref swap_num) = scenario.swap_driver_inputs_with {
+            session.drivers.iter()
+                .find(|d| d.driver_number == *swap_num)
+                .unwrap_or(base_driver)
+        } else {
+            base_driver
+        };
+
+        // Compute baseline lap times from actual race data
+        let baseline_laps = extract_lap_times(base_driver);
+        if baseline_laps.is_empty() {
+            return Err("No lap time data for driver".to_string());
+        }
 
-    // Get reference input driver (driving style, may be swapped)
-    let input_driver = if let Some(ref swap_num) = scenario.swap_driver_inputs_with {
-        session.drivers.iter()
-            .find(|d| d.driver_number == *swap_num)
-            .unwrap_or(base_driver)
-    } else {
-        base_driver
-    };
+        // Compute performance factors
+        let physics = LapPhysics::resolve(session, base_driver, &baseline_laps);
+        let factors = perf_factors(physics.as_ref(), &scenario.car_params, &scenario.env_params);
 
-    // Compute baseline lap times from actual race data
-    let baseline_laps = extract_lap_times(base_driver);
-    if baseline_laps.is_empty() {
-        return Err("No lap time data for driver".to_string());
-    }
+        // Compute car efficiency delta from swapping
+        let car_delta = if scenario.swap_car_with.is_some() {
+            compute_car_delta(base_driver, car_driver)
+        } else {
+            1.0
+        };
 
-    // Compute performance factors
-    let baseline_env = EnvironmentParams::default();
-    let factors = compute_perf_factors(&scenario.car_params, &scenario.env_params, &baseline_env);
+        // Compute driver style delta from swapping
+        let driver_delta = if scenario.swap_driver_inputs_with.is_some() {
+            compute_driver_style_delta(base_driver, input_driver)
+        } else {
+            1.0
+        };
 
-    // Compute car efficiency delta from swapping
-    let car_delta = if scenario.swap_car_with.is_some() {
-        compute_car_delta(base_driver, car_driver)
-    } else {
-        1.0
-    };
+        let num_laps = scenario.num_laps.unwrap_or(baseline_laps.len() as u32) as usize;
+        let num_laps = num_laps.min(baseline_laps.len());
 
-    // Compute driver style delta from swapping
-    let driver_delta = if scenario.swap_driver_inputs_with.is_some() {
-        compute_driver_style_delta(base_driver, input_driver)
-    } else {
-        1.0
-    };
+        let compound = scenario.car_params.tyre_compound
+            .or_else(|| base_driver.laps.first().map(|l| l.compound))
+            .unwrap_or(Compound::Hard);
+
+        Ok(ScenarioModel { base_driver, baseline_laps, num_laps, factors, car_delta, driver_delta, compound, physics })
+    }
+
+    /// Performance factors for another setup on the same scenario.
+    pub fn perf_factors(&self, car: &CarParams, env: &EnvironmentParams) -> PerfFactors {
+        perf_factors(self.physics.as_ref(), car, env)
+    }
+}
 
-    let num_laps = scenario.num_laps.unwrap_or(baseline_laps.len() as u32) as usize;
-    let num_laps = num_laps.min(baseline_laps.len());
+fn perf_factors(physics: Option<&LapPhysics>, car: &CarParams, env: &EnvironmentParams) -> PerfFactors {
+    match physics {
+        Some(p) => p.perf_factors(car, env),
+        None => compute_perf_factors(car, env, &EnvironmentParams::default()),
+    }
+}
+
+// ── Main simulation function ──────────────────────────────────────────────────
 
-    let compound = scenario.car_params.tyre_compound.clone()
-        .unwrap_or_else(|| base_driver.laps.first()
-            .map(|l| l.compound.clone())
-            .unwrap_or_else(|| "HARD".to_string()));
+pub fn run_simulation(
+    session: &SessionData,
+    scenario: &SimulationScenario,
+) -> Result<SimulationResult, String> {
+    let ScenarioModel { base_driver, baseline_laps, num_laps, factors, car_delta, driver_delta, compound, .. } =
+        ScenarioModel::resolve(session, scenario)?;
 
     let mut simulated_laps = Vec::with_capacity(num_laps);
     let mut fuel_kg = scenario.car_params.fuel_load_kg;
     let fuel_burn_per_lap = 3.0; // ~3 kg per lap typical F1
 
+    // Loop invariants: none of these depend on the lap
+    let lap_factor = factors.overall_lap_factor * car_delta * driver_delta;
+    let deg_per_lap = tyre_degradation_per_lap(compound, scenario.car_params.tyre_wear_rate);
+    let base_speed = extract_avg_speed(base_driver);
+    let max_speed = base_speed * factors.straight_speed_factor * 1.3;
+    let avg_speed = base_speed * (0.4 * factors.straight_speed_factor + 0.6 * factors.corner_speed_factor);
+
     for (i, &baseline_time) in baseline_laps.iter().take(num_laps).enumerate() {
         let tyre_life = (i as u32 + 1) * scenario.car_params.tyre_wear_rate as u32;
-        let tyre_deg = tyre_degradation_per_lap(&compound, scenario.car_params.tyre_wear_rate)
-            * i as f64;
+        let tyre_deg = deg_per_lap * i as f64;
 
         // Combined lap time
-        let simulated_time = baseline_time
-            * factors.overall_lap_factor
-            * car_delta
-            * driver_delta
-            + tyre_deg;
+        let simulated_time = baseline_time * lap_factor + tyre_deg;
 
         let delta = simulated_time - baseline_time;
 
-        // Sector splits (approximate 20% / 40% / 40% for Las Vegas)
-        let sector1 = simulated_time * 0.20;
-        let sector2 = simulated_time * 0.40;
-        let sector3 = simulated_time * 0.40;
-
-        // Speed estimates
-        let base_speed = extract_avg_speed(base_driver);
-        let max_speed = base_speed * factors.straight_speed_factor * 1.3;
-        let avg_speed = base_speed * (0.4 * factors.straight_speed_factor + 0.6 * factors.corner_speed_factor);
+        let [sector1, sector2, sector3] = factors.sector_fractions.map(|f| simulated_time * f);
 
         fuel_kg = (fuel_kg - fuel_burn_per_lap).max(0.0);
 
@@ -298,7 +430,7 @@ pub fn run_simulation(
             max_speed_kmh: max_speed,
             avg_speed_kmh: avg_speed,
             tyre_life,
-            compound: compound.clone(),
+            compound,
             fuel_remaining_kg: fuel_kg,
             delta_to_baseline_s: delta,
         });
@@ -312,7 +444,6 @@ pub fn run_simulation(
     let total_time_delta_s = total_time_s - baseline_total;
     let avg_lap_delta_s = total_time_delta_s / num_laps as f64;
 
-    let base_speed = extract_avg_speed(base_driver);
     let straight_speed_delta = base_speed * 1.3 * (factors.straight_speed_factor - 1.0);
     let corner_speed_delta = base_speed * (factors.corner_speed_factor - 1.0);
 
@@ -336,6 +467,146 @@ pub fn run_simulation(
     })
 }
 
+// ── Parameter sweep ───────────────────────────────────────────────────────────
+
+/// Largest grid `run_parameter_sweep` will evaluate.
+const MAX_SWEEP_POINTS: usize = 250_000;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Serialize, Deserialize)]
+#[serde(rename_all = "camelCase")]
+pub enum SweepParam {
+    EnginePowerFactor,
+    AeroDownforceFactor,
+    AeroDragFactor,
+    TyreWearRate,
+    FuelLoadKg,
+}
+
+impl SweepParam {
+    fn set(self, car: &mut CarParams, value: f64) {
+        match self {
+            SweepParam::EnginePowerFactor => car.engine_power_factor = value,
+            SweepParam::AeroDownforceFactor => car.aero_downforce_factor = value,
+            SweepParam::AeroDragFactor => car.aero_drag_factor = value,
+            SweepParam::TyreWearRate => car.tyre_wear_rate = value,
+            SweepParam::FuelLoadKg => car.fuel_load_kg = value,
+        }
+    }
+}
+
+#[derive(Debug, Clone, Serialize, Deserialize)]
+#[serde(rename_all = "camelCase")]
+pub struct SweepAxis {
+    pub param: SweepParam,
+    pub min: f64,
+    pub max: f64,
+    /// Evenly spaced values from `min` to `max` inclusive (1 = just `min`)
+    pub steps: usize,
+}
+
+impl SweepAxis {
+    fn len(&self) -> usize {
+        self.steps.max(1)
+    }
+
+    fn values(&self) -> Vec<f64> {
+        if self.steps <= 1 {
+            return vec![self.min];
+        }
+        let step = (self.max - self.min) / (self.steps - 1) as f64;
+        (0..self.steps).map(|k| self.min + step * k as f64).collect()
+    }
+}
+
+#[derive(Debug, Clone, Serialize, Deserialize)]
+#[serde(rename_all = "camelCase")]
+pub struct SweepRequest {
+    /// Everything not swept is taken from here
+    pub scenario: SimulationScenario,
+    /// One to three axes
+    pub axes: Vec<SweepAxis>,
+}
+
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct SweepAxisValues {
+    pub param: SweepParam,
+    pub values: Vec<f64>,
+}
+
+/// Summary tensors over the sweep grid, row-major with the last axis
+/// varying fastest: point `(i, j, k)` is at `(i * shape[1] + j) * shape[2] + k`.
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct SweepResult {
+    pub axes: Vec<SweepAxisValues>,
+    pub shape: Vec<usize>,
+    pub total_time_delta_s: Vec<f64>,
+    pub fastest_lap_s: Vec<f64>,
+}
+
+/// Evaluate `run_simulation` over a grid of car parameters, keeping only
+/// the total time delta and fastest lap of each point. The scenario is
+/// resolved once; each point recomputes just the performance factors and
+/// never builds its laps.
+pub fn run_parameter_sweep(session: &SessionData, request: &SweepRequest) -> Result<SweepResult, String> {
+    if request.axes.is_empty() || request.axes.len() > 3 {
+        return Err(format!("A sweep takes one to three axes, got {}", request.axes.len()));
+    }
+    for (i, axis) in request.axes.iter().enumerate() {
+        if request.axes[..i].iter().any(|a| a.param == axis.param) {
+            return Err(format!("{:?} is swept more than once", axis.param));
+        }
+        if !axis.min.is_finite() || !axis.max.is_finite() {
+            return Err(format!("{:?} range {}..{} is not finite", axis.param, axis.min, axis.max));
+        }
+    }
+    // Sized from the step counts, so an oversized grid is refused before
+    // any of its values are built
+    let shape: Vec<usize> = request.axes.iter().map(SweepAxis::len).collect();
+    let points = shape
+        .iter()
+        .try_fold(1usize, |n, &len| n.checked_mul(len))
+        .filter(|&n| n <= MAX_SWEEP_POINTS)
+        .ok_or_else(|| format!("Sweep of shape {shape:?} exceeds the limit of {MAX_SWEEP_POINTS} points"))?;
+    let axes: Vec<SweepAxisValues> = request
+        .axes
+        .iter()
+        .map(|a| SweepAxisValues { param: a.param, values: a.values() })
+        .collect();
+
+    let model = ScenarioModel::resolve(session, &request.scenario)?;
+    let baseline = &model.baseline_laps[..model.num_laps];
+    let baseline_total: f64 = baseline.iter().sum();
+    // Sum of tyre age over the stint: 0 + 1 + … + (n − 1)
+    let age_sum = (model.num_laps * model.num_laps.saturating_sub(1) / 2) as f64;
+    let summaries: Vec<(f64, f64)> = (0..points)
+        .into_par_iter()
+        .map(|point| {
+            let mut car = request.scenario.car_params.clone();
+            let mut rest = point;
+            for axis in axes.iter().rev() {
+                let n = axis.values.len();
+                axis.param.set(&mut car, axis.values[rest % n]);
+                rest /= n;
+            }
+
+            let factors = model.perf_factors(&car, &request.scenario.env_params);
+            let lap_factor = factors.overall_lap_factor * model.car_delta * model.driver_delta;
+            let deg_per_lap = tyre_degradation_per_lap(model.compound, car.tyre_wear_rate);
+
+            let total = baseline_total * lap_factor + deg_per_lap * age_sum;
+            let fastest = baseline
+                .iter()
+                .enumerate()
+                .map(|(i, t)| t * lap_factor + deg_per_lap * i as f64)
+                .fold(f64::INFINITY, f64::min);
+            (total - baseline_total, fastest)
+        })
+        .collect();
+    let (total_time_delta_s, fastest_lap_s) = summaries.into_iter().unzip();
+
+    Ok(SweepResult { axes, shape, total_time_delta_s, fastest_lap_s })
+}
+
 // ── Compare two drivers in same session ──────────────────────────────────────
 
 pub fn compare_drivers(
@@ -398,7 +669,7 @@ pub fn compare_drivers(
 
 // ── Helper functions ──────────────────────────────────────────────────────────
 
-fn extract_lap_times(driver: &DriverData) -> Vec<f64> {
+pub(crate) fn extract_lap_times(driver: &DriverData) -> Vec<f64> {
     // Compute lap times from lap start times
     let mut times = Vec::new();
     for i in 0..driver.laps.len().saturating_sub(1) {
@@ -412,16 +683,16 @@ fn extract_lap_times(driver: &DriverData) -> Vec<f64> {
 
 fn extract_avg_speed(driver: &DriverData) -> f64 {
     if driver.samples.is_empty() { return 200.0; }
-    let sum: f32 = driver.samples.iter()
-        .filter(|s| s.speed > 0.0)
-        .map(|s| s.speed)
+    let speeds = &driver.samples.speeds;
+    let sum: f32 = speeds.iter()
+        .filter(|&&v| v > 0.0)
         .sum();
-    let count = driver.samples.iter().filter(|s| s.speed > 0.0).count();
+    let count = speeds.iter().filter(|&&v| v > 0.0).count();
     if count == 0 { 200.0 } else { sum as f64 / count as f64 }
 }
 
 fn extract_max_speed(driver: &DriverData) -> f64 {
-    driver.samples.iter().map(|s| s.speed as f64).fold(0.0, f64::max)
+    driver.samples.speeds.iter().map(|&v| v as f64).fold(0.0, f64::max)
 }
 
 fn compute_car_delta(base: &DriverData, swap: &DriverData) -> f64 {
@@ -444,11 +715,11 @@ fn compute_car_delta(base: &DriverData, swap: &DriverData) -> f64 {
 fn compute_driver_style_delta(base: &DriverData, swap: &DriverData) -> f64 {
     // Estimate driver style impact from throttle application and braking patterns
     let base_throttle_avg: f32 = if !base.samples.is_empty() {
-        base.samples.iter().map(|s| s.throttle).sum::<f32>() / base.samples.len() as f32
+        base.samples.throttles.iter().sum::<f32>() / base.samples.len() as f32
     } else { 0.7 };
 
     let swap_throttle_avg: f32 = if !swap.samples.is_empty() {
-        swap.samples.iter().map(|s| s.throttle).sum::<f32>() / swap.samples.len() as f32
+        swap.samples.throttles.iter().sum::<f32>() / swap.samples.len() as f32
     } else { 0.7 };
 
     // More aggressive throttle → faster (small effect)
@@ -478,7 +749,7 @@ fn build_description(
         let pct = (scenario.car_params.aero_drag_factor - 1.0) * 100.0;
         parts.push(format!("{:+.0}% drag", pct));
     }
-    if let Some(ref tyre) = scenario.car_params.tyre_compound {
+    if let Some(tyre) = scenario.car_params.tyre_compound {
         parts.push(format!("{} tyres", tyre));
     }
     if let Some(ref swap) = scenario.swap_car_with {
@@ -501,6 +772,8 @@ fn build_description(
 #[cfg(test)]
 mod tests {
     use super::*;
+    use crate::session::SampleColumns;
+    use crate::test_fixtures;
 
     #[test]
     fn test_car_params_default() {
@@ -513,13 +786,31 @@ mod tests {
     #[test]
     fn test_compound_grip_factors_ordered() {
         // SOFT should be faster (lower factor) than MEDIUM, HARD
-        let soft = compound_grip_factor("SOFT");
-        let medium = compound_grip_factor("MEDIUM");
-        let hard = compound_grip_factor("HARD");
+        let soft = compound_grip_factor(Compound::Soft);
+        let medium = compound_grip_factor(Compound::Medium);
+        let hard = compound_grip_factor(Compound::Hard);
         assert!(soft < medium, "SOFT ({soft}) should be faster than MEDIUM ({medium})");
         assert!(medium < hard, "MEDIUM ({medium}) should be faster than HARD ({hard})");
     }
 
+    #[test]
+    fn test_compound_parses_timing_names() {
+        let car: CarParams = serde_json::from_value(serde_json::json!({
+            "enginePowerFactor": 1.0, "aeroDownforceFactor": 1.0, "aeroDragFactor": 1.0,
+            "tyreCompound": "INTER", "tyreWearRate": 1.0, "fuelLoadKg": 95.0,
+        }))
+        .unwrap();
+        assert_eq!(car.tyre_compound, Some(Compound::Intermediate));
+        assert_eq!(compound_grip_factor(Compound::Intermediate), 1.020);
+        assert_eq!(Compound::parse("soft"), Compound::Soft);
+        assert_eq!(Compound::parse("TEST_UNKNOWN"), Compound::Unknown);
+        assert_eq!(serde_json::to_value(Compound::Intermediate).unwrap(), "INTERMEDIATE");
+        for c in Compound::ALL {
+            assert_eq!(Compound::from_code(c.code()), c);
+            assert_eq!(Compound::parse(c.name()), c);
+        }
+    }
+
     #[test]
     fn test_perf_factors_baseline() {
         let car = CarParams::default();
@@ -555,15 +846,15 @@ mod tests {
 
     #[test]
     fn test_tyre_degradation_soft_faster_than_hard() {
-        let soft_deg = tyre_degradation_per_lap("SOFT", 1.0);
-        let hard_deg = tyre_degradation_per_lap("HARD", 1.0);
+        let soft_deg = tyre_degradation_per_lap(Compound::Soft, 1.0);
+        let hard_deg = tyre_degradation_per_lap(Compound::Hard, 1.0);
         assert!(soft_deg > hard_deg, "SOFT tyres should degrade faster than HARD");
     }
 
     #[test]
     fn test_tyre_degradation_wear_rate_multiplier() {
-        let normal = tyre_degradation_per_lap("MEDIUM", 1.0);
-        let high = tyre_degradation_per_lap("MEDIUM", 2.0);
+        let normal = tyre_degradation_per_lap(Compound::Medium, 1.0);
+        let high = tyre_degradation_per_lap(Compound::Medium, 2.0);
         assert!((high - 2.0 * normal).abs() < 1e-10, "Wear rate multiplier should scale linearly");
     }
 
@@ -587,4 +878,149 @@ mod tests {
         assert!(f_heavy.overall_lap_factor > f_light.overall_lap_factor,
             "Heavier fuel load should be slower");
     }
+
+    fn session_with_laps(lap_time: f64, laps: u32) -> SessionData {
+        // Each lap 10 ms slower than the one before
+        let mut laps = test_fixtures::laps(laps + 1, lap_time, Compound::Medium);
+        for (k, lap) in laps.iter_mut().enumerate() {
+            lap.lap_start_time_s = k as f64 * (lap_time + 0.01 * k as f64);
+        }
+        test_fixtures::session(vec![test_fixtures::driver("16", SampleColumns::default(), laps)])
+    }
+
+    #[test]
+    fn test_sweep_matches_single_runs() {
+        let session = session_with_laps(81.0, 20);
+        let scenario = SimulationScenario {
+            event_name: "Monza".to_string(),
+            session: "R".to_string(),
+            base_driver: "16".to_string(),
+            swap_car_with: None,
+            swap_driver_inputs_with: None,
+            car_params: CarParams::default(),
+            env_params: EnvironmentParams::default(),
+            num_laps: None,
+        };
+        let request = SweepRequest {
+            scenario: scenario.clone(),
+            axes: vec![
+                SweepAxis { param: SweepParam::EnginePowerFactor, min: 0.9, max: 1.1, steps: 3 },
+                SweepAxis { param: SweepParam::TyreWearRate, min: 0.5, max: 2.0, steps: 4 },
+            ],
+        };
+        let sweep = run_parameter_sweep(&session, &request).unwrap();
+        assert_eq!(sweep.shape, vec![3, 4]);
+        assert_eq!(sweep.total_time_delta_s.len(), 12);
+
+        // Point (2, 1): engine 1.1, wear 1.0
+        let mut single = scenario.clone();
+        single.car_params.engine_power_factor = 1.1;
+        single.car_params.tyre_wear_rate = 1.0;
+        let expected = run_simulation(&session, &single).unwrap();
+        let k = 2 * 4 + 1;
+        assert!((sweep.total_time_delta_s[k] - expected.delta_summary.total_time_delta_s).abs() < 1e-6);
+        assert!((sweep.fastest_lap_s[k] - expected.fastest_lap_s).abs() < 1e-9);
+
+        let twice = SweepRequest { axes: vec![request.axes[0].clone(), request.axes[0].clone()], ..request.clone() };
+        assert!(run_parameter_sweep(&session, &twice).is_err());
+
+        // Refused from the step counts alone, even where their product overflows
+        let huge = |steps: usize| SweepRequest {
+            axes: request.axes.iter().map(|a| SweepAxis { steps, ..a.clone() }).collect(),
+            ..request.clone()
+        };
+        assert!(run_parameter_sweep(&session, &huge(1_000)).is_err());
+        assert!(run_parameter_sweep(&session, &huge(usize::MAX)).is_err());
+        let mut unbounded = request.clone();
+        unbounded.axes[0].max = f64::INFINITY;
+        assert!(run_parameter_sweep(&session, &unbounded).is_err());
+    }
+
+    /// One driver lapping a stadium (two 2.5 km straights, two 80 m-radius
+    /// hairpins) every `lap_time` seconds, sampled at 10 Hz.
+    fn session_on_track(lap_time: f64, laps: u32) -> SessionData {
+        use std::f64::consts::PI;
+
+        let (straight, radius) = (2_500.0, 80.0);
+        let length = 2.0 * straight + 2.0 * PI * radius;
+        let at = |d: f64| -> (f64, f64) {
+            let d = d.rem_euclid(length);
+            let turn = PI * radius;
+            if d < straight {
+                (d, 0.0)
+            } else if d < straight + turn {
+                let a = (d - straight) / radius;
+                (straight + radius * a.sin(), radius - radius * a.cos())
+            } else if d < 2.0 * straight + turn {
+                (straight - (d - straight - turn), 2.0 * radius)
+            } else {
+                let a = (d - 2.0 * straight - turn) / radius;
+                (-radius * a.sin(), radius + radius * a.cos())
+            }
+        };
+
+        let mut s = SampleColumns::default();
+        for i in 0..(lap_time * laps as f64 * 10.0) as usize {
+            let t = i as f64 / 10.0;
+            let (x, y) = at(t / lap_time * length);
+            s.times.push(t);
+            s.xs.push(x as f32);
+            s.ys.push(y as f32);
+            s.speeds.push((length / lap_time * 3.6) as f32);
+            s.throttles.push(1.0);
+            s.brakes.push(0.0);
+            s.gears.push(7);
+            s.drs.push(0);
+        }
+        test_fixtures::session(vec![test_fixtures::driver("16", s, test_fixtures::laps(laps + 1, lap_time, Compound::Medium))])
+    }
+
+    #[test]
+    fn test_lap_physics_drives_car_changes() {
+        let session = session_on_track(70.0, 4);
+        let scenario = SimulationScenario {
+            event_name: "Monza".to_string(),
+            session: "R".to_string(),
+            base_driver: "16".to_string(),
+            swap_car_with: None,
+            swap_driver_inputs_with: None,
+            car_params: CarParams::default(),
+            env_params: EnvironmentParams::default(),
+            num_laps: None,
+        };
+        let model = ScenarioModel::resolve(&session, &scenario).unwrap();
+        let physics = model.physics.as_ref().expect("the stadium has a reference line");
+        let cal = physics.calibration;
+        assert!((cal.baseline.lap_time_s - 70.0).abs() < 0.1, "{:?}", cal.baseline);
+        // Constant speed gives the drag fit nothing to work with
+        assert_eq!((cal.cda, cal.c_roll), (DEFAULT_CDA as f32, PointMass::baseline(cal.cda, 1.0).c_roll));
+        // Calibrated once per driver, not per scenario
+        let again = ScenarioModel::resolve(&session, &scenario).unwrap();
+        assert_eq!(again.physics.unwrap().calibration.mu, cal.mu);
+        assert!(session.drivers[0].lap_calibration.get().is_some());
+        // The default car only carries the conditions multiplier
+        let conditions = conditions_factor(&scenario.car_params, &scenario.env_params);
+        assert!((model.factors.overall_lap_factor - conditions).abs() < 1e-12);
+        let fractions = model.factors.sector_fractions;
+        assert!((fractions.iter().sum::<f64>() - 1.0).abs() < 1e-9 && fractions != DEFAULT_SECTOR_FRACTIONS);
+
+        let factor = |tweak: fn(&mut CarParams)| {
+            let mut car = CarParams::default();
+            tweak(&mut car);
+            model.perf_factors(&car, &scenario.env_params)
+        };
+        let power = factor(|c| c.engine_power_factor = 1.1);
+        let downforce = factor(|c| c.aero_downforce_factor = 1.1);
+        let heavy = factor(|c| c.fuel_load_kg = 110.0);
+        assert!(power.overall_lap_factor < conditions && power.straight_speed_factor > 1.0);
+        assert!(downforce.overall_lap_factor < conditions && downforce.corner_speed_factor > 1.0);
+        assert!(heavy.overall_lap_factor > conditions);
+
+        let mut faster = scenario.clone();
+        faster.car_params.engine_power_factor = 1.1;
+        let result = run_simulation(&session, &faster).unwrap();
+        assert!(result.delta_summary.total_time_delta_s < 0.0);
+        let lap = &result.laps[0];
+        assert!((lap.sector1_s + lap.sector2_s + lap.sector3_s - lap.lap_time_s).abs() < 1e-9);
+    }
 }
@@ -0,0 +1,479 @@
+//! Versioned on-disk snapshot of a built session, for instant reopen.
+//!
+//! `load_session` spends its time in the ASOF JOIN, row decoding and spline
+//! solving. A snapshot stores the finished columns, spline coefficients, laps,
+//! heatmap and track layout as flat little-endian arrays, so reopening is one
+//! file read plus bulk copies. The frame cache is not stored; it is rebuilt
+//! from the restored splines according to the current `LoadOptions`.
+//!
+//! Snapshots live in `<db stem>.snapshots/` next to the DuckDB file and are
+//! read through a memory map. Each one records a fingerprint of its sources
+//! that is cheap to recompute on every open: the size and modification time
+//! of the session's lake files, row counts and latest `SessionTime` of any
+//! telemetry read from DuckDB tables, and summed row hashes over the
+//! session's few thousand `laps` rows. A mismatch, version bump, decode error
+//! or snapshot of another session means the snapshot is rebuilt.
+//!
+//! ```text
+//! header   8 B magic "F1SNAP\0\0" | u32 version | u64 source fingerprint
+//! body     str event | str session | f64 duration | u32 n_drivers
+//!          per driver: str number, abbreviation, team
+//!                      spline_x [ts a b c d] | spline_y [ts a b c d]
+//!                      samples [times xs ys speeds throttles brakes gears drs]
+//!                      u32 n_laps × (u32 lap, f64 start, u8 pos, u8 compound code, u8 tyre life)
+//!          heatmap  [f32 x, y, speed_norm interleaved]
+//!          layout   [f32 center line x, y interleaved] | f32 x_min x_max y_min y_max
+//!                   | f64 duration | f32 lap distance
+//! str = u32 length + UTF-8; [..] arrays = u64 length + packed elements
+//! ```
+
+use crate::interpolate::Spline;
+use crate::lake::{self, partition_slug, TelemetrySource};
+use crate::session::{DriverData, LapRecord, SampleColumns};
+use crate::telemetry_lod::TelemetryLod;
+use crate::types::{Compound, HeatCell, TrackLayout};
+use duckdb::Connection;
+use memmap2::Mmap;
+use std::fs::File;
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use std::sync::OnceLock;
+use std::time::UNIX_EPOCH;
+
+const MAGIC: &[u8; 8] = b"F1SNAP\0\0";
+
+/// Bump whenever the layout above changes.
+pub const SNAPSHOT_VERSION: u32 = 3;
+
+/// Everything `load_session` builds except the frame cache.
+pub struct SessionSnapshot {
+    pub event_name: String,
+    pub session: String,
+    pub duration_s: f64,
+    pub drivers: Vec<DriverData>,
+    pub heatmap: Vec<HeatCell>,
+    pub track_layout: TrackLayout,
+}
+
+pub fn snapshot_path(db_path: &str, event_name: &str, session: &str) -> PathBuf {
+    let file = format!("{}__{}.f1snap", partition_slug(event_name), partition_slug(session));
+    Path::new(db_path).with_extension("snapshots").join(file)
+}
+
+/// Cheap digest of the sources for one session. Any re-ingest that adds,
+/// drops or rewrites lake files, adds or drops table rows, extends the last
+/// timestamp or changes a lap changes it.
+///
+/// Lap row hashes are summed modulo 2^52 so the aggregate stays exact as a DOUBLE.
+pub fn source_fingerprint(
+    conn: &Connection,
+    db_path: &str,
+    source: &TelemetrySource,
+    event_name: &str,
+    session: &str,
+) -> Result<u64, String> {
+    let mut aggregates = vec![
+        "(SELECT CAST(COUNT(*) AS DOUBLE) FROM laps WHERE EventName = ? AND Session = ?)".to_string(),
+        "(SELECT CAST(COALESCE(SUM(hash(DriverNumber, Driver, Team, LapNumber, LapStartTime, Position, Compound, TyreLife)) % 4503599627370496, 0) AS DOUBLE)
+          FROM laps WHERE EventName = ? AND Session = ?)".to_string(),
+    ];
+    let tables = [Some(&source.position), Some(&source.car), source.merged.as_ref()];
+    for table in tables.into_iter().flatten().filter(|r| lake::is_table(r)) {
+        aggregates.push(format!("(SELECT CAST(COUNT(*) AS DOUBLE) FROM {table} WHERE EventName = ? AND Session = ?)"));
+        aggregates.push(format!(
+            "(SELECT CAST(COALESCE(MAX(SessionTime), 0) AS DOUBLE) FROM {table} WHERE EventName = ? AND Session = ?)"
+        ));
+    }
+    let mut stmt = conn
+        .prepare(&format!("SELECT {}", aggregates.join(", ")))
+        .map_err(|e| format!("Failed to prepare fingerprint query: {e}"))?;
+    let params = (0..aggregates.len()).flat_map(|_| [event_name, session]);
+    let values: Vec<f64> = stmt
+        .query_row(duckdb::params_from_iter(params), |row| (0..aggregates.len()).map(|i| row.get(i)).collect())
+        .map_err(|e| format!("Failed to query fingerprint: {e}"))?;
+
+    // FNV-1a over the aggregates' raw bits, then each lake file's metadata
+    let mut hash: u64 = 0xcbf2_9ce4_8422_2325;
+    let mut feed = |bytes: &[u8]| {
+        for &byte in bytes {
+            hash = (hash ^ byte as u64).wrapping_mul(0x0100_0000_01b3);
+        }
+    };
+    for v in values {
+        feed(&v.to_bits().to_le_bytes());
+    }
+    for (path, len, modified) in lake::session_files(db_path, event_name, session) {
+        let mtime_ns = modified.duration_since(UNIX_EPOCH).map_or(0, |d| d.as_nanos());
+        feed(path.as_os_str().as_encoded_bytes());
+        feed(&len.to_le_bytes());
+        feed(&mtime_ns.to_le_bytes());
+    }
+    Ok(hash)
+}
+
+/// Read the snapshot of `event_name`/`session` at `path` if it exists, is
+/// current and matches `fingerprint`.
+pub fn read(path: &Path, fingerprint: u64, event_name: &str, session: &str) -> Option<SessionSnapshot> {
+    let file = File::open(path).ok()?;
+    // SAFETY: snapshots are only ever published by rename over the old file
+    // (see `write`), never truncated or rewritten in place, so the mapped
+    // file cannot change under the decoder.
+    let map = unsafe { Mmap::map(&file) }.ok()?;
+    decode(&map, fingerprint, event_name, session).ok()
+}
+
+/// Write atomically (temp file + rename) so a crash never leaves a torn snapshot.
+/// The temp name is unique per process and call, so concurrent writers of the
+/// same session never share (or truncate) each other's temp file.
+pub fn write(path: &Path, fingerprint: u64, snap: &SessionSnapshot) -> Result<(), String> {
+    static TMP_COUNTER: AtomicU64 = AtomicU64::new(0);
+
+    if let Some(dir) = path.parent() {
+        std::fs::create_dir_all(dir).map_err(|e| format!("Failed to create snapshot dir: {e}"))?;
+    }
+    let n = TMP_COUNTER.fetch_add(1, Ordering::Relaxed);
+    let tmp = path.with_extension(format!("f1snap.{}.{n}.tmp", std::process::id()));
+    if let Err(e) = std::fs::write(&tmp, encode(fingerprint, snap)) {
+        let _ = std::fs::remove_file(&tmp);
+        return Err(format!("Failed to write snapshot: {e}"));
+    }
+    std::fs::rename(&tmp, path).map_err(|e| {
+        let _ = std::fs::remove_file(&tmp);
+        format!("Failed to publish snapshot: {e}")
+    })
+}
+
+// ── Encoding ─────────────────────────────────────────────────────────────────
+
+pub fn encode(fingerprint: u64, snap: &SessionSnapshot) -> Vec<u8> {
+    let mut w = Writer(Vec::new());
+    w.0.extend_from_slice(MAGIC);
+    w.u32(SNAPSHOT_VERSION);
+    w.u64(fingerprint);
+
+    w.str(&snap.event_name);
+    w.str(&snap.session);
+    w.f64(snap.duration_s);
+    w.u32(snap.drivers.len() as u32);
+
+    for d in &snap.drivers {
+        w.str(&d.driver_number);
+        w.str(&d.abbreviation);
+        w.str(&d.team);
+        for spline in [&d.spline_x, &d.spline_y] {
+            for part in spline.parts() {
+                w.f64s(part);
+            }
+        }
+        let s = &d.samples;
+        w.f64s(&s.times);
+        for col in [&s.xs, &s.ys, &s.speeds, &s.throttles, &s.brakes] {
+            w.f32s(col);
+        }
+        w.u8s(&s.gears);
+        w.u8s(&s.drs);
+
+        w.u32(d.laps.len() as u32);
+        for lap in &d.laps {
+            w.u32(lap.lap_number);
+            w.f64(lap.lap_start_time_s);
+            w.0.push(lap.position);
+            w.0.push(lap.compound.code());
+            w.0.push(lap.tyre_life);
+        }
+    }
+
+    let heat: Vec<f32> = snap.heatmap.iter().flat_map(|c| [c.x, c.y, c.speed_norm]).collect();
+    w.f32s(&heat);
+
+    let layout = &snap.track_layout;
+    let center: Vec<f32> = layout.center_line.iter().flatten().copied().collect();
+    w.f32s(&center);
+    for v in [layout.x_min, layout.x_max, layout.y_min, layout.y_max] {
+        w.f32(v);
+    }
+    w.f64(layout.duration_s);
+    w.f32(layout.lap_distance_m);
+
+    w.0
+}
+
+struct Writer(Vec<u8>);
+
+impl Writer {
+    fn u32(&mut self, v: u32) {
+        self.0.extend_from_slice(&v.to_le_bytes());
+    }
+    fn u64(&mut self, v: u64) {
+        self.0.extend_from_slice(&v.to_le_bytes());
+    }
+    fn f32(&mut self, v: f32) {
+        self.0.extend_from_slice(&v.to_le_bytes());
+    }
+    fn f64(&mut self, v: f64) {
+        self.0.extend_from_slice(&v.to_le_bytes());
+    }
+    fn str(&mut self, s: &str) {
+        self.u32(s.len() as u32);
+        self.0.extend_from_slice(s.as_bytes());
+    }
+    fn f64s(&mut self, vs: &[f64]) {
+        self.u64(vs.len() as u64);
+        self.0.reserve(vs.len() * 8);
+        for v in vs {
+            self.0.extend_from_slice(&v.to_le_bytes());
+        }
+    }
+    fn f32s(&mut self, vs: &[f32]) {
+        self.u64(vs.len() as u64);
+        self.0.reserve(vs.len() * 4);
+        for v in vs {
+            self.0.extend_from_slice(&v.to_le_bytes());
+        }
+    }
+    fn u8s(&mut self, vs: &[u8]) {
+        self.u64(vs.len() as u64);
+        self.0.extend_from_slice(vs);
+    }
+}
+
+// ── Decoding ─────────────────────────────────────────────────────────────────
+
+pub fn decode(bytes: &[u8], fingerprint: u64, expected_event: &str, expected_session: &str) -> Result<SessionSnapshot, String> {
+    let mut r = Reader { buf: bytes, pos: 0 };
+    if r.take(MAGIC.len())? != MAGIC {
+        return Err("Not a session snapshot".to_string());
+    }
+    let version = r.u32()?;
+    if version != SNAPSHOT_VERSION {
+        return Err(format!("Snapshot version {version}, expected {SNAPSHOT_VERSION}"));
+    }
+    if r.u64()? != fingerprint {
+        return Err("Snapshot is stale".to_string());
+    }
+
+    let event_name = r.str()?;
+    let session = r.str()?;
+    // Distinct names can share a file name once slugged
+    if event_name != expected_event || session != expected_session {
+        return Err(format!("Snapshot is of {event_name} {session}"));
+    }
+    let duration_s = r.f64()?;
+    let n_drivers = r.u32()? as usize;
+
+    let mut drivers = Vec::with_capacity(n_drivers.min(256));
+    for _ in 0..n_drivers {
+        let driver_number = r.str()?;
+        let abbreviation = r.str()?;
+        let team = r.str()?;
+        let spline_x = Spline::from_parts(r.f64s()?, r.f64s()?, r.f64s()?, r.f64s()?, r.f64s()?)?;
+        let spline_y = Spline::from_parts(r.f64s()?, r.f64s()?, r.f64s()?, r.f64s()?, r.f64s()?)?;
+
+        let samples = SampleColumns {
+            times: r.f64s()?,
+            xs: r.f32s()?,
+            ys: r.f32s()?,
+            speeds: r.f32s()?,
+            throttles: r.f32s()?,
+            brakes: r.f32s()?,
+            gears: r.u8s()?,
+            drs: r.u8s()?,
+        };
+        let n = samples.len();
+        let lens = [samples.xs.len(), samples.ys.len(), samples.speeds.len(), samples.throttles.len(),
+                    samples.brakes.len(), samples.gears.len(), samples.drs.len()];
+        if lens.iter().any(|&l| l != n) {
+            return Err(format!("Ragged sample columns for driver {driver_number}"));
+        }
+
+        let n_laps = r.u32()? as usize;
+        let mut laps = Vec::with_capacity(n_laps.min(1024));
+        for _ in 0..n_laps {
+            laps.push(LapRecord {
+                lap_number: r.u32()?,
+                lap_start_time_s: r.f64()?,
+                position: r.u8()?,
+                compound: Compound::from_code(r.u8()?),
+                tyre_life: r.u8()?,
+            });
+        }
+
+        // Cheap to rebuild, so not stored
+        let lod = TelemetryLod::build(&samples);
+        drivers.push(DriverData {
+            driver_number,
+            abbreviation,
+            team,
+            spline_x,
+            spline_y,
+            samples,
+            lod,
+            laps,
+            playback_segment: AtomicUsize::new(0),
+            fastest_lap: OnceLock::new(),
+            lap_index: OnceLock::new(),
+            lap_calibration: OnceLock::new(),
+        });
+    }
+
+    let heatmap = r
+        .f32s()?
+        .chunks_exact(3)
+        .map(|c| HeatCell { x: c[0], y: c[1], speed_norm: c[2] })
+        .collect();
+
+    let center_line = r.f32s()?.chunks_exact(2).map(|c| [c[0], c[1]]).collect();
+    let track_layout = TrackLayout {
+        center_line,
+        x_min: r.f32()?,
+        x_max: r.f32()?,
+        y_min: r.f32()?,
+        y_max: r.f32()?,
+        duration_s: r.f64()?,
+        lap_distance_m: r.f32()?,
+    };
+
+    Ok(SessionSnapshot { event_name, session, duration_s, drivers, heatmap, track_layout })
+}
+
+struct Reader<'a> {
+    buf: &'a [u8],
+    pos: usize,
+}
+
+impl<'a> Reader<'a> {
+    fn take(&mut self, n: usize) -> Result<&'a [u8], String> {
+        let end = self.pos.checked_add(n).filter(|&e| e <= self.buf.len());
+        let end = end.ok_or_else(|| "Truncated snapshot".to_string())?;
+        let out = &self.buf[self.pos..end];
+        self.pos = end;
+        Ok(out)
+    }
+    fn array<const N: usize>(&mut self) -> Result<[u8; N], String> {
+        Ok(self.take(N)?.try_into().expect("take returns N bytes"))
+    }
+    fn u8(&mut self) -> Result<u8, String> {
+        Ok(self.take(1)?[0])
+    }
+    fn u32(&mut self) -> Result<u32, String> {
+        self.array().map(u32::from_le_bytes)
+    }
+    fn u64(&mut self) -> Result<u64, String> {
+        self.array().map(u64::from_le_bytes)
+    }
+    fn f32(&mut self) -> Result<f32, String> {
+        self.array().map(f32::from_le_bytes)
+    }
+    fn f64(&mut self) -> Result<f64, String> {
+        self.array().map(f64::from_le_bytes)
+    }
+    fn str(&mut self) -> Result<String, String> {
+        let n = self.u32()? as usize;
+        String::from_utf8(self.take(n)?.to_vec()).map_err(|e| format!("Bad string in snapshot: {e}"))
+    }
+    fn len_prefixed(&mut self, elem: usize) -> Result<&'a [u8], String> {
+        let n = usize::try_from(self.u64()?).map_err(|_| "Snapshot array too long".to_string())?;
+        let bytes = n.checked_mul(elem).ok_or_else(|| "Snapshot array too long".to_string())?;
+        self.take(bytes)
+    }
+    fn f64s(&mut self) -> Result<Vec<f64>, String> {
+        let raw = self.len_prefixed(8)?;
+        Ok(raw.chunks_exact(8).map(|c| f64::from_le_bytes(c.try_into().unwrap())).collect())
+    }
+    fn f32s(&mut self) -> Result<Vec<f32>, String> {
+        let raw = self.len_prefixed(4)?;
+        Ok(raw.chunks_exact(4).map(|c| f32::from_le_bytes(c.try_into().unwrap())).collect())
+    }
+    fn u8s(&mut self) -> Result<Vec<u8>, String> {
+        Ok(self.len_prefixed(1)?.to_vec())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::session::RawSample;
+    use crate::test_fixtures;
+
+    fn snapshot() -> SessionSnapshot {
+        let ts: Vec<f64> = (0..50).map(|i| i as f64 * 0.25).collect();
+        let xs: Vec<f64> = ts.iter().map(|t| (t * 0.7).sin() * 100.0).collect();
+        let ys: Vec<f64> = ts.iter().map(|t| t * 3.0).collect();
+        let mut samples = SampleColumns::default();
+        for i in 0..ts.len() {
+            samples.push(RawSample {
+                session_time: ts[i], x: xs[i] as f32, y: ys[i] as f32, speed: 200.0 + i as f32,
+                gear: (i % 8) as u8, throttle: 0.5, brake: 0.0, drs: 12,
+            });
+        }
+        let laps = vec![LapRecord { lap_number: 1, lap_start_time_s: 0.5, position: 7, compound: Compound::Soft, tyre_life: 3 }];
+        let mut driver = test_fixtures::driver("44", samples, laps);
+        driver.abbreviation = "HAM".to_string();
+        driver.team = "Ferrari".to_string();
+        SessionSnapshot {
+            event_name: "São Paulo Grand Prix".to_string(),
+            session: "R".to_string(),
+            duration_s: 12.25,
+            drivers: vec![driver],
+            heatmap: vec![HeatCell { x: 1.0, y: 2.0, speed_norm: 0.5 }],
+            track_layout: TrackLayout {
+                center_line: vec![[0.0, 1.0], [2.0, 3.0]],
+                x_min: -1.0, x_max: 1.0, y_min: -2.0, y_max: 2.0,
+                duration_s: 12.25, lap_distance_m: 4309.0,
+            },
+        }
+    }
+
+    #[test]
+    fn test_round_trip() {
+        let snap = snapshot();
+        let decoded = decode(&encode(7, &snap), 7, "São Paulo Grand Prix", "R").expect("decode");
+        assert_eq!(decoded.event_name, snap.event_name);
+        assert_eq!(decoded.duration_s, snap.duration_s);
+
+        let (a, b) = (&snap.drivers[0], &decoded.drivers[0]);
+        assert_eq!(b.abbreviation, "HAM");
+        assert_eq!(b.samples.times, a.samples.times);
+        assert_eq!(b.samples.speeds, a.samples.speeds);
+        assert_eq!(b.samples.gears, a.samples.gears);
+        assert_eq!(b.laps[0].compound, Compound::Soft);
+        for t in [0.0, 3.3, 7.77, 12.25] {
+            assert_eq!(a.spline_x.eval(t), b.spline_x.eval(t));
+            assert_eq!(a.spline_y.eval(t), b.spline_y.eval(t));
+        }
+        assert_eq!(decoded.heatmap[0].speed_norm, 0.5);
+        assert_eq!(decoded.track_layout.center_line, snap.track_layout.center_line);
+        assert_eq!(decoded.track_layout.lap_distance_m, 4309.0);
+    }
+
+    #[test]
+    fn test_rejects_stale_and_truncated() {
+        let bytes = encode(7, &snapshot());
+        let (event, session) = ("São Paulo Grand Prix", "R");
+        assert!(decode(&bytes, 8, event, session).is_err());
+        assert!(decode(&bytes[..bytes.len() - 1], 7, event, session).is_err());
+        assert!(decode(b"garbage", 7, event, session).is_err());
+        // Another event that slugs to the same file name
+        assert_eq!(snapshot_path("f1.duckdb", "S-o Paulo Grand Prix", "R"), snapshot_path("f1.duckdb", event, session));
+        assert!(decode(&bytes, 7, "S-o Paulo Grand Prix", session).is_err());
+        assert!(decode(&bytes, 7, event, "Q").is_err());
+    }
+
+    #[test]
+    fn test_write_then_read_mapped() {
+        let db = std::env::temp_dir().join(format!("f1-snapshot-test-{}.duckdb", std::process::id()));
+        let (db, event) = (db.to_str().unwrap(), "São Paulo Grand Prix");
+        let path = snapshot_path(db, event, "R");
+        write(&path, 7, &snapshot()).unwrap();
+        let read_back = read(&path, 7, event, "R").expect("mapped read");
+        assert_eq!(read_back.drivers[0].samples.times, snapshot().drivers[0].samples.times);
+        assert!(read(&path, 8, event, "R").is_none());
+        std::fs::remove_dir_all(path.parent().unwrap()).unwrap();
+    }
+
+    #[test]
+    fn test_snapshot_path_is_next_to_db() {
+        let p = snapshot_path("/data/f1.duckdb", "São Paulo Grand Prix", "R");
+        assert_eq!(p, Path::new("/data/f1.snapshots/S_o_Paulo_Grand_Prix__R.f1snap"));
+    }
+}
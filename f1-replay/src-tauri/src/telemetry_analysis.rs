@@ -1,28 +1,33 @@
 /// Distance-normalised telemetry analysis and Cd*A aero fitting.
-use crate::session::{DriverData, RawSample};
-use crate::types::{AeroFitResult, LapComparison, LapTelemetry, MiniSector};
+use crate::lap_index::{lap_index, LapIndex, MAX_LAP_S, MIN_LAP_S};
+use crate::resample::LinearPlan;
+use crate::session::DriverData;
+use crate::types::{AeroFitResult, LapComparison, LapDeltaMatrix, LapTelemetry, MiniSector};
+use rayon::prelude::*;
 
 // ── Constants ─────────────────────────────────────────────────────────────────
 
-const AIR_DENSITY: f64 = 1.225; // kg/m³ at sea level, 15 °C
-const SAMPLE_STEP: f32 = 10.0;  // metres between resampled points
+pub(crate) const AIR_DENSITY: f64 = 1.225; // kg/m³ at sea level, 15 °C
+pub(crate) const SAMPLE_STEP: f32 = 10.0;  // metres between resampled points
 const MINI_SECTOR_LEN: f32 = 25.0; // metres per mini-sector
-const CAR_MASS_KG: f64 = 798.0; // F1 car + driver minimum
+pub(crate) const CAR_MASS_KG: f64 = 798.0; // F1 car + driver minimum
 
 // ── Arc-length distance computation ──────────────────────────────────────────
 
 /// Compute cumulative arc-length distance (metres) for each raw sample.
-/// Returns a Vec the same length as `samples` with monotonically increasing
+/// Returns a Vec the same length as `xs`/`ys` with monotonically increasing
 /// distances starting at 0. Uses XY position deltas only.
-pub fn compute_distances(samples: &[RawSample]) -> Vec<f32> {
-    let mut dists = Vec::with_capacity(samples.len());
-    if samples.is_empty() {
+pub fn compute_distances(xs: &[f32], ys: &[f32]) -> Vec<f32> {
+    debug_assert_eq!(xs.len(), ys.len());
+    let n = xs.len().min(ys.len());
+    let mut dists = Vec::with_capacity(n);
+    if n == 0 {
         return dists;
     }
     dists.push(0.0_f32);
-    for i in 1..samples.len() {
-        let dx = samples[i].x - samples[i - 1].x;
-        let dy = samples[i].y - samples[i - 1].y;
+    for i in 1..n {
+        let dx = xs[i] - xs[i - 1];
+        let dy = ys[i] - ys[i - 1];
         let d = (dx * dx + dy * dy).sqrt();
         dists.push(dists[i - 1] + d);
     }
@@ -33,15 +38,15 @@ pub fn compute_distances(samples: &[RawSample]) -> Vec<f32> {
 
 /// Build a `LapTelemetry` for driver `d` on lap `lap_number`.
 ///
-/// We locate the raw samples that fall within the lap's time window
-/// [lap_start, next_lap_start), compute arc-length distances, then
-/// resample all channels onto a uniform `SAMPLE_STEP`-metre grid.
+/// The driver's `LapIndex` gives the raw samples within the lap's time
+/// window [lap_start, next_lap_start) and their arc-length distances; all
+/// channels are then resampled onto a uniform `SAMPLE_STEP`-metre grid.
 pub fn build_lap_telemetry(
     driver: &DriverData,
     lap_number: u32,
 ) -> Option<LapTelemetry> {
-    // Find the lap record
-    let lap_idx = driver.laps.iter().position(|l| l.lap_number == lap_number)?;
+    let index = lap_index(driver);
+    let lap_idx = LapIndex::lap_position(&driver.laps, lap_number)?;
     let lap = &driver.laps[lap_idx];
     let t_start = lap.lap_start_time_s;
 
@@ -53,78 +58,43 @@ pub fn build_lap_telemetry(
         .unwrap_or(f64::MAX);
 
     let lap_time = if t_end < f64::MAX { t_end - t_start } else { return None; };
-    if lap_time < 60.0 || lap_time > 200.0 {
+    if !(MIN_LAP_S..=MAX_LAP_S).contains(&lap_time) {
         // Implausible lap – skip (SC, inlap, outlap, etc.)
         return None;
     }
 
     // Slice samples belonging to this lap
-    let samples: Vec<&RawSample> = driver
-        .samples
-        .iter()
-        .filter(|s| s.session_time >= t_start && s.session_time < t_end)
-        .collect();
-
-    if samples.len() < 10 {
+    let cols = &driver.samples;
+    let range = index.lap_samples(lap_idx);
+    if range.len() < 10 {
         return None;
     }
+    let lap_speeds = &cols.speeds[range.clone()];
+    let lap_throttles = &cols.throttles[range.clone()];
+    let lap_brakes = &cols.brakes[range.clone()];
+    let lap_gears = &cols.gears[range.clone()];
+    let lap_drs = &cols.drs[range];
 
     // ── Arc-length on the slice ─────────────────────────────────────────────
-    let mut arc_dists: Vec<f32> = vec![0.0];
-    for i in 1..samples.len() {
-        let dx = samples[i].x - samples[i - 1].x;
-        let dy = samples[i].y - samples[i - 1].y;
-        arc_dists.push(arc_dists[i - 1] + (dx * dx + dy * dy).sqrt());
-    }
+    let arc_dists = index.lap_distances(lap_idx);
     let total_dist = *arc_dists.last().unwrap();
     if total_dist < 100.0 {
         return None;
     }
 
     // ── Resample onto uniform grid ──────────────────────────────────────────
+    // One forward walk over arc_dists places every grid point; each channel
+    // is then a straight gather over the plan.
     let n_steps = (total_dist / SAMPLE_STEP).ceil() as usize;
-    let mut distances = Vec::with_capacity(n_steps);
-    let mut speeds    = Vec::with_capacity(n_steps);
-    let mut throttles = Vec::with_capacity(n_steps);
-    let mut brakes    = Vec::with_capacity(n_steps);
-    let mut gears     = Vec::with_capacity(n_steps);
-    let mut drs_out   = Vec::with_capacity(n_steps);
-
-    let mut j = 0usize; // pointer into arc_dists / samples
-    for k in 0..n_steps {
-        let target_d = k as f32 * SAMPLE_STEP;
-        distances.push(target_d);
-
-        // Advance j until arc_dists[j+1] > target_d (or we reach end)
-        while j + 1 < arc_dists.len() - 1 && arc_dists[j + 1] <= target_d {
-            j += 1;
-        }
-
-        if j + 1 >= samples.len() {
-            // Clamp to last sample
-            let s = samples[samples.len() - 1];
-            speeds.push(s.speed);
-            throttles.push(s.throttle);
-            brakes.push(s.brake);
-            gears.push(s.gear);
-            drs_out.push(matches!(s.drs, 10 | 12 | 14));
-            continue;
-        }
+    let distances: Vec<f32> = (0..n_steps).map(|k| k as f32 * SAMPLE_STEP).collect();
+    let plan = LinearPlan::new(arc_dists, distances.iter().copied());
 
-        let d0 = arc_dists[j];
-        let d1 = arc_dists[j + 1];
-        let frac = if (d1 - d0).abs() < 1e-6 { 0.0_f32 } else { (target_d - d0) / (d1 - d0) };
-        let frac = frac.clamp(0.0, 1.0);
-        let s0 = samples[j];
-        let s1 = samples[j + 1];
-
-        speeds.push(s0.speed + (s1.speed - s0.speed) * frac);
-        throttles.push(s0.throttle + (s1.throttle - s0.throttle) * frac);
-        brakes.push(s0.brake + (s1.brake - s0.brake) * frac);
-        // Gear: nearest neighbour
-        gears.push(if frac < 0.5 { s0.gear } else { s1.gear });
-        drs_out.push(matches!(if frac < 0.5 { s0.drs } else { s1.drs }, 10 | 12 | 14));
-    }
+    let speeds = plan.lerp(lap_speeds);
+    let throttles = plan.lerp(lap_throttles);
+    let brakes = plan.lerp(lap_brakes);
+    // Gear and DRS: nearest neighbour
+    let gears = plan.nearest(lap_gears);
+    let drs_out = plan.nearest(lap_drs).into_iter().map(|d| matches!(d, 10 | 12 | 14)).collect();
 
     Some(LapTelemetry {
         driver_number: driver.driver_number.clone(),
@@ -155,6 +125,53 @@ pub fn fastest_lap_telemetry(driver: &DriverData) -> Option<LapTelemetry> {
     best
 }
 
+// ── Memoised fastest lap ──────────────────────────────────────────────────────
+
+/// A driver's fastest valid lap together with its integrated time axis,
+/// computed once per loaded session so comparisons are array math only.
+#[derive(Debug, Clone)]
+pub struct FastestLap {
+    pub telemetry: LapTelemetry,
+    /// Integrated time to reach each distance step, before scaling to the
+    /// lap time (see `time_scale`).
+    elapsed: Vec<f32>,
+}
+
+impl FastestLap {
+    pub fn heap_bytes(&self) -> usize {
+        let t = &self.telemetry;
+        (t.distances.len() + t.speeds.len() + t.throttles.len() + t.brakes.len() + self.elapsed.len()) * 4
+            + t.gears.len()
+            + t.drs.len()
+    }
+
+    /// Factor that makes the time at step `n - 1` the actual lap time.
+    fn time_scale(&self, n: usize) -> f32 {
+        self.telemetry.lap_time_s as f32 / self.elapsed[n - 1].max(1e-6)
+    }
+}
+
+/// The driver's memoised fastest lap; the first call builds it.
+pub fn fastest_lap(driver: &DriverData) -> Option<&FastestLap> {
+    driver
+        .fastest_lap
+        .get_or_init(|| {
+            fastest_lap_telemetry(driver).map(|telemetry| FastestLap { elapsed: integrate_time(&telemetry), telemetry })
+        })
+        .as_ref()
+}
+
+/// Running time delta (A − B) over the shorter of the two distance axes.
+fn running_delta(a: &FastestLap, b: &FastestLap) -> Vec<f32> {
+    let n = a.elapsed.len().min(b.elapsed.len());
+    let (scale_a, scale_b) = (a.time_scale(n), b.time_scale(n));
+    a.elapsed[..n]
+        .iter()
+        .zip(&b.elapsed[..n])
+        .map(|(ta, tb)| ta * scale_a - tb * scale_b)
+        .collect()
+}
+
 // ── Distance-normalised two-driver lap comparison ────────────────────────────
 
 /// Compare two drivers on their respective fastest valid laps.
@@ -164,21 +181,18 @@ pub fn compare_laps(
     driver_a: &DriverData,
     driver_b: &DriverData,
 ) -> Result<LapComparison, String> {
-    let lt_a = fastest_lap_telemetry(driver_a)
+    let fl_a = fastest_lap(driver_a)
         .ok_or_else(|| format!("No valid lap found for driver {}", driver_a.driver_number))?;
-    let lt_b = fastest_lap_telemetry(driver_b)
+    let fl_b = fastest_lap(driver_b)
         .ok_or_else(|| format!("No valid lap found for driver {}", driver_b.driver_number))?;
-
-    // Use the shorter distance axis as the reference
-    let n = lt_a.distances.len().min(lt_b.distances.len());
-    let distances: Vec<f32> = (0..n).map(|i| lt_a.distances[i]).collect();
-
-    // Build cumulative-time axis for each driver (time elapsed to reach each distance)
-    let time_a = build_time_axis(&lt_a, n);
-    let time_b = build_time_axis(&lt_b, n);
+    let (lt_a, lt_b) = (&fl_a.telemetry, &fl_b.telemetry);
 
     // Delta: positive means A is ahead in time at this point (A got here earlier)
-    let delta_time: Vec<f32> = (0..n).map(|i| time_a[i] - time_b[i]).collect();
+    let delta_time = running_delta(fl_a, fl_b);
+
+    // The shorter distance axis is the reference
+    let n = delta_time.len();
+    let distances = lt_a.distances[..n].to_vec();
 
     // Mini-sectors: every MINI_SECTOR_LEN metres
     let mini_sectors = build_mini_sectors(&distances, &delta_time);
@@ -205,22 +219,69 @@ pub fn compare_laps(
     })
 }
 
-/// Compute cumulative time (seconds) to reach each distance index.
-///
-/// We integrate speed (km/h → m/s) over distance steps.
-fn build_time_axis(lt: &LapTelemetry, n: usize) -> Vec<f32> {
-    let mut time = vec![0.0_f32; n];
-    for i in 1..n {
-        let avg_speed_ms = ((lt.speeds[i - 1] + lt.speeds[i]) / 2.0) / 3.6;
-        let dd = lt.distances[i] - lt.distances[i - 1];
-        let dt = if avg_speed_ms > 0.5 { dd / avg_speed_ms } else { 0.1 };
-        time[i] = time[i - 1] + dt;
+// ── All-pairs fastest-lap delta matrix ───────────────────────────────────────
+
+/// Fastest-lap and mini-sector deltas between every pair of drivers with a
+/// valid lap. Fastest laps are built (or fetched from the memo) in parallel,
+/// then each unordered pair is compared once and mirrored with the sign
+/// flipped.
+pub fn lap_delta_matrix(drivers: &[DriverData]) -> LapDeltaMatrix {
+    let laps: Vec<(&DriverData, &FastestLap)> = drivers
+        .par_iter()
+        .filter_map(|d| fastest_lap(d).map(|fl| (d, fl)))
+        .collect();
+    let n = laps.len();
+
+    let pairs: Vec<(usize, usize)> = (0..n).flat_map(|i| (i..n).map(move |j| (i, j))).collect();
+    let upper: Vec<Vec<f32>> = pairs
+        .par_iter()
+        .map(|&(i, j)| {
+            let delta = running_delta(laps[i].1, laps[j].1);
+            let distances = &laps[i].1.telemetry.distances[..delta.len()];
+            build_mini_sectors(distances, &delta).into_iter().map(|m| m.delta_s).collect()
+        })
+        .collect();
+
+    let mut mini_sector_deltas = vec![vec![Vec::new(); n]; n];
+    for (&(i, j), sectors) in pairs.iter().zip(upper) {
+        if i != j {
+            mini_sector_deltas[j][i] = sectors.iter().map(|d| -d).collect();
+        }
+        mini_sector_deltas[i][j] = sectors;
     }
-    // Scale so that time[n-1] matches the actual lap time
-    let scale = lt.lap_time_s as f32 / time[n - 1].max(1e-6);
-    for t in time.iter_mut() {
-        *t *= scale;
+
+    let lap_times: Vec<f64> = laps.iter().map(|(_, fl)| fl.telemetry.lap_time_s).collect();
+    let lap_time_delta = lap_times
+        .iter()
+        .map(|a| lap_times.iter().map(|b| a - b).collect())
+        .collect();
+
+    LapDeltaMatrix {
+        drivers: laps.iter().map(|(d, _)| d.driver_number.clone()).collect(),
+        lap_numbers: laps.iter().map(|(_, fl)| fl.telemetry.lap_number).collect(),
+        lap_times,
+        lap_time_delta,
+        mini_sector_len_m: MINI_SECTOR_LEN,
+        mini_sector_deltas,
     }
+}
+
+/// Cumulative time (seconds) to reach each distance index, unscaled.
+///
+/// We integrate speed (km/h → m/s) over distance steps.
+fn integrate_time(lt: &LapTelemetry) -> Vec<f32> {
+    // Per-step times are independent; only the running sum is sequential
+    let step_times = lt.speeds.windows(2).zip(lt.distances.windows(2)).map(|(v, d)| {
+        let avg_speed_ms = ((v[0] + v[1]) / 2.0) / 3.6;
+        if avg_speed_ms > 0.5 { (d[1] - d[0]) / avg_speed_ms } else { 0.1 }
+    });
+    let mut time = Vec::with_capacity(lt.distances.len());
+    time.push(0.0_f32);
+    let mut elapsed = 0.0_f32;
+    time.extend(step_times.map(|dt| {
+        elapsed += dt;
+        elapsed
+    }));
     time
 }
 
@@ -279,6 +340,7 @@ fn build_mini_sectors(
 ///   β = g * C_roll     →  C_roll = β / g
 pub fn fit_cda(driver: &DriverData) -> AeroFitResult {
     let samples = &driver.samples;
+    let (times, speeds, brakes) = (&samples.times, &samples.speeds, &samples.brakes);
     let n = samples.len();
     if n < 50 {
         return zero_fit(&driver.driver_number);
@@ -289,15 +351,13 @@ pub fn fit_cda(driver: &DriverData) -> AeroFitResult {
     let mut ys: Vec<f64> = Vec::new(); // -a  (m/s²)
 
     for i in 1..n {
-        let s0 = &samples[i - 1];
-        let s1 = &samples[i];
-        if s0.brake < 0.7 || s0.speed < 100.0 { continue; }
+        if brakes[i - 1] < 0.7 || speeds[i - 1] < 100.0 { continue; }
 
-        let dt = (s1.session_time - s0.session_time) as f64;
+        let dt = times[i] - times[i - 1];
         if dt < 1e-4 || dt > 0.5 { continue; }
 
-        let v0 = s0.speed as f64 / 3.6; // km/h → m/s
-        let v1 = s1.speed as f64 / 3.6;
+        let v0 = speeds[i - 1] as f64 / 3.6; // km/h → m/s
+        let v1 = speeds[i] as f64 / 3.6;
         let accel = (v1 - v0) / dt; // negative during braking
         if accel >= 0.0 { continue; } // filter out noise / throttle application
 
@@ -367,20 +427,43 @@ fn ols_linear(xs: &[f64], ys: &[f64]) -> (f64, f64, f64) {
 #[cfg(test)]
 mod tests {
     use super::*;
+    use crate::test_fixtures;
+    use crate::types::Compound;
 
-    fn make_sample(t: f64, x: f32, y: f32, speed: f32, brake: f32) -> RawSample {
-        RawSample { session_time: t, x, y, speed, gear: 5, throttle: 0.0, brake, drs: 0 }
+    /// Three laps of a 500 m radius circle at constant speed, 4 Hz.
+    fn circle_driver(number: &str, lap_time: f64) -> DriverData {
+        let samples = test_fixtures::circle_samples(500.0, lap_time, 3.0 * lap_time, 4.0, 0.0);
+        test_fixtures::driver(number, samples, test_fixtures::laps(4, lap_time, Compound::Soft))
+    }
+
+    #[test]
+    fn test_lap_delta_matrix_is_antisymmetric_and_matches_pairs() {
+        let drivers = vec![circle_driver("1", 90.0), circle_driver("4", 91.0), circle_driver("16", 92.5)];
+        let m = lap_delta_matrix(&drivers);
+        assert_eq!(m.drivers, vec!["1", "4", "16"]);
+        for i in 0..3 {
+            assert_eq!(m.lap_time_delta[i][i], 0.0);
+            assert!(m.mini_sector_deltas[i][i].iter().all(|&d| d == 0.0));
+            for j in 0..3 {
+                assert_eq!(m.lap_time_delta[i][j], -m.lap_time_delta[j][i]);
+                let (ij, ji) = (&m.mini_sector_deltas[i][j], &m.mini_sector_deltas[j][i]);
+                assert!(ij.iter().zip(ji).all(|(a, b)| *a == -*b));
+            }
+        }
+        assert!((m.lap_time_delta[0][2] + 2.5).abs() < 1e-6);
+
+        let pair = compare_laps(&drivers[0], &drivers[2]).unwrap();
+        let from_pair: Vec<f32> = pair.mini_sectors.iter().map(|ms| ms.delta_s).collect();
+        assert_eq!(m.mini_sector_deltas[0][2], from_pair);
+        // The faster driver gains steadily round the lap
+        assert!(pair.delta_time.iter().rev().nth(5).is_some_and(|&d| d < -2.4));
+        assert!(from_pair[from_pair.len() / 2] > from_pair[from_pair.len() - 2]);
     }
 
     #[test]
     fn test_compute_distances_straight() {
         // 3 samples 100 m apart in X
-        let samples = vec![
-            make_sample(0.0, 0.0, 0.0, 50.0, 0.0),
-            make_sample(1.0, 100.0, 0.0, 50.0, 0.0),
-            make_sample(2.0, 200.0, 0.0, 50.0, 0.0),
-        ];
-        let d = compute_distances(&samples);
+        let d = compute_distances(&[0.0, 100.0, 200.0], &[0.0, 0.0, 0.0]);
         assert_eq!(d.len(), 3);
         assert!((d[0] - 0.0).abs() < 1e-4);
         assert!((d[1] - 100.0).abs() < 1e-4);
@@ -389,17 +472,14 @@ mod tests {
 
     #[test]
     fn test_compute_distances_diagonal() {
-        let samples = vec![
-            make_sample(0.0, 0.0, 0.0, 50.0, 0.0),
-            make_sample(1.0, 3.0, 4.0, 50.0, 0.0), // 5 m hypotenuse
-        ];
-        let d = compute_distances(&samples);
+        // 5 m hypotenuse
+        let d = compute_distances(&[0.0, 3.0], &[0.0, 4.0]);
         assert!((d[1] - 5.0).abs() < 1e-3);
     }
 
     #[test]
     fn test_compute_distances_empty() {
-        assert_eq!(compute_distances(&[]).len(), 0);
+        assert_eq!(compute_distances(&[], &[]).len(), 0);
     }
 
     #[test]
@@ -437,7 +517,7 @@ mod tests {
     }
 
     #[test]
-    fn test_build_time_axis_scaling() {
+    fn test_time_axis_scaling() {
         // Constant 100 km/h = 27.78 m/s over 100 m → ~3.6 s
         let lt = LapTelemetry {
             driver_number: "1".to_string(),
@@ -450,7 +530,9 @@ mod tests {
             gears:     vec![5; 4],
             drs:       vec![false; 4],
         };
-        let ta = build_time_axis(&lt, 4);
+        let fl = FastestLap { elapsed: integrate_time(&lt), telemetry: lt };
+        let scale = fl.time_scale(4);
+        let ta: Vec<f32> = fl.elapsed.iter().map(|t| t * scale).collect();
         // Must be scaled: last element should equal lap_time_s
         assert!((ta[3] - 90.0_f32).abs() < 1e-3);
         // Monotonically increasing
@@ -0,0 +1,248 @@
+//! Multi-resolution (M4) pyramid over a driver's telemetry for the charts.
+//!
+//! A full race is tens of thousands of samples per driver, far more than a
+//! chart can draw. Each pyramid level splits the samples into fixed-size
+//! buckets and keeps, per bucket, the first and last sample plus the min and
+//! max of every charted channel. Drawing those points as a line is
+//! pixel-identical to drawing every sample as long as no bucket is wider
+//! than a pixel column, so a window is answered from the coarsest level that
+//! still gives that resolution.
+
+use crate::session::SampleColumns;
+use crate::types::DriverTelemetry;
+use std::ops::Range;
+
+/// Samples per bucket on the finest level; each coarser level doubles it.
+const BASE_BUCKET: usize = 8;
+
+/// Channels whose extremes every bucket keeps: speed, throttle, brake, gear.
+const CHANNELS: usize = 4;
+
+fn channel(s: &SampleColumns, c: usize, i: usize) -> f32 {
+    match c {
+        0 => s.speeds[i],
+        1 => s.throttles[i],
+        2 => s.brakes[i],
+        _ => s.gears[i] as f32,
+    }
+}
+
+#[derive(Clone, Copy)]
+struct Extremes {
+    first: u32,
+    last: u32,
+    min: [u32; CHANNELS],
+    max: [u32; CHANNELS],
+}
+
+impl Extremes {
+    fn of_range(s: &SampleColumns, range: Range<usize>) -> Self {
+        let i = range.start as u32;
+        let mut e = Extremes { first: i, last: i, min: [i; CHANNELS], max: [i; CHANNELS] };
+        for j in range.skip(1) {
+            e.last = j as u32;
+            for c in 0..CHANNELS {
+                let v = channel(s, c, j);
+                if v < channel(s, c, e.min[c] as usize) {
+                    e.min[c] = j as u32;
+                }
+                if v > channel(s, c, e.max[c] as usize) {
+                    e.max[c] = j as u32;
+                }
+            }
+        }
+        e
+    }
+
+    fn merge(s: &SampleColumns, a: &Extremes, b: &Extremes) -> Self {
+        let mut e = Extremes { first: a.first, last: b.last, min: a.min, max: a.max };
+        for c in 0..CHANNELS {
+            if channel(s, c, b.min[c] as usize) < channel(s, c, a.min[c] as usize) {
+                e.min[c] = b.min[c];
+            }
+            if channel(s, c, b.max[c] as usize) > channel(s, c, a.max[c] as usize) {
+                e.max[c] = b.max[c];
+            }
+        }
+        e
+    }
+
+    /// Append this bucket's sample indices in time order, without repeats.
+    fn push_indices(&self, out: &mut Vec<u32>) {
+        let mut picks = [0u32; 2 + 2 * CHANNELS];
+        picks[0] = self.first;
+        picks[1] = self.last;
+        picks[2..2 + CHANNELS].copy_from_slice(&self.min);
+        picks[2 + CHANNELS..].copy_from_slice(&self.max);
+        picks.sort_unstable();
+        let mut prev = None;
+        for i in picks {
+            if prev != Some(i) {
+                out.push(i);
+                prev = Some(i);
+            }
+        }
+    }
+}
+
+struct LodLevel {
+    bucket_len: usize,
+    /// Sorted indices into the driver's `SampleColumns`.
+    indices: Vec<u32>,
+}
+
+#[derive(Default)]
+pub struct TelemetryLod {
+    /// Finest first.
+    levels: Vec<LodLevel>,
+}
+
+impl TelemetryLod {
+    /// Build every level; each is merged from the one below, so the whole
+    /// pyramid costs one pass over the samples plus a shrinking tail.
+    pub fn build(s: &SampleColumns) -> Self {
+        let n = s.len();
+        let mut levels = Vec::new();
+        if n <= BASE_BUCKET {
+            return TelemetryLod { levels };
+        }
+
+        let mut buckets: Vec<Extremes> = (0..n)
+            .step_by(BASE_BUCKET)
+            .map(|start| Extremes::of_range(s, start..(start + BASE_BUCKET).min(n)))
+            .collect();
+        let mut bucket_len = BASE_BUCKET;
+        loop {
+            let mut indices = Vec::with_capacity(buckets.len() * 4);
+            for b in &buckets {
+                b.push_indices(&mut indices);
+            }
+            levels.push(LodLevel { bucket_len, indices });
+            if buckets.len() <= 1 {
+                break;
+            }
+            buckets = buckets
+                .chunks(2)
+                .map(|pair| match pair {
+                    [a, b] => Extremes::merge(s, a, b),
+                    [a] => *a,
+                    _ => unreachable!(),
+                })
+                .collect();
+            bucket_len *= 2;
+        }
+        TelemetryLod { levels }
+    }
+
+    pub fn heap_bytes(&self) -> usize {
+        self.levels.iter().map(|l| l.indices.len() * 4).sum()
+    }
+
+    /// Indices of the samples to draw for `range` over `pixel_width` columns,
+    /// or `None` when even the finest level would not thin the range out.
+    fn select(&self, range: Range<usize>, pixel_width: usize) -> Option<Vec<u32>> {
+        let needed = range.len().div_ceil(pixel_width.max(1));
+        let level = self.levels.iter().rev().find(|l| l.bucket_len <= needed.max(1))?;
+
+        // Buckets are aligned to the whole session, so the window's edge
+        // buckets are clipped; pin the exact endpoints so lines reach them.
+        let lo = level.indices.partition_point(|&i| (i as usize) < range.start);
+        let hi = level.indices.partition_point(|&i| (i as usize) < range.end);
+        let inner = &level.indices[lo..hi];
+        if inner.len() + 2 >= range.len() {
+            return None;
+        }
+
+        let first = range.start as u32;
+        let last = (range.end - 1) as u32;
+        let mut out = Vec::with_capacity(inner.len() + 2);
+        out.push(first);
+        out.extend(inner.iter().copied().filter(|&i| i != first && i != last));
+        out.push(last);
+        Some(out)
+    }
+}
+
+/// Telemetry for `t_start <= time <= t_end`, reduced to what fits in
+/// `pixel_width` columns when given. Every sample is returned without one.
+pub fn telemetry_window(
+    driver_number: String,
+    samples: &SampleColumns,
+    lod: &TelemetryLod,
+    t_start: f64,
+    t_end: f64,
+    pixel_width: Option<usize>,
+) -> DriverTelemetry {
+    let range = samples.range_inclusive(t_start, t_end);
+    match pixel_width.and_then(|w| lod.select(range.clone(), w)) {
+        Some(indices) => {
+            let gather = |col: &[f32]| indices.iter().map(|&i| col[i as usize]).collect();
+            DriverTelemetry {
+                driver_number,
+                times: indices.iter().map(|&i| samples.times[i as usize]).collect(),
+                speeds: gather(&samples.speeds),
+                gears: indices.iter().map(|&i| samples.gears[i as usize]).collect(),
+                throttles: gather(&samples.throttles),
+                brakes: gather(&samples.brakes),
+            }
+        }
+        None => DriverTelemetry {
+            driver_number,
+            times: samples.times[range.clone()].to_vec(),
+            speeds: samples.speeds[range.clone()].to_vec(),
+            gears: samples.gears[range.clone()].to_vec(),
+            throttles: samples.throttles[range.clone()].to_vec(),
+            brakes: samples.brakes[range].to_vec(),
+        },
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::session::RawSample;
+
+    fn samples(n: usize, speed: impl Fn(usize) -> f32) -> SampleColumns {
+        let mut s = SampleColumns::default();
+        for i in 0..n {
+            s.push(RawSample {
+                session_time: i as f64 * 0.25, x: 0.0, y: 0.0, speed: speed(i),
+                gear: 5, throttle: 1.0, brake: 0.0, drs: 0,
+            });
+        }
+        s
+    }
+
+    #[test]
+    fn test_window_respects_pixel_budget() {
+        let s = samples(40_000, |i| 200.0 + (i as f32 * 0.01).sin() * 100.0);
+        let lod = TelemetryLod::build(&s);
+        let out = telemetry_window("1".into(), &s, &lod, 0.0, 1e9, Some(800));
+        // Under two buckets per pixel, each contributing a handful of points
+        assert!(out.times.len() <= 2 * 800 * (2 + 2 * CHANNELS), "{}", out.times.len());
+        assert!(out.times.len() >= 800);
+        assert!(out.times.windows(2).all(|w| w[0] < w[1]));
+        assert_eq!(out.times.first(), s.times.first());
+        assert_eq!(out.times.last(), s.times.last());
+    }
+
+    #[test]
+    fn test_window_keeps_spikes() {
+        let s = samples(10_000, |i| if i == 6_123 { 5.0 } else if i == 777 { 400.0 } else { 250.0 });
+        let lod = TelemetryLod::build(&s);
+        let out = telemetry_window("1".into(), &s, &lod, 0.0, 1e9, Some(100));
+        assert!(out.speeds.len() < 1_000);
+        assert!(out.speeds.contains(&5.0));
+        assert!(out.speeds.contains(&400.0));
+    }
+
+    #[test]
+    fn test_narrow_window_is_raw() {
+        let s = samples(10_000, |i| i as f32);
+        let lod = TelemetryLod::build(&s);
+        let out = telemetry_window("1".into(), &s, &lod, 100.0, 110.0, Some(800));
+        assert_eq!(out.times.len(), 41);
+        let all = telemetry_window("1".into(), &s, &lod, 0.0, 1e9, None);
+        assert_eq!(all.times.len(), 10_000);
+    }
+}
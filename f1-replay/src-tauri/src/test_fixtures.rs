@@ -0,0 +1,80 @@
+//! Builders for the sessions unit tests run against, so a new field on
+//! `DriverData` or `SessionData` is added here once rather than in every
+//! test module.
+
+use crate::interpolate::Spline;
+use crate::session::{DriverData, LapRecord, SampleColumns, SessionData};
+use crate::telemetry_lod::TelemetryLod;
+use crate::types::{Compound, TrackLayout};
+use std::f64::consts::TAU;
+use std::sync::atomic::AtomicUsize;
+use std::sync::OnceLock;
+
+/// A driver over `samples`, with position splines built from them.
+pub fn driver(number: &str, samples: SampleColumns, laps: Vec<LapRecord>) -> DriverData {
+    let xs: Vec<f64> = samples.xs.iter().map(|&v| v as f64).collect();
+    let ys: Vec<f64> = samples.ys.iter().map(|&v| v as f64).collect();
+    DriverData {
+        driver_number: number.to_string(),
+        abbreviation: number.to_string(),
+        team: String::new(),
+        spline_x: Spline::new(&samples.times, &xs),
+        spline_y: Spline::new(&samples.times, &ys),
+        samples,
+        lod: TelemetryLod::default(),
+        laps,
+        playback_segment: AtomicUsize::new(0),
+        fastest_lap: OnceLock::new(),
+        lap_index: OnceLock::new(),
+        lap_calibration: OnceLock::new(),
+    }
+}
+
+/// A session of `drivers` lasting until the last sample of any of them.
+pub fn session(drivers: Vec<DriverData>) -> SessionData {
+    let duration_s = drivers.iter().filter_map(|d| d.samples.times.last().copied()).fold(0.0, f64::max);
+    SessionData {
+        event_name: "Monza".to_string(),
+        session: "R".to_string(),
+        duration_s,
+        drivers,
+        heatmap: Vec::new(),
+        track_layout: TrackLayout {
+            center_line: Vec::new(),
+            x_min: 0.0, x_max: 0.0, y_min: 0.0, y_max: 0.0,
+            duration_s, lap_distance_m: 0.0,
+        },
+        frame_cache: None,
+        race_analysis: OnceLock::new(),
+        track_index: OnceLock::new(),
+    }
+}
+
+/// Constant-speed laps of a circle around the origin, one every `lap_time`
+/// seconds, sampled at `hz` over `0..=duration_s`. `phase` is the angle at
+/// t = 0 as a fraction of a lap. Flat out in 7th, no brake or DRS.
+pub fn circle_samples(radius: f64, lap_time: f64, duration_s: f64, hz: f64, phase: f64) -> SampleColumns {
+    let speed_kmh = (TAU * radius / lap_time * 3.6) as f32;
+    let mut s = SampleColumns::default();
+    for i in 0..=(duration_s * hz).round() as usize {
+        let t = i as f64 / hz;
+        let angle = (t / lap_time + phase) * TAU;
+        s.times.push(t);
+        s.xs.push((radius * angle.cos()) as f32);
+        s.ys.push((radius * angle.sin()) as f32);
+        s.speeds.push(speed_kmh);
+        s.throttles.push(1.0);
+        s.brakes.push(0.0);
+        s.gears.push(7);
+        s.drs.push(0);
+    }
+    s
+}
+
+/// `count` laps starting every `lap_time` seconds from t = 0, in P1 on one
+/// set of `compound`.
+pub fn laps(count: u32, lap_time: f64, compound: Compound) -> Vec<LapRecord> {
+    (0..count)
+        .map(|k| LapRecord { lap_number: k + 1, lap_start_time_s: k as f64 * lap_time, position: 1, compound, tyre_life: 1 })
+        .collect()
+}
@@ -7,9 +7,86 @@ pub struct SessionInfo {
     pub year: Option<i64>,
 }
 
-#[derive(Debug, Clone, Serialize, Deserialize)]
+/// Tyre compound. Serialised as the upper-case names the timing data uses
+/// ("SOFT", "INTERMEDIATE", ...); anything unrecognised parses as `Unknown`.
+/// The discriminant is the `frame_wire` compound code.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq, Hash, Serialize, Deserialize)]
+#[serde(from = "String", into = "&'static str")]
+#[repr(u8)]
+pub enum Compound {
+    #[default]
+    Unknown = 0,
+    Soft = 1,
+    Medium = 2,
+    Hard = 3,
+    Intermediate = 4,
+    Wet = 5,
+}
+
+impl Compound {
+    pub const ALL: [Compound; 6] = [
+        Compound::Unknown, Compound::Soft, Compound::Medium,
+        Compound::Hard, Compound::Intermediate, Compound::Wet,
+    ];
+
+    pub fn parse(name: &str) -> Compound {
+        let name = name.trim();
+        if name.eq_ignore_ascii_case("INTER") {
+            return Compound::Intermediate;
+        }
+        Compound::ALL
+            .into_iter()
+            .find(|c| c.name().eq_ignore_ascii_case(name))
+            .unwrap_or_default()
+    }
+
+    pub fn name(self) -> &'static str {
+        match self {
+            Compound::Unknown => "UNKNOWN",
+            Compound::Soft => "SOFT",
+            Compound::Medium => "MEDIUM",
+            Compound::Hard => "HARD",
+            Compound::Intermediate => "INTERMEDIATE",
+            Compound::Wet => "WET",
+        }
+    }
+
+    pub fn code(self) -> u8 {
+        self as u8
+    }
+
+    /// Inverse of `code`; out-of-range codes are `Unknown`.
+    pub fn from_code(code: u8) -> Compound {
+        Compound::ALL.get(code as usize).copied().unwrap_or_default()
+    }
+}
+
+impl From<String> for Compound {
+    fn from(name: String) -> Self {
+        Compound::parse(&name)
+    }
+}
+
+impl From<Compound> for &'static str {
+    fn from(c: Compound) -> Self {
+        c.name()
+    }
+}
+
+impl std::fmt::Display for Compound {
+    fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
+        f.write_str(self.name())
+    }
+}
+
+/// Index of a driver in `SessionData::drivers`, which is also the order
+/// `get_driver_meta` returns them in. Frames carry this instead of the
+/// driver number so building one never touches a string.
+pub type DriverId = u16;
+
+#[derive(Debug, Clone, Copy, Serialize, Deserialize)]
 pub struct DriverFrame {
-    pub driver_number: String,
+    pub driver_id: DriverId,
     pub x: f32,
     pub y: f32,
     pub heading: f32,
@@ -19,12 +96,12 @@ pub struct DriverFrame {
     pub brake: f32,
     pub drs_active: bool,
     pub position: u8,
-    pub compound: String,
+    pub compound: Compound,
     pub tyre_life: u8,
     pub is_in_pit: bool,
 }
 
-#[derive(Debug, Clone, Serialize, Deserialize)]
+#[derive(Debug, Clone, Default, Serialize, Deserialize)]
 pub struct FrameData {
     pub time_s: f64,
     pub drivers: Vec<DriverFrame>,
@@ -37,6 +114,29 @@ pub struct HeatCell {
     pub speed_norm: f32,
 }
 
+#[derive(Debug, Clone, Copy, Default, PartialEq, Serialize, Deserialize)]
+#[serde(rename_all = "lowercase")]
+pub enum HeatChannel {
+    #[default]
+    Speed,
+    Throttle,
+    Brake,
+}
+
+/// Which samples a heatmap covers. Unset fields select everything; laps are
+/// inclusive on both ends.
+#[derive(Debug, Clone, Default, Serialize, Deserialize)]
+pub struct HeatmapFilter {
+    #[serde(default)]
+    pub drivers: Option<Vec<String>>,
+    #[serde(default)]
+    pub lap_start: Option<u32>,
+    #[serde(default)]
+    pub lap_end: Option<u32>,
+    #[serde(default)]
+    pub channel: HeatChannel,
+}
+
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct TrackLayout {
     pub center_line: Vec<[f32; 2]>,
@@ -48,6 +148,37 @@ pub struct TrackLayout {
     pub lap_distance_m: f32,
 }
 
+/// Where a driver is on the circuit at an instant; see `lap_index::field_at`.
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct TrackPosition {
+    pub driver_id: DriverId,
+    pub driver_number: String,
+    /// Running order by race distance
+    pub position: u8,
+    pub lap: u32,
+    /// Distance along the reference lap from the start line
+    pub lap_distance_m: f32,
+    /// Distance along the reference line since the start of lap 1
+    pub race_distance_m: f64,
+}
+
+/// Running gaps for the whole field on a shared time axis.
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct GapChart {
+    pub times: Vec<f64>,
+    /// Session driver order
+    pub drivers: Vec<DriverGaps>,
+}
+
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct DriverGaps {
+    pub driver_id: DriverId,
+    pub driver_number: String,
+    /// `None` where the driver has no data or the other car never got there
+    pub gap_to_leader_s: Vec<Option<f32>>,
+    pub interval_s: Vec<Option<f32>>,
+}
+
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct DriverTelemetry {
     pub driver_number: String,
@@ -60,6 +191,7 @@ pub struct DriverTelemetry {
 
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct DriverMeta {
+    pub driver_id: DriverId,
     pub driver_number: String,
     pub abbreviation: String,
     pub team: String,
@@ -107,6 +239,21 @@ pub struct LapComparison {
     pub mini_sectors: Vec<MiniSector>,
 }
 
+/// Fastest-lap deltas between every pair of drivers with a valid lap.
+/// Rows and columns follow `drivers`.
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct LapDeltaMatrix {
+    pub drivers: Vec<String>,
+    pub lap_numbers: Vec<u32>,
+    pub lap_times: Vec<f64>,
+    /// `lap_time_delta[i][j] = lap_times[i] - lap_times[j]`
+    pub lap_time_delta: Vec<Vec<f64>>,
+    pub mini_sector_len_m: f32,
+    /// `mini_sector_deltas[i][j][k]`: mean running delta of `i` against `j`
+    /// over mini-sector `k`, as `MiniSector::delta_s` with A = `i`
+    pub mini_sector_deltas: Vec<Vec<Vec<f32>>>,
+}
+
 /// 25-metre mini sector dominance
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct MiniSector {
@@ -170,6 +317,15 @@ pub struct RaceAnalysis {
     pub insights: Vec<RaceInsight>,
 }
 
+impl RaceAnalysis {
+    /// Rough heap footprint (row vectors only, not their strings).
+    pub fn heap_bytes(&self) -> usize {
+        self.drivers.len() * std::mem::size_of::<DriverAnalysis>()
+            + self.stints.len() * std::mem::size_of::<StintAnalysis>()
+            + self.insights.len() * std::mem::size_of::<RaceInsight>()
+    }
+}
+
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct DriverAnalysis {
     pub driver_number: String,
@@ -195,7 +351,7 @@ pub struct StintAnalysis {
     pub driver_number: String,
     pub start_lap: u32,
     pub end_lap: u32,
-    pub compound: String,
+    pub compound: Compound,
     pub laps: usize,
     pub avg_lap_s: Option<f64>,
     pub tyre_life_start: u8,
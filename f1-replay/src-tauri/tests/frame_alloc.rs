@@ -0,0 +1,54 @@
+//! Playback must not allocate per frame. Counting allocations needs a
+//! `#[global_allocator]`, which replaces the allocator for the whole test
+//! binary, so this lives in its own integration test rather than in the
+//! lib's unit tests.
+//!
+//!     cargo test --features bench --test frame_alloc
+
+use f1_replay_lib::bench::{get_frame_into, synthetic_session, Fixture, FrameData};
+use std::alloc::{GlobalAlloc, Layout, System};
+use std::cell::Cell;
+
+/// Counts the allocations made on each thread, so the test only sees its own.
+struct CountingAlloc;
+
+thread_local!(static ALLOCATIONS: Cell<usize> = const { Cell::new(0) });
+
+fn count_allocation() {
+    let _ = ALLOCATIONS.try_with(|n| n.set(n.get() + 1));
+}
+
+unsafe impl GlobalAlloc for CountingAlloc {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        count_allocation();
+        System.alloc(layout)
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        System.dealloc(ptr, layout)
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        count_allocation();
+        System.realloc(ptr, layout, new_size)
+    }
+}
+
+#[global_allocator]
+static COUNTING_ALLOC: CountingAlloc = CountingAlloc;
+
+#[test]
+fn test_playback_frames_do_not_allocate() {
+    let fx = Fixture { drivers: 3, samples_per_driver: 2_000, laps: 2 };
+    for hz in [Some(10.0), None] {
+        let session = synthetic_session(&fx, hz);
+        let mut frame = FrameData { time_s: 0.0, drivers: Vec::with_capacity(fx.drivers) };
+        let before = ALLOCATIONS.with(Cell::get);
+        for k in 0..600 {
+            get_frame_into(&session, k as f64 * 0.25, &mut frame);
+        }
+        assert_eq!(ALLOCATIONS.with(Cell::get), before, "frame cache at {hz:?} Hz");
+        let ids: Vec<_> = frame.drivers.iter().map(|d| d.driver_id).collect();
+        assert_eq!(ids, [0, 1, 2]);
+    }
+}
@@ -1,15 +1,26 @@
-import { invoke } from '@tauri-apps/api/core';
+import { Channel, invoke } from '@tauri-apps/api/core';
 
 // ── Types returned FROM Rust (Rust serializes with snake_case by default) ──────
 export interface SessionInfo   { event_name: string; session: string; year: number | null; }
-export interface DriverFrame   {
-  driver_number: string; x: number; y: number; heading: number;
+export type Compound = 'UNKNOWN' | 'SOFT' | 'MEDIUM' | 'HARD' | 'INTERMEDIATE' | 'WET';
+/** Frames identify drivers by `driver_id`, their index in `getDriverMeta()`. */
+export interface WireDriverFrame {
+  driver_id: number; x: number; y: number; heading: number;
   speed: number; gear: number; throttle: number; brake: number;
-  drs_active: boolean; position: number; compound: string;
+  drs_active: boolean; position: number; compound: Compound;
   tyre_life: number; is_in_pit: boolean;
 }
-export interface FrameData     { time_s: number; drivers: DriverFrame[]; }
+/** A frame with the driver number resolved through the session's meta. */
+export interface DriverFrame extends WireDriverFrame { driver_number: string; }
+export interface FrameData     { time_s: number; drivers: WireDriverFrame[]; }
 export interface HeatCell      { x: number; y: number; speed_norm: number; }
+export type HeatChannel = 'speed' | 'throttle' | 'brake';
+export interface HeatmapFilter {
+  drivers?: string[] | null;
+  lap_start?: number | null;
+  lap_end?: number | null;
+  channel?: HeatChannel;
+}
 export interface TrackLayout   {
   center_line: [number, number][];
   x_min: number; x_max: number; y_min: number; y_max: number;
@@ -19,7 +30,16 @@ export interface DriverTelemetry {
   driver_number: string; times: number[]; speeds: number[];
   gears: number[]; throttles: number[]; brakes: number[];
 }
-export interface DriverMeta    { driver_number: string; abbreviation: string; team: string; }
+export interface TrackPosition {
+  driver_id: number; driver_number: string; position: number;
+  lap: number; lap_distance_m: number; race_distance_m: number;
+}
+export interface DriverGaps {
+  driver_id: number; driver_number: string;
+  gap_to_leader_s: (number | null)[]; interval_s: (number | null)[];
+}
+export interface GapChart      { times: number[]; drivers: DriverGaps[]; }
+export interface DriverMeta    { driver_id: number; driver_number: string; abbreviation: string; team: string; }
 
 // ── Distance-normalised comparison types ──────────────────────────────────────
 export interface MiniSector {
@@ -49,6 +69,16 @@ export interface LapComparison {
   mini_sectors: MiniSector[];
 }
 
+// Rows and columns follow `drivers`; [i][j] is i against j
+export interface LapDeltaMatrix {
+  drivers: string[];
+  lap_numbers: number[];
+  lap_times: number[];
+  lap_time_delta: number[][];
+  mini_sector_len_m: number;
+  mini_sector_deltas: number[][][];
+}
+
 export interface AeroFitResult {
   driver_number: string;
   cda: number;
@@ -104,7 +134,7 @@ export interface StintAnalysis {
   driver_number: string;
   start_lap: number;
   end_lap: number;
-  compound: string;
+  compound: Compound;
   laps: number;
   avg_lap_s: number | null;
   tyre_life_start: number;
@@ -118,6 +148,172 @@ export interface RaceInsight {
   severity: number;
 }
 
+// Simulation inputs mirror the Rust types, which deserialise camelCase
+export interface SimulationScenario {
+  eventName: string;
+  session: string;
+  baseDriver: string;
+  swapCarWith: string | null;
+  swapDriverInputsWith: string | null;
+  carParams: {
+    enginePowerFactor: number;
+    aeroDownforceFactor: number;
+    aeroDragFactor: number;
+    tyreCompound: Compound | null;
+    tyreWearRate: number;
+    fuelLoadKg: number;
+  };
+  envParams: {
+    trackTempC: number;
+    airTempC: number;
+    windSpeedMs: number;
+    windDirectionDeg: number;
+    humidity: number;
+  };
+  numLaps: number | null;
+}
+export type SweepParam =
+  'enginePowerFactor' | 'aeroDownforceFactor' | 'aeroDragFactor' | 'tyreWearRate' | 'fuelLoadKg';
+export interface SweepAxis {
+  param: SweepParam;
+  min: number;
+  max: number;
+  steps: number;
+}
+// Row-major over `shape`, last axis fastest
+export interface SweepResult {
+  axes: { param: SweepParam; values: number[] }[];
+  shape: number[];
+  total_time_delta_s: number[];
+  fastest_lap_s: number[];
+}
+export interface MonteCarloConfig {
+  scenario: SimulationScenario;
+  iterations: number;
+  seed?: number;
+  pitWindow?: [number, number] | null;
+  compounds?: Compound[];
+  pitLossS?: number;
+  safetyCarProb?: number;
+  degradationNoise?: number;
+  lapNoiseS?: number;
+}
+export interface Distribution {
+  mean: number;
+  std_dev: number;
+  min: number;
+  p5: number;
+  p50: number;
+  p95: number;
+  max: number;
+  histogram_start: number;
+  histogram_bin_width: number;
+  histogram: number[];
+}
+export interface StrategyOutcome {
+  pit_lap: number | null;
+  compound: Compound;
+  runs: number;
+  mean_time_s: number;
+  mean_position: number;
+}
+export interface MonteCarloResult {
+  iterations: number;
+  num_laps: number;
+  field_size: number;
+  finish_time_s: Distribution;
+  position_probabilities: number[];
+  strategies: StrategyOutcome[];
+}
+
+// ── Live sessions (input types are camelCase, like SimulationScenario) ───────
+export interface LiveLap {
+  lapNumber: number;
+  lapStartTimeS: number;
+  position: number;
+  compound: Compound;
+  tyreLife: number;
+}
+export interface DriverChunk {
+  driverNumber: string;
+  abbreviation?: string;
+  team?: string;
+  times: number[];
+  xs: number[];
+  ys: number[];
+  speeds: number[];
+  throttles: number[];   // 0–1
+  brakes: number[];      // 0–1
+  gears: number[];
+  drs: number[];
+  laps?: LiveLap[];
+}
+export interface LiveChunk { drivers: DriverChunk[]; }
+export interface LiveStatus {
+  event_name: string;
+  session: string;
+  drivers: number;
+  samples: number;
+  chunks: number;
+  live_edge_s: number;
+  duration_s: number;
+  x_min: number;
+  x_max: number;
+  y_min: number;
+  y_max: number;
+}
+
+// ── Perf tracing ──────────────────────────────────────────────────────────────
+export interface SpanStats {
+  name: string;
+  count: number;
+  window: number;
+  last_ms: number;
+  mean_ms: number;
+  p50_ms: number;
+  p99_ms: number;
+  max_ms: number;
+}
+export interface PerfStats { spans: SpanStats[]; }
+
+// Batch results written by `sim_cli` (totals are NaN → null for failed runs)
+export interface ReplayLogRun {
+  scenario_index: number;
+  status: 'ok' | 'failed';
+  total_time_s: number | null;
+  total_delta_s: number | null;
+  fastest_lap_s: number | null;
+  avg_lap_s: number | null;
+  lap_count: number;
+  /** Result description, or the error of a failed run */
+  text: string;
+}
+
+export interface ReplayLogSummary {
+  blocks: number;
+  trailing_bytes: number;
+  runs: ReplayLogRun[];
+}
+
+export interface LoggedLap {
+  lap_number: number;
+  lap_time_s: number;
+  delta_to_baseline_s: number;
+  fuel_remaining_kg: number;
+  compound: Compound;
+  tyre_life: number;
+}
+
+export interface LoggedRun { run: ReplayLogRun; laps: LoggedLap[]; }
+
+export interface ReplayExportSummary {
+  path: string;
+  bytes: number;
+  frames: number;
+  drivers: number;
+  elapsed_ms: number;
+}
+
 // ── Tauri v2: snake_case Rust param names → camelCase in invoke() args ─────────
 
 export const getSessions       = () => invoke<SessionInfo[]>('get_sessions');
@@ -127,19 +323,73 @@ export const loadSessionCmd    = (eventName: string, session: string) =>
 
 export const getSpeedHeatmap   = () => invoke<HeatCell[]>('get_speed_heatmap');
 
+export const getHeatmap        = (filter: HeatmapFilter) =>
+  invoke<HeatCell[]>('get_heatmap', { filter });
+
 export const getFrame          = (timeS: number) =>
   invoke<FrameData>('get_frame', { timeS });
 
-export const getDriverTelemetry = (driverNumber: string, timeStart: number, timeEnd: number) =>
-  invoke<DriverTelemetry>('get_driver_telemetry', { driverNumber, timeStart, timeEnd });
+// Packed binary frames (decode with $lib/frameWire)
+export const getFramePacked    = (timeS: number) =>
+  invoke<ArrayBuffer>('get_frame_packed', { timeS });
+
+export const streamFrames      = (startS: number, speed: number, onFrame: Channel<ArrayBuffer>) =>
+  invoke<void>('stream_frames', { startS, speed, onFrame });
+
+export const stopFrameStream   = () => invoke<void>('stop_frame_stream');
+
+// Pass the chart's width in pixels to get a min/max-preserving reduction
+// instead of every sample in the window
+export const getDriverTelemetry = (driverNumber: string, timeStart: number, timeEnd: number, pixelWidth?: number) =>
+  invoke<DriverTelemetry>('get_driver_telemetry', { driverNumber, timeStart, timeEnd, pixelWidth });
 
 export const getDriverMeta     = () => invoke<DriverMeta[]>('get_driver_meta');
 
 export const compareLapsCmd    = (driverA: string, driverB: string) =>
   invoke<LapComparison>('compare_laps_cmd', { driverA, driverB });
 
+export const getLapDeltaMatrix = () => invoke<LapDeltaMatrix>('get_lap_delta_matrix');
+
 export const getAeroFitCmd     = (driverNumber: string) =>
   invoke<AeroFitResult>('get_aero_fit_cmd', { driverNumber });
 
 export const getRaceAnalysis   = () =>
   invoke<RaceAnalysis>('get_race_analysis');
+
+export const getTrackPositions = (timeS: number) =>
+  invoke<TrackPosition[]>('get_track_positions', { timeS });
+
+export const getGapChart       = (timeStart: number, timeEnd: number, points?: number) =>
+  invoke<GapChart>('get_gap_chart', { timeStart, timeEnd, points });
+
+export const runParameterSweep = (scenario: SimulationScenario, axes: SweepAxis[]) =>
+  invoke<SweepResult>('run_parameter_sweep', { request: { scenario, axes } });
+
+export const runMonteCarlo     = (config: MonteCarloConfig) =>
+  invoke<MonteCarloResult>('run_monte_carlo', { config });
+
+// While a live session is running, frames, the speed heatmap and driver meta
+// come from it; finishing publishes it as the loaded session
+export const startLiveSession  = (eventName: string, session: string) =>
+  invoke<void>('start_live_session', { eventName, session });
+
+export const ingestLiveChunk   = (chunk: LiveChunk) =>
+  invoke<LiveStatus>('ingest_live_chunk', { chunk });
+
+export const getLiveStatus     = () => invoke<LiveStatus | null>('get_live_status');
+
+export const finishLiveSession = () => invoke<TrackLayout>('finish_live_session');
+
+export const openReplayLog     = (path: string) =>
+  invoke<ReplayLogSummary>('open_replay_log', { path });
+
+export const getReplayLogRun   = (path: string, scenarioIndex: number) =>
+  invoke<LoggedRun>('get_replay_log_run', { path, scenarioIndex });
+
+export const exportReplay      = (path: string, hz?: number) =>
+  invoke<ReplayExportSummary>('export_replay', { path, hz });
+
+export const getPerfStats      = () => invoke<PerfStats>('get_perf_stats');
+
+// Chrome Trace Event JSON (open in chrome://tracing or ui.perfetto.dev)
+export const exportPerfTrace   = () => invoke<string>('export_perf_trace');
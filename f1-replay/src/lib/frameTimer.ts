@@ -0,0 +1,47 @@
+// Rolling record of per-frame UI work (frame decode, renderer updates and
+// the draw call; Svelte's DOM flush runs afterwards and is not included),
+// read by the perf overlay. Plain object, not a store: it is written every
+// frame and only sampled a couple of times per second.
+
+export const FRAME_BUDGET_MS = 1000 / 60;
+const WINDOW = 240;
+
+export interface FrameSummary {
+  p50: number;
+  p99: number;
+  max: number;
+  /** p50 as a fraction of FRAME_BUDGET_MS */
+  budgetUse: number;
+}
+
+export class FrameTimer {
+  private samples = new Float32Array(WINDOW);
+  private next = 0;
+  private filled = 0;
+  private pending = 0;
+
+  /** Time `fn` and add it to the current frame's work. */
+  measure<T>(fn: () => T): T {
+    const t0 = performance.now();
+    try {
+      return fn();
+    } finally {
+      this.pending += performance.now() - t0;
+    }
+  }
+
+  /** Close the current frame (once per requestAnimationFrame). */
+  endFrame(): void {
+    this.samples[this.next] = this.pending;
+    this.next = (this.next + 1) % WINDOW;
+    this.filled = Math.min(this.filled + 1, WINDOW);
+    this.pending = 0;
+  }
+
+  summary(): FrameSummary {
+    const sorted = Array.from(this.samples.subarray(0, this.filled)).sort((a, b) => a - b);
+    const pct = (p: number) => sorted.length ? sorted[Math.max(0, Math.ceil(p * sorted.length) - 1)] : 0;
+    const p50 = pct(0.5);
+    return { p50, p99: pct(0.99), max: sorted[sorted.length - 1] ?? 0, budgetUse: p50 / FRAME_BUDGET_MS };
+  }
+}
@@ -0,0 +1,56 @@
+import type { Compound, DriverFrame } from '$lib/commands';
+
+// ── Binary frame layout (mirror of src-tauri/src/frame_wire.rs) ───────────────
+//
+// header 16 B: f64 time_s | u32 driver_count | u32 record_bytes
+// record 32 B: f32 x, y, heading, speed, throttle, brake
+//              u8 gear, position, tyre_life, flags | u8 compound, 3 B pad
+// Record i is driver i of getDriverMeta().
+
+export const HEADER_BYTES = 16;
+export const FLAG_DRS = 1 << 0;
+export const FLAG_IN_PIT = 1 << 1;
+
+// Indexed by `Compound::code` (the enum discriminant) on the Rust side.
+export const WIRE_COMPOUNDS: Compound[] = ['UNKNOWN', 'SOFT', 'MEDIUM', 'HARD', 'INTERMEDIATE', 'WET'];
+
+export interface PackedFrame {
+  timeS: number;
+  drivers: DriverFrame[];
+}
+
+/** Decode a packed frame through typed-array views over `buf` (no byte copies). */
+export function decodeFrame(buf: ArrayBuffer, driverNumbers: string[]): PackedFrame {
+  const header = new DataView(buf, 0, HEADER_BYTES);
+  const timeS = header.getFloat64(0, true);
+  const count = header.getUint32(8, true);
+  const stride = header.getUint32(12, true);
+
+  const f32 = new Float32Array(buf, HEADER_BYTES, (count * stride) / 4);
+  const u8 = new Uint8Array(buf, HEADER_BYTES, count * stride);
+  const words = stride / 4;
+
+  const drivers: DriverFrame[] = new Array(count);
+  for (let i = 0; i < count; i++) {
+    const w = i * words;
+    const b = i * stride;
+    const flags = u8[b + 27];
+    drivers[i] = {
+      driver_id: i,
+      driver_number: driverNumbers[i] ?? String(i),
+      x: f32[w],
+      y: f32[w + 1],
+      heading: f32[w + 2],
+      speed: f32[w + 3],
+      throttle: f32[w + 4],
+      brake: f32[w + 5],
+      gear: u8[b + 24],
+      position: u8[b + 25],
+      tyre_life: u8[b + 26],
+      drs_active: (flags & FLAG_DRS) !== 0,
+      is_in_pit: (flags & FLAG_IN_PIT) !== 0,
+      compound: WIRE_COMPOUNDS[u8[b + 28]] ?? 'UNKNOWN',
+    };
+  }
+  return { timeS, drivers };
+}
@@ -1,5 +1,6 @@
 import type { DriverFrame, HeatCell } from '$lib/commands';
 import { TEAM_COLORS_HEX } from '$lib/constants';
+import { decodeFrame } from '$lib/frameWire';
 
 // ── Speed colour ramp (matches design spec) ──────────────────────────────────
 const SPEED_RAMP: [number, string][] = [
@@ -10,7 +11,7 @@ const SPEED_RAMP: [number, string][] = [
   [1.00, '#ff2200'],
 ];
 
-function speedColor(norm: number): string {
+export function speedColor(norm: number): string {
   for (let i = 0; i < SPEED_RAMP.length - 1; i++) {
     const [t0, c0] = SPEED_RAMP[i];
     const [t1, c1] = SPEED_RAMP[i + 1];
@@ -83,7 +84,8 @@ export class Canvas2DRenderer {
   private heatImageData: ImageData | null = null;
   private heatCacheScale = 0;
 
-  init(canvas: HTMLCanvasElement) {
+  // Labels are drawn on the main canvas, so a label overlay is not needed
+  init(canvas: HTMLCanvasElement, _labels?: HTMLCanvasElement) {
     this.canvas = canvas;
     this.ctx = canvas.getContext('2d')!;
     this.setupEvents();
@@ -143,6 +145,11 @@ export class Canvas2DRenderer {
     }
   }
 
+  /** Decode a packed frame; records follow the `setupDrivers` order. */
+  updatePacked(buf: ArrayBuffer) {
+    this.update(decodeFrame(buf, [...this.carStates.keys()]).drivers);
+  }
+
   update(frames: DriverFrame[]) {
     for (const f of frames) {
       const state = this.carStates.get(f.driver_number);
@@ -428,7 +435,7 @@ export class Canvas2DRenderer {
 
 // ── Utility ───────────────────────────────────────────────────────────────────
 
-function hexToRgb(hex: string): { r: number; g: number; b: number } | null {
+export function hexToRgb(hex: string): { r: number; g: number; b: number } | null {
   const m = /^#([0-9a-f]{2})([0-9a-f]{2})([0-9a-f]{2})$/i.exec(hex);
   if (!m) return null;
   return { r: parseInt(m[1], 16), g: parseInt(m[2], 16), b: parseInt(m[3], 16) };
@@ -0,0 +1,552 @@
+import * as THREE from 'three';
+import type { DriverFrame, HeatCell } from '$lib/commands';
+import { TEAM_COLORS_HEX } from '$lib/constants';
+import { FLAG_DRS, HEADER_BYTES } from '$lib/frameWire';
+import { SceneManager } from './SceneManager';
+import { hexToRgb, speedColor } from './Canvas2DRenderer';
+
+// GPU counterpart of Canvas2DRenderer with the same public surface. Every
+// layer is uploaded once and redrawn by the GPU on pan and zoom; per frame
+// only the car instances and one trail slot per car are rewritten.
+//
+//   heatmap  one point-sprite draw, sized in track units, max-blended
+//   track    static ribbon mesh, widths clamped in pixels by the shader
+//   trails   instanced segments read straight out of a ring buffer
+//   cars     one instanced quad per car
+//   labels   text on a 2D overlay canvas (optional)
+
+const TRAIL_LEN = 60;
+const BACKGROUND = 0x0f0f10;
+// Heatmap bin size in track units (heatmap::BIN_SIZE)
+const HEAT_CELL = 60;
+
+// ── Shaders ───────────────────────────────────────────────────────────────────
+
+const HEAT_VERT = /* glsl */`
+uniform vec2 origin;
+uniform float bufferPxPerUnit;
+attribute vec3 heatColor;
+varying vec3 vColor;
+void main() {
+  vColor = heatColor;
+  // Radius of HEAT_CELL track units, at least 3 px
+  gl_PointSize = max(6.0, 2.0 * ${HEAT_CELL.toFixed(1)} * bufferPxPerUnit);
+  gl_Position = projectionMatrix * modelViewMatrix * vec4(position.xy - origin, -3.0, 1.0);
+}`;
+
+const HEAT_FRAG = /* glsl */`
+varying vec3 vColor;
+void main() {
+  float d = length(gl_PointCoord - 0.5) * 2.0;
+  if (d > 1.0) discard;
+  // Linear falloff to the rim, as the Canvas2D bitmap
+  float a = (1.0 - d) * 0.78;
+  gl_FragColor = vec4(vColor * a, a);
+}`;
+
+const RIBBON_VERT = /* glsl */`
+uniform vec2 origin;
+uniform float pxToWorld;
+uniform float halfWidth;  // track units
+uniform float minHalfPx;
+uniform float extraPx;
+attribute vec2 miter;
+attribute float side;
+void main() {
+  float halfPx = max(minHalfPx, halfWidth / pxToWorld) + extraPx;
+  vec2 p = position.xy - origin + miter * side * halfPx * pxToWorld;
+  gl_Position = projectionMatrix * modelViewMatrix * vec4(p, -2.0, 1.0);
+}`;
+
+const FLAT_FRAG = /* glsl */`
+uniform vec4 color;
+void main() { gl_FragColor = color; }`;
+
+const TRAIL_VERT = /* glsl */`
+uniform vec2 origin;
+uniform float pxToWorld;
+uniform float head;
+uniform float filled;
+attribute vec2 segStart;
+attribute vec2 segEnd;
+attribute float slot;
+attribute vec3 teamColor;
+varying vec4 vColor;
+void main() {
+  float age = mod(head - slot + ${TRAIL_LEN.toFixed(1)}, ${TRAIL_LEN.toFixed(1)});
+  // The segment out of the newest slot wraps to the oldest; cars at the
+  // origin have no position yet
+  bool hidden = slot == head || age >= filled
+    || (segStart.x == 0.0 && segStart.y == 0.0) || (segEnd.x == 0.0 && segEnd.y == 0.0);
+
+  vec2 dir = segEnd - segStart;
+  float len = length(dir);
+  vec2 n = len > 0.0 ? vec2(-dir.y, dir.x) / len : vec2(0.0);
+  vec2 p = mix(segStart, segEnd, position.x) + n * position.y * 0.75 * pxToWorld;
+  gl_Position = hidden
+    ? vec4(2.0, 2.0, 2.0, 1.0)
+    : projectionMatrix * modelViewMatrix * vec4(p - origin, -1.0, 1.0);
+  vColor = vec4(teamColor, 0.33 * (1.0 - age / ${TRAIL_LEN.toFixed(1)}));
+}`;
+
+const TRAIL_FRAG = /* glsl */`
+varying vec4 vColor;
+void main() { gl_FragColor = vColor; }`;
+
+// Quad corners span ±1.8 dot radii, enough for the brake glow
+const CAR_VERT = /* glsl */`
+uniform vec2 origin;
+uniform float pxToWorld;
+uniform float dotPx;
+attribute vec2 offset;
+attribute vec3 teamColor;
+attribute vec4 state;  // brake, drs, focused, visible
+varying vec2 vLocal;
+varying vec3 vColor;
+varying vec4 vState;
+void main() {
+  vLocal = position.xy * 1.8;
+  vColor = teamColor;
+  vState = state;
+  vec2 p = offset - origin + vLocal * dotPx * pxToWorld;
+  gl_Position = state.w > 0.5
+    ? projectionMatrix * modelViewMatrix * vec4(p, 0.0, 1.0)
+    : vec4(2.0, 2.0, 2.0, 1.0);
+}`;
+
+const CAR_FRAG = /* glsl */`
+uniform float dotPx;
+varying vec2 vLocal;
+varying vec3 vColor;
+varying vec4 vState;
+
+// "over" in premultiplied alpha
+vec4 over(vec4 dst, vec3 rgb, float a) { return vec4(rgb * a + dst.rgb * (1.0 - a), a + dst.a * (1.0 - a)); }
+// Coverage of a ring of radius r (dot radii) and width w (pixels)
+float ring(float d, float r, float w) { return 1.0 - smoothstep(0.0, 1.0, abs(d - r) * dotPx - w * 0.5 + 0.5); }
+
+void main() {
+  float d = length(vLocal);
+  float aa = 1.0 / dotPx;
+  vec4 c = vec4(0.0);
+  if (vState.x > 0.3) c = over(c, vec3(0.86, 0.12, 0.0), vState.x * 0.25 * (1.0 - smoothstep(1.8 - aa, 1.8, d)));
+  if (vState.y > 0.5) c = over(c, vec3(0.0, 0.9, 0.7), 0.5 * ring(d, 1.5, 1.5));
+  if (vState.z > 0.5) c = over(c, vec3(1.0), 0.8 * ring(d, 1.7, 2.0));
+  c = over(c, vColor, 1.0 - smoothstep(1.0 - aa, 1.0, d));
+  c = over(c, vec3(1.0), 0.6 * ring(d, 1.0, 1.0));
+  if (c.a < 0.004) discard;
+  gl_FragColor = vec4(c.rgb / c.a, c.a);
+}`;
+
+// ── InstancedRenderer ─────────────────────────────────────────────────────────
+
+export class InstancedRenderer {
+  private sm = new SceneManager();
+  private labelCanvas: HTMLCanvasElement | null = null;
+  private labelCtx: CanvasRenderingContext2D | null = null;
+
+  private heat?: THREE.Points;
+  private track: THREE.Mesh[] = [];
+
+  // One entry per driver, in setupDrivers order (= frame record order)
+  private driverNumbers: string[] = [];
+  private index: Map<string, number> = new Map();
+  private abbrs: string[] = [];
+  private carColors: Float32Array = new Float32Array(0);
+  private positions: Uint8Array = new Uint8Array(0);
+  private brakes: Float32Array = new Float32Array(0);
+  private drs: Uint8Array = new Uint8Array(0);
+  private focused = -1;
+
+  private cars?: THREE.Mesh;
+  private carOffset!: THREE.InstancedBufferAttribute;
+  private carState!: THREE.InstancedBufferAttribute;
+  private carColor!: THREE.InstancedBufferAttribute;
+  /** Instance slot of each driver; refilled by position so P1 draws last. */
+  private drawOrder: number[] = [];
+
+  // Trail ring: slot-major [slot][driver] xy in track coordinates, with one
+  // extra slot mirroring slot 0 so segment ends never wrap in the buffer
+  private trails?: THREE.Mesh;
+  private ring: Float32Array = new Float32Array(0);
+  private ringBuffer?: THREE.InstancedInterleavedBuffer;
+  private head = TRAIL_LEN - 1;
+  private filled = 0;
+
+  private uniforms = {
+    origin:          { value: new THREE.Vector2() },
+    pxToWorld:       { value: 1 },
+    bufferPxPerUnit: { value: 1 },
+  };
+
+  init(canvas: HTMLCanvasElement, labels?: HTMLCanvasElement) {
+    this.sm.init(canvas, canvas.width, canvas.height, { bloom: false, background: BACKGROUND });
+    if (labels) {
+      this.labelCanvas = labels;
+      this.labelCtx = labels.getContext('2d');
+      this.sizeLabels(canvas.width, canvas.height);
+    }
+  }
+
+  setTrackBounds(xMin: number, xMax: number, yMin: number, yMax: number) {
+    // Shaders take raw track coordinates and subtract the track centre
+    this.uniforms.origin.value.set((xMin + xMax) / 2, (yMin + yMax) / 2);
+    this.sm.setTrackBounds(xMin, xMax, yMin, yMax);
+  }
+
+  resize(width: number, height: number) {
+    this.sm.resize(width, height);
+    this.sizeLabels(width, height);
+  }
+
+  // ── Static layers ──────────────────────────────────────────────────────────
+
+  setCenterLine(line: [number, number][]) {
+    for (const mesh of this.track) {
+      this.sm.scene.remove(mesh);
+      (mesh.material as THREE.Material).dispose();
+    }
+    this.track[0]?.geometry.dispose();
+    this.track = [];
+    if (line.length < 2) return;
+
+    const geo = buildRibbon(line);
+    // Same three strokes as Canvas2DRenderer.drawTrack, widest first
+    const strokes: [number, number, number, [number, number, number, number]][] = [
+      [7.5, 1.5, 2,  [1, 1, 1, 0.05]],
+      [7.5, 1.5, 0,  [40 / 255, 40 / 255, 45 / 255, 0.9]],
+      [0,   0.75, 0, [1, 1, 1, 0.12]],
+    ];
+    strokes.forEach(([halfWidth, minHalfPx, extraPx, [r, g, b, a]], i) => {
+      const mat = new THREE.ShaderMaterial({
+        vertexShader: RIBBON_VERT,
+        fragmentShader: FLAT_FRAG,
+        uniforms: {
+          ...this.uniforms,
+          halfWidth: { value: halfWidth },
+          minHalfPx: { value: minHalfPx },
+          extraPx:   { value: extraPx },
+          color:     { value: new THREE.Vector4(r, g, b, a) },
+        },
+        transparent: true,
+        depthTest: false,
+        depthWrite: false,
+        side: THREE.DoubleSide,
+      });
+      const mesh = new THREE.Mesh(geo, mat);
+      mesh.renderOrder = i;
+      mesh.frustumCulled = false;
+      this.track.push(mesh);
+      this.sm.scene.add(mesh);
+    });
+  }
+
+  setHeatmap(cells: HeatCell[]) {
+    if (this.heat) {
+      this.sm.scene.remove(this.heat);
+      this.heat.geometry.dispose();
+      (this.heat.material as THREE.Material).dispose();
+      this.heat = undefined;
+    }
+    if (cells.length === 0) return;
+
+    const pos = new Float32Array(cells.length * 3);
+    const col = new Float32Array(cells.length * 3);
+    cells.forEach((cell, i) => {
+      pos[i * 3] = cell.x;
+      pos[i * 3 + 1] = cell.y;
+      const rgb = hexToRgb(speedColor(cell.speed_norm)) ?? { r: 0, g: 0, b: 0 };
+      col[i * 3] = rgb.r / 255;
+      col[i * 3 + 1] = rgb.g / 255;
+      col[i * 3 + 2] = rgb.b / 255;
+    });
+    const geo = new THREE.BufferGeometry();
+    geo.setAttribute('position', new THREE.BufferAttribute(pos, 3));
+    geo.setAttribute('heatColor', new THREE.BufferAttribute(col, 3));
+
+    // Max blending keeps the strongest splat per pixel, like the Canvas2D
+    // bitmap; summing overlapping splats would wash dense areas to white
+    const mat = new THREE.ShaderMaterial({
+      vertexShader: HEAT_VERT,
+      fragmentShader: HEAT_FRAG,
+      uniforms: this.uniforms,
+      blending: THREE.CustomBlending,
+      blendEquation: THREE.MaxEquation,
+      depthTest: false,
+      depthWrite: false,
+    });
+    this.heat = new THREE.Points(geo, mat);
+    this.heat.renderOrder = -1;
+    this.heat.frustumCulled = false;
+    this.sm.scene.add(this.heat);
+  }
+
+  // ── Drivers ────────────────────────────────────────────────────────────────
+
+  setupDrivers(
+    driverNumbers: string[],
+    abbrMap: Record<string, string>,
+    teamMap: Record<string, string>
+  ) {
+    for (const mesh of [this.cars, this.trails]) {
+      if (!mesh) continue;
+      this.sm.scene.remove(mesh);
+      mesh.geometry.dispose();
+      (mesh.material as THREE.Material).dispose();
+    }
+
+    const n = driverNumbers.length;
+    this.driverNumbers = driverNumbers;
+    this.index = new Map(driverNumbers.map((num, i) => [num, i]));
+    this.abbrs = driverNumbers.map((num) => abbrMap[num] ?? num);
+    this.positions = new Uint8Array(n).fill(20);
+    this.brakes = new Float32Array(n);
+    this.drs = new Uint8Array(n);
+    this.drawOrder = driverNumbers.map((_, i) => i);
+    this.focused = -1;
+    const colors = new Float32Array(n * 3);
+    this.carColors = colors;
+    driverNumbers.forEach((num, i) => {
+      const rgb = hexToRgb(TEAM_COLORS_HEX[teamMap[num] ?? 'Unknown'] ?? '#888888')!;
+      colors[i * 3] = rgb.r / 255;
+      colors[i * 3 + 1] = rgb.g / 255;
+      colors[i * 3 + 2] = rgb.b / 255;
+    });
+
+    // Cars: instance slots are reassigned in draw order every frame
+    const carGeo = new THREE.InstancedBufferGeometry();
+    carGeo.setIndex([0, 1, 2, 0, 2, 3]);
+    carGeo.setAttribute('position', new THREE.BufferAttribute(new Float32Array([-1, -1, 0, 1, -1, 0, 1, 1, 0, -1, 1, 0]), 3));
+    this.carOffset = new THREE.InstancedBufferAttribute(new Float32Array(n * 2), 2).setUsage(THREE.DynamicDrawUsage);
+    this.carState = new THREE.InstancedBufferAttribute(new Float32Array(n * 4), 4).setUsage(THREE.DynamicDrawUsage);
+    this.carColor = new THREE.InstancedBufferAttribute(new Float32Array(n * 3), 3).setUsage(THREE.DynamicDrawUsage);
+    carGeo.setAttribute('offset', this.carOffset);
+    carGeo.setAttribute('state', this.carState);
+    carGeo.setAttribute('teamColor', this.carColor);
+    carGeo.instanceCount = n;
+    this.cars = this.overlayMesh(carGeo, CAR_VERT, CAR_FRAG, { dotPx: { value: 6 } }, 4);
+
+    // Trails: one instance per (slot, driver) segment
+    this.ring = new Float32Array((TRAIL_LEN + 1) * n * 2);
+    this.head = TRAIL_LEN - 1;
+    this.filled = 0;
+    this.ringBuffer = new THREE.InstancedInterleavedBuffer(this.ring, 2).setUsage(THREE.DynamicDrawUsage);
+    const slots = new Float32Array(TRAIL_LEN * n);
+    const trailColors = new Float32Array(TRAIL_LEN * n * 3);
+    for (let s = 0; s < TRAIL_LEN; s++) {
+      for (let i = 0; i < n; i++) {
+        slots[s * n + i] = s;
+        trailColors.set(colors.subarray(i * 3, i * 3 + 3), (s * n + i) * 3);
+      }
+    }
+    const trailGeo = new THREE.InstancedBufferGeometry();
+    trailGeo.setIndex([0, 1, 2, 0, 2, 3]);
+    // x: along the segment, y: across it
+    trailGeo.setAttribute('position', new THREE.BufferAttribute(new Float32Array([0, -1, 0, 1, -1, 0, 1, 1, 0, 0, 1, 0]), 3));
+    trailGeo.setAttribute('segStart', new THREE.InterleavedBufferAttribute(this.ringBuffer, 2, 0));
+    trailGeo.setAttribute('segEnd', new THREE.InterleavedBufferAttribute(this.ringBuffer, 2, n * 2));
+    trailGeo.setAttribute('slot', new THREE.InstancedBufferAttribute(slots, 1));
+    trailGeo.setAttribute('teamColor', new THREE.InstancedBufferAttribute(trailColors, 3));
+    trailGeo.instanceCount = TRAIL_LEN * n;
+    this.trails = this.overlayMesh(trailGeo, TRAIL_VERT, TRAIL_FRAG, {
+      head:   { value: this.head },
+      filled: { value: 0 },
+    }, 3);
+  }
+
+  private overlayMesh(
+    geo: THREE.BufferGeometry,
+    vertexShader: string,
+    fragmentShader: string,
+    extra: Record<string, THREE.IUniform>,
+    renderOrder: number
+  ): THREE.Mesh {
+    const mat = new THREE.ShaderMaterial({
+      vertexShader,
+      fragmentShader,
+      uniforms: { ...this.uniforms, ...extra },
+      transparent: true,
+      depthTest: false,
+      depthWrite: false,
+      side: THREE.DoubleSide,
+    });
+    const mesh = new THREE.Mesh(geo, mat);
+    mesh.renderOrder = renderOrder;
+    mesh.frustumCulled = false;
+    this.sm.scene.add(mesh);
+    return mesh;
+  }
+
+  /** Consume a packed frame (frameWire layout) without decoding it. */
+  updatePacked(buf: ArrayBuffer) {
+    const header = new DataView(buf, 0, HEADER_BYTES);
+    const count = Math.min(header.getUint32(8, true), this.driverNumbers.length);
+    const stride = header.getUint32(12, true);
+    const f32 = new Float32Array(buf, HEADER_BYTES, (count * stride) / 4);
+    const u8 = new Uint8Array(buf, HEADER_BYTES, count * stride);
+    const words = stride / 4;
+
+    this.beginFrame();
+    for (let i = 0; i < count; i++) {
+      const w = i * words;
+      const b = i * stride;
+      this.setCar(i, f32[w], f32[w + 1], f32[w + 5], (u8[b + 27] & FLAG_DRS) !== 0, u8[b + 25]);
+    }
+    this.endFrame();
+  }
+
+  update(frames: DriverFrame[]) {
+    this.beginFrame();
+    for (const f of frames) {
+      const i = this.index.get(f.driver_number);
+      if (i !== undefined) this.setCar(i, f.x, f.y, f.brake, f.drs_active, f.position);
+    }
+    this.endFrame();
+  }
+
+  private beginFrame() {
+    // Cars missing from a frame hold their last position
+    const n2 = this.driverNumbers.length * 2;
+    const prev = this.head;
+    this.head = (this.head + 1) % TRAIL_LEN;
+    this.ring.copyWithin(this.head * n2, prev * n2, prev * n2 + n2);
+  }
+
+  private setCar(i: number, x: number, y: number, brake: number, drs: boolean, position: number) {
+    const n = this.driverNumbers.length;
+    const r = (this.head * n + i) * 2;
+    this.ring[r] = x;
+    this.ring[r + 1] = y;
+    this.positions[i] = position;
+    this.brakes[i] = brake;
+    this.drs[i] = drs ? 1 : 0;
+  }
+
+  private endFrame() {
+    if (!this.cars || !this.ringBuffer) return;
+    const n = this.driverNumbers.length;
+    this.filled = Math.min(this.filled + 1, TRAIL_LEN);
+    if (this.head === 0) this.ring.copyWithin(TRAIL_LEN * n * 2, 0, n * 2);
+
+    // Upload only this frame's ring slot (and its mirror)
+    this.ringBuffer.clearUpdateRanges();
+    this.ringBuffer.addUpdateRange(this.head * n * 2, n * 2);
+    if (this.head === 0) this.ringBuffer.addUpdateRange(TRAIL_LEN * n * 2, n * 2);
+    this.ringBuffer.needsUpdate = true;
+    const trailUniforms = (this.trails!.material as THREE.ShaderMaterial).uniforms;
+    trailUniforms.head.value = this.head;
+    trailUniforms.filled.value = this.filled;
+
+    // Draw back to front by position so P1 ends up on top
+    this.drawOrder.sort((a, b) => this.positions[b] - this.positions[a]);
+    const offset = this.carOffset.array as Float32Array;
+    const state = this.carState.array as Float32Array;
+    const color = this.carColor.array as Float32Array;
+    this.drawOrder.forEach((driver, slot) => {
+      const r = (this.head * n + driver) * 2;
+      const x = this.ring[r];
+      const y = this.ring[r + 1];
+      offset[slot * 2] = x;
+      offset[slot * 2 + 1] = y;
+      color.set(this.carColors.subarray(driver * 3, driver * 3 + 3), slot * 3);
+      state[slot * 4] = this.brakes[driver];
+      state[slot * 4 + 1] = this.drs[driver];
+      state[slot * 4 + 2] = driver === this.focused ? 1 : 0;
+      state[slot * 4 + 3] = x !== 0 || y !== 0 ? 1 : 0;
+    });
+    this.carOffset.needsUpdate = true;
+    this.carState.needsUpdate = true;
+    this.carColor.needsUpdate = true;
+  }
+
+  setFocus(driverNumber: string | null) {
+    this.focused = driverNumber === null ? -1 : (this.index.get(driverNumber) ?? -1);
+  }
+
+  render() {
+    const ppu = this.sm.pixelsPerUnit();
+    this.uniforms.pxToWorld.value = 1 / ppu;
+    this.uniforms.bufferPxPerUnit.value = ppu * this.sm.renderer.getPixelRatio();
+    const dotPx = Math.max(4, Math.min(12, ppu * 8));
+    if (this.cars) (this.cars.material as THREE.ShaderMaterial).uniforms.dotPx.value = dotPx;
+    this.sm.render();
+    this.drawLabels(dotPx);
+  }
+
+  // ── Labels ─────────────────────────────────────────────────────────────────
+
+  private sizeLabels(width: number, height: number) {
+    if (!this.labelCanvas) return;
+    this.labelCanvas.width = width;
+    this.labelCanvas.height = height;
+  }
+
+  private drawLabels(dotPx: number) {
+    const ctx = this.labelCtx;
+    if (!ctx || !this.labelCanvas) return;
+    ctx.clearRect(0, 0, this.labelCanvas.width, this.labelCanvas.height);
+    if (!this.cars) return;
+
+    const fontSize = Math.max(8, Math.min(14, dotPx * 1.1));
+    ctx.font = `bold ${fontSize}px "JetBrains Mono", monospace`;
+    ctx.textAlign = 'center';
+    ctx.textBaseline = 'middle';
+    const n = this.driverNumbers.length;
+    for (const driver of this.drawOrder) {
+      const isFocused = driver === this.focused;
+      if (this.sm.zoomLevel <= 0.5 && !isFocused) continue;
+      const r = (this.head * n + driver) * 2;
+      const x = this.ring[r];
+      const y = this.ring[r + 1];
+      if (x === 0 && y === 0) continue;
+      const [sx, sy] = this.sm.toScreen(x, y);
+      ctx.fillStyle = 'rgba(0,0,0,0.8)';
+      ctx.fillText(this.abbrs[driver], sx + 1, sy + dotPx + fontSize + 1);
+      ctx.fillStyle = '#ffffff';
+      ctx.fillText(this.abbrs[driver], sx, sy + dotPx + fontSize);
+    }
+  }
+}
+
+// ── Geometry ──────────────────────────────────────────────────────────────────
+
+/** Two vertices per centerline point, offset along the miter normal by the shader. */
+function buildRibbon(line: [number, number][]): THREE.BufferGeometry {
+  // Close the loop if the ends meet, matching Canvas2DRenderer.drawTrack
+  const first = line[0];
+  const last = line[line.length - 1];
+  const closed = Math.hypot(first[0] - last[0], first[1] - last[1]) < 500;
+  const pts = closed ? [...line, first] : line;
+  const n = pts.length;
+
+  const pos = new Float32Array(n * 2 * 3);
+  const nrm = new Float32Array(n * 2 * 2);
+  const side = new Float32Array(n * 2);
+  for (let i = 0; i < n; i++) {
+    const prev = pts[i > 0 ? i - 1 : closed ? n - 2 : 0];
+    const next = pts[i < n - 1 ? i + 1 : closed ? 1 : n - 1];
+    const dx = next[0] - prev[0];
+    const dy = next[1] - prev[1];
+    const len = Math.hypot(dx, dy) || 1;
+    for (let k = 0; k < 2; k++) {
+      const v = i * 2 + k;
+      pos[v * 3] = pts[i][0];
+      pos[v * 3 + 1] = pts[i][1];
+      nrm[v * 2] = -dy / len;
+      nrm[v * 2 + 1] = dx / len;
+      side[v] = k === 0 ? -1 : 1;
+    }
+  }
+  const index: number[] = [];
+  for (let i = 0; i < n - 1; i++) {
+    const a = i * 2;
+    index.push(a, a + 1, a + 2, a + 1, a + 3, a + 2);
+  }
+
+  const geo = new THREE.BufferGeometry();
+  geo.setAttribute('position', new THREE.BufferAttribute(pos, 3));
+  geo.setAttribute('miter', new THREE.BufferAttribute(nrm, 2));
+  geo.setAttribute('side', new THREE.BufferAttribute(side, 1));
+  geo.setIndex(index);
+  return geo;
+}
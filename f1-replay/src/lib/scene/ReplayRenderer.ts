@@ -0,0 +1,24 @@
+import type { DriverFrame, HeatCell } from '$lib/commands';
+import { Canvas2DRenderer } from './Canvas2DRenderer';
+import { InstancedRenderer } from './InstancedRenderer';
+
+/** What the replay view needs from a track renderer. */
+export interface ReplayRenderer {
+  init(canvas: HTMLCanvasElement, labels?: HTMLCanvasElement): void;
+  setTrackBounds(xMin: number, xMax: number, yMin: number, yMax: number): void;
+  resize(width: number, height: number): void;
+  setCenterLine(line: [number, number][]): void;
+  setHeatmap(cells: HeatCell[]): void;
+  setupDrivers(driverNumbers: string[], abbrMap: Record<string, string>, teamMap: Record<string, string>): void;
+  /** A packed frame straight off the wire (see `$lib/frameWire`). */
+  updatePacked(buf: ArrayBuffer): void;
+  update(frames: DriverFrame[]): void;
+  setFocus(driverNumber: string | null): void;
+  render(): void;
+}
+
+/** The WebGL2 renderer where available, Canvas 2D otherwise. */
+export function createRenderer(): ReplayRenderer {
+  const probe = document.createElement('canvas');
+  return probe.getContext('webgl2') ? new InstancedRenderer() : new Canvas2DRenderer();
+}
@@ -4,12 +4,18 @@ import { RenderPass } from 'three/addons/postprocessing/RenderPass.js';
 import { UnrealBloomPass } from 'three/addons/postprocessing/UnrealBloomPass.js';
 import { OutputPass } from 'three/addons/postprocessing/OutputPass.js';
 
+export interface SceneOptions {
+  /** Bloom post-processing; off renders straight to the canvas. Default on. */
+  bloom?: boolean;
+  background?: number;
+}
+
 export class SceneManager {
   renderer!: THREE.WebGLRenderer;
   scene!: THREE.Scene;
   camera!: THREE.OrthographicCamera;
-  composer!: EffectComposer;
-  bloomPass!: UnrealBloomPass;
+  composer?: EffectComposer;
+  bloomPass?: UnrealBloomPass;
 
   private width = 1;
   private height = 1;
@@ -27,21 +33,26 @@ export class SceneManager {
   private targetCamY = 0;
   private zoom = 1;
 
-  init(canvas: HTMLCanvasElement, containerW?: number, containerH?: number) {
+  init(canvas: HTMLCanvasElement, containerW?: number, containerH?: number, options: SceneOptions = {}) {
     this.width  = containerW ?? (canvas.clientWidth  || 1200);
     this.height = containerH ?? (canvas.clientHeight || 800);
+    const bloom = options.bloom ?? true;
 
     this.renderer = new THREE.WebGLRenderer({ canvas, antialias: true });
     this.renderer.setPixelRatio(Math.min(window.devicePixelRatio, 2));
     this.renderer.setSize(this.width, this.height);
-    this.renderer.toneMapping = THREE.ACESFilmicToneMapping;
-    this.renderer.toneMappingExposure = 1.0;
+    if (bloom) {
+      this.renderer.toneMapping = THREE.ACESFilmicToneMapping;
+      this.renderer.toneMappingExposure = 1.0;
+    }
     this.renderer.outputColorSpace = THREE.SRGBColorSpace;
 
     this.scene = new THREE.Scene();
-    this.scene.background = new THREE.Color(0x03010a);
+    this.scene.background = new THREE.Color(options.background ?? 0x03010a);
 
     this.camera = this.makeOrthoCamera();
+    this.setupMouseControls(canvas);
+    if (!bloom) return;
 
     this.composer = new EffectComposer(this.renderer);
     this.composer.addPass(new RenderPass(this.scene, this.camera));
@@ -54,8 +65,6 @@ export class SceneManager {
     );
     this.composer.addPass(this.bloomPass);
     this.composer.addPass(new OutputPass());
-
-    this.setupMouseControls(canvas);
   }
 
   private makeOrthoCamera(): THREE.OrthographicCamera {
@@ -121,8 +130,16 @@ export class SceneManager {
 
     canvas.addEventListener('wheel', (e) => {
       e.preventDefault();
-      this.zoom *= e.deltaY < 0 ? 1.1 : 0.9;
-      this.zoom = Math.max(0.3, Math.min(10, this.zoom));
+      // Zoom toward the cursor: keep the world point under it fixed
+      const rect = canvas.getBoundingClientRect();
+      const scale = (this.baseViewH / this.zoom) / this.height;
+      const wx = this.camera.left + (e.clientX - rect.left) * scale;
+      const wy = this.camera.top - (e.clientY - rect.top) * scale;
+      const next = Math.max(0.3, Math.min(10, this.zoom * (e.deltaY < 0 ? 1.1 : 0.9)));
+      const k = this.zoom / next;
+      this.targetCamX = wx + (this.targetCamX - wx) * k;
+      this.targetCamY = wy + (this.targetCamY - wy) * k;
+      this.zoom = next;
       this.updateCamera();
     }, { passive: false });
   }
@@ -131,11 +148,29 @@ export class SceneManager {
     this.width = width;
     this.height = height;
     this.renderer.setSize(width, height);
-    this.composer.setSize(width, height);
-    this.bloomPass.setSize(width, height);
+    this.composer?.setSize(width, height);
+    this.bloomPass?.setSize(width, height);
     this.updateCamera();
   }
 
+  get zoomLevel(): number {
+    return this.zoom;
+  }
+
+  /** CSS pixels per track unit at the current zoom. */
+  pixelsPerUnit(): number {
+    return this.height / (this.baseViewH / this.zoom);
+  }
+
+  /** Position of a track coordinate in CSS pixels from the canvas top-left. */
+  toScreen(trackX: number, trackY: number): [number, number] {
+    const s = this.pixelsPerUnit();
+    return [
+      (this.worldX(trackX) - this.camera.left) * s,
+      (this.camera.top - this.worldY(trackY)) * s,
+    ];
+  }
+
   /** Convert track X coordinate to world (scene) X. */
   worldX(trackX: number): number {
     return trackX - this.trackCX;
@@ -147,6 +182,7 @@ export class SceneManager {
   }
 
   render() {
-    this.composer.render();
+    if (this.composer) this.composer.render();
+    else this.renderer.render(this.scene, this.camera);
   }
 }
@@ -1,17 +1,27 @@
 from __future__ import annotations
 
 import argparse
+import os
+import re
+import shutil
 from collections import defaultdict
+from concurrent.futures import FIRST_COMPLETED, Future, ProcessPoolExecutor, wait
+from pathlib import Path
 from typing import Literal
 
 import duckdb
 import fastf1
 import pandas as pd
+import pyarrow as pa
 
 YEAR: int = 2025
 GP_ROUND: int | None = None
 SESSION_INDICATOR: Literal["FP1", "FP2", "FP3", "Q", "R"] | None = None
 DB_PATH = "f1.duckdb"
+PARTITION_KEYS: tuple[str, ...] = ("Year", "RoundNumber", "Session")
+LAKE_TABLES: tuple[str, ...] = ("car_telemetry", "position_telemetry", "merged_telemetry")
+LAKE_SLUG_SQL = "regexp_replace(EventName, '[^A-Za-z0-9]+', '_', 'g')"
+DEFAULT_WORKERS: int = min(4, os.cpu_count() or 1)
 SESSION_TYPES: tuple[Literal["FP1", "FP2", "FP3", "Q", "R"], ...] = (
     "FP1",
     "FP2",
@@ -21,41 +31,229 @@ SESSION_TYPES: tuple[Literal["FP1", "FP2", "FP3", "Q", "R"], ...] = (
 )
 
 
-def _normalize_for_duckdb(df: pd.DataFrame) -> pd.DataFrame:
-    """Convert columns to DuckDB-friendly types."""
-    out = df.copy()
-    for col in out.columns:
-        series = out[col]
+def _normalize_for_duckdb(df: pd.DataFrame) -> pa.Table:
+    """Convert a frame to an Arrow table with DuckDB-friendly column types.
+
+    Every conversion is a whole-column cast; numeric and datetime columns
+    are handed to Arrow without copying, and DuckDB scans the result directly.
+    """
+    arrays = []
+    for col in df.columns:
+        series = df[col]
         if pd.api.types.is_timedelta64_dtype(series):
-            out[col] = series.dt.total_seconds()
+            array = pa.array(series.dt.total_seconds(), from_pandas=True)
         elif pd.api.types.is_bool_dtype(series):
-            out[col] = series.astype("Int64")
+            array = pa.array(series, from_pandas=True).cast(pa.int64())
         elif pd.api.types.is_object_dtype(series):
-            out[col] = series.map(
-                lambda value: (
-                    value.total_seconds()
-                    if isinstance(value, pd.Timedelta)
-                    else value.isoformat()
-                    if isinstance(value, pd.Timestamp)
-                    else None
-                    if pd.isna(value)
-                    else value
-                )
-            )
-    return out
-
-
-def _write_tables_to_duckdb(tables: dict[str, pd.DataFrame], db_path: str = DB_PATH) -> None:
-    """Write tables to DuckDB using native DuckDB SQL for speed and safety."""
+            array = _normalize_object_column(series)
+        else:
+            array = pa.array(series, from_pandas=True)
+        if pa.types.is_dictionary(array.type):
+            # Categoricals would become DuckDB ENUMs; store their values instead
+            array = array.cast(array.type.value_type)
+        arrays.append(array)
+    return pa.Table.from_arrays(arrays, names=[str(col) for col in df.columns])
+
+
+def _normalize_object_column(series: pd.Series) -> pa.Array:
+    """Timedeltas become seconds, timestamps ISO-8601 strings, NaN/None NULL."""
+    kind = pd.api.types.infer_dtype(series, skipna=True)
+    if kind in ("timedelta", "timedelta64"):
+        return pa.array(pd.to_timedelta(series).dt.total_seconds(), from_pandas=True)
+    if kind in ("datetime", "datetime64"):
+        iso = series.astype(str).str.replace(" ", "T", n=1, regex=False)
+        return pa.array(iso.where(series.notna(), None), from_pandas=True)
+    try:
+        return pa.array(series, from_pandas=True)
+    except (pa.ArrowInvalid, pa.ArrowTypeError):
+        # Mixed Python types in one column: fall back to text
+        return pa.array(series.astype(str).where(series.notna(), None), from_pandas=True)
+
+
+# Position samples with the latest car sample at or before each one, filtered
+# and clamped exactly as the replay backend's loader does, so readers can
+# range-scan instead of re-running the ASOF JOIN on every open.
+MERGED_TELEMETRY_SQL = """
+    SELECT p.Year, p.RoundNumber, p.Session, p.EventName,
+           CAST(p.DriverNumber AS VARCHAR) AS DriverNumber,
+           CAST(p.SessionTime AS DOUBLE) AS SessionTime,
+           CAST(p.X AS FLOAT) AS X,
+           CAST(p.Y AS FLOAT) AS Y,
+           CAST(COALESCE(c.Speed, 0) AS FLOAT) AS Speed,
+           CAST(LEAST(GREATEST(CAST(COALESCE(c.nGear, 0) AS INTEGER), 0), 8) AS UTINYINT) AS nGear,
+           LEAST(GREATEST(CAST(COALESCE(c.Throttle, 0) AS FLOAT), 0), 1) AS Throttle,
+           LEAST(GREATEST(CAST(COALESCE(c.Brake, 0) AS FLOAT), 0), 1) AS Brake,
+           CAST(LEAST(GREATEST(CAST(COALESCE(c.DRS, 0) AS INTEGER), 0), 255) AS UTINYINT) AS DRS
+    FROM position_telemetry p
+    ASOF JOIN car_telemetry c
+        ON  p.DriverNumber = c.DriverNumber
+        AND p.SessionTime >= c.SessionTime
+    WHERE p.X != 0 AND p.Y != 0
+    ORDER BY p.DriverNumber, p.SessionTime
+"""
+
+
+def _merge_telemetry(position: pa.Table, car: pa.Table) -> pa.Table:
+    """Join one session's position and car telemetry into merged_telemetry rows."""
+    con = duckdb.connect()
+    try:
+        con.register("position_telemetry", position)
+        con.register("car_telemetry", car)
+        return con.execute(MERGED_TELEMETRY_SQL).fetch_arrow_table()
+    finally:
+        con.close()
+
+
+def _table_exists(con: duckdb.DuckDBPyConnection, table_name: str) -> bool:
+    return (
+        con.execute(
+            "SELECT COUNT(*) FROM information_schema.tables WHERE table_name = ?",
+            [table_name],
+        ).fetchone()[0]
+        > 0
+    )
+
+
+def _add_missing_columns(con: duckdb.DuckDBPyConnection, table_name: str) -> None:
+    """Widen `table_name` with any columns of `tmp_df` it does not have yet."""
+    existing = {row[0] for row in con.execute(f"DESCRIBE {table_name}").fetchall()}
+    for name, column_type, *_ in con.execute("DESCRIBE tmp_df").fetchall():
+        if name not in existing:
+            con.execute(f'ALTER TABLE {table_name} ADD COLUMN "{name}" {column_type}')
+
+
+def _lake_dir(db_path: str) -> Path:
+    """Parquet telemetry lake next to the database (`f1.duckdb` -> `f1.lake/`)."""
+    return Path(db_path).with_suffix(".lake")
+
+
+def _partition_slug(value: str) -> str:
+    """Same slug as `LAKE_SLUG_SQL` and the replay backend's `partition_slug`."""
+    return re.sub(r"[^A-Za-z0-9]+", "_", value)
+
+
+def _write_lake_table(con: duckdb.DuckDBPyConnection, table_name: str, lake_dir: Path) -> None:
+    """Replace this batch's sessions of `table_name` in the Parquet lake.
+
+    Layout is `<table>/year=/event=/session=/driver=/`, zstd-compressed and
+    sorted by SessionTime within each driver. The partition columns stand in
+    for Year, Session and DriverNumber, which are not stored in the files.
+    """
+    table_dir = lake_dir / table_name
+    sessions = con.execute(
+        f"SELECT DISTINCT Year, {LAKE_SLUG_SQL} AS event, Session FROM tmp_df"
+    ).fetchall()
+    for year, event, session in sessions:
+        shutil.rmtree(
+            table_dir / f"year={year}" / f"event={event}" / f"session={_partition_slug(session)}",
+            ignore_errors=True,
+        )
+
+    target = str(table_dir).replace("'", "''")
+    con.execute(
+        f"""
+        COPY (
+            SELECT * EXCLUDE (Year, Session, DriverNumber),
+                   Year AS year,
+                   {LAKE_SLUG_SQL} AS event,
+                   regexp_replace(Session, '[^A-Za-z0-9]+', '_', 'g') AS session,
+                   DriverNumber AS driver
+            FROM tmp_df
+            ORDER BY driver, SessionTime
+        ) TO '{target}' (
+            FORMAT PARQUET,
+            COMPRESSION ZSTD,
+            PARTITION_BY (year, event, session, driver),
+            OVERWRITE_OR_IGNORE
+        )
+        """
+    )
+
+    # The lake is now the copy the backend reads; drop stale table rows
+    if _table_exists(con, table_name):
+        con.execute(
+            f"DELETE FROM {table_name} USING (SELECT DISTINCT Year, RoundNumber, Session FROM tmp_df) k "
+            f"WHERE {table_name}.Year = k.Year AND {table_name}.RoundNumber = k.RoundNumber "
+            f"AND {table_name}.Session = k.Session"
+        )
+
+
+def _write_tables_to_duckdb(
+    tables: dict[str, pa.Table],
+    db_path: str = DB_PATH,
+    telemetry_lake: bool = False,
+) -> None:
+    """Upsert tables into DuckDB, replacing only the partitions present in each frame.
+
+    Rows are partitioned by whichever of PARTITION_KEYS a table carries
+    (Year, RoundNumber, Session for per-session tables; Year for the
+    schedule). Existing rows in those partitions are deleted and the new
+    rows inserted; every other partition is untouched. All tables of a call
+    are written in one transaction, so a session is only listed in
+    `sessions` (what `_ingested_sessions` skips on) once all of its tables
+    are in. Tables come from `_normalize_for_duckdb`. With `telemetry_lake`,
+    the LAKE_TABLES go to Parquet under `_lake_dir(db_path)` instead; those
+    files are written before the commit, so a failed run leaves the session
+    unlisted and the next run rewrites them.
+    """
     con = duckdb.connect(db_path)
-    for table_name, dataframe in tables.items():
-        if dataframe.empty:
-            continue  # skip empty tables
-        df = _normalize_for_duckdb(dataframe)
-        con.execute(f"DROP TABLE IF EXISTS {table_name}")
-        con.register("tmp_df", df)
+    con.execute("BEGIN TRANSACTION")
+    try:
+        for table_name, table in tables.items():
+            if table.num_rows == 0:
+                continue  # skip empty tables
+            con.register("tmp_df", table)
+            try:
+                _write_table(con, table_name, table, db_path, telemetry_lake)
+            finally:
+                con.unregister("tmp_df")
+        con.execute("COMMIT")
+    except Exception:
+        con.execute("ROLLBACK")
+        raise
+    finally:
+        con.close()
+
+
+def _write_table(
+    con: duckdb.DuckDBPyConnection,
+    table_name: str,
+    table: pa.Table,
+    db_path: str,
+    telemetry_lake: bool,
+) -> None:
+    """Write the registered `tmp_df` into `table_name` (see `_write_tables_to_duckdb`)."""
+    if telemetry_lake and table_name in LAKE_TABLES:
+        _write_lake_table(con, table_name, _lake_dir(db_path))
+        return
+    if not _table_exists(con, table_name):
         con.execute(f"CREATE TABLE {table_name} AS SELECT * FROM tmp_df")
-    con.close()
+        return
+
+    _add_missing_columns(con, table_name)
+    keys = [k for k in PARTITION_KEYS if k in table.column_names]
+    if keys:
+        key_list = ", ".join(keys)
+        match = " AND ".join(f"{table_name}.{k} = k.{k}" for k in keys)
+        con.execute(
+            f"DELETE FROM {table_name} "
+            f"USING (SELECT DISTINCT {key_list} FROM tmp_df) k WHERE {match}"
+        )
+    con.execute(f"INSERT INTO {table_name} BY NAME SELECT * FROM tmp_df")
+
+
+def _ingested_sessions(db_path: str, year: int) -> set[tuple[int, str]]:
+    """(RoundNumber, Session) pairs of `year` already present in the database."""
+    con = duckdb.connect(db_path)
+    try:
+        if not _table_exists(con, "sessions"):
+            return set()
+        rows = con.execute(
+            "SELECT DISTINCT RoundNumber, Session FROM sessions WHERE Year = ?", [year]
+        ).fetchall()
+        return {(int(round_number), str(session)) for round_number, session in rows}
+    finally:
+        con.close()
 
 
 def _build_lap_features(session_laps: pd.DataFrame) -> pd.DataFrame:
@@ -101,11 +299,135 @@ def _build_driver_stints(session_laps: pd.DataFrame) -> pd.DataFrame:
     return stints
 
 
+def _load_session_tables(
+    year: int,
+    round_number: int,
+    session_type: Literal["FP1", "FP2", "FP3", "Q", "R"],
+) -> dict[str, pa.Table] | None:
+    """Load one session from FastF1 and return its normalised tables.
+
+    Runs in a worker process; the frames it returns are the only copy of
+    the session held by the parent. Includes `merged_telemetry`, built here
+    so the join runs in parallel across workers.
+    """
+    try:
+        session = fastf1.get_session(year, round_number, session_type)
+        session.load(laps=True, telemetry=True, weather=True, messages=True)
+    except Exception as error:
+        print(f"Skipping {year} R{round_number} {session_type}: {error}")
+        return None
+
+    tables: dict[str, list[pd.DataFrame]] = defaultdict(list)
+
+    context = {
+        "Year": year,
+        "RoundNumber": int(round_number),
+        "Session": session_type,
+        "EventName": session.event.EventName,
+        "EventDate": session.event.EventDate,
+        "Country": session.event.Country,
+        "Location": session.event.Location,
+    }
+
+    session_meta = pd.DataFrame(
+        [
+            {
+                **context,
+                "SessionName": session.name,
+                "ApiPath": getattr(session, "api_path", ""),
+                "F1ApiSupport": int(bool(session.f1_api_support)),
+                "Date": session.date,
+            }
+        ]
+    )
+    tables["sessions"].append(session_meta)
+
+    if not session.results.empty:
+        results = session.results.copy()
+        for k, v in context.items():
+            results[k] = v
+        tables["session_results"].append(results)
+
+    if not session.laps.empty:
+        laps = session.laps.copy()
+        for k, v in context.items():
+            laps[k] = v
+        tables["laps"].append(laps)
+        tables["lap_features"].append(_build_lap_features(laps))
+        tables["driver_stints"].append(_build_driver_stints(laps))
+
+    if not session.weather_data.empty:
+        weather = session.weather_data.copy()
+        for k, v in context.items():
+            weather[k] = v
+        tables["weather"].append(weather)
+
+    if not session.track_status.empty:
+        track_status = session.track_status.copy()
+        for k, v in context.items():
+            track_status[k] = v
+        tables["track_status"].append(track_status)
+
+    if not session.session_status.empty:
+        session_status = session.session_status.copy()
+        for k, v in context.items():
+            session_status[k] = v
+        tables["session_status"].append(session_status)
+
+    if not session.race_control_messages.empty:
+        race_control = session.race_control_messages.copy()
+        for k, v in context.items():
+            race_control[k] = v
+        tables["race_control_messages"].append(race_control)
+
+    for driver_number, car_df in session.car_data.items():
+        if car_df.empty:
+            continue
+        car_data = car_df.copy()
+        car_data["DriverNumber"] = str(driver_number)
+        for k, v in context.items():
+            car_data[k] = v
+        tables["car_telemetry"].append(car_data)
+
+    for driver_number, pos_df in session.pos_data.items():
+        if pos_df.empty:
+            continue
+        position_data = pos_df.copy()
+        position_data["DriverNumber"] = str(driver_number)
+        for k, v in context.items():
+            position_data[k] = v
+        tables["position_telemetry"].append(position_data)
+
+    normalized = {
+        table_name: _normalize_for_duckdb(
+            pd.concat([f for f in frames if not f.empty], ignore_index=True)
+        )
+        for table_name, frames in tables.items()
+        if any(not f.empty for f in frames)
+    }
+    if "position_telemetry" in normalized and "car_telemetry" in normalized:
+        normalized["merged_telemetry"] = _merge_telemetry(
+            normalized["position_telemetry"], normalized["car_telemetry"]
+        )
+    return normalized
+
+
 def ingest_fastf1_data(
     year: int,
     gp_round: int | None = None,
     session_indicator: Literal["FP1", "FP2", "FP3", "Q", "R"] | None = None,
-) -> dict[str, pd.DataFrame]:
+    skip_sessions: set[tuple[int, str]] | None = None,
+    db_path: str = DB_PATH,
+    workers: int = DEFAULT_WORKERS,
+    telemetry_lake: bool = False,
+) -> dict[str, int]:
+    """Ingest sessions into `db_path` and return rows written per table.
+
+    Sessions load concurrently in up to `workers` processes. No more than
+    `workers` sessions are in flight at once, and each finished session is
+    written to DuckDB and released before the next one is submitted. Peak
+    memory therefore stays around one session per worker, not one season.
+    """
     schedule = fastf1.get_event_schedule(year, include_testing=False).copy()
     rounds = (
         [int(gp_round)]
@@ -116,104 +438,49 @@ def ingest_fastf1_data(
         [session_indicator] if session_indicator is not None else list(SESSION_TYPES)
     )
 
-    tables: dict[str, list[pd.DataFrame]] = defaultdict(list)
+    row_counts: dict[str, int] = defaultdict(int)
+
+    def flush(tables: dict[str, pa.Table] | None) -> None:
+        if not tables:
+            return
+        _write_tables_to_duckdb(tables, db_path=db_path, telemetry_lake=telemetry_lake)
+        for table_name, table in tables.items():
+            row_counts[table_name] += table.num_rows
+
     schedule["Year"] = year
-    tables["event_schedule"].append(schedule)
+    flush({"event_schedule": _normalize_for_duckdb(schedule)})
 
+    jobs: list[tuple[int, Literal["FP1", "FP2", "FP3", "Q", "R"]]] = []
     for round_number in rounds:
         for session_type in session_types:
-            try:
-                session = fastf1.get_session(year, round_number, session_type)
-                session.load(laps=True, telemetry=True, weather=True, messages=True)
-            except Exception as error:
-                print(f"Skipping {year} R{round_number} {session_type}: {error}")
+            if skip_sessions and (int(round_number), session_type) in skip_sessions:
+                print(f"Already ingested {year} R{round_number} {session_type}; use --force to reload")
                 continue
+            jobs.append((int(round_number), session_type))
 
-            context = {
-                "Year": year,
-                "RoundNumber": int(round_number),
-                "Session": session_type,
-                "EventName": session.event.EventName,
-                "EventDate": session.event.EventDate,
-                "Country": session.event.Country,
-                "Location": session.event.Location,
-            }
+    if workers <= 1:
+        for round_number, session_type in jobs:
+            flush(_load_session_tables(year, round_number, session_type))
+        return dict(row_counts)
 
-            session_meta = pd.DataFrame(
-                [
-                    {
-                        **context,
-                        "SessionName": session.name,
-                        "ApiPath": getattr(session, "api_path", ""),
-                        "F1ApiSupport": int(bool(session.f1_api_support)),
-                        "Date": session.date,
-                    }
-                ]
-            )
-            tables["sessions"].append(session_meta)
-
-            if not session.results.empty:
-                results = session.results.copy()
-                for k, v in context.items():
-                    results[k] = v
-                tables["session_results"].append(results)
-
-            if not session.laps.empty:
-                laps = session.laps.copy()
-                for k, v in context.items():
-                    laps[k] = v
-                tables["laps"].append(laps)
-                tables["lap_features"].append(_build_lap_features(laps))
-                tables["driver_stints"].append(_build_driver_stints(laps))
-
-            if not session.weather_data.empty:
-                weather = session.weather_data.copy()
-                for k, v in context.items():
-                    weather[k] = v
-                tables["weather"].append(weather)
-
-            if not session.track_status.empty:
-                track_status = session.track_status.copy()
-                for k, v in context.items():
-                    track_status[k] = v
-                tables["track_status"].append(track_status)
-
-            if not session.session_status.empty:
-                session_status = session.session_status.copy()
-                for k, v in context.items():
-                    session_status[k] = v
-                tables["session_status"].append(session_status)
-
-            if not session.race_control_messages.empty:
-                race_control = session.race_control_messages.copy()
-                for k, v in context.items():
-                    race_control[k] = v
-                tables["race_control_messages"].append(race_control)
-
-            for driver_number, car_df in session.car_data.items():
-                if car_df.empty:
-                    continue
-                car_data = car_df.copy()
-                car_data["DriverNumber"] = str(driver_number)
-                for k, v in context.items():
-                    car_data[k] = v
-                tables["car_telemetry"].append(car_data)
-
-            for driver_number, pos_df in session.pos_data.items():
-                if pos_df.empty:
-                    continue
-                position_data = pos_df.copy()
-                position_data["DriverNumber"] = str(driver_number)
-                for k, v in context.items():
-                    position_data[k] = v
-                tables["position_telemetry"].append(position_data)
-
-    return {
-        table_name: pd.concat([f for f in frames if not f.empty], ignore_index=True)
-        if frames
-        else pd.DataFrame()
-        for table_name, frames in tables.items()
-    }
+    pending_jobs = iter(jobs)
+    with ProcessPoolExecutor(max_workers=workers) as pool:
+
+        def submit_next(in_flight: set[Future]) -> None:
+            job = next(pending_jobs, None)
+            if job is not None:
+                in_flight.add(pool.submit(_load_session_tables, year, *job))
+
+        in_flight: set[Future] = set()
+        for _ in range(workers):
+            submit_next(in_flight)
+        while in_flight:
+            done, in_flight = wait(in_flight, return_when=FIRST_COMPLETED)
+            for future in done:
+                flush(future.result())
+                submit_next(in_flight)
+
+    return dict(row_counts)
 
 
 def parse_args() -> argparse.Namespace:
@@ -241,18 +508,37 @@ def parse_args() -> argparse.Namespace:
         help="Ignore --session and ingest FP1/FP2/FP3/Q/R",
     )
     parser.add_argument("--db-path", default=DB_PATH, help="DuckDB database path")
+    parser.add_argument(
+        "--workers",
+        type=int,
+        default=DEFAULT_WORKERS,
+        help="Sessions to load in parallel (1 loads serially in-process)",
+    )
+    parser.add_argument(
+        "--telemetry-lake",
+        action="store_true",
+        help="Write car/position telemetry to a Hive-partitioned Parquet lake next to the database",
+    )
+    parser.add_argument(
+        "--force",
+        action="store_true",
+        help="Re-ingest sessions that are already in the database",
+    )
     return parser.parse_args()
 
 
 if __name__ == "__main__":
     args = parse_args()
     session_indicator = None if args.all_sessions else args.session_indicator
-    data = ingest_fastf1_data(
+    row_counts = ingest_fastf1_data(
         year=args.year,
         gp_round=args.gp_round,
         session_indicator=session_indicator,
+        skip_sessions=None if args.force else _ingested_sessions(args.db_path, args.year),
+        db_path=args.db_path,
+        workers=args.workers,
+        telemetry_lake=args.telemetry_lake,
     )
-    _write_tables_to_duckdb(data, db_path=args.db_path)
     print("Ingestion complete.")
-    for table_name, df in data.items():
-        print(f"{table_name}: {len(df):,} rows")
+    for table_name, rows in row_counts.items():
+        print(f"{table_name}: {rows:,} rows")
@@ -1,9 +1,73 @@
+import re
+from pathlib import Path
+
 import duckdb
 import pandas as pd
 import numpy as np
 import plotly.graph_objects as go
 
-conn = duckdb.connect("f1.duckdb")
+DB_PATH = "f1.duckdb"
+EVENT_NAME = "Las Vegas Grand Prix"
+SESSION = "R"
+
+conn = duckdb.connect(DB_PATH)
+PARAMS = {"event": EVENT_NAME, "session": SESSION}
+
+
+def _slug(value: str) -> str:
+    """Lake partition slug; same as `main._partition_slug`."""
+    return re.sub(r"[^A-Za-z0-9]+", "_", value)
+
+
+def _lake_relation(table: str) -> str | None:
+    """This session's partitions of `table` in the Parquet lake, if present."""
+    session_dir = f"event={_slug(EVENT_NAME)}/session={_slug(SESSION)}"
+    root = Path(DB_PATH).with_suffix(".lake") / table
+    if not any(root.glob(f"year=*/{session_dir}")):
+        return None
+    glob = str(root / "year=*" / session_dir / "driver=*" / "*.parquet").replace("'", "''")
+    return f"""(
+        SELECT * EXCLUDE (year, event, session, driver),
+               CAST(session AS VARCHAR) AS Session,
+               CAST(driver AS VARCHAR) AS DriverNumber
+        FROM read_parquet('{glob}', hive_partitioning = true))"""
+
+
+def _table_has_session(table: str) -> bool:
+    exists = conn.execute(
+        "SELECT COUNT(*) FROM information_schema.tables WHERE table_name = ?", [table]
+    ).fetchone()[0]
+    return exists > 0 and conn.execute(
+        f"SELECT COUNT(*) FROM (SELECT 1 FROM {table} WHERE EventName = ? AND Session = ? LIMIT 1)",
+        [EVENT_NAME, SESSION],
+    ).fetchone()[0] > 0
+
+
+def telemetry_relation() -> str:
+    """Merged telemetry for the session, wherever ingest put it.
+
+    Prefers materialised `merged_telemetry` (lake, then table). Databases
+    ingested before it existed fall back to joining position and car
+    telemetry, read from the lake when `--telemetry-lake` was used.
+    """
+    merged = _lake_relation("merged_telemetry")
+    if merged is None and _table_has_session("merged_telemetry"):
+        merged = "merged_telemetry"
+    if merged is not None:
+        return merged
+    position = _lake_relation("position_telemetry") or "position_telemetry"
+    car = _lake_relation("car_telemetry") or "car_telemetry"
+    return f"""(
+        SELECT p.EventName, p.Session, p.DriverNumber, p.SessionTime, p.X, p.Y,
+               c.Speed, c.nGear, c.DRS
+        FROM {position} p
+        ASOF JOIN {car} c
+            ON  p.DriverNumber = c.DriverNumber
+            AND p.EventName    = c.EventName
+            AND p.Session      = c.Session
+            AND p.SessionTime >= c.SessionTime
+        WHERE p.X != 0 AND p.Y != 0)"""
+
 
 # Official 2024 team colors
 TEAM_COLORS = {
@@ -21,12 +85,12 @@ TEAM_COLORS = {
 
 # ── Load driver info ──────────────────────────────────────────────────────────
 print("Loading data...")
-drivers_df = conn.query("""
+drivers_df = conn.execute("""
     SELECT DISTINCT DriverNumber, Driver, Team
     FROM laps
-    WHERE EventName = 'Las Vegas Grand Prix' AND Session = 'R'
+    WHERE EventName = $event AND Session = $session
     ORDER BY CAST(DriverNumber AS INT)
-""").df()
+""", PARAMS).df()
 
 driver_map = {
     str(r.DriverNumber): {
@@ -39,48 +103,38 @@ driver_map = {
 all_drivers = sorted(driver_map, key=lambda x: int(x))
 
 # ── Speed heatmap (background) ────────────────────────────────────────────────
-heatmap_df = conn.query("""
+TELEMETRY = telemetry_relation()
+
+heatmap_df = conn.execute(f"""
     SELECT
-        ROUND(p.X / 50) * 50  AS XBin,
-        ROUND(p.Y / 50) * 50  AS YBin,
-        AVG(c.Speed)           AS AvgSpeed,
-        COUNT(*)               AS n
-    FROM position_telemetry p
-    ASOF JOIN car_telemetry c
-        ON  p.DriverNumber = c.DriverNumber
-        AND p.EventName    = c.EventName
-        AND p.Session      = c.Session
-        AND p.SessionTime >= c.SessionTime
-    WHERE p.EventName = 'Las Vegas Grand Prix'
-      AND p.Session   = 'R'
-      AND p.X != 0 AND p.Y != 0
+        ROUND(X / 50) * 50  AS XBin,
+        ROUND(Y / 50) * 50  AS YBin,
+        AVG(Speed)          AS AvgSpeed,
+        COUNT(*)            AS n
+    FROM {TELEMETRY}
+    WHERE EventName = $event
+      AND Session   = $session
     GROUP BY XBin, YBin
     HAVING COUNT(*) > 5
-""").df()
+""", PARAMS).df()
 
 # ── Sampled animation data (10-second buckets) ────────────────────────────────
 SAMPLE = 10
-anim_df = conn.query(f"""
+anim_df = conn.execute(f"""
     SELECT
-        p.DriverNumber,
-        CAST(ROUND(p.SessionTime / {SAMPLE}) * {SAMPLE} AS INT) AS T,
-        arg_max(p.X, p.SessionTime)      AS X,
-        arg_max(p.Y, p.SessionTime)      AS Y,
-        AVG(c.Speed)                     AS Speed,
-        arg_max(c.nGear, c.SessionTime)  AS Gear,
-        arg_max(c.DRS,   c.SessionTime)  AS DRS
-    FROM position_telemetry p
-    ASOF JOIN car_telemetry c
-        ON  p.DriverNumber = c.DriverNumber
-        AND p.EventName    = c.EventName
-        AND p.Session      = c.Session
-        AND p.SessionTime >= c.SessionTime
-    WHERE p.EventName = 'Las Vegas Grand Prix'
-      AND p.Session   = 'R'
-      AND p.X != 0 AND p.Y != 0
-    GROUP BY p.DriverNumber, T
-    ORDER BY T, p.DriverNumber
-""").df()
+        DriverNumber,
+        CAST(ROUND(SessionTime / {SAMPLE}) * {SAMPLE} AS INT) AS T,
+        arg_max(X, SessionTime)      AS X,
+        arg_max(Y, SessionTime)      AS Y,
+        AVG(Speed)                   AS Speed,
+        arg_max(nGear, SessionTime)  AS Gear,
+        arg_max(DRS,   SessionTime)  AS DRS
+    FROM {TELEMETRY}
+    WHERE EventName = $event
+      AND Session   = $session
+    GROUP BY DriverNumber, T
+    ORDER BY T, DriverNumber
+""", PARAMS).df()
 
 print(f"  {anim_df.T.nunique()} animation frames, {len(heatmap_df)} heatmap cells")
 